@@ -0,0 +1,581 @@
+/*!
+ * \file allocProfiler.cpp
+ * \brief This file is used to profile allocation sites with
+ *        JVMTI SampledObjectAlloc event.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include <jvmti.h>
+#include <jni.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "globals.hpp"
+#include "vmFunctions.hpp"
+#include "util.hpp"
+#include "oopUtil.hpp"
+#include "sorter.hpp"
+#include "callbackRegister.hpp"
+#include "allocProfiler.hpp"
+
+#if PROCESSOR_ARCH == X86
+#include "arch/x86/lock.inline.hpp"
+#elif PROCESSOR_ARCH == ARM
+#include "arch/arm/lock.inline.hpp"
+#endif
+
+/* Class static variables. */
+
+/*!
+ * \brief Singleton instance of TAllocationProfiler.
+ */
+TAllocationProfiler *TAllocationProfiler::inst = NULL;
+
+/* Common methods. */
+
+/*!
+ * \brief Comparator of sampled bytes in current interval for TSorter.
+ * \param arg1 [in] Target of comparison.
+ * \param arg2 [in] Target of comparison.
+ * \return Difference of arg1 and arg2.
+ */
+int AllocSiteBytesCmp(const void *arg1, const void *arg2) {
+  jlong cmp = ((TAllocSiteStat *)arg2)->intervalBytes -
+              ((TAllocSiteStat *)arg1)->intervalBytes;
+  if (cmp > 0) {
+    /* arg2 is bigger than arg1. */
+    return -1;
+  } else if (cmp < 0) {
+    /* arg1 is bigger than arg2. */
+    return 1;
+  } else {
+    /* arg2 is equal arg1. */
+    return 0;
+  }
+}
+
+/*!
+ * \brief Calculate hash value of TAllocStackTrace.
+ * \param trace [in] Stack trace of allocation site.
+ * \return Hash value.
+ */
+size_t TAllocStackTraceHasher::operator()(
+    const TAllocStackTrace &trace) const {
+  size_t hash = trace.depth;
+
+  for (int idx = 0; idx < trace.depth; idx++) {
+    hash = hash * 31 + ((size_t)trace.frames[idx] >> 3);
+  }
+
+  return hash;
+}
+
+/*!
+ * \brief Compare TAllocStackTrace.
+ * \param trace1 [in] Stack trace of allocation site.
+ * \param trace2 [in] Stack trace of allocation site.
+ * \return true if both stack traces are same.
+ */
+bool TAllocStackTraceEqual::operator()(const TAllocStackTrace &trace1,
+                                       const TAllocStackTrace &trace2) const {
+  return (trace1.depth == trace2.depth) &&
+         (memcmp(trace1.frames, trace2.frames,
+                 sizeof(jmethodID) * trace1.depth) == 0);
+}
+
+/*!
+ * \brief Calculate hash value of TAllocSiteKey.
+ * \param key [in] Key of allocation site.
+ * \return Hash value.
+ */
+size_t TAllocSiteKeyHasher::operator()(const TAllocSiteKey &key) const {
+  return ((size_t)key.klassOop >> 3) * 31 + key.stackId;
+}
+
+/*!
+ * \brief Compare TAllocSiteKey.
+ * \param key1 [in] Key of allocation site.
+ * \param key2 [in] Key of allocation site.
+ * \return true if both keys are same.
+ */
+bool TAllocSiteKeyEqual::operator()(const TAllocSiteKey &key1,
+                                    const TAllocSiteKey &key2) const {
+  return (key1.klassOop == key2.klassOop) && (key1.stackId == key2.stackId);
+}
+
+/*!
+ * \brief Event handler of JVMTI SampledObjectAlloc for allocation profiler.
+ * \param jvmti  [in] JVMTI environment.
+ * \param env    [in] JNI environment of the event (current) thread.
+ * \param thread [in] JNI local reference to the allocating thread.
+ * \param object [in] JNI local reference to the sampled object.
+ * \param klass  [in] JNI local reference to the class of the object.
+ * \param size   [in] Size of the object in bytes.
+ */
+void JNICALL OnSampledObjectAllocForProfile(jvmtiEnv *jvmti, JNIEnv *env,
+                                            jthread thread, jobject object,
+                                            jclass klass, jlong size) {
+  TAllocationProfiler::getInstance()->sample(jvmti, env, thread, object,
+                                             size);
+}
+
+/* Class methods. */
+
+/*!
+ * \brief Global initialization.
+ * \param depth    [in] Number of frames which are recorded at each sample.
+ * \param interval [in] Average interval of sampling in bytes.
+ * \return Process result.
+ * \warning Please call only once from main thread.
+ */
+bool TAllocationProfiler::globalInitialize(int depth, int interval) {
+  try {
+    inst = new TAllocationProfiler(depth, interval);
+  } catch (...) {
+    logger->printCritMsg("Cannot initialize TAllocationProfiler.");
+    return false;
+  }
+
+  return true;
+}
+
+/*!
+ * \brief Global finalization.
+ */
+void TAllocationProfiler::globalFinalize(void) {
+  delete inst;
+  inst = NULL;
+}
+
+/*!
+ * \brief TAllocationProfiler constructor.
+ * \param depth    [in] Number of frames which are recorded at each sample.
+ * \param interval [in] Average interval of sampling in bytes.
+ */
+TAllocationProfiler::TAllocationProfiler(int depth, int interval)
+    : stackDepth(depth),
+      samplingInterval(interval),
+      lockVal(0),
+      stacks(),
+      stackRefs(),
+      freeStacks(),
+      stackIndex(),
+      sites() {
+  memset(&overflow, 0, sizeof(TAllocSiteStat));
+  overflow.key.stackId = ALLOC_PROFILE_UNKNOWN_STACK;
+
+  /* Released stack IDs are pushed in spinlock without allocation. */
+  freeStacks.reserve(ALLOC_PROFILE_MAX_STACKS);
+}
+
+/*!
+ * \brief TAllocationProfiler destructor.
+ */
+TAllocationProfiler::~TAllocationProfiler() { /* Do Nothing. */ }
+
+/*!
+ * \brief Setting JVMTI capabilities and callback for allocation profiler.
+ * \param jvmti        [in]  JVMTI environment.
+ * \param capabilities [out] Capabilities to merge.
+ * \return true if running JVM supports SampledObjectAlloc event.
+ */
+bool TAllocationProfiler::setCapabilities(jvmtiEnv *jvmti,
+                                          jvmtiCapabilities *capabilities) {
+#ifdef HAVE_SAMPLED_OBJECT_ALLOC
+  jvmtiCapabilities potentials = {0};
+
+  /* SampledObjectAlloc is available since JDK 11. */
+  if (isError(jvmti, jvmti->GetPotentialCapabilities(&potentials)) ||
+      !potentials.can_generate_sampled_object_alloc_events) {
+    logger->printWarnMsg(
+        "SampledObjectAlloc event is not supported by this JVM.");
+    return false;
+  }
+
+  TSampledObjectAllocCallback::mergeCapabilities(capabilities);
+  TSampledObjectAllocCallback::registerCallback(
+      &OnSampledObjectAllocForProfile);
+  return true;
+#else
+  logger->printWarnMsg(
+      "HeapStats was built without SampledObjectAlloc event support.");
+  return false;
+#endif
+}
+
+/*!
+ * \brief Switch SampledObjectAlloc event notification.
+ * \param jvmti  [in] JVMTI environment.
+ * \param enable [in] Event notification is enable.
+ */
+void TAllocationProfiler::switchEventNotification(jvmtiEnv *jvmti,
+                                                  bool enable) {
+#ifdef HAVE_SAMPLED_OBJECT_ALLOC
+  if (enable &&
+      isError(jvmti, jvmti->SetHeapSamplingInterval(samplingInterval))) {
+    logger->printWarnMsg("Couldn't set heap sampling interval.");
+  }
+
+  TSampledObjectAllocCallback::switchEventNotification(
+      jvmti, enable ? JVMTI_ENABLE : JVMTI_DISABLE);
+#endif
+}
+
+/*!
+ * \brief Get ID of the stack trace.<br>
+ *        The stack trace is added to stack table if it does not exist.
+ * \param trace [in] Stack trace of allocation site.
+ * \return Stack ID. ALLOC_PROFILE_UNKNOWN_STACK if stack table is full.
+ * \warning Caller must hold lockVal.
+ */
+int TAllocationProfiler::getStackId(const TAllocStackTrace *trace) {
+  std::tr1::unordered_map<TAllocStackTrace, int, TAllocStackTraceHasher,
+                          TAllocStackTraceEqual>::iterator itr =
+      stackIndex.find(*trace);
+  if (likely(itr != stackIndex.end())) {
+    return itr->second;
+  }
+
+  /* Reuse stack ID which has been released. */
+  if (!freeStacks.empty()) {
+    int stackId = freeStacks.back();
+    try {
+      stackIndex[*trace] = stackId;
+    } catch (...) {
+      /* Maybe failed to allocate memory. */
+      return ALLOC_PROFILE_UNKNOWN_STACK;
+    }
+
+    freeStacks.pop_back();
+    stacks[stackId] = *trace;
+    stackRefs[stackId] = 0;
+    return stackId;
+  }
+
+  if (unlikely(stacks.size() >= ALLOC_PROFILE_MAX_STACKS)) {
+    return ALLOC_PROFILE_UNKNOWN_STACK;
+  }
+
+  int stackId = stacks.size();
+  try {
+    stacks.push_back(*trace);
+    stackRefs.push_back(0);
+    stackIndex[*trace] = stackId;
+  } catch (...) {
+    /* Maybe failed to allocate memory. */
+    if ((int)stacks.size() > stackId) {
+      stacks.pop_back();
+    }
+    if ((int)stackRefs.size() > stackId) {
+      stackRefs.pop_back();
+    }
+    return ALLOC_PROFILE_UNKNOWN_STACK;
+  }
+
+  return stackId;
+}
+
+/*!
+ * \brief Release the stack trace to be reused by other site.
+ * \param stackId [in] Stack ID which is not referred by any site.
+ * \warning Caller must hold lockVal.
+ */
+void TAllocationProfiler::releaseStack(int stackId) {
+  stackIndex.erase(stacks[stackId]);
+  stacks[stackId].depth = 0;
+
+  /* Capacity is reserved, so this never allocates memory. */
+  freeStacks.push_back(stackId);
+}
+
+/*!
+ * \brief Remove the allocation site and release its stack trace.
+ * \param site [in] Allocation site to remove.
+ * \return Next allocation site.
+ * \warning Caller must hold lockVal.
+ */
+TAllocSiteMap::iterator TAllocationProfiler::removeSite(
+    TAllocSiteMap::iterator site) {
+  int stackId = site->first.stackId;
+
+  if ((stackId != ALLOC_PROFILE_UNKNOWN_STACK) &&
+      (--stackRefs[stackId] == 0)) {
+    releaseStack(stackId);
+  }
+
+  return sites.erase(site);
+}
+
+/*!
+ * \brief Account sampled object to its allocation site.
+ * \param jvmti  [in] JVMTI environment.
+ * \param env    [in] JNI environment of current thread.
+ * \param thread [in] Allocating thread.
+ * \param object [in] Sampled object.
+ * \param size   [in] Size of the object in bytes.
+ */
+void TAllocationProfiler::sample(jvmtiEnv *jvmti, JNIEnv *env,
+                                 jthread thread, jobject object,
+                                 jlong size) {
+  TAllocStackTrace trace;
+  trace.depth = 0;
+
+  /* Stack trace is taken before locking to keep critical section short. */
+  if (stackDepth > 0) {
+    jvmtiFrameInfo frames[ALLOC_PROFILE_MAX_DEPTH];
+    jint count = 0;
+
+    if (likely(!isError(jvmti, jvmti->GetStackTrace(thread, 0, stackDepth,
+                                                    frames, &count)))) {
+      TVMFunctions *vmFunc = TVMFunctions::getInstance();
+
+      for (int idx = 0; idx < count; idx++) {
+        jclass declaringClass = NULL;
+        trace.frames[idx] = frames[idx].method;
+        trace.frameKlassOops[idx] = NULL;
+
+        /* Declaring class is needed to remove the site at class unloading. */
+        if (likely(!isError(jvmti, jvmti->GetMethodDeclaringClass(
+                                       frames[idx].method, &declaringClass)))) {
+          trace.frameKlassOops[idx] =
+              vmFunc->AsKlassOop(*(void **)declaringClass);
+          env->DeleteLocalRef(declaringClass);
+        }
+      }
+      trace.depth = count;
+    }
+  }
+
+  TAllocSiteKey key;
+  key.klassOop = getKlassOopFromOop(*(void **)object);
+
+  spinLockWait(&lockVal);
+  {
+    key.stackId = getStackId(&trace);
+
+    TAllocSiteStat *stat = &overflow;
+    try {
+      TAllocSiteMap::iterator itr = sites.find(key);
+
+      if (likely(itr != sites.end())) {
+        stat = &itr->second;
+      } else if (sites.size() < ALLOC_PROFILE_MAX_SITES) {
+        stat = &sites[key];
+        memset(stat, 0, sizeof(TAllocSiteStat));
+        stat->key = key;
+
+        if (key.stackId != ALLOC_PROFILE_UNKNOWN_STACK) {
+          stackRefs[key.stackId]++;
+        }
+      }
+    } catch (...) {
+      /* Maybe failed to allocate memory. Account to overflow. */
+    }
+
+    /* New stack trace which is not referred by any site. */
+    if (unlikely((stat == &overflow) &&
+                 (key.stackId != ALLOC_PROFILE_UNKNOWN_STACK) &&
+                 (stackRefs[key.stackId] == 0))) {
+      releaseStack(key.stackId);
+    }
+
+    stat->count++;
+    stat->bytes += size;
+    stat->intervalCount++;
+    stat->intervalBytes += size;
+  }
+  spinLockRelease(&lockVal);
+}
+
+/*!
+ * \brief Remove allocation sites which refer the unloaded class.<br>
+ *        Address of the class and jmethodIDs of its methods might be
+ *        reused by other class.
+ * \param klassOop [in] Unloaded class.
+ */
+void TAllocationProfiler::removeClass(void *klassOop) {
+  spinLockWait(&lockVal);
+  {
+    TAllocSiteMap::iterator itr = sites.begin();
+
+    while (itr != sites.end()) {
+      bool isReferred = (itr->first.klassOop == klassOop);
+      int stackId = itr->first.stackId;
+
+      if (!isReferred && (stackId != ALLOC_PROFILE_UNKNOWN_STACK)) {
+        TAllocStackTrace *trace = &stacks[stackId];
+        for (int idx = 0; idx < trace->depth; idx++) {
+          if (trace->frameKlassOops[idx] == klassOop) {
+            isReferred = true;
+            break;
+          }
+        }
+      }
+
+      if (isReferred) {
+        itr = removeSite(itr);
+      } else {
+        itr++;
+      }
+    }
+  }
+  spinLockRelease(&lockVal);
+}
+
+/*!
+ * \brief Format the frame as "Lfoo/Bar;.method" .
+ * \param jvmti  [in]  JVMTI environment.
+ * \param env    [in]  JNI environment.
+ * \param method [in]  Method ID of the frame.
+ * \param buf    [out] Buffer to store string.
+ * \param len    [in]  Length of buf.
+ */
+void TAllocationProfiler::getFrameName(jvmtiEnv *jvmti, JNIEnv *env,
+                                       jmethodID method, char *buf,
+                                       size_t len) {
+  jvmtiFrameInfo frame = {method, 0};
+  TJavaStackMethodInfo info;
+  getMethodFrameInfo(jvmti, env, frame, &info);
+
+  snprintf(buf, len, "%s.%s",
+           (info.className == NULL) ? "(unknown)" : info.className,
+           (info.methodName == NULL) ? "(unknown)" : info.methodName);
+
+  free(info.className);
+  free(info.methodName);
+  free(info.sourceFile);
+}
+
+/*!
+ * \brief Output ranking of allocation sites by sampled bytes in
+ *        current interval.<br>
+ *        Sites which are not sampled in the interval are removed to make
+ *        room for new sites.
+ * \param jvmti [in] JVMTI environment.
+ * \param env   [in] JNI environment.
+ * \param rank  [in] Number of allocation sites to output.
+ */
+void TAllocationProfiler::showRanking(jvmtiEnv *jvmti, JNIEnv *env,
+                                      int rank) {
+  TSorter<TAllocSiteStat> *sortArray;
+  try {
+    sortArray =
+        new TSorter<TAllocSiteStat>(rank, (TComparator)&AllocSiteBytesCmp);
+  } catch (...) {
+    logger->printWarnMsg("Couldn't allocate working memory!");
+    return;
+  }
+
+  TAllocStackTrace *traces =
+      (TAllocStackTrace *)malloc(sizeof(TAllocStackTrace) * rank);
+  if (unlikely(traces == NULL)) {
+    logger->printWarnMsg("Couldn't allocate working memory!");
+    delete sortArray;
+    return;
+  }
+
+  int numStacks;
+  spinLockWait(&lockVal);
+  {
+    TAllocSiteMap::iterator itr = sites.begin();
+
+    while (itr != sites.end()) {
+      if (itr->second.intervalCount == 0) {
+        /* Idle site is removed not to fill sites for the life of JVM. */
+        itr = removeSite(itr);
+        continue;
+      }
+
+      sortArray->push(itr->second);
+      itr->second.intervalCount = 0;
+      itr->second.intervalBytes = 0;
+      itr++;
+    }
+
+    if (overflow.intervalCount > 0) {
+      sortArray->push(overflow);
+      overflow.intervalCount = 0;
+      overflow.intervalBytes = 0;
+    }
+
+    numStacks = stacks.size() - freeStacks.size();
+
+    /*
+     * Copy stack traces of ranked sites in this lock, because the stack ID
+     * might be reused after the site is removed by class unloading.
+     */
+    int rankCnt = sortArray->getCount();
+    Node<TAllocSiteStat> *aNode = sortArray->lastNode();
+    for (int Cnt = 0; Cnt < rankCnt && aNode != NULL;
+         Cnt++, aNode = aNode->prev) {
+      int stackId = aNode->value.key.stackId;
+
+      if (stackId == ALLOC_PROFILE_UNKNOWN_STACK) {
+        traces[Cnt].depth = 0;
+      } else {
+        traces[Cnt] = stacks[stackId];
+      }
+    }
+  }
+  spinLockRelease(&lockVal);
+
+  /* Output ranking header. */
+  logger->printInfoMsg(
+      "Allocation Site Ranking (sampling interval: %d bytes, stacks: %d)",
+      samplingInterval, numStacks);
+  logger->printInfoMsg(
+      "Rank    sampled(byte)      total(byte)   samples  Class name");
+  logger->printInfoMsg(
+      "----  ---------------  ---------------  --------  ----------");
+
+  /* Output high-rank allocation site information. */
+  int rankCnt = sortArray->getCount();
+  Node<TAllocSiteStat> *aNode = sortArray->lastNode();
+  for (int Cnt = 0; Cnt < rankCnt && aNode != NULL;
+       Cnt++, aNode = aNode->prev) {
+    TAllocSiteStat *stat = &aNode->value;
+    const char *className = "(others)";
+
+    if (stat->key.klassOop != NULL) {
+      TObjectData *objData = clsContainer->findClass(stat->key.klassOop);
+      className = (objData == NULL) ? "(unknown)" : objData->className;
+    }
+
+#ifdef LP64
+    logger->printInfoMsg("%4d  %15ld  %15ld  %8ld  %s",
+#else
+    logger->printInfoMsg("%4d  %15lld  %15lld  %8lld  %s",
+#endif
+                         Cnt + 1, stat->intervalBytes, stat->bytes,
+                         stat->intervalCount, className);
+
+    for (int idx = 0; idx < traces[Cnt].depth; idx++) {
+      char frameName[1024];
+      getFrameName(jvmti, env, traces[Cnt].frames[idx], frameName,
+                   sizeof(frameName));
+      logger->printInfoMsg("                at %s", frameName);
+    }
+  }
+
+  /* Clean up after ranking output. */
+  logger->flush();
+  free(traces);
+  delete sortArray;
+}
@@ -0,0 +1,307 @@
+/*!
+ * \file allocProfiler.hpp
+ * \brief This file is used to profile allocation sites with
+ *        JVMTI SampledObjectAlloc event.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#ifndef ALLOC_PROFILER_HPP
+#define ALLOC_PROFILER_HPP
+
+#include <jvmti.h>
+#include <jni.h>
+
+#include <vector>
+#include <tr1/unordered_map>
+
+/*!
+ * \brief Max number of stack frames of allocation site.
+ */
+#define ALLOC_PROFILE_MAX_DEPTH 16
+
+/*!
+ * \brief Max number of stack traces in deduplicated stack table.
+ */
+#define ALLOC_PROFILE_MAX_STACKS 65536
+
+/*!
+ * \brief Max number of allocation sites in statistics.
+ */
+#define ALLOC_PROFILE_MAX_SITES 4096
+
+/*!
+ * \brief Stack ID of stack trace which cannot be stored to stack table.
+ */
+#define ALLOC_PROFILE_UNKNOWN_STACK -1
+
+/*!
+ * \brief Stack trace of allocation site.
+ */
+typedef struct {
+  int depth;                                 /*!< Number of stored frames. */
+  jmethodID frames[ALLOC_PROFILE_MAX_DEPTH]; /*!< Top frames of allocating
+                                                  thread.                  */
+  void *frameKlassOops[ALLOC_PROFILE_MAX_DEPTH]; /*!< Declaring classes of
+                                                      frames. They are not
+                                                      compared.            */
+} TAllocStackTrace;
+
+/*!
+ * \brief Key of allocation site.
+ */
+typedef struct {
+  void *klassOop; /*!< Class of sampled object. NULL means "others". */
+  int stackId;    /*!< Index of stack trace in stack table.          */
+} TAllocSiteKey;
+
+/*!
+ * \brief Statistics of allocation site.
+ */
+typedef struct {
+  TAllocSiteKey key;   /*!< Key of this statistics.                   */
+  jlong count;         /*!< Number of samples.                        */
+  jlong bytes;         /*!< Total size of sampled objects.            */
+  jlong intervalCount; /*!< Number of samples in current interval.    */
+  jlong intervalBytes; /*!< Size of sampled objects in current interval. */
+} TAllocSiteStat;
+
+/*!
+ * \brief Hasher of TAllocStackTrace.
+ */
+struct TAllocStackTraceHasher {
+  size_t operator()(const TAllocStackTrace &trace) const;
+};
+
+/*!
+ * \brief Comparator of TAllocStackTrace.
+ */
+struct TAllocStackTraceEqual {
+  bool operator()(const TAllocStackTrace &trace1,
+                  const TAllocStackTrace &trace2) const;
+};
+
+/*!
+ * \brief Hasher of TAllocSiteKey.
+ */
+struct TAllocSiteKeyHasher {
+  size_t operator()(const TAllocSiteKey &key) const;
+};
+
+/*!
+ * \brief Comparator of TAllocSiteKey.
+ */
+struct TAllocSiteKeyEqual {
+  bool operator()(const TAllocSiteKey &key1, const TAllocSiteKey &key2) const;
+};
+
+/*!
+ * \brief Statistics of allocation sites.
+ */
+typedef std::tr1::unordered_map<TAllocSiteKey, TAllocSiteStat,
+                                TAllocSiteKeyHasher, TAllocSiteKeyEqual>
+    TAllocSiteMap;
+
+/*!
+ * \brief Event handler of JVMTI SampledObjectAlloc for allocation profiler.
+ * \param jvmti  [in] JVMTI environment.
+ * \param env    [in] JNI environment of the event (current) thread.
+ * \param thread [in] JNI local reference to the allocating thread.
+ * \param object [in] JNI local reference to the sampled object.
+ * \param klass  [in] JNI local reference to the class of the object.
+ * \param size   [in] Size of the object in bytes.
+ */
+void JNICALL OnSampledObjectAllocForProfile(jvmtiEnv *jvmti, JNIEnv *env,
+                                            jthread thread, jobject object,
+                                            jclass klass, jlong size);
+
+/*!
+ * \brief This class aggregates sampled allocation per class and
+ *        allocation stack.<br>
+ *        Stack traces are deduplicated in a table which is shared by all
+ *        allocation sites, so each site holds only ID of its stack.
+ */
+class TAllocationProfiler {
+ private:
+  /*!
+   * \brief Singleton instance of TAllocationProfiler.
+   */
+  static TAllocationProfiler *inst;
+
+  /*!
+   * \brief Number of frames which are recorded at each sample.
+   */
+  int stackDepth;
+
+  /*!
+   * \brief Average interval of sampling in bytes.
+   */
+  int samplingInterval;
+
+  /*!
+   * \brief SpinLock variable for stack table and statistics.
+   */
+  volatile int lockVal;
+
+  /*!
+   * \brief Deduplicated stack traces. Index of this vector is stack ID.
+   */
+  std::vector<TAllocStackTrace> stacks;
+
+  /*!
+   * \brief Number of sites which refer each stack trace.
+   */
+  std::vector<int> stackRefs;
+
+  /*!
+   * \brief Stack IDs which are not referred by any site. They are reused.
+   */
+  std::vector<int> freeStacks;
+
+  /*!
+   * \brief Index to find stack ID from stack trace.
+   */
+  std::tr1::unordered_map<TAllocStackTrace, int, TAllocStackTraceHasher,
+                          TAllocStackTraceEqual> stackIndex;
+
+  /*!
+   * \brief Statistics of allocation sites.
+   */
+  TAllocSiteMap sites;
+
+  /*!
+   * \brief Statistics which cannot be stored to sites.
+   */
+  TAllocSiteStat overflow;
+
+  /*!
+   * \brief Get ID of the stack trace.<br>
+   *        The stack trace is added to stack table if it does not exist.
+   * \param trace [in] Stack trace of allocation site.
+   * \return Stack ID. ALLOC_PROFILE_UNKNOWN_STACK if stack table is full.
+   * \warning Caller must hold lockVal.
+   */
+  int getStackId(const TAllocStackTrace *trace);
+
+  /*!
+   * \brief Release the stack trace to be reused by other site.
+   * \param stackId [in] Stack ID which is not referred by any site.
+   * \warning Caller must hold lockVal.
+   */
+  void releaseStack(int stackId);
+
+  /*!
+   * \brief Remove the allocation site and release its stack trace.
+   * \param site [in] Allocation site to remove.
+   * \return Next allocation site.
+   * \warning Caller must hold lockVal.
+   */
+  TAllocSiteMap::iterator removeSite(TAllocSiteMap::iterator site);
+
+  /*!
+   * \brief Format the frame as "Lfoo/Bar;.method" .
+   * \param jvmti  [in]  JVMTI environment.
+   * \param env    [in]  JNI environment.
+   * \param method [in]  Method ID of the frame.
+   * \param buf    [out] Buffer to store string.
+   * \param len    [in]  Length of buf.
+   */
+  static void getFrameName(jvmtiEnv *jvmti, JNIEnv *env, jmethodID method,
+                           char *buf, size_t len);
+
+ protected:
+  /*!
+   * \brief TAllocationProfiler constructor.
+   * \param depth    [in] Number of frames which are recorded at each sample.
+   * \param interval [in] Average interval of sampling in bytes.
+   */
+  TAllocationProfiler(int depth, int interval);
+
+  /*!
+   * \brief TAllocationProfiler destructor.
+   */
+  virtual ~TAllocationProfiler();
+
+ public:
+  /*!
+   * \brief Global initialization.
+   * \param depth    [in] Number of frames which are recorded at each sample.
+   * \param interval [in] Average interval of sampling in bytes.
+   * \return Process result.
+   * \warning Please call only once from main thread.
+   */
+  static bool globalInitialize(int depth, int interval);
+
+  /*!
+   * \brief Global finalization.
+   */
+  static void globalFinalize(void);
+
+  /*!
+   * \brief Get singleton instance of TAllocationProfiler.
+   * \return Instance of TAllocationProfiler.
+   */
+  inline static TAllocationProfiler *getInstance() { return inst; };
+
+  /*!
+   * \brief Setting JVMTI capabilities and callback for allocation profiler.
+   * \param jvmti        [in]  JVMTI environment.
+   * \param capabilities [out] Capabilities to merge.
+   * \return true if running JVM supports SampledObjectAlloc event.
+   */
+  static bool setCapabilities(jvmtiEnv *jvmti,
+                              jvmtiCapabilities *capabilities);
+
+  /*!
+   * \brief Switch SampledObjectAlloc event notification.
+   * \param jvmti  [in] JVMTI environment.
+   * \param enable [in] Event notification is enable.
+   */
+  void switchEventNotification(jvmtiEnv *jvmti, bool enable);
+
+  /*!
+   * \brief Account sampled object to its allocation site.
+   * \param jvmti  [in] JVMTI environment.
+   * \param env    [in] JNI environment of current thread.
+   * \param thread [in] Allocating thread.
+   * \param object [in] Sampled object.
+   * \param size   [in] Size of the object in bytes.
+   */
+  void sample(jvmtiEnv *jvmti, JNIEnv *env, jthread thread, jobject object,
+              jlong size);
+
+  /*!
+   * \brief Remove allocation sites which refer the unloaded class.<br>
+   *        Address of the class and jmethodIDs of its methods might be
+   *        reused by other class.
+   * \param klassOop [in] Unloaded class.
+   */
+  void removeClass(void *klassOop);
+
+  /*!
+   * \brief Output ranking of allocation sites by sampled bytes in
+   *        current interval.<br>
+   *        Sites which are not sampled in the interval are removed to make
+   *        room for new sites.
+   * \param jvmti [in] JVMTI environment.
+   * \param env   [in] JNI environment.
+   * \param rank  [in] Number of allocation sites to output.
+   */
+  void showRanking(jvmtiEnv *jvmti, JNIEnv *env, int rank);
+};
+
+#endif  // ALLOC_PROFILER_HPP
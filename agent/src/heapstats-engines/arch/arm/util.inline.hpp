@@ -39,4 +39,8 @@ inline int atomic_get(int *target) {
   return ret;
 }
 
+inline void publish_barrier(void) {
+  asm volatile("dmb" : : : "memory");
+}
+
 #endif  // ARM_UTIL_H
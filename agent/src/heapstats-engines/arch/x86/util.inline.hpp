@@ -43,4 +43,17 @@ inline int atomic_get(int *target) {
   return ret;
 }
 
+/*
+ * x86 does not reorder stores with older stores, nor loads with older loads.
+ * So we need to prevent reordering by compiler only when single producer
+ * publishes data to single consumer.
+ *
+ * Intel (R)  64 and IA-32 Architectures Software Developer’s Manual
+ *   Volume 3A: System Programming Guide, Part 1
+ *     8.2.2 Memory Ordering in P6 and More Recent Processor Families
+ */
+inline void publish_barrier(void) {
+  asm volatile("" : : : "memory");
+}
+
 #endif  // X86_UTIL_H
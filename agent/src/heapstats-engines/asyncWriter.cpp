@@ -0,0 +1,1027 @@
+/*!
+ * \file asyncWriter.cpp
+ * \brief This file is used to write output files asynchronously.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef HAVE_LINUX_IO_URING_H
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#include "globals.hpp"
+#include "util.hpp"
+#include "asyncWriter.hpp"
+
+/*!
+ * \brief Singleton instance.
+ */
+TAsyncWriter *TAsyncWriter::inst = NULL;
+
+/*!
+ * \brief Backend which executes requests on the caller thread.<br>
+ *        It is used when async_io is "none", or no other backend is
+ *        available.
+ */
+class TSyncWriter : public TAsyncWriter {
+ public:
+  /*!
+   * \brief Execute request, and complete it.
+   * \param request [in] Request to execute.
+   */
+  void submit(TAsyncRequest *request) {
+    request->owner->complete(request, execute(request));
+  }
+
+  /*!
+   * \brief Get name of backend.
+   * \return Name of backend.
+   */
+  const char *getName(void) { return "none"; }
+};
+
+/*!
+ * \brief Backend which executes requests by worker threads.
+ */
+class TThreadPoolWriter : public TAsyncWriter {
+ public:
+  /*!
+   * \brief TThreadPoolWriter constructor.
+   * \param numThreads [in] Number of worker threads.
+   * \exception Throws int as errno if no worker thread can be started.
+   */
+  TThreadPoolWriter(int numThreads) {
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&queueCond, NULL);
+    head = NULL;
+    tail = NULL;
+    isTerminating = false;
+    this->numThreads = 0;
+
+    threads = (pthread_t *)malloc(sizeof(pthread_t) * numThreads);
+    if (unlikely(threads == NULL)) {
+      pthread_cond_destroy(&queueCond);
+      pthread_mutex_destroy(&mutex);
+      throw ENOMEM;
+    }
+
+    /* Signals should be handled by threads of JVM. */
+    sigset_t allSignals;
+    sigset_t oldMask;
+    sigfillset(&allSignals);
+    pthread_sigmask(SIG_BLOCK, &allSignals, &oldMask);
+
+    int result = 0;
+    for (int Cnt = 0; Cnt < numThreads; Cnt++) {
+      result = pthread_create(&threads[this->numThreads], NULL, &entryPoint,
+                              this);
+      if (likely(result == 0)) {
+        this->numThreads++;
+      }
+    }
+
+    pthread_sigmask(SIG_SETMASK, &oldMask, NULL);
+
+    if (unlikely(this->numThreads == 0)) {
+      free(threads);
+      pthread_cond_destroy(&queueCond);
+      pthread_mutex_destroy(&mutex);
+      throw result;
+    }
+  }
+
+  /*!
+   * \brief TThreadPoolWriter destructor.<br>
+   *        Worker threads exit after all queued requests are executed.
+   */
+  ~TThreadPoolWriter(void) {
+    ENTER_PTHREAD_SECTION(&mutex) {
+      isTerminating = true;
+      pthread_cond_broadcast(&queueCond);
+    }
+    EXIT_PTHREAD_SECTION(&mutex)
+
+    for (int Cnt = 0; Cnt < numThreads; Cnt++) {
+      pthread_join(threads[Cnt], NULL);
+    }
+
+    free(threads);
+    pthread_cond_destroy(&queueCond);
+    pthread_mutex_destroy(&mutex);
+  }
+
+  /*!
+   * \brief Add request to queue.
+   * \param request [in] Request to execute.
+   */
+  void submit(TAsyncRequest *request) {
+    request->next = NULL;
+
+    ENTER_PTHREAD_SECTION(&mutex) {
+      if (tail == NULL) {
+        head = request;
+      } else {
+        tail->next = request;
+      }
+
+      tail = request;
+      pthread_cond_signal(&queueCond);
+    }
+    EXIT_PTHREAD_SECTION(&mutex)
+  }
+
+  /*!
+   * \brief Get name of backend.
+   * \return Name of backend.
+   */
+  const char *getName(void) { return "threads"; }
+
+ private:
+  /*!
+   * \brief Mutex for request queue.
+   */
+  pthread_mutex_t mutex;
+
+  /*!
+   * \brief Condition to notify new request.
+   */
+  pthread_cond_t queueCond;
+
+  /*!
+   * \brief Head of request queue.
+   */
+  TAsyncRequest *head;
+
+  /*!
+   * \brief Tail of request queue.
+   */
+  TAsyncRequest *tail;
+
+  /*!
+   * \brief Worker threads.
+   */
+  pthread_t *threads;
+
+  /*!
+   * \brief Number of started worker threads.
+   */
+  int numThreads;
+
+  /*!
+   * \brief Worker threads should exit.
+   */
+  bool isTerminating;
+
+  /*!
+   * \brief Entry point of worker thread.
+   * \param data [in] Instance of TThreadPoolWriter.
+   * \return Always NULL.
+   */
+  static void *entryPoint(void *data) {
+    TThreadPoolWriter *pool = (TThreadPoolWriter *)data;
+
+    while (true) {
+      TAsyncRequest *request = NULL;
+
+      ENTER_PTHREAD_SECTION(&pool->mutex) {
+        while ((pool->head == NULL) && !pool->isTerminating) {
+          pthread_cond_wait(&pool->queueCond, &pool->mutex);
+        }
+
+        request = pool->head;
+        if (request != NULL) {
+          pool->head = request->next;
+          if (pool->head == NULL) {
+            pool->tail = NULL;
+          }
+        }
+      }
+      EXIT_PTHREAD_SECTION(&pool->mutex)
+
+      if (request == NULL) {
+        /* Queue is empty, and terminating. */
+        break;
+      }
+
+      request->owner->complete(request, execute(request));
+    }
+
+    return NULL;
+  }
+};
+
+#ifdef HAVE_LINUX_IO_URING_H
+
+/*!
+ * \brief Backend which executes requests by io_uring.<br>
+ *        Requests are submitted by caller threads, and completions are
+ *        reaped by a dedicated thread.
+ *        Raw system calls are used not to depend on liburing.
+ */
+class TUringWriter : public TAsyncWriter {
+ public:
+  /*!
+   * \brief TUringWriter constructor.
+   * \param entries [in] Number of entries of submission queue.
+   * \exception Throws int as errno if io_uring is not available.
+   */
+  TUringWriter(unsigned int entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    ringFd = syscall(__NR_io_uring_setup, entries, &params);
+    if (ringFd < 0) {
+      /* e.g. ENOSYS on old kernel, or EPERM by seccomp. */
+      throw errno;
+    }
+
+    sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize =
+        params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool isSingleMmap = (params.features & IORING_FEAT_SINGLE_MMAP);
+    if (isSingleMmap) {
+      sqRingSize = cqRingSize = (sqRingSize > cqRingSize) ? sqRingSize
+                                                          : cqRingSize;
+    }
+
+    sqRing = (char *)mmap(NULL, sqRingSize, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, ringFd,
+                          IORING_OFF_SQ_RING);
+    cqRing = isSingleMmap ? sqRing
+                          : (char *)mmap(NULL, cqRingSize,
+                                         PROT_READ | PROT_WRITE,
+                                         MAP_SHARED | MAP_POPULATE, ringFd,
+                                         IORING_OFF_CQ_RING);
+    numEntries = params.sq_entries;
+    sqes = (struct io_uring_sqe *)mmap(
+        NULL, numEntries * sizeof(struct io_uring_sqe),
+        PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd,
+        IORING_OFF_SQES);
+    if (unlikely((sqRing == MAP_FAILED) || (cqRing == MAP_FAILED) ||
+                 ((void *)sqes == MAP_FAILED))) {
+      int raisedErrNum = errno;
+      unmapRing();
+      close(ringFd);
+      throw raisedErrNum;
+    }
+
+    sqHead = (unsigned *)(sqRing + params.sq_off.head);
+    sqTail = (unsigned *)(sqRing + params.sq_off.tail);
+    sqMask = *(unsigned *)(sqRing + params.sq_off.ring_mask);
+    sqArray = (unsigned *)(sqRing + params.sq_off.array);
+    cqHead = (unsigned *)(cqRing + params.cq_off.head);
+    cqTail = (unsigned *)(cqRing + params.cq_off.tail);
+    cqMask = *(unsigned *)(cqRing + params.cq_off.ring_mask);
+    cqes = (struct io_uring_cqe *)(cqRing + params.cq_off.cqes);
+
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&spaceCond, NULL);
+    inflight = 0;
+
+    /* Signals should be handled by threads of JVM. */
+    sigset_t allSignals;
+    sigset_t oldMask;
+    sigfillset(&allSignals);
+    pthread_sigmask(SIG_BLOCK, &allSignals, &oldMask);
+    int result = pthread_create(&reaper, NULL, &entryPoint, this);
+    pthread_sigmask(SIG_SETMASK, &oldMask, NULL);
+
+    if (unlikely(result != 0)) {
+      pthread_cond_destroy(&spaceCond);
+      pthread_mutex_destroy(&mutex);
+      unmapRing();
+      close(ringFd);
+      throw result;
+    }
+  }
+
+  /*!
+   * \brief TUringWriter destructor.<br>
+   *        Reaper thread exits after all requests are completed.
+   */
+  ~TUringWriter(void) {
+    bool isNotified = false;
+
+    /* NOP without request notifies termination to reaper thread. */
+    ENTER_PTHREAD_SECTION(&mutex) {
+      while (inflight >= numEntries) {
+        pthread_cond_wait(&spaceCond, &mutex);
+      }
+
+      isNotified = pushEntry(IORING_OP_NOP, NULL);
+      if (unlikely(!isNotified)) {
+        /* Reaper thread cannot be stopped. Wait for in-flight requests. */
+        while (inflight > 0) {
+          pthread_cond_wait(&spaceCond, &mutex);
+        }
+      }
+    }
+    EXIT_PTHREAD_SECTION(&mutex)
+
+    if (unlikely(!isNotified)) {
+      /* Ring is left to reaper thread which waits for completion forever. */
+      pthread_detach(reaper);
+      return;
+    }
+
+    pthread_join(reaper, NULL);
+
+    pthread_cond_destroy(&spaceCond);
+    pthread_mutex_destroy(&mutex);
+    unmapRing();
+    close(ringFd);
+  }
+
+  /*!
+   * \brief Submit request to io_uring.
+   * \param request [in] Request to execute.
+   */
+  void submit(TAsyncRequest *request) {
+    bool isSubmitted = false;
+
+    ENTER_PTHREAD_SECTION(&mutex) {
+      /* Completion queue must not overflow. */
+      while (inflight >= numEntries) {
+        pthread_cond_wait(&spaceCond, &mutex);
+      }
+
+      inflight++;
+      isSubmitted = pushEntry((request->opcode == ASYNC_WRITE)
+                                  ? IORING_OP_WRITEV
+                                  : IORING_OP_FSYNC,
+                              request);
+      if (unlikely(!isSubmitted)) {
+        inflight--;
+        pthread_cond_signal(&spaceCond);
+      }
+    }
+    EXIT_PTHREAD_SECTION(&mutex)
+
+    if (unlikely(!isSubmitted)) {
+      /* Execute on the caller thread not to lose the request. */
+      request->owner->complete(request, execute(request));
+    }
+  }
+
+  /*!
+   * \brief Get name of backend.
+   * \return Name of backend.
+   */
+  const char *getName(void) { return "io_uring"; }
+
+ private:
+  /*!
+   * \brief File descriptor of io_uring.
+   */
+  int ringFd;
+
+  /*!
+   * \brief Mapped submission queue ring.
+   */
+  char *sqRing;
+
+  /*!
+   * \brief Mapped completion queue ring.
+   */
+  char *cqRing;
+
+  /*!
+   * \brief Size of sqRing.
+   */
+  size_t sqRingSize;
+
+  /*!
+   * \brief Size of cqRing.
+   */
+  size_t cqRingSize;
+
+  /*!
+   * \brief Mapped submission queue entries.
+   */
+  struct io_uring_sqe *sqes;
+
+  /*!
+   * \brief Number of entries of submission queue.
+   */
+  unsigned int numEntries;
+
+  unsigned *sqHead;  /*!< Head of submission queue. */
+  unsigned *sqTail;  /*!< Tail of submission queue. */
+  unsigned sqMask;   /*!< Mask of submission queue index. */
+  unsigned *sqArray; /*!< Index array of submission queue. */
+  unsigned *cqHead;  /*!< Head of completion queue. */
+  unsigned *cqTail;  /*!< Tail of completion queue. */
+  unsigned cqMask;   /*!< Mask of completion queue index. */
+  struct io_uring_cqe *cqes; /*!< Completion queue entries. */
+
+  /*!
+   * \brief Mutex for submission queue.
+   */
+  pthread_mutex_t mutex;
+
+  /*!
+   * \brief Condition to wait space of completion queue.
+   */
+  pthread_cond_t spaceCond;
+
+  /*!
+   * \brief Number of in-flight requests.
+   */
+  unsigned int inflight;
+
+  /*!
+   * \brief Thread which reaps completions.
+   */
+  pthread_t reaper;
+
+  /*!
+   * \brief Unmap rings of io_uring.
+   */
+  void unmapRing(void) {
+    if ((sqes != NULL) && ((void *)sqes != MAP_FAILED)) {
+      munmap(sqes, numEntries * sizeof(struct io_uring_sqe));
+    }
+    if ((cqRing != NULL) && (cqRing != MAP_FAILED) && (cqRing != sqRing)) {
+      munmap(cqRing, cqRingSize);
+    }
+    if ((sqRing != NULL) && (sqRing != MAP_FAILED)) {
+      munmap(sqRing, sqRingSize);
+    }
+  }
+
+  /*!
+   * \brief Push entry to submission queue, and submit it.<br>
+   *        Entry is removed from submission queue if it cannot be
+   *        submitted, so it is never completed by reaper thread.
+   * \param opcode  [in] Operation of io_uring.
+   * \param request [in] Request of entry.
+   * \return false if the entry could not be submitted.
+   * \warning Caller must hold mutex.
+   */
+  bool pushEntry(unsigned char opcode, TAsyncRequest *request) {
+    unsigned tail = *sqTail;
+    unsigned index = tail & sqMask;
+    struct io_uring_sqe *sqe = &sqes[index];
+
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    sqe->opcode = opcode;
+    sqe->user_data = (uintptr_t)request;
+    if (request != NULL) {
+      sqe->fd = request->fd;
+
+      if (opcode == IORING_OP_WRITEV) {
+        request->iov.iov_base = request->buffer + request->written;
+        request->iov.iov_len = request->length - request->written;
+        sqe->addr = (uintptr_t)&request->iov;
+        sqe->len = 1;
+        sqe->off = request->offset + request->written;
+      } else {
+        sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+      }
+    }
+
+    sqArray[index] = index;
+    __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+
+    while (syscall(__NR_io_uring_enter, ringFd, 1, 0, 0, NULL, 0) < 0) {
+      if ((errno != EINTR) && (errno != EAGAIN) && (errno != EBUSY)) {
+        logger->printWarnMsgWithErrno("Could not submit to io_uring");
+
+        /* Kernel does not consume the entry when io_uring_enter fails. */
+        __atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  /*!
+   * \brief Handle completion of request.
+   * \param request [in] Completed request.
+   * \param result  [in] Result of io_uring operation.
+   */
+  void onCompletion(TAsyncRequest *request, int result) {
+    unsigned char nextOpcode = IORING_OP_NOP;
+    int error = 0;
+
+    if (result < 0) {
+      if ((result == -EINTR) || (result == -EAGAIN)) {
+        nextOpcode = (request->opcode == ASYNC_WRITE) ? IORING_OP_WRITEV
+                                                      : IORING_OP_FSYNC;
+      } else {
+        error = -result;
+      }
+    } else if (request->opcode == ASYNC_WRITE) {
+      request->written += result;
+
+      if (unlikely(result == 0)) {
+        /* Avoid infinite loop. */
+        error = EIO;
+      } else if (request->written < request->length) {
+        /* Short write. */
+        nextOpcode = IORING_OP_WRITEV;
+      } else if (request->isSync) {
+        request->opcode = ASYNC_FSYNC;
+        nextOpcode = IORING_OP_FSYNC;
+      }
+    }
+
+    if (nextOpcode != IORING_OP_NOP) {
+      /* Resubmission reuses the slot, so inflight is not changed. */
+      bool isSubmitted = false;
+      ENTER_PTHREAD_SECTION(&mutex) {
+        isSubmitted = pushEntry(nextOpcode, request);
+      }
+      EXIT_PTHREAD_SECTION(&mutex)
+
+      if (likely(isSubmitted)) {
+        return;
+      }
+
+      /* Rest of the request is executed on reaper thread. */
+      error = execute(request);
+    }
+
+    ENTER_PTHREAD_SECTION(&mutex) {
+      inflight--;
+      pthread_cond_signal(&spaceCond);
+    }
+    EXIT_PTHREAD_SECTION(&mutex)
+
+    request->owner->complete(request, error);
+  }
+
+  /*!
+   * \brief Entry point of reaper thread.
+   * \param data [in] Instance of TUringWriter.
+   * \return Always NULL.
+   */
+  static void *entryPoint(void *data) {
+    TUringWriter *ring = (TUringWriter *)data;
+    bool isTerminating = false;
+
+    while (true) {
+      unsigned head = *ring->cqHead;
+      unsigned tail = __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE);
+
+      if (head == tail) {
+        if (isTerminating) {
+          bool isIdle = false;
+          ENTER_PTHREAD_SECTION(&ring->mutex) { isIdle = (ring->inflight == 0); }
+          EXIT_PTHREAD_SECTION(&ring->mutex)
+
+          if (isIdle) {
+            break;
+          }
+        }
+
+        syscall(__NR_io_uring_enter, ring->ringFd, 0, 1,
+                IORING_ENTER_GETEVENTS, NULL, 0);
+        continue;
+      }
+
+      for (; head != tail; head++) {
+        struct io_uring_cqe *cqe = &ring->cqes[head & ring->cqMask];
+        TAsyncRequest *request = (TAsyncRequest *)(uintptr_t)cqe->user_data;
+        int result = cqe->res;
+
+        /* Release entry before resubmission. */
+        __atomic_store_n(ring->cqHead, head + 1, __ATOMIC_RELEASE);
+
+        if (request == NULL) {
+          isTerminating = true;
+        } else {
+          ring->onCompletion(request, result);
+        }
+      }
+    }
+
+    return NULL;
+  }
+};
+
+#endif  // HAVE_LINUX_IO_URING_H
+
+/*!
+ * \brief Execute request on the caller thread.
+ * \param request [in] Request to execute.
+ * \return Value is zero, if process is succeed.<br />
+ *         Value is error number a.k.a. "errno", if process is failure.
+ */
+int TAsyncWriter::execute(TAsyncRequest *request) {
+  if (request->opcode == ASYNC_WRITE) {
+    while (request->written < request->length) {
+      ssize_t ret = ::pwrite(request->fd, request->buffer + request->written,
+                             request->length - request->written,
+                             request->offset + request->written);
+      if (unlikely(ret < 0)) {
+        if (errno != EINTR) {
+          return errno;
+        }
+      } else if (unlikely(ret == 0)) {
+        /* Avoid infinite loop. */
+        return EIO;
+      } else {
+        request->written += ret;
+      }
+    }
+
+    if (!request->isSync) {
+      return 0;
+    }
+  }
+
+  return (fdatasync(request->fd) == 0) ? 0 : errno;
+}
+
+/*!
+ * \brief Global initialization.<br>
+ *        Backend is selected by "async_io".
+ * \return Process result.
+ * \warning Please call only once from main thread.
+ */
+bool TAsyncWriter::globalInitialize(void) {
+  const char *backend = conf->AsyncIO()->get();
+
+#ifdef HAVE_LINUX_IO_URING_H
+  if ((strcmp(backend, "auto") == 0) || (strcmp(backend, "io_uring") == 0)) {
+    try {
+      inst = new TUringWriter(ASYNC_WRITER_QUEUE_DEPTH);
+    } catch (int errNum) {
+      errno = errNum;
+      logger->printDebugMsg("io_uring is not available: %s",
+                            strerror(errNum));
+      inst = NULL;
+    } catch (...) {
+      inst = NULL;
+    }
+  }
+#endif
+
+  if ((inst == NULL) && (strcmp(backend, "none") != 0)) {
+    if (strcmp(backend, "io_uring") == 0) {
+      logger->printWarnMsg(
+          "io_uring is not available. Thread pool is used for output.");
+    }
+
+    try {
+      inst = new TThreadPoolWriter(conf->AsyncIOThreads()->get());
+    } catch (...) {
+      logger->printWarnMsg(
+          "Could not start I/O threads. Files are written synchronously.");
+      inst = NULL;
+    }
+  }
+
+  if (inst == NULL) {
+    try {
+      inst = new TSyncWriter();
+    } catch (...) {
+      logger->printWarnMsg("Cannot initialize TAsyncWriter.");
+      return false;
+    }
+  }
+
+  logger->printDebugMsg("Asynchronous I/O backend: %s", inst->getName());
+  return true;
+}
+
+/*!
+ * \brief Global finalization.<br>
+ *        All submitted requests are completed before it returns.
+ */
+void TAsyncWriter::globalFinalize(void) {
+  delete inst;
+  inst = NULL;
+}
+
+/*!
+ * \brief Get policy of fdatasync(2) from configuration.
+ * \return Policy of fdatasync(2).
+ */
+static TFsyncPolicy getFsyncPolicy(void) {
+  const char *policy = conf->FsyncPolicy()->get();
+
+  if (strcmp(policy, "always") == 0) {
+    return FSYNC_ALWAYS;
+  } else if (strcmp(policy, "close") == 0) {
+    return FSYNC_CLOSE;
+  }
+
+  return FSYNC_NONE;
+}
+
+/*!
+ * \brief TAsyncFile constructor.
+ * \param fd          [in] Output file descriptor.
+ *                         It is not closed by this class.
+ * \param offset      [in] File offset to start writing.
+ * \param maxInflight [in] Max number of in-flight buffers.<br>
+ *                         It should be 1 for O_APPEND file to keep order.
+ */
+TAsyncFile::TAsyncFile(int fd, off_t offset, int maxInflight) {
+  this->chunk = (char *)malloc(ASYNC_WRITER_CHUNK_SIZE);
+  if (unlikely(this->chunk == NULL)) {
+    throw ENOMEM;
+  }
+
+  this->fd = fd;
+  this->offset = offset;
+  this->chunkLen = 0;
+  this->numFreeChunks = 0;
+  this->inflight = 0;
+  this->maxInflight =
+      (maxInflight < 1)
+          ? 1
+          : ((maxInflight > ASYNC_WRITER_MAX_INFLIGHT) ? ASYNC_WRITER_MAX_INFLIGHT
+                                                       : maxInflight);
+  this->error = 0;
+  this->fsyncPolicy = getFsyncPolicy();
+
+  pthread_mutex_init(&mutex, NULL);
+  pthread_cond_init(&completeCond, NULL);
+}
+
+/*!
+ * \brief TAsyncFile destructor.<br>
+ *        It waits all requests, but buffered data is discarded.
+ */
+TAsyncFile::~TAsyncFile(void) {
+  waitInflight(0);
+
+  free(chunk);
+  for (int Cnt = 0; Cnt < numFreeChunks; Cnt++) {
+    free(freeChunks[Cnt]);
+  }
+
+  pthread_cond_destroy(&completeCond);
+  pthread_mutex_destroy(&mutex);
+}
+
+/*!
+ * \brief Submit request to backend.
+ * \param opcode   [in] Operation of request.
+ * \param buffer   [in] Data to write. It is released by this class.
+ * \param length   [in] Length of data.
+ * \param offset   [in] File offset of data.
+ * \param isSync   [in] fdatasync(2) after writing data.
+ * \param isChunk  [in] Buffer is chunk which can be reused.
+ * \return Value is zero, if process is succeed.<br />
+ *         Value is error number a.k.a. "errno", if process is failure.
+ */
+int TAsyncFile::submit(TAsyncOpcode opcode, char *buffer, size_t length,
+                       off_t offset, bool isSync, bool isChunk) {
+  TAsyncRequest *request;
+  try {
+    request = new TAsyncRequest();
+  } catch (...) {
+    free(buffer);
+    setError(ENOMEM);
+    return ENOMEM;
+  }
+
+  request->owner = this;
+  request->opcode = opcode;
+  request->fd = fd;
+  request->buffer = buffer;
+  request->length = length;
+  request->written = 0;
+  request->offset = offset;
+  request->isSync = isSync;
+  request->isChunk = isChunk;
+  request->next = NULL;
+
+  ENTER_PTHREAD_SECTION(&mutex) { inflight++; }
+  EXIT_PTHREAD_SECTION(&mutex)
+
+  TAsyncWriter *backend = TAsyncWriter::getInstance();
+  if (unlikely(backend == NULL)) {
+    complete(request, TAsyncWriter::execute(request));
+  } else {
+    backend->submit(request);
+  }
+
+  return 0;
+}
+
+/*!
+ * \brief Keep error as the first error if no error is raised yet.
+ * \param result [in] Error number.
+ */
+void TAsyncFile::setError(int result) {
+  ENTER_PTHREAD_SECTION(&mutex) {
+    if (error == 0) {
+      error = result;
+    }
+  }
+  EXIT_PTHREAD_SECTION(&mutex)
+}
+
+/*!
+ * \brief Wait until number of in-flight requests is less than the limit.
+ * \param limit [in] Max number of in-flight requests after waiting.
+ */
+void TAsyncFile::waitInflight(int limit) {
+  ENTER_PTHREAD_SECTION(&mutex) {
+    while (inflight > limit) {
+      pthread_cond_wait(&completeCond, &mutex);
+    }
+  }
+  EXIT_PTHREAD_SECTION(&mutex)
+}
+
+/*!
+ * \brief Callback of completion of request.
+ * \param request [in] Completed request.
+ * \param result  [in] Zero, or error number if the request is failure.
+ * \warning This function is called by backend.
+ */
+void TAsyncFile::complete(TAsyncRequest *request, int result) {
+  if (result != 0) {
+    setError(result);
+  }
+
+  ENTER_PTHREAD_SECTION(&mutex) {
+    if (request->isChunk && (numFreeChunks < ASYNC_WRITER_MAX_INFLIGHT)) {
+      freeChunks[numFreeChunks++] = request->buffer;
+    } else {
+      free(request->buffer);
+    }
+
+    inflight--;
+    pthread_cond_broadcast(&completeCond);
+  }
+  EXIT_PTHREAD_SECTION(&mutex)
+
+  delete request;
+}
+
+/*!
+ * \brief Get the first error of requests.
+ * \return Error number, or zero if no error is raised.
+ */
+int TAsyncFile::getError(void) {
+  int result = 0;
+
+  ENTER_PTHREAD_SECTION(&mutex) { result = error; }
+  EXIT_PTHREAD_SECTION(&mutex)
+
+  return result;
+}
+
+/*!
+ * \brief Append data to the file.
+ * \param data   [in] Data to write.
+ * \param length [in] Length of data.
+ * \return Value is zero, if process is succeed.<br />
+ *         Value is error number a.k.a. "errno", if process is failure.
+ */
+int TAsyncFile::write(const void *data, size_t length) {
+  const char *pos = (const char *)data;
+
+  while (length > 0) {
+    if (unlikely(chunk == NULL)) {
+      /* Previous allocation is failed. */
+      return ENOMEM;
+    }
+
+    size_t copyLen = ASYNC_WRITER_CHUNK_SIZE - chunkLen;
+    if (copyLen > length) {
+      copyLen = length;
+    }
+
+    memcpy(chunk + chunkLen, pos, copyLen);
+    chunkLen += copyLen;
+    pos += copyLen;
+    length -= copyLen;
+
+    if (chunkLen == ASYNC_WRITER_CHUNK_SIZE) {
+      int result = flush();
+      if (unlikely(result != 0)) {
+        return result;
+      }
+    }
+  }
+
+  return 0;
+}
+
+/*!
+ * \brief Write data at the offset.<br>
+ *        Data is copied, and it does not move offset to append.
+ * \param data   [in] Data to write.
+ * \param length [in] Length of data.
+ * \param offset [in] File offset of data.
+ * \return Value is zero, if process is succeed.<br />
+ *         Value is error number a.k.a. "errno", if process is failure.
+ */
+int TAsyncFile::pwrite(const void *data, size_t length, off_t offset) {
+  int result = getError();
+  if (unlikely(result != 0)) {
+    return result;
+  }
+
+  char *buffer = (char *)malloc(length);
+  if (unlikely(buffer == NULL)) {
+    setError(ENOMEM);
+    return ENOMEM;
+  }
+
+  memcpy(buffer, data, length);
+  waitInflight(maxInflight - 1);
+  return submit(ASYNC_WRITE, buffer, length, offset,
+                fsyncPolicy == FSYNC_ALWAYS, false);
+}
+
+/*!
+ * \brief Submit buffered data without waiting for completion.
+ * \return Value is zero, if process is succeed.<br />
+ *         Value is error number a.k.a. "errno", if process is failure.
+ */
+int TAsyncFile::flush(void) {
+  int result = getError();
+  if (unlikely(result != 0)) {
+    /* Data after the error is discarded. */
+    offset += chunkLen;
+    chunkLen = 0;
+    return result;
+  }
+
+  if (chunkLen == 0) {
+    return 0;
+  }
+
+  waitInflight(maxInflight - 1);
+
+  char *buffer = chunk;
+  size_t length = chunkLen;
+  off_t bufferOffset = offset;
+  offset += chunkLen;
+  chunkLen = 0;
+
+  /* Reuse buffer which is already written. */
+  chunk = NULL;
+  ENTER_PTHREAD_SECTION(&mutex) {
+    if (numFreeChunks > 0) {
+      chunk = freeChunks[--numFreeChunks];
+    }
+  }
+  EXIT_PTHREAD_SECTION(&mutex)
+
+  if (chunk == NULL) {
+    chunk = (char *)malloc(ASYNC_WRITER_CHUNK_SIZE);
+  }
+
+  result = submit(ASYNC_WRITE, buffer, length, bufferOffset,
+                  fsyncPolicy == FSYNC_ALWAYS, true);
+  if ((result == 0) && unlikely(chunk == NULL)) {
+    /* Following data cannot be written. */
+    setError(ENOMEM);
+    result = ENOMEM;
+  }
+
+  return result;
+}
+
+/*!
+ * \brief Write all buffered data, and wait for all requests.<br>
+ *        The file is synced if fsync_policy is not "none".
+ * \return Value is zero, if all requests are succeed.<br />
+ *         Value is error number a.k.a. "errno", if any request is failure.
+ */
+int TAsyncFile::finish(void) {
+  int result = flush();
+  waitInflight(0);
+
+  if ((result == 0) && (fsyncPolicy != FSYNC_NONE)) {
+    /* Sync after all data is written, because requests are not ordered. */
+    result = submit(ASYNC_FSYNC, NULL, 0, 0, true, false);
+    waitInflight(0);
+  }
+
+  int lastError = getError();
+  return (lastError != 0) ? lastError : result;
+}
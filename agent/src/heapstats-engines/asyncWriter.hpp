@@ -0,0 +1,309 @@
+/*!
+ * \file asyncWriter.hpp
+ * \brief This file is used to write output files asynchronously.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#ifndef ASYNC_WRITER_HPP
+#define ASYNC_WRITER_HPP
+
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+/*!
+ * \brief Size of a buffer which is submitted to backend at once.
+ */
+#define ASYNC_WRITER_CHUNK_SIZE (256 * 1024)
+
+/*!
+ * \brief Max number of in-flight buffers of a file.
+ */
+#define ASYNC_WRITER_MAX_INFLIGHT 4
+
+/*!
+ * \brief Number of entries of io_uring submission queue.
+ */
+#define ASYNC_WRITER_QUEUE_DEPTH 64
+
+/*!
+ * \brief Policy of fdatasync(2) for output files.
+ */
+typedef enum {
+  FSYNC_NONE,  /*!< Never sync. Page cache is written back by kernel. */
+  FSYNC_CLOSE, /*!< Sync when output file is finished.                */
+  FSYNC_ALWAYS /*!< Sync after each submitted buffer, too.            */
+} TFsyncPolicy;
+
+/*!
+ * \brief Kind of I/O request.
+ */
+typedef enum { ASYNC_WRITE, ASYNC_FSYNC } TAsyncOpcode;
+
+class TAsyncFile;
+
+/*!
+ * \brief I/O request which is submitted to backend.
+ */
+typedef struct TAsyncRequest {
+  TAsyncFile *owner;   /*!< File which submits this request.              */
+  TAsyncOpcode opcode; /*!< Current operation.                            */
+  int fd;              /*!< Target file descriptor.                       */
+  char *buffer;        /*!< Data to write.                                */
+  size_t length;       /*!< Length of data.                               */
+  size_t written;      /*!< Length of data which is already written.      */
+  off_t offset;        /*!< File offset of data.                          */
+  bool isSync;         /*!< fdatasync(2) after writing data.              */
+  bool isChunk;        /*!< Buffer is chunk which can be reused.          */
+  TAsyncRequest *next; /*!< Next request in queue of thread pool.         */
+  struct iovec iov;    /*!< Vector of unwritten data for io_uring.        */
+} TAsyncRequest;
+
+/*!
+ * \brief This class is backend of asynchronous output.<br>
+ *        Requests of all writers are executed by io_uring, or by thread
+ *        pool if io_uring is not available.
+ */
+class TAsyncWriter {
+ public:
+  /*!
+   * \brief TAsyncWriter destructor.
+   */
+  virtual ~TAsyncWriter(void){};
+
+  /*!
+   * \brief Submit request.<br>
+   *        TAsyncFile::complete() of owner is called when the request is
+   *        completed or failed.
+   * \param request [in] Request to execute.
+   */
+  virtual void submit(TAsyncRequest *request) = 0;
+
+  /*!
+   * \brief Get name of backend.
+   * \return Name of backend.
+   */
+  virtual const char *getName(void) = 0;
+
+  /*!
+   * \brief Global initialization.<br>
+   *        Backend is selected by "async_io".
+   * \return Process result.
+   * \warning Please call only once from main thread.
+   */
+  static bool globalInitialize(void);
+
+  /*!
+   * \brief Global finalization.<br>
+   *        All submitted requests are completed before it returns.
+   */
+  static void globalFinalize(void);
+
+  /*!
+   * \brief Get singleton instance.
+   * \return Instance of TAsyncWriter.<br>
+   *         Value is NULL if it is not initialized.
+   */
+  inline static TAsyncWriter *getInstance() { return inst; };
+
+  /*!
+   * \brief Execute request on the caller thread.
+   * \param request [in] Request to execute.
+   * \return Value is zero, if process is succeed.<br />
+   *         Value is error number a.k.a. "errno", if process is failure.
+   */
+  static int execute(TAsyncRequest *request);
+
+ private:
+  /*!
+   * \brief Singleton instance.
+   */
+  static TAsyncWriter *inst;
+};
+
+/*!
+ * \brief This class writes an output file through TAsyncWriter.<br>
+ *        Small writes are collected into chunks, and each chunk is written
+ *        at its own offset while the caller makes next one.
+ *        The first error of requests is kept, and later writes are ignored,
+ *        so callers can rollback the file after finish().
+ * \warning An instance must be used by one thread at a time.
+ */
+class TAsyncFile {
+ public:
+  /*!
+   * \brief TAsyncFile constructor.
+   * \param fd          [in] Output file descriptor.
+   *                         It is not closed by this class.
+   * \param offset      [in] File offset to start writing.
+   * \param maxInflight [in] Max number of in-flight buffers.<br>
+   *                         It should be 1 for O_APPEND file to keep order.
+   */
+  TAsyncFile(int fd, off_t offset,
+             int maxInflight = ASYNC_WRITER_MAX_INFLIGHT);
+
+  /*!
+   * \brief TAsyncFile destructor.<br>
+   *        It waits all requests, but buffered data is discarded.
+   */
+  virtual ~TAsyncFile(void);
+
+  /*!
+   * \brief Append data to the file.
+   * \param data   [in] Data to write.
+   * \param length [in] Length of data.
+   * \return Value is zero, if process is succeed.<br />
+   *         Value is error number a.k.a. "errno", if process is failure.
+   */
+  int write(const void *data, size_t length);
+
+  /*!
+   * \brief Write data at the offset.<br>
+   *        Data is copied, and it does not move offset to append.
+   * \param data   [in] Data to write.
+   * \param length [in] Length of data.
+   * \param offset [in] File offset of data.
+   * \return Value is zero, if process is succeed.<br />
+   *         Value is error number a.k.a. "errno", if process is failure.
+   */
+  int pwrite(const void *data, size_t length, off_t offset);
+
+  /*!
+   * \brief Submit buffered data without waiting for completion.
+   * \return Value is zero, if process is succeed.<br />
+   *         Value is error number a.k.a. "errno", if process is failure.
+   */
+  int flush(void);
+
+  /*!
+   * \brief Write all buffered data, and wait for all requests.<br>
+   *        The file is synced if fsync_policy is not "none".
+   * \return Value is zero, if all requests are succeed.<br />
+   *         Value is error number a.k.a. "errno", if any request is failure.
+   */
+  int finish(void);
+
+  /*!
+   * \brief Get the first error of requests.
+   * \return Error number, or zero if no error is raised.
+   */
+  int getError(void);
+
+  /*!
+   * \brief Get offset of next data to append.
+   * \return File offset.
+   */
+  inline off_t getOffset(void) { return offset + chunkLen; };
+
+  /*!
+   * \brief Callback of completion of request.
+   * \param request [in] Completed request.
+   * \param result  [in] Zero, or error number if the request is failure.
+   * \warning This function is called by backend.
+   */
+  void complete(TAsyncRequest *request, int result);
+
+ private:
+  /*!
+   * \brief Output file descriptor.
+   */
+  int fd;
+
+  /*!
+   * \brief File offset of the head of current chunk.
+   */
+  off_t offset;
+
+  /*!
+   * \brief Current chunk to collect data.
+   */
+  char *chunk;
+
+  /*!
+   * \brief Length of data in current chunk.
+   */
+  size_t chunkLen;
+
+  /*!
+   * \brief Chunks which can be reused.
+   */
+  char *freeChunks[ASYNC_WRITER_MAX_INFLIGHT];
+
+  /*!
+   * \brief Number of chunks in freeChunks.
+   */
+  int numFreeChunks;
+
+  /*!
+   * \brief Number of in-flight requests.
+   */
+  int inflight;
+
+  /*!
+   * \brief Max number of in-flight buffers.
+   */
+  int maxInflight;
+
+  /*!
+   * \brief The first error of requests.
+   */
+  int error;
+
+  /*!
+   * \brief Policy of fdatasync(2).
+   */
+  TFsyncPolicy fsyncPolicy;
+
+  /*!
+   * \brief Mutex for completion state.
+   */
+  pthread_mutex_t mutex;
+
+  /*!
+   * \brief Condition to wait completion.
+   */
+  pthread_cond_t completeCond;
+
+  /*!
+   * \brief Submit request to backend.
+   * \param opcode   [in] Operation of request.
+   * \param buffer   [in] Data to write. It is released by this class.
+   * \param length   [in] Length of data.
+   * \param offset   [in] File offset of data.
+   * \param isSync   [in] fdatasync(2) after writing data.
+   * \param isChunk  [in] Buffer is chunk which can be reused.
+   * \return Value is zero, if process is succeed.<br />
+   *         Value is error number a.k.a. "errno", if process is failure.
+   */
+  int submit(TAsyncOpcode opcode, char *buffer, size_t length, off_t offset,
+             bool isSync, bool isChunk);
+
+  /*!
+   * \brief Keep error as the first error if no error is raised yet.
+   * \param result [in] Error number.
+   */
+  void setError(int result);
+
+  /*!
+   * \brief Wait until number of in-flight requests is less than the limit.
+   * \param limit [in] Max number of in-flight requests after waiting.
+   */
+  void waitInflight(int limit);
+};
+
+#endif  // ASYNC_WRITER_HPP
@@ -0,0 +1,156 @@
+/*!
+ * \file bufferedFdWriter.hpp
+ * \brief This file is used to write text to file descriptor through buffer.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#ifndef BUFFERED_FD_WRITER_HPP
+#define BUFFERED_FD_WRITER_HPP
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "util.hpp"
+
+/*!
+ * \brief Size of buffer of TBufferedFdWriter.
+ */
+#define BUFFERED_FD_WRITER_SIZE 65536
+
+/*!
+ * \brief Max length of a formatted string.<br>
+ *        Longer string is truncated.
+ */
+#define BUFFERED_FD_WRITER_MAX_LINE 4096
+
+/*!
+ * \brief This class collects small writes into large buffer.<br>
+ *        The first error of write(2) is kept, and later writes are ignored.
+ */
+class TBufferedFdWriter {
+ public:
+  /*!
+   * \brief TBufferedFdWriter constructor.
+   * \param fd [in] Output file descriptor. It is not closed by this class.
+   */
+  TBufferedFdWriter(int fd) {
+    this->buffer = (char *)malloc(BUFFERED_FD_WRITER_SIZE);
+    if (unlikely(this->buffer == NULL)) {
+      throw ENOMEM;
+    }
+
+    this->fd = fd;
+    this->len = 0;
+    this->error = 0;
+  }
+
+  /*!
+   * \brief TBufferedFdWriter destructor.<br>
+   *        Buffered data is flushed.
+   */
+  ~TBufferedFdWriter() {
+    flush();
+    free(this->buffer);
+  }
+
+  /*!
+   * \brief Append formatted string.
+   * \param format [in] Format string of printf(3).
+   * \return Value is zero, if process is succeed.<br />
+   *         Value is error number a.k.a. "errno", if process is failure.
+   */
+  int printf(const char *format, ...) {
+    if (unlikely(BUFFERED_FD_WRITER_SIZE - this->len <
+                 BUFFERED_FD_WRITER_MAX_LINE)) {
+      flush();
+    }
+
+    if (unlikely(this->error != 0)) {
+      return this->error;
+    }
+
+    va_list args;
+    va_start(args, format);
+    int ret = vsnprintf(this->buffer + this->len, BUFFERED_FD_WRITER_MAX_LINE,
+                        format, args);
+    va_end(args);
+
+    if (likely(ret > 0)) {
+      this->len += (ret < BUFFERED_FD_WRITER_MAX_LINE)
+                       ? ret
+                       : BUFFERED_FD_WRITER_MAX_LINE - 1;
+    }
+
+    return 0;
+  }
+
+  /*!
+   * \brief Write all buffered data.
+   * \return Value is zero, if process is succeed.<br />
+   *         Value is error number a.k.a. "errno", if process is failure.
+   */
+  int flush(void) {
+    size_t pos = 0;
+    while ((this->error == 0) && (pos < this->len)) {
+      ssize_t ret = write(this->fd, this->buffer + pos, this->len - pos);
+      if (unlikely(ret < 0)) {
+        if (errno != EINTR) {
+          this->error = errno;
+        }
+      } else {
+        pos += ret;
+      }
+    }
+
+    this->len = 0;
+    return this->error;
+  }
+
+  /*!
+   * \brief Get the first error of write(2).
+   * \return Error number, or zero if no error is raised.
+   */
+  inline int getError(void) { return this->error; }
+
+ private:
+  /*!
+   * \brief Output file descriptor.
+   */
+  int fd;
+
+  /*!
+   * \brief Buffer of output data.
+   */
+  char *buffer;
+
+  /*!
+   * \brief Length of data in buffer.
+   */
+  size_t len;
+
+  /*!
+   * \brief The first error of write(2).
+   */
+  int error;
+};
+
+#endif  // BUFFERED_FD_WRITER_HPP
@@ -320,6 +320,28 @@ class TMonitorWaitedCallback
   };
 };
 
+#ifdef HAVE_SAMPLED_OBJECT_ALLOC
+/*!
+ * \brief JVMTI SampledObjectAlloc callback.
+ */
+class TSampledObjectAllocCallback
+    : public TJVMTIEventCallback<jvmtiEventSampledObjectAlloc,
+                                 JVMTI_EVENT_SAMPLED_OBJECT_ALLOC> {
+ public:
+  static void JNICALL callbackStub(jvmtiEnv *jvmti, JNIEnv *env, jthread thread,
+                                   jobject object, jclass klass, jlong size) {
+    ITERATE_CALLBACK_CHAIN(jvmtiEventSampledObjectAlloc, jvmti, env, thread,
+                           object, klass, size);
+  };
+
+  DEFINE_MERGE_CALLBACK(SampledObjectAlloc)
+
+  static void mergeCapabilities(jvmtiCapabilities *capabilities) {
+    capabilities->can_generate_sampled_object_alloc_events = 1;
+  };
+};
+#endif
+
 /*!
  * \brief Register JVMTI callbacks to JVM.
  *
@@ -341,6 +363,9 @@ inline bool registerJVMTICallbacks(jvmtiEnv *jvmti) {
   TThreadEndCallback::mergeCallback(&callbacks);
   TMonitorWaitCallback::mergeCallback(&callbacks);
   TMonitorWaitedCallback::mergeCallback(&callbacks);
+#ifdef HAVE_SAMPLED_OBJECT_ALLOC
+  TSampledObjectAllocCallback::mergeCallback(&callbacks);
+#endif
 
   return isError(
       jvmti, jvmti->SetEventCallbacks(&callbacks, sizeof(jvmtiEventCallbacks)));
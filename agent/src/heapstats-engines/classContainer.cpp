@@ -20,9 +20,12 @@
  */
 
 #include <fcntl.h>
+#include <math.h>
 
 #include "globals.hpp"
 #include "classContainer.hpp"
+#include "snapShotFile.hpp"
+#include "asyncWriter.hpp"
 
 /*!
  * \brief SNMP variable Identifier of raise heap-alert date.
@@ -44,6 +47,10 @@ static oid OID_ALERT_CLS_SIZE[] = {SNMP_OID_HEAPALERT, 4};
  * \brief SNMP variable Identifier of instance count.
  */
 static oid OID_ALERT_CLS_COUNT[] = {SNMP_OID_HEAPALERT, 5};
+/*!
+ * \brief SNMP variable Identifier of number of classes which exceed threshold.
+ */
+static oid OID_ALERT_CLS_NUM[] = {SNMP_OID_HEAPALERT, 6};
 
 /*!
  * \brief SNMP variable Identifier of raise Java heap alert date.
@@ -451,37 +458,51 @@ int HeapDeltaCmp(const void *arg1, const void *arg2) {
   }
 }
 
+/*!
+ * \brief Get length of snapshot header in file.
+ * \param header [in] Snapshot file information.
+ * \return Length of header.
+ */
+inline size_t getHeaderLength(const TSnapShotFileHeader &header) {
+  size_t length = sizeof(TSnapShotFileHeader) - sizeof(header.gcCause) +
+                  header.gcCauseLen;
+
+  /* Estimation fields are written only in sampled snapshot. */
+  if ((header.magicNumber & EXTENDED_SAMPLED_SNAPSHOT) !=
+      EXTENDED_SAMPLED_SNAPSHOT) {
+    length -= sizeof(TSnapShotFileHeader) -
+              offsetof(TSnapShotFileHeader, sampleRate);
+  }
+
+  return length;
+}
+
 /*!
  * \brief Output snapshot header information to file.
- * \param fd     [in] Target file descriptor.
+ * \param writer [in] Writer of snapshot file.
+ * \param offset [in] File offset of header.
  * \param header [in] Snapshot file information.
  * \return Value is zero, if process is succeed.<br />
  *         Value is error number a.k.a. "errno", if process is failure.
  */
-inline int writeHeader(const int fd, TSnapShotFileHeader header) {
-  int result = 0;
-  try {
-    /* Write header param before GC-cause. */
-    if (unlikely(write(fd, &header, offsetof(TSnapShotFileHeader, gcCause)) <
-                 0)) {
-      throw 1;
-    }
+inline int writeHeader(TAsyncFile *writer, off_t offset,
+                       TSnapShotFileHeader header) {
+  /* Header is packed to a request, because GC-cause is variable length. */
+  char buffer[sizeof(TSnapShotFileHeader)];
+  size_t pos = offsetof(TSnapShotFileHeader, gcCause);
 
-    /* Write GC-cause. */
-    if (unlikely(write(fd, header.gcCause, header.gcCauseLen) < 0)) {
-      throw 1;
-    }
+  /* Header param before GC-cause. */
+  memcpy(buffer, &header, pos);
 
-    /* Write header param after gccause. */
-    if (unlikely(write(fd, &header.FGCCount,
-                       sizeof(TSnapShotFileHeader) -
-                           offsetof(TSnapShotFileHeader, FGCCount)) < 0)) {
-      throw 1;
-    }
-  } catch (...) {
-    result = errno;
-  }
-  return result;
+  /* GC-cause. */
+  memcpy(buffer + pos, header.gcCause, header.gcCauseLen);
+  pos += header.gcCauseLen;
+
+  /* Header param after gccause. */
+  size_t length = getHeaderLength(header);
+  memcpy(buffer + pos, &header.FGCCount, length - pos);
+
+  return writer->pwrite(buffer, length, offset);
 }
 
 /*!
@@ -564,15 +585,19 @@ inline bool sendMemoryUsageAlertTrap(TTrapSender *pSender,
 }
 
 /*!
- * \brief Send class information by SNMP trap.
+ * \brief Send class information by SNMP trap.<br>
+ *        Alerts in a snapshot are coalesced into one trap which has
+ *        the largest class and the number of alerted classes.
  * \param pSender       [in] SNMP trap sender.
  * \param heapUsage     [in] Heap usage information of sending target class.
  * \param className     [in] Name of sending target class(JNI format string).
  * \param instanceCount [in] Number of instance of sending target class.
+ * \param alertCount    [in] Number of classes which exceed the threshold.
  * \return Process result.
  */
 inline bool sendHeapAlertTrap(TTrapSender *pSender, THeapDelta heapUsage,
-                              char *className, jlong instanceCount) {
+                              char *className, jlong instanceCount,
+                              jlong alertCount) {
   /* Setting trap information. */
   char paramStr[256];
   /* Trap OID. */
@@ -618,6 +643,11 @@ inline bool sendHeapAlertTrap(TTrapSender *pSender, THeapDelta heapUsage,
     pSender->addValue(OID_ALERT_CLS_COUNT, OID_LENGTH(OID_ALERT_CLS_COUNT),
                       paramStr, SNMP_VAR_TYPE_COUNTER64);
 
+    /* Set number of alerted classes. */
+    sprintf(paramStr, JLONG_FORMAT_STR, alertCount);
+    pSender->addValue(OID_ALERT_CLS_NUM, OID_LENGTH(OID_ALERT_CLS_NUM),
+                      paramStr, SNMP_VAR_TYPE_COUNTER64);
+
     /* Send trap. */
     if (unlikely(pSender->sendTrap() != SNMP_PROC_SUCCESS)) {
       /* Clean up. */
@@ -630,41 +660,96 @@ inline bool sendHeapAlertTrap(TTrapSender *pSender, THeapDelta heapUsage,
   return result;
 }
 
+/*!
+ * \brief Set estimation of sampled heap census to header.<br>
+ *        Sampled objects follow Poisson sampling, so 95% confidence
+ *        intervals of Horvitz-Thompson estimators are written.
+ * \param hdr      [in,out] Snapshot file information.
+ * \param snapshot [in]     Snapshot instance which is merged.
+ */
+inline void setSamplingInfo(TSnapShotFileHeader *hdr,
+                            TSnapShotContainer *snapshot) {
+  double rate = snapshot->getSampleRate() / 100.0;
+
+  hdr->sampleRate = snapshot->getSampleRate();
+  hdr->sampledObjects = snapshot->getSampledObjects();
+  hdr->countError =
+      (jlong)(1.96 * sqrt(hdr->sampledObjects * (1.0 - rate)) / rate + 0.5);
+  hdr->sizeError = (jlong)(
+      1.96 * sqrt(snapshot->getSampledSquareSize() * (1.0 - rate)) / rate +
+      0.5);
+}
+
+/*!
+ * \brief Scale counter of sampled objects up to estimation of all objects.
+ * \param counter    [in,out] Counter of sampled objects.
+ * \param sampleRate [in]     Percentage of sampled objects.
+ */
+inline void scaleSampledCounter(TObjectCounter *counter, jlong sampleRate) {
+  /* Snapshot which is skipped by governor has no sampled objects. */
+  if (unlikely(sampleRate <= 0)) {
+    return;
+  }
+
+  counter->count = (counter->count * 100 + sampleRate / 2) / sampleRate;
+  counter->total_size =
+      (counter->total_size * 100 + sampleRate / 2) / sampleRate;
+}
+
+/*!
+ * \brief Scale class counter and its reference edges of sampled objects.
+ * \param clsCounter [in,out] Class counter which is merged from children.
+ * \param sampleRate [in]     Percentage of sampled objects.
+ */
+inline void scaleSampledCounters(TClassCounter *clsCounter,
+                                 jlong sampleRate) {
+  scaleSampledCounter(clsCounter->counter, sampleRate);
+
+  for (TChildClassCounter *childCounter = clsCounter->child;
+       childCounter != NULL; childCounter = childCounter->next) {
+    scaleSampledCounter(childCounter->counter, sampleRate);
+  }
+}
+
 /*!
  * \brief Output class information to file.
- * \param fd      [in] Target file descriptor.
- * \param objData [in] The class information.
- * \param cur     [in] The class size counter.
+ * \param writer      [in] Writer of snapshot file.
+ * \param objData     [in] The class information.
+ * \param cur         [in] The class size counter.
+ * \param withRefTree [in] Output children-class-information or not.
  * \return Value is zero, if process is succeed.<br />
  *         Value is error number a.k.a. "errno", if process is failure.
  */
-inline int writeClassData(const int fd, const TObjectData *objData,
-                          const TClassCounter *cur) {
+inline int writeClassData(TAsyncFile *writer, const TObjectData *objData,
+                          const TClassCounter *cur, bool withRefTree) {
   int result = 0;
   /* Output class-information. */
   try {
     /* Output TObjectData.tag & TObjectData.classNameLen. */
-    if (unlikely(write(fd, objData, sizeof(jlong) << 1) < 0)) {
+    if (unlikely((result = writer->write(objData, sizeof(jlong) << 1)) != 0)) {
       throw 1;
     }
 
     /* Output class name. */
-    if (unlikely(write(fd, objData->className, objData->classNameLen) < 0)) {
+    if (unlikely((result = writer->write(objData->className,
+                                         objData->classNameLen)) != 0)) {
       throw 1;
     }
 
     /* Output class loader's instance id and class tag. */
-    if (unlikely(write(fd, &objData->clsLoaderId, sizeof(jlong) << 1) < 0)) {
+    if (unlikely((result = writer->write(&objData->clsLoaderId,
+                                         sizeof(jlong) << 1)) != 0)) {
       throw 1;
     }
 
     /* Output class instance count and heap usage. */
-    if (unlikely(write(fd, cur->counter, sizeof(TObjectCounter)) < 0)) {
+    if (unlikely((result = writer->write(cur->counter,
+                                         sizeof(TObjectCounter))) != 0)) {
       throw 1;
     }
 
     /* Output children-class-information. */
-    if (conf->CollectRefTree()->get()) {
+    if (withRefTree) {
       TChildClassCounter *childCounter = cur->child;
 
       while (childCounter != NULL) {
@@ -673,13 +758,15 @@ inline int writeClassData(const int fd, const TObjectData *objData,
                    (childCounter->counter->total_size > 0))) {
           /* Output child class tag. */
           jlong childClsTag = (uintptr_t)childCounter->objData;
-          if (unlikely(write(fd, &childClsTag, sizeof(jlong)) < 0)) {
+          if (unlikely((result = writer->write(&childClsTag,
+                                               sizeof(jlong))) != 0)) {
             throw 1;
           }
 
           /* Output child class instance count and heap usage. */
-          if (unlikely(
-              write(fd, childCounter->counter, sizeof(TObjectCounter)) < 0)) {
+          if (unlikely((result = writer->write(childCounter->counter,
+                                               sizeof(TObjectCounter))) !=
+                       0)) {
             throw 1;
           }
         }
@@ -690,15 +777,15 @@ inline int writeClassData(const int fd, const TObjectData *objData,
 
       /* Output end-marker of children-class-information. */
       const jlong childClsEndMarker[] = {-1, -1, -1};
-      if (unlikely(
-          write(fd, childClsEndMarker, sizeof(childClsEndMarker)) < 0)) {
+      if (unlikely((result = writer->write(childClsEndMarker,
+                                           sizeof(childClsEndMarker))) != 0)) {
         throw 1;
       }
 
     }
 
   } catch (...) {
-    result = errno;
+    ; /* Error number is already set to result. */
   }
 
   return result;
@@ -727,6 +814,19 @@ int TClassContainer::afterTakeSnapShot(TSnapShotContainer *snapshot,
   hdr.safepointTime = jvmInfo->getSafepointTime();
   hdr.magicNumber |= EXTENDED_SAFEPOINT_TIME;
 
+  /* Reference tree might be disabled by overhead governor. */
+  bool withRefTree = ((hdr.magicNumber & EXTENDED_REFTREE_SNAPSHOT) ==
+                      EXTENDED_REFTREE_SNAPSHOT);
+
+  /*
+   * Set estimation if heap census is sampled.
+   * Skipped snapshot (sampling rate is 0) cannot be estimated.
+   */
+  bool isSampled = snapshot->isSampling() && !snapshot->isSkipped();
+  if (isSampled) {
+    setSamplingInfo(&hdr, snapshot);
+  }
+
   /* If java heap usage alert is enable. */
   if (conf->getHeapAlertThreshold() > 0) {
     jlong usage = hdr.newAreaSize + hdr.oldAreaSize;
@@ -809,7 +909,8 @@ int TClassContainer::afterTakeSnapShot(TSnapShotContainer *snapshot,
 
   /* Open file and seek EOF. */
 
-  int fd = open(conf->FileName()->get(), O_CREAT | O_WRONLY, S_IRUSR | S_IWUSR);
+  TSnapShotFile *snapShotFile = TSnapShotFile::getInstance();
+  int fd = snapShotFile->openSegment(hdr.snapShotTime);
   /* If failure open file. */
   if (unlikely(fd < 0)) {
     int raisedErrNum = errno;
@@ -820,27 +921,32 @@ int TClassContainer::afterTakeSnapShot(TSnapShotContainer *snapshot,
   }
 
   off_t oldFileOffset = -1;
+  TAsyncFile *writer = NULL;
   try {
     /* Move position to EOF. */
     oldFileOffset = lseek(fd, 0, SEEK_END);
     /* If failure seek. */
     if (unlikely(oldFileOffset < 0)) {
-      throw 1;
+      throw errno;
     }
 
-    /* Frist, Output each classes information. Secondly output header. */
-    if (unlikely(lseek(fd, sizeof(TSnapShotFileHeader) - sizeof(char[80]) +
-                               hdr.gcCauseLen,
-                       SEEK_CUR) < 0)) {
-      throw 1;
-    }
+    /*
+     * Frist, Output each classes information. Secondly output header.
+     * Class information is written while next classes are processed.
+     */
+    writer = new TAsyncFile(fd, oldFileOffset + getHeaderLength(hdr));
+  } catch (int errNum) {
+    logger->printWarnMsg("Could not write snapshot");
+    close(fd);
+    delete sortArray;
+    delete workClsMap;
+    return errNum;
   } catch (...) {
-    int raisedErrNum = errno;
     logger->printWarnMsg("Could not write snapshot");
     close(fd);
     delete sortArray;
     delete workClsMap;
-    return raisedErrNum;
+    return ENOMEM;
   }
 
   /* Output class information. */
@@ -850,6 +956,12 @@ int TClassContainer::afterTakeSnapShot(TSnapShotContainer *snapshot,
   int raiseErrorCode = 0;
   register jlong AlertThreshold = conf->getAlertThreshold();
 
+  /* The largest class over threshold to send trap. */
+  jlong alertCount = 0;
+  THeapDelta alertResult = {0};
+  char *alertClassName = NULL;
+  jlong alertInstanceCount = 0;
+
   /* Loop each class. */
   for (TClassMap::iterator it = workClsMap->begin(); it != workClsMap->end();
        ++it) {
@@ -867,6 +979,11 @@ int TClassContainer::afterTakeSnapShot(TSnapShotContainer *snapshot,
       }
     }
 
+    /* Estimate all objects from sampled objects. */
+    if (isSampled) {
+      scaleSampledCounters(cur, hdr.sampleRate);
+    }
+
     /* Calculate uasge and delta size. */
     result.usage = cur->counter->total_size;
     result.delta = cur->counter->total_size - objData->oldTotalSize;
@@ -877,7 +994,7 @@ int TClassContainer::afterTakeSnapShot(TSnapShotContainer *snapshot,
     if (!conf->ReduceSnapShot()->get() || (result.usage > 0)) {
       /* Output class-information. */
       if (likely(raiseErrorCode == 0)) {
-        raiseErrorCode = writeClassData(fd, objData, cur);
+        raiseErrorCode = writeClassData(writer, objData, cur, withRefTree);
       }
 
       numEntries++;
@@ -908,15 +1025,28 @@ int TClassContainer::afterTakeSnapShot(TSnapShotContainer *snapshot,
         sendFlag = 1;
       }
 
-      /* If need send trap. */
-      if (conf->SnmpSend()->get() && sendFlag != 0) {
-        if (unlikely(!sendHeapAlertTrap(pSender, result, objData->className,
-                                        cur->counter->count))) {
-          logger->printWarnMsg("Send SNMP trap failed!");
+      /* Keep the largest class to send trap after loop. */
+      if (sendFlag != 0) {
+        if ((alertCount == 0) ||
+            ((order == DELTA) ? (result.delta > alertResult.delta)
+                              : (result.usage > alertResult.usage))) {
+          alertResult = result;
+          alertClassName = objData->className;
+          alertInstanceCount = cur->counter->count;
         }
+
+        alertCount++;
       }
     }
   }
+
+  /* If need send trap. */
+  if (conf->SnmpSend()->get() && (alertCount > 0)) {
+    if (unlikely(!sendHeapAlertTrap(pSender, alertResult, alertClassName,
+                                    alertInstanceCount, alertCount))) {
+      logger->printWarnMsg("Send SNMP trap failed!");
+    }
+  }
   delete workClsMap;
 
   /* Set output entry count. */
@@ -931,33 +1061,34 @@ int TClassContainer::afterTakeSnapShot(TSnapShotContainer *snapshot,
       throw 1;
     }
 
-    /* If fail seeking to header position. */
-    if (unlikely(lseek(fd, oldFileOffset, SEEK_SET) < 0)) {
-      raisedErrNum = errno;
-      throw 2;
-    }
-
-    raisedErrNum = writeHeader(fd, hdr);
+    raisedErrNum = writeHeader(writer, oldFileOffset, hdr);
     /* If failed to write a snapshot header. */
     if (unlikely(raisedErrNum != 0)) {
-      throw 3;
+      throw 2;
     }
   } catch (...) {
     ; /* Failed to write file. */
   }
 
+  /*
+   * Wait for all data. Error of in-flight data is reported here.
+   * Rollback must not be done until all requests are completed.
+   */
+  int writtenErrNum = writer->finish();
+  if (raisedErrNum == 0) {
+    raisedErrNum = writtenErrNum;
+  }
+  delete writer;
+
   /* Clean up. */
   if (unlikely(close(fd) != 0 && raisedErrNum == 0)) {
     errno = raisedErrNum;
     logger->printWarnMsgWithErrno("Could not write snapshot");
   }
 
-  /* If need rollback snapshot. */
-  if (unlikely(raisedErrNum != 0)) {
-    if (unlikely(truncate(conf->FileName()->get(), oldFileOffset) < 0)) {
-      logger->printWarnMsgWithErrno("Could not rollback snapshot");
-    }
-  }
+  /* Rollback snapshot if need, and update state of the segment. */
+  snapShotFile->finishSegment(hdr.snapShotTime, oldFileOffset,
+                              raisedErrNum == 0);
 
   /* Cleanup. */
   (*rank) = sortArray;
@@ -24,6 +24,7 @@
 
 #include "globals.hpp"
 #include "util.hpp"
+#include "cmdHelper.hpp"
 #include "cmdArchiver.hpp"
 
 /*!
@@ -133,6 +134,20 @@ int TCmdArchiver::execute(char *cmdline) {
     return -1;
   }
 
+  /* Execute command in helper process to avoid forking JVM. */
+  TCmdHelper *helper = TCmdHelper::getInstance();
+  if (likely(helper != NULL) && helper->execute(argArray, &result)) {
+    if (unlikely(result != 0)) {
+      logger->printWarnMsg("Failure execute archive command.");
+    }
+
+    /* Cleanup. */
+    free(argArray[0]);
+    free(argArray);
+
+    return result;
+  }
+
   /* Fork process without copy. */
   pid_t forkPid = vfork();
 
@@ -0,0 +1,301 @@
+/*!
+ * \file cmdHelper.cpp
+ * \brief This file is used to execute external command in helper process.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#include "globals.hpp"
+#include "util.hpp"
+#include "cmdHelper.hpp"
+
+/*!
+ * \brief Singleton instance of TCmdHelper.
+ */
+TCmdHelper *TCmdHelper::inst = NULL;
+
+/*!
+ * \brief Mutex to serialize requests.
+ */
+pthread_mutex_t TCmdHelper::requestMutex =
+    PTHREAD_ADAPTIVE_MUTEX_INITIALIZER_NP;
+
+/*!
+ * \brief Global initialization.
+ * \return Process result.
+ * \warning Please call only once from main thread.
+ */
+bool TCmdHelper::globalInitialize(void) {
+  try {
+    inst = new TCmdHelper();
+  } catch (...) {
+    logger->printWarnMsg("Cannot initialize TCmdHelper.");
+    return false;
+  }
+
+  return true;
+}
+
+/*!
+ * \brief Global finalization.
+ */
+void TCmdHelper::globalFinalize(void) {
+  delete inst;
+  inst = NULL;
+}
+
+/*!
+ * \brief TCmdHelper constructor.
+ */
+TCmdHelper::TCmdHelper(void) {
+  int fds[2];
+  if (unlikely(socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) !=
+               0)) {
+    int raisedErrNum = errno;
+    logger->printWarnMsgWithErrno("Could not create socket for helper.");
+    throw raisedErrNum;
+  }
+
+  helperPid = fork();
+  if (helperPid == 0) {
+    /* Helper process. */
+    close(fds[0]);
+    helperMain(fds[1]);
+  } else if (unlikely(helperPid < 0)) {
+    int raisedErrNum = errno;
+    logger->printWarnMsgWithErrno("Could not fork helper process.");
+    close(fds[0]);
+    close(fds[1]);
+    throw raisedErrNum;
+  }
+
+  close(fds[1]);
+  sockFd = fds[0];
+
+  /* Don't wait for hung command forever. */
+  struct timeval timeout = {CMD_HELPER_TIMEOUT, 0};
+  if (unlikely(setsockopt(sockFd, SOL_SOCKET, SO_RCVTIMEO, &timeout,
+                          sizeof(timeout)) != 0)) {
+    logger->printWarnMsgWithErrno("Could not set timeout of archive helper.");
+  }
+}
+
+/*!
+ * \brief TCmdHelper destructor.
+ */
+TCmdHelper::~TCmdHelper(void) { shutdown(); }
+
+/*!
+ * \brief Close socket and reap helper process.<br>
+ *        Helper process exits when it reads EOF.
+ */
+void TCmdHelper::shutdown(void) {
+  if (sockFd >= 0) {
+    close(sockFd);
+    sockFd = -1;
+
+    while ((waitpid(helperPid, NULL, 0) < 0) && (errno == EINTR)) {
+      /* Retry. */
+    }
+  }
+}
+
+/*!
+ * \brief Main loop of helper process.<br>
+ *        This process is forked from JVM, so only system calls are used.
+ *        Memory allocation might be deadlocked because other threads in JVM
+ *        might hold a lock of malloc at fork.<br>
+ *        Commands are executed with environment variables of JVM at spawn.
+ *        <br>
+ *        This process exits when it reads EOF from the socket. It is closed
+ *        when JVM exits. PR_SET_PDEATHSIG is not used because it fires when
+ *        the thread which forked this process exits, not the JVM.
+ * \param fd [in] Socket to agent.
+ * \warning This function never returns.
+ */
+void TCmdHelper::helperMain(int fd) {
+  static char request[CMD_HELPER_MAX_REQUEST];
+  static char *argv[CMD_HELPER_MAX_ARGS + 1];
+  extern char **environ;
+
+  /* Signal handlers of JVM cannot work in this process. */
+  sigset_t sigMask;
+  sigemptyset(&sigMask);
+  sigprocmask(SIG_SETMASK, &sigMask, NULL);
+  for (int sig = 1; sig < NSIG; sig++) {
+    signal(sig, SIG_DFL);
+  }
+
+  /*
+   * Leave process group of JVM to ignore keyboard signals, and to kill
+   * running command together with this process on timeout.
+   */
+  setsid();
+
+  /* Close all file descriptors except standard streams and the socket. */
+  struct rlimit fdLimit;
+  int maxFd = 1024;
+  if ((getrlimit(RLIMIT_NOFILE, &fdLimit) == 0) &&
+      (fdLimit.rlim_cur != RLIM_INFINITY)) {
+    maxFd = (int)fdLimit.rlim_cur;
+  }
+  for (int i = 3; i < maxFd; i++) {
+    if (i != fd) {
+      close(i);
+    }
+  }
+
+  while (true) {
+    ssize_t len = recv(fd, request, sizeof(request) - 1, 0);
+    if (len == 0) {
+      /* Agent closed the socket. */
+      _exit(0);
+    } else if (unlikely(len < 0)) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      _exit(1);
+    }
+
+    /* Request is NUL-separated arguments. */
+    request[len] = '\0';
+    int argc = 0;
+    for (char *pos = request;
+         (pos < request + len) && (argc < CMD_HELPER_MAX_ARGS);
+         pos += strlen(pos) + 1) {
+      argv[argc++] = pos;
+    }
+    argv[argc] = NULL;
+
+    int result = 0;
+    pid_t child = (argc > 0) ? vfork() : -1;
+    if (child == 0) {
+      /* Command process. */
+      execve(argv[0], argv, environ);
+      _exit(errno);
+    } else if (unlikely(child < 0)) {
+      result = (argc > 0) ? errno : EINVAL;
+    } else {
+      int st = 0;
+      while ((waitpid(child, &st, 0) < 0) && (errno == EINTR)) {
+        /* Retry. */
+      }
+
+      result = WIFEXITED(st) ? WEXITSTATUS(st) : -1;
+    }
+
+    if (unlikely(send(fd, &result, sizeof(result), MSG_NOSIGNAL) < 0)) {
+      _exit(1);
+    }
+  }
+}
+
+/*!
+ * \brief Execute command in helper process.
+ * \param argv   [in]  Arguments of command. argv[0] is path of command.
+ * \param result [out] Exit status of command, -1 if command was killed,
+ *                     or error number of fork.
+ * \return false if helper process is not available.<br>
+ *         Command should be executed by other way in this case.<br>
+ *         If the command timed out, it is killed and this function returns
+ *         true with -1 as result.
+ */
+bool TCmdHelper::execute(char *const *argv, int *result) {
+  /* Build request. */
+  size_t len = 0;
+  for (int i = 0; argv[i] != NULL; i++) {
+    if (unlikely(i >= CMD_HELPER_MAX_ARGS)) {
+      return false;
+    }
+    len += strlen(argv[i]) + 1;
+  }
+
+  if (unlikely((len == 0) || (len >= CMD_HELPER_MAX_REQUEST))) {
+    return false;
+  }
+
+  char *request = (char *)malloc(len);
+  if (unlikely(request == NULL)) {
+    return false;
+  }
+
+  char *pos = request;
+  for (int i = 0; argv[i] != NULL; i++) {
+    size_t argLen = strlen(argv[i]) + 1;
+    memcpy(pos, argv[i], argLen);
+    pos += argLen;
+  }
+
+  bool isSucceeded = false;
+  bool isTimedOut = false;
+  ENTER_PTHREAD_SECTION(&requestMutex) {
+    if (likely(sockFd >= 0)) {
+      ssize_t ret;
+      while (((ret = send(sockFd, request, len, MSG_NOSIGNAL)) < 0) &&
+             (errno == EINTR)) {
+        /* Retry. */
+      }
+
+      if (likely(ret == (ssize_t)len)) {
+        while (((ret = recv(sockFd, result, sizeof(int), 0)) < 0) &&
+               (errno == EINTR)) {
+          /* Retry. */
+        }
+        isSucceeded = (ret == sizeof(int));
+        isTimedOut =
+            (ret < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK));
+      }
+
+      if (unlikely(isTimedOut)) {
+        /*
+         * Kill helper process and running command.
+         * The command is regarded as failure because it would hang again
+         * if it were executed by other way.
+         */
+        logger->printWarnMsg(
+            "Archive helper process did not respond in %d sec.",
+            CMD_HELPER_TIMEOUT);
+        if (kill(-helperPid, SIGKILL) != 0) {
+          kill(helperPid, SIGKILL);
+        }
+        *result = -1;
+      } else if (unlikely(!isSucceeded)) {
+        /* Helper process has been terminated. */
+        logger->printWarnMsg("Archive helper process is not available.");
+      }
+
+      if (unlikely(!isSucceeded)) {
+        shutdown();
+      }
+    }
+  }
+  EXIT_PTHREAD_SECTION(&requestMutex)
+
+  free(request);
+  return isSucceeded || isTimedOut;
+}
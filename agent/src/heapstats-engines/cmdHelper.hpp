@@ -0,0 +1,130 @@
+/*!
+ * \file cmdHelper.hpp
+ * \brief This file is used to execute external command in helper process.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#ifndef CMD_HELPER_HPP
+#define CMD_HELPER_HPP
+
+#include <pthread.h>
+#include <sys/types.h>
+
+/*!
+ * \brief Max size of a request which is sent to helper process.
+ */
+#define CMD_HELPER_MAX_REQUEST 65536
+
+/*!
+ * \brief Max number of arguments in a request.
+ */
+#define CMD_HELPER_MAX_ARGS 255
+
+/*!
+ * \brief Timeout of a request to helper process (in seconds).<br>
+ *        Command is killed and regarded as failure if it isn't finished
+ *        in time.
+ */
+#define CMD_HELPER_TIMEOUT 300
+
+/*!
+ * \brief This class spawns small helper process at agent initialization,
+ *        and executes external commands in it.<br>
+ *        Helper process is forked when JVM is still small, so the command
+ *        can be run without forking JVM which might have large RSS at
+ *        collecting log. Arguments are sent through SOCK_SEQPACKET socket,
+ *        and exit status is returned in the same way.
+ */
+class TCmdHelper {
+ private:
+  /*!
+   * \brief Singleton instance of TCmdHelper.
+   */
+  static TCmdHelper *inst;
+
+  /*!
+   * \brief Mutex to serialize requests.
+   */
+  static pthread_mutex_t requestMutex;
+
+  /*!
+   * \brief Socket to helper process. -1 if helper is not available.
+   */
+  int sockFd;
+
+  /*!
+   * \brief Process ID of helper process.
+   */
+  pid_t helperPid;
+
+  /*!
+   * \brief Close socket and reap helper process.
+   */
+  void shutdown(void);
+
+  /*!
+   * \brief Main loop of helper process.
+   * \param fd [in] Socket to agent.
+   * \warning This function never returns.
+   */
+  static void helperMain(int fd);
+
+ protected:
+  /*!
+   * \brief TCmdHelper constructor.
+   */
+  TCmdHelper(void);
+
+  /*!
+   * \brief TCmdHelper destructor.
+   */
+  virtual ~TCmdHelper(void);
+
+ public:
+  /*!
+   * \brief Global initialization.
+   * \return Process result.
+   * \warning Please call only once from main thread.
+   */
+  static bool globalInitialize(void);
+
+  /*!
+   * \brief Global finalization.
+   */
+  static void globalFinalize(void);
+
+  /*!
+   * \brief Get singleton instance of TCmdHelper.
+   * \return Instance of TCmdHelper.
+   */
+  inline static TCmdHelper *getInstance() { return inst; };
+
+  /*!
+   * \brief Execute command in helper process.
+   * \param argv   [in]  Arguments of command. argv[0] is path of command.
+   * \param result [out] Exit status of command, -1 if command was killed,
+   *                     or error number of fork.
+   * \return false if helper process is not available.<br>
+   *         Command should be executed by other way in this case.<br>
+   *         If the command timed out, it is killed and this function returns
+   *         true with -1 as result.
+   */
+  bool execute(char *const *argv, int *result);
+};
+
+#endif  // CMD_HELPER_HPP
@@ -80,9 +80,25 @@ void TConfiguration::initializeConfig(const TConfiguration *src) {
     fileName =
         new TStringConfig(this, "file", (char *)"heapstats_snapshot.dat",
                           &ReadStringValue, (TStringConfig::TFinalizer) & free);
+    snapShotRotateSize = new TLongConfig(this, "snapshot_rotate_size", 0);
+    snapShotRotateInterval =
+        new TLongConfig(this, "snapshot_rotate_interval", 0);
+    snapShotRotateCount = new TIntConfig(this, "snapshot_rotate_count", 0);
+    snapShotPreallocate =
+        new TBooleanConfig(this, "snapshot_preallocate", false);
+    asyncIO = new TStringConfig(this, "async_io", (char *)"auto",
+                                &ReadStringValue,
+                                (TStringConfig::TFinalizer) & free);
+    asyncIOThreads = new TIntConfig(this, "async_io_threads", 2);
+    fsyncPolicy = new TStringConfig(this, "fsync_policy", (char *)"none",
+                                    &ReadStringValue,
+                                    (TStringConfig::TFinalizer) & free);
     heapLogFile =
         new TStringConfig(this, "heaplogfile", (char *)"heapstats_log.csv",
                           &ReadStringValue, (TStringConfig::TFinalizer) & free);
+    heapLogBinary = new TBooleanConfig(this, "heaplog_binary", false);
+    heapLogBinaryRecords =
+        new TIntConfig(this, "heaplog_binary_records", 86400);
     archiveFile =
         new TStringConfig(this, "archivefile", (char *)"heapstats_analyze.zip",
                           &ReadStringValue, (TStringConfig::TFinalizer) & free);
@@ -90,12 +106,58 @@ void TConfiguration::initializeConfig(const TConfiguration *src) {
                                 (TStringConfig::TFinalizer) & free);
     reduceSnapShot = new TBooleanConfig(this, "reduce_snapshot", true);
     collectRefTree = new TBooleanConfig(this, "collect_reftree", true);
+    snapShotSampleRate = new TIntConfig(this, "snapshot_sample_rate", 100);
+    gcOverheadGovernor = new TBooleanConfig(this, "gc_overhead_governor",
+                                            false, &setOnewayBooleanValue);
+    gcOverheadBudget = new TIntConfig(this, "gc_overhead_budget", 10);
+    gcOverheadSampleRate =
+        new TIntConfig(this, "gc_overhead_sample_rate", 10);
+    gcOverheadRecoverCount =
+        new TIntConfig(this, "gc_overhead_recover_count", 5);
     triggerOnFullGC = new TBooleanConfig(this, "trigger_on_fullgc", true,
                                          &setOnewayBooleanValue);
     triggerOnDump = new TBooleanConfig(this, "trigger_on_dump", true,
                                        &setOnewayBooleanValue);
     checkDeadlock = new TBooleanConfig(this, "check_deadlock", false,
                                        &setOnewayBooleanValue);
+    monitorProfile = new TBooleanConfig(this, "monitor_profile", false,
+                                        &setOnewayBooleanValue);
+    monitorProfileRank = new TIntConfig(this, "monitor_profile_rank", 10);
+    monitorProfileStackDepth =
+        new TIntConfig(this, "monitor_profile_stack_depth", 0);
+    cpuProfile = new TBooleanConfig(this, "cpu_profile", false,
+                                    &setOnewayBooleanValue);
+    cpuProfileFrequency = new TIntConfig(this, "cpu_profile_frequency", 100);
+    cpuProfileFileName = new TStringConfig(
+        this, "cpu_profile_filename", (char *)"heapstats-cpu-profile.txt",
+        &ReadStringValue, (TStringConfig::TFinalizer) & free);
+    allocProfile = new TBooleanConfig(this, "alloc_profile", false,
+                                      &setOnewayBooleanValue);
+    allocProfileInterval =
+        new TIntConfig(this, "alloc_profile_interval", 524288);
+    allocProfileRank = new TIntConfig(this, "alloc_profile_rank", 10);
+    allocProfileStackDepth =
+        new TIntConfig(this, "alloc_profile_stack_depth", 8);
+    threadCpuProfile = new TBooleanConfig(this, "thread_cpu_profile", false,
+                                          &setOnewayBooleanValue);
+    threadCpuProfileRank = new TIntConfig(this, "thread_cpu_profile_rank", 10);
+    perfSampler = new TBooleanConfig(this, "perf_sampler", false,
+                                     &setOnewayBooleanValue);
+    perfSamplerInterval = new TIntConfig(this, "perf_sampler_interval", 100);
+    perfSamplerRecords = new TIntConfig(this, "perf_sampler_records", 600);
+    perfSamplerCounters = new TStringConfig(
+        this, "perf_sampler_counters", NULL, &ReadStringValue,
+        (TStringConfig::TFinalizer) & free);
+    liveCounter = new TBooleanConfig(this, "live_counter", false,
+                                     &setOnewayBooleanValue);
+    liveCounterFile = new TStringConfig(this, "live_counter_file", NULL,
+                                        &ReadStringValue,
+                                        (TStringConfig::TFinalizer) & free);
+    metricsServer = new TBooleanConfig(this, "metrics_server", false,
+                                       &setOnewayBooleanValue);
+    metricsSocket = new TStringConfig(this, "metrics_socket", NULL,
+                                      &ReadStringValue,
+                                      (TStringConfig::TFinalizer) & free);
     triggerOnLogError = new TBooleanConfig(this, "trigger_on_logerror", true,
                                            &setOnewayBooleanValue);
     triggerOnLogSignal = new TBooleanConfig(this, "trigger_on_logsignal", true,
@@ -130,6 +192,12 @@ void TConfiguration::initializeConfig(const TConfiguration *src) {
         this, "thread_record_iotracer",
         (char *)DEFAULT_CONF_DIR "/IoTrace.class",
         &ReadStringValue, (TStringConfig::TFinalizer) & free);
+    threadRecordIOStatsEntries =
+        new TIntConfig(this, "thread_record_iostats_entries", 256);
+    threadRecordIOStatsFileName = new TStringConfig(
+        this, "thread_record_iostats_filename",
+        (char *)"heapstats-iostats.csv", &ReadStringValue,
+        (TStringConfig::TFinalizer) & free);
     snmpSend =
         new TBooleanConfig(this, "snmp_send", false, &setOnewayBooleanValue);
     snmpTarget =
@@ -141,6 +209,7 @@ void TConfiguration::initializeConfig(const TConfiguration *src) {
     snmpLibPath =
         new TStringConfig(this, "snmp_libpath", (char *)LIBNETSNMP_PATH,
                           &setSnmpLibPath, (TStringConfig::TFinalizer) & free);
+    snmpTrapRate = new TIntConfig(this, "snmp_trap_rate", 10);
     logDir = new TStringConfig(this, "logdir", (char *)"./tmp",
                                &ReadStringValue,
                                (TStringConfig::TFinalizer) & free);
@@ -148,18 +217,61 @@ void TConfiguration::initializeConfig(const TConfiguration *src) {
         this, "archive_command",
         (char *)"/usr/bin/zip %archivefile% -jr %logdir%",
         &ReadStringValue, (TStringConfig::TFinalizer) & free);
+    nativeArchive = new TBooleanConfig(this, "native_archive", true);
+    archiveHelper = new TBooleanConfig(this, "archive_helper", true,
+                                       &setOnewayBooleanValue);
+    memMapSummary = new TBooleanConfig(this, "memmap_summary", true);
+    memMapSample = new TBooleanConfig(this, "memmap_sample", false);
+    symbolCache = new TBooleanConfig(this, "symbol_cache", true);
+    symbolCacheDir = new TStringConfig(this, "symbol_cache_dir", NULL,
+                                       &ReadStringValue,
+                                       (TStringConfig::TFinalizer) & free);
     killOnError = new TBooleanConfig(this, "kill_on_error", false);
   } else {
     attach = new TBooleanConfig(*src->attach);
     fileName = new TStringConfig(*src->fileName);
     heapLogFile = new TStringConfig(*src->heapLogFile);
+    heapLogBinary = new TBooleanConfig(*src->heapLogBinary);
+    heapLogBinaryRecords = new TIntConfig(*src->heapLogBinaryRecords);
+    snapShotRotateSize = new TLongConfig(*src->snapShotRotateSize);
+    snapShotRotateInterval = new TLongConfig(*src->snapShotRotateInterval);
+    snapShotRotateCount = new TIntConfig(*src->snapShotRotateCount);
+    snapShotPreallocate = new TBooleanConfig(*src->snapShotPreallocate);
+    asyncIO = new TStringConfig(*src->asyncIO);
+    asyncIOThreads = new TIntConfig(*src->asyncIOThreads);
+    fsyncPolicy = new TStringConfig(*src->fsyncPolicy);
     archiveFile = new TStringConfig(*src->archiveFile);
     logFile = new TStringConfig(*src->logFile);
     reduceSnapShot = new TBooleanConfig(*src->reduceSnapShot);
     collectRefTree = new TBooleanConfig(*src->collectRefTree);
+    snapShotSampleRate = new TIntConfig(*src->snapShotSampleRate);
+    gcOverheadGovernor = new TBooleanConfig(*src->gcOverheadGovernor);
+    gcOverheadBudget = new TIntConfig(*src->gcOverheadBudget);
+    gcOverheadSampleRate = new TIntConfig(*src->gcOverheadSampleRate);
+    gcOverheadRecoverCount = new TIntConfig(*src->gcOverheadRecoverCount);
     triggerOnFullGC = new TBooleanConfig(*src->triggerOnFullGC);
     triggerOnDump = new TBooleanConfig(*src->triggerOnDump);
     checkDeadlock = new TBooleanConfig(*src->checkDeadlock);
+    monitorProfile = new TBooleanConfig(*src->monitorProfile);
+    monitorProfileRank = new TIntConfig(*src->monitorProfileRank);
+    monitorProfileStackDepth = new TIntConfig(*src->monitorProfileStackDepth);
+    cpuProfile = new TBooleanConfig(*src->cpuProfile);
+    cpuProfileFrequency = new TIntConfig(*src->cpuProfileFrequency);
+    cpuProfileFileName = new TStringConfig(*src->cpuProfileFileName);
+    allocProfile = new TBooleanConfig(*src->allocProfile);
+    allocProfileInterval = new TIntConfig(*src->allocProfileInterval);
+    allocProfileRank = new TIntConfig(*src->allocProfileRank);
+    allocProfileStackDepth = new TIntConfig(*src->allocProfileStackDepth);
+    threadCpuProfile = new TBooleanConfig(*src->threadCpuProfile);
+    threadCpuProfileRank = new TIntConfig(*src->threadCpuProfileRank);
+    perfSampler = new TBooleanConfig(*src->perfSampler);
+    perfSamplerInterval = new TIntConfig(*src->perfSamplerInterval);
+    perfSamplerRecords = new TIntConfig(*src->perfSamplerRecords);
+    perfSamplerCounters = new TStringConfig(*src->perfSamplerCounters);
+    liveCounter = new TBooleanConfig(*src->liveCounter);
+    liveCounterFile = new TStringConfig(*src->liveCounterFile);
+    metricsServer = new TBooleanConfig(*src->metricsServer);
+    metricsSocket = new TStringConfig(*src->metricsSocket);
     triggerOnLogError = new TBooleanConfig(*src->triggerOnLogError);
     triggerOnLogSignal = new TBooleanConfig(*src->triggerOnLogSignal);
     triggerOnLogLock = new TBooleanConfig(*src->triggerOnLogLock);
@@ -179,25 +291,70 @@ void TConfiguration::initializeConfig(const TConfiguration *src) {
     threadRecordBufferSize = new TLongConfig(*src->threadRecordBufferSize);
     threadRecordFileName = new TStringConfig(*src->threadRecordFileName);
     threadRecordIOTracer = new TStringConfig(*src->threadRecordIOTracer);
+    threadRecordIOStatsEntries =
+        new TIntConfig(*src->threadRecordIOStatsEntries);
+    threadRecordIOStatsFileName =
+        new TStringConfig(*src->threadRecordIOStatsFileName);
     snmpSend = new TBooleanConfig(*src->snmpSend);
     snmpTarget = new TStringConfig(*src->snmpTarget);
     snmpComName = new TStringConfig(*src->snmpComName);
     snmpLibPath = new TStringConfig(*src->snmpLibPath);
+    snmpTrapRate = new TIntConfig(*src->snmpTrapRate);
     logDir = new TStringConfig(*src->logDir);
     archiveCommand = new TStringConfig(*src->archiveCommand);
+    nativeArchive = new TBooleanConfig(*src->nativeArchive);
+    archiveHelper = new TBooleanConfig(*src->archiveHelper);
+    memMapSummary = new TBooleanConfig(*src->memMapSummary);
+    memMapSample = new TBooleanConfig(*src->memMapSample);
+    symbolCache = new TBooleanConfig(*src->symbolCache);
+    symbolCacheDir = new TStringConfig(*src->symbolCacheDir);
     killOnError = new TBooleanConfig(*src->killOnError);
   }
 
   configs.push_back(attach);
   configs.push_back(fileName);
   configs.push_back(heapLogFile);
+  configs.push_back(heapLogBinary);
+  configs.push_back(heapLogBinaryRecords);
+  configs.push_back(snapShotRotateSize);
+  configs.push_back(snapShotRotateInterval);
+  configs.push_back(snapShotRotateCount);
+  configs.push_back(snapShotPreallocate);
+  configs.push_back(asyncIO);
+  configs.push_back(asyncIOThreads);
+  configs.push_back(fsyncPolicy);
   configs.push_back(archiveFile);
   configs.push_back(logFile);
   configs.push_back(reduceSnapShot);
   configs.push_back(collectRefTree);
+  configs.push_back(snapShotSampleRate);
+  configs.push_back(gcOverheadGovernor);
+  configs.push_back(gcOverheadBudget);
+  configs.push_back(gcOverheadSampleRate);
+  configs.push_back(gcOverheadRecoverCount);
   configs.push_back(triggerOnFullGC);
   configs.push_back(triggerOnDump);
   configs.push_back(checkDeadlock);
+  configs.push_back(monitorProfile);
+  configs.push_back(monitorProfileRank);
+  configs.push_back(monitorProfileStackDepth);
+  configs.push_back(cpuProfile);
+  configs.push_back(cpuProfileFrequency);
+  configs.push_back(cpuProfileFileName);
+  configs.push_back(allocProfile);
+  configs.push_back(allocProfileInterval);
+  configs.push_back(allocProfileRank);
+  configs.push_back(allocProfileStackDepth);
+  configs.push_back(threadCpuProfile);
+  configs.push_back(threadCpuProfileRank);
+  configs.push_back(perfSampler);
+  configs.push_back(perfSamplerInterval);
+  configs.push_back(perfSamplerRecords);
+  configs.push_back(perfSamplerCounters);
+  configs.push_back(liveCounter);
+  configs.push_back(liveCounterFile);
+  configs.push_back(metricsServer);
+  configs.push_back(metricsSocket);
   configs.push_back(triggerOnLogError);
   configs.push_back(triggerOnLogSignal);
   configs.push_back(triggerOnLogLock);
@@ -217,12 +374,21 @@ void TConfiguration::initializeConfig(const TConfiguration *src) {
   configs.push_back(threadRecordBufferSize);
   configs.push_back(threadRecordFileName);
   configs.push_back(threadRecordIOTracer);
+  configs.push_back(threadRecordIOStatsEntries);
+  configs.push_back(threadRecordIOStatsFileName);
   configs.push_back(snmpSend);
   configs.push_back(snmpTarget);
   configs.push_back(snmpComName);
   configs.push_back(snmpLibPath);
+  configs.push_back(snmpTrapRate);
   configs.push_back(logDir);
   configs.push_back(archiveCommand);
+  configs.push_back(nativeArchive);
+  configs.push_back(archiveHelper);
+  configs.push_back(memMapSummary);
+  configs.push_back(memMapSample);
+  configs.push_back(symbolCache);
+  configs.push_back(symbolCacheDir);
   configs.push_back(killOnError);
 }
 
@@ -438,7 +604,25 @@ void TConfiguration::printSetting(void) {
 
   /* Output filenames. */
   logger->printInfoMsg("SnapShot FileName = %s", fileName->get());
+  if ((snapShotRotateSize->get() > 0) || (snapShotRotateInterval->get() > 0)) {
+    logger->printInfoMsg(
+        "SnapShot Rotation = %ld bytes / %ld sec (keep %d, preallocate: %s)",
+        snapShotRotateSize->get(), snapShotRotateInterval->get(),
+        snapShotRotateCount->get(),
+        snapShotPreallocate->get() ? "true" : "false");
+  } else {
+    logger->printInfoMsg("SnapShot Rotation = false");
+  }
+  logger->printInfoMsg("Asynchronous I/O = %s (%d threads), fsync: %s",
+                       asyncIO->get(), asyncIOThreads->get(),
+                       fsyncPolicy->get());
   logger->printInfoMsg("Heap Log FileName = %s", heapLogFile->get());
+  if (heapLogBinary->get()) {
+    logger->printInfoMsg("Heap Log Format = binary (%d records)",
+                         heapLogBinaryRecords->get());
+  } else {
+    logger->printInfoMsg("Heap Log Format = CSV");
+  }
   logger->printInfoMsg("Archive FileName = %s", archiveFile->get());
   logger->printInfoMsg(
       "Console Log FileName = %s",
@@ -455,6 +639,21 @@ void TConfiguration::printSetting(void) {
   logger->printInfoMsg("CollectRefTree = %s",
                        collectRefTree->get() ? "true" : "false");
 
+  /* Output sampling rate of heap census. */
+  logger->printInfoMsg("SnapShot sample rate = %d %%",
+                       snapShotSampleRate->get());
+
+  /* Output status of GC overhead governor. */
+  if (gcOverheadGovernor->get()) {
+    logger->printInfoMsg(
+        "GC overhead governor = true (budget: %d %%, sample rate: %d %%, "
+        "recover count: %d)",
+        gcOverheadBudget->get(), gcOverheadSampleRate->get(),
+        gcOverheadRecoverCount->get());
+  } else {
+    logger->printInfoMsg("GC overhead governor = false");
+  }
+
   /* Output status of snapshot triggers. */
   logger->printInfoMsg("Trigger on FullGC = %s",
                        triggerOnFullGC->get() ? "true" : "false");
@@ -465,6 +664,79 @@ void TConfiguration::printSetting(void) {
   logger->printInfoMsg("Deadlock check (experimental feature) = %s",
                        checkDeadlock->get() ? "true" : "false");
 
+  /* Output status of monitor contention profiler. */
+  if (monitorProfile->get()) {
+    logger->printInfoMsg("Monitor profile = true (rank: %d, stack depth: %d)",
+                         monitorProfileRank->get(),
+                         monitorProfileStackDepth->get());
+  } else {
+    logger->printInfoMsg("Monitor profile = false");
+  }
+
+  /* Output status of CPU profiler. */
+  if (cpuProfile->get()) {
+    logger->printInfoMsg("CPU profile = true (%d Hz, file: %s)",
+                         cpuProfileFrequency->get(),
+                         cpuProfileFileName->get());
+  } else {
+    logger->printInfoMsg("CPU profile = false");
+  }
+
+  /* Output status of allocation profiler. */
+  if (allocProfile->get()) {
+    logger->printInfoMsg(
+        "Allocation profile = true (interval: %d bytes, rank: %d, "
+        "stack depth: %d)",
+        allocProfileInterval->get(), allocProfileRank->get(),
+        allocProfileStackDepth->get());
+  } else {
+    logger->printInfoMsg("Allocation profile = false");
+  }
+
+  /* Output status of per-thread CPU time ranking. */
+  if (threadCpuProfile->get()) {
+    logger->printInfoMsg("Thread CPU profile = true (rank: %d)",
+                         threadCpuProfileRank->get());
+  } else {
+    logger->printInfoMsg("Thread CPU profile = false");
+  }
+
+  /* Output status of performance counter sampler. */
+  if (perfSampler->get()) {
+    logger->printInfoMsg(
+        "Perf counter sampler = true (interval: %d msec, records: %d, "
+        "counters: %s)",
+        perfSamplerInterval->get(), perfSamplerRecords->get(),
+        ((perfSamplerCounters->get() == NULL) ||
+         (perfSamplerCounters->get()[0] == '\0'))
+            ? "(none)"
+            : perfSamplerCounters->get());
+  } else {
+    logger->printInfoMsg("Perf counter sampler = false");
+  }
+
+  /* Output status of live counter export. */
+  if (liveCounter->get()) {
+    logger->printInfoMsg("Live counter = true (file: %s)",
+                         (liveCounterFile->get() != NULL) &&
+                                 (liveCounterFile->get()[0] != '\0')
+                             ? liveCounterFile->get()
+                             : "(default)");
+  } else {
+    logger->printInfoMsg("Live counter = false");
+  }
+
+  /* Output status of metrics server. */
+  if (metricsServer->get()) {
+    logger->printInfoMsg("Metrics server = true (socket: %s)",
+                         (metricsSocket->get() != NULL) &&
+                                 (metricsSocket->get()[0] != '\0')
+                             ? metricsSocket->get()
+                             : "(default)");
+  } else {
+    logger->printInfoMsg("Metrics server = false");
+  }
+
   /* Output status of logging triggers. */
   logger->printInfoMsg("Log trigger on Error = %s",
                        triggerOnLogError->get() ? "true" : "false");
@@ -552,6 +824,10 @@ void TConfiguration::printSetting(void) {
                        threadRecordFileName->get());
   logger->printInfoMsg("Thread record I/O tracer = %s",
                        threadRecordIOTracer->get());
+  logger->printInfoMsg("Max entries of I/O statistics = %d",
+                       threadRecordIOStatsEntries->get());
+  logger->printInfoMsg("I/O statistics file name = %s",
+                       threadRecordIOStatsFileName->get());
 
   /* Output about SNMP trap. */
   logger->printInfoMsg("Send SNMP Trap = %s",
@@ -559,12 +835,30 @@ void TConfiguration::printSetting(void) {
   logger->printInfoMsg("SNMP target = %s", snmpTarget->get());
   logger->printInfoMsg("SNMP community = %s", snmpComName->get());
   logger->printInfoMsg("NET-SNMP client library path = %s", snmpLibPath->get());
+  logger->printInfoMsg("SNMP trap rate = %d traps/sec", snmpTrapRate->get());
 
   /* Output temporary log directory path. */
   logger->printInfoMsg("Temporary log directory = %s", logDir->get());
 
   /* Output archive command. */
   logger->printInfoMsg("Archive command = \"%s\"", archiveCommand->get());
+  logger->printInfoMsg("Native archive = %s",
+                       nativeArchive->get() ? "true" : "false");
+  logger->printInfoMsg("Archive helper process = %s",
+                       archiveHelper->get() ? "true" : "false");
+
+  /* Output memory map setting. */
+  logger->printInfoMsg("Memory map summary = %s",
+                       memMapSummary->get() ? "true" : "false");
+  logger->printInfoMsg("Memory map sample = %s",
+                       memMapSample->get() ? "true" : "false");
+
+  /* Output symbol cache setting. */
+  logger->printInfoMsg("Symbol cache = %s",
+                       symbolCache->get() ? "true" : "false");
+  logger->printInfoMsg("Symbol cache directory = %s",
+                       (symbolCacheDir->get() != NULL) ? symbolCacheDir->get()
+                                                       : "(default)");
 
   /* Output about force killing JVM. */
   logger->printInfoMsg("Kill on Error = %s",
@@ -601,6 +895,82 @@ bool TConfiguration::validate(void) {
     }
   }
 
+  /* Binary common log check */
+  if (heapLogBinary->get() && (heapLogBinaryRecords->get() <= 0)) {
+    logger->printWarnMsg("Invalid value: heaplog_binary_records = %d",
+                         heapLogBinaryRecords->get());
+    result = false;
+  }
+
+  /* SnapShot rotation check */
+  TLongConfig *rotations[] = {snapShotRotateSize, snapShotRotateInterval,
+                              NULL};
+  for (TLongConfig **rotation = rotations; *rotation != NULL; rotation++) {
+    if ((*rotation)->get() < 0) {
+      logger->printWarnMsg("Invalid value: %s = %ld",
+                           (*rotation)->getConfigName(), (*rotation)->get());
+      result = false;
+    }
+  }
+
+  if (snapShotRotateCount->get() < 0) {
+    logger->printWarnMsg("Invalid value: snapshot_rotate_count = %d",
+                         snapShotRotateCount->get());
+    result = false;
+  }
+
+  /* Asynchronous I/O check */
+  const char *asyncIOValue = asyncIO->get();
+  if ((asyncIOValue == NULL) || ((strcmp(asyncIOValue, "auto") != 0) &&
+                                 (strcmp(asyncIOValue, "io_uring") != 0) &&
+                                 (strcmp(asyncIOValue, "threads") != 0) &&
+                                 (strcmp(asyncIOValue, "none") != 0))) {
+    logger->printWarnMsg("Invalid value: async_io = %s",
+                         (asyncIOValue == NULL) ? "" : asyncIOValue);
+    result = false;
+  }
+
+  if ((snapShotSampleRate->get() <= 0) || (snapShotSampleRate->get() > 100)) {
+    logger->printWarnMsg("Invalid value: snapshot_sample_rate = %d",
+                         snapShotSampleRate->get());
+    result = false;
+  }
+
+  if ((gcOverheadBudget->get() <= 0) || (gcOverheadBudget->get() > 100)) {
+    logger->printWarnMsg("Invalid value: gc_overhead_budget = %d",
+                         gcOverheadBudget->get());
+    result = false;
+  }
+
+  if ((gcOverheadSampleRate->get() <= 0) ||
+      (gcOverheadSampleRate->get() > 100)) {
+    logger->printWarnMsg("Invalid value: gc_overhead_sample_rate = %d",
+                         gcOverheadSampleRate->get());
+    result = false;
+  }
+
+  if (gcOverheadRecoverCount->get() <= 0) {
+    logger->printWarnMsg("Invalid value: gc_overhead_recover_count = %d",
+                         gcOverheadRecoverCount->get());
+    result = false;
+  }
+
+  if (asyncIOThreads->get() <= 0) {
+    logger->printWarnMsg("Invalid value: async_io_threads = %d",
+                         asyncIOThreads->get());
+    result = false;
+  }
+
+  const char *fsyncPolicyValue = fsyncPolicy->get();
+  if ((fsyncPolicyValue == NULL) ||
+      ((strcmp(fsyncPolicyValue, "none") != 0) &&
+       (strcmp(fsyncPolicyValue, "close") != 0) &&
+       (strcmp(fsyncPolicyValue, "always") != 0))) {
+    logger->printWarnMsg("Invalid value: fsync_policy = %s",
+                         (fsyncPolicyValue == NULL) ? "" : fsyncPolicyValue);
+    result = false;
+  }
+
   /* Range check */
   TIntConfig *percentages[] = {alertPercentage, heapAlertPercentage, NULL};
   for (TIntConfig **percentage = percentages; *percentage != NULL;
@@ -656,6 +1026,96 @@ bool TConfiguration::validate(void) {
                            threadRecordFileName->get());
       result = false;
     }
+
+    if (threadRecordIOStatsEntries->get() < 0) {
+      logger->printWarnMsg("Invalid value: thread_record_iostats_entries = %d",
+                           threadRecordIOStatsEntries->get());
+      result = false;
+    } else if ((threadRecordIOStatsEntries->get() > 0) &&
+               !isValidPath(threadRecordIOStatsFileName->get())) {
+      logger->printWarnMsg(
+          "Permission denied: thread_record_iostats_filename = %s",
+          threadRecordIOStatsFileName->get());
+      result = false;
+    }
+  }
+
+  /* Monitor profiler check */
+  if (monitorProfile->get()) {
+    if (monitorProfileRank->get() <= 0) {
+      logger->printWarnMsg("Invalid value: monitor_profile_rank = %d",
+                           monitorProfileRank->get());
+      result = false;
+    }
+
+    if ((monitorProfileStackDepth->get() < 0) ||
+        (monitorProfileStackDepth->get() > MONITOR_PROFILE_MAX_DEPTH)) {
+      logger->printWarnMsg("Invalid value: monitor_profile_stack_depth = %d",
+                           monitorProfileStackDepth->get());
+      result = false;
+    }
+  }
+
+  /* CPU profiler check */
+  if (cpuProfile->get()) {
+    if ((cpuProfileFrequency->get() <= 0) ||
+        (cpuProfileFrequency->get() > 1000)) {
+      logger->printWarnMsg("Invalid value: cpu_profile_frequency = %d",
+                           cpuProfileFrequency->get());
+      result = false;
+    }
+
+    if (!isValidPath(cpuProfileFileName->get())) {
+      logger->printWarnMsg("Permission denied: cpu_profile_filename = %s",
+                           cpuProfileFileName->get());
+      result = false;
+    }
+  }
+
+  /* Allocation profiler check */
+  if (allocProfile->get()) {
+    if (allocProfileInterval->get() < 0) {
+      logger->printWarnMsg("Invalid value: alloc_profile_interval = %d",
+                           allocProfileInterval->get());
+      result = false;
+    }
+
+    if (allocProfileRank->get() <= 0) {
+      logger->printWarnMsg("Invalid value: alloc_profile_rank = %d",
+                           allocProfileRank->get());
+      result = false;
+    }
+
+    if ((allocProfileStackDepth->get() < 0) ||
+        (allocProfileStackDepth->get() > ALLOC_PROFILE_MAX_DEPTH)) {
+      logger->printWarnMsg("Invalid value: alloc_profile_stack_depth = %d",
+                           allocProfileStackDepth->get());
+      result = false;
+    }
+  }
+
+  /* Per-thread CPU time ranking check */
+  if (threadCpuProfile->get()) {
+    if (threadCpuProfileRank->get() <= 0) {
+      logger->printWarnMsg("Invalid value: thread_cpu_profile_rank = %d",
+                           threadCpuProfileRank->get());
+      result = false;
+    }
+  }
+
+  /* Performance counter sampler check */
+  if (perfSampler->get()) {
+    if (perfSamplerInterval->get() <= 0) {
+      logger->printWarnMsg("Invalid value: perf_sampler_interval = %d",
+                           perfSamplerInterval->get());
+      result = false;
+    }
+
+    if (perfSamplerRecords->get() <= 1) {
+      logger->printWarnMsg("Invalid value: perf_sampler_records = %d",
+                           perfSamplerRecords->get());
+      result = false;
+    }
   }
 
   /* SNMP check */
@@ -674,6 +1134,12 @@ bool TConfiguration::validate(void) {
       logger->printWarnMsg("snmp_comname have to be set when snmp_send is set");
       result = false;
     }
+
+    if (snmpTrapRate->get() < 0) {
+      logger->printWarnMsg("Invalid value: snmp_trap_rate = %d",
+                           snmpTrapRate->get());
+      result = false;
+    }
   }
 
   return result;
@@ -687,15 +1153,39 @@ void TConfiguration::merge(TConfiguration *src) {
   attach->set(src->attach->get());
   fileName->set(src->fileName->get());
   heapLogFile->set(src->heapLogFile->get());
+  heapLogBinary->set(src->heapLogBinary->get());
+  heapLogBinaryRecords->set(src->heapLogBinaryRecords->get());
+  snapShotRotateSize->set(src->snapShotRotateSize->get());
+  snapShotRotateInterval->set(src->snapShotRotateInterval->get());
+  snapShotRotateCount->set(src->snapShotRotateCount->get());
+  snapShotPreallocate->set(src->snapShotPreallocate->get());
+  fsyncPolicy->set(src->fsyncPolicy->get());
   archiveFile->set(src->archiveFile->get());
   logFile->set(src->logFile->get());
   rankLevel->set(src->rankLevel->get());
   logLevel->set(src->logLevel->get());
   reduceSnapShot->set(src->reduceSnapShot->get());
   collectRefTree->set(src->collectRefTree->get());
+  gcOverheadGovernor->set(gcOverheadGovernor->get() &&
+                          src->gcOverheadGovernor->get());
+  gcOverheadBudget->set(src->gcOverheadBudget->get());
+  gcOverheadSampleRate->set(src->gcOverheadSampleRate->get());
+  gcOverheadRecoverCount->set(src->gcOverheadRecoverCount->get());
   triggerOnFullGC->set(triggerOnFullGC->get() && src->triggerOnFullGC->get());
   triggerOnDump->set(triggerOnDump->get() && src->triggerOnDump->get());
   checkDeadlock->set(checkDeadlock->get() && src->checkDeadlock->get());
+  monitorProfile->set(monitorProfile->get() && src->monitorProfile->get());
+  monitorProfileRank->set(src->monitorProfileRank->get());
+  cpuProfile->set(cpuProfile->get() && src->cpuProfile->get());
+  cpuProfileFileName->set(src->cpuProfileFileName->get());
+  allocProfile->set(allocProfile->get() && src->allocProfile->get());
+  allocProfileRank->set(src->allocProfileRank->get());
+  threadCpuProfile->set(threadCpuProfile->get() &&
+                        src->threadCpuProfile->get());
+  threadCpuProfileRank->set(src->threadCpuProfileRank->get());
+  perfSampler->set(perfSampler->get() && src->perfSampler->get());
+  liveCounter->set(liveCounter->get() && src->liveCounter->get());
+  metricsServer->set(metricsServer->get() && src->metricsServer->get());
   triggerOnLogError->set(triggerOnLogError->get() &&
                          src->triggerOnLogError->get());
   triggerOnLogSignal->set(triggerOnLogSignal->get() &&
@@ -710,9 +1200,14 @@ void TConfiguration::merge(TConfiguration *src) {
   logInterval->set(src->logInterval->get());
   firstCollect->set(src->firstCollect->get());
   threadRecordFileName->set(src->threadRecordFileName->get());
+  threadRecordIOStatsFileName->set(src->threadRecordIOStatsFileName->get());
   snmpSend->set(snmpSend->get() & src->snmpSend->get());
   logDir->set(src->logDir->get());
   archiveCommand->set(src->archiveCommand->get());
+  nativeArchive->set(src->nativeArchive->get());
+  archiveHelper->set(archiveHelper->get() && src->archiveHelper->get());
+  memMapSummary->set(src->memMapSummary->get());
+  memMapSample->set(src->memMapSample->get());
   killOnError->set(src->killOnError->get());
 }
 
@@ -203,9 +203,36 @@ class TConfiguration {
   /*!< Output snapshot file name. */
   TStringConfig *fileName;
 
+  /*!< Size of snapshot file to rotate. */
+  TLongConfig *snapShotRotateSize;
+
+  /*!< Interval of snapshot file rotation (in sec). */
+  TLongConfig *snapShotRotateInterval;
+
+  /*!< Number of rotated snapshot files to keep. */
+  TIntConfig *snapShotRotateCount;
+
+  /*!< Preallocate snapshot file up to rotation size. */
+  TBooleanConfig *snapShotPreallocate;
+
+  /*!< Backend of asynchronous output. */
+  TStringConfig *asyncIO;
+
+  /*!< Number of threads of thread pool backend. */
+  TIntConfig *asyncIOThreads;
+
+  /*!< Policy of fdatasync for output files. */
+  TStringConfig *fsyncPolicy;
+
   /*!< Output common log file name. */
   TStringConfig *heapLogFile;
 
+  /*!< Is common log written as binary columnar ring? */
+  TBooleanConfig *heapLogBinary;
+
+  /*!< Number of records in binary common log. */
+  TIntConfig *heapLogBinaryRecords;
+
   /*!< Output archive log file name. */
   TStringConfig *archiveFile;
 
@@ -218,6 +245,21 @@ class TConfiguration {
   /*!< Whether collecting reftree. */
   TBooleanConfig *collectRefTree;
 
+  /*!< Percentage of objects which are counted in heap census. */
+  TIntConfig *snapShotSampleRate;
+
+  /*!< Degrade heap census in GC if it inflates GC pause. */
+  TBooleanConfig *gcOverheadGovernor;
+
+  /*!< Percentage of GC pause which heap census can take. */
+  TIntConfig *gcOverheadBudget;
+
+  /*!< Sampling rate of heap census which is degraded by governor. */
+  TIntConfig *gcOverheadSampleRate;
+
+  /*!< Number of light collections to restore heap census. */
+  TIntConfig *gcOverheadRecoverCount;
+
   /*!< Make snapshot is triggered by Full GC. */
   TBooleanConfig *triggerOnFullGC;
 
@@ -227,6 +269,66 @@ class TConfiguration {
   /*!< Is deadlock finder enabled? */
   TBooleanConfig *checkDeadlock;
 
+  /*!< Is monitor contention profiler enabled? */
+  TBooleanConfig *monitorProfile;
+
+  /*!< Number of monitors in contention ranking. */
+  TIntConfig *monitorProfileRank;
+
+  /*!< Number of stack frames which are used to distinguish monitors. */
+  TIntConfig *monitorProfileStackDepth;
+
+  /*!< Is CPU sampling profiler enabled? */
+  TBooleanConfig *cpuProfile;
+
+  /*!< Sampling frequency of CPU profiler (Hz in CPU time). */
+  TIntConfig *cpuProfileFrequency;
+
+  /*!< File name of collapsed stacks which are sampled by CPU profiler. */
+  TStringConfig *cpuProfileFileName;
+
+  /*!< Is allocation profiler enabled? */
+  TBooleanConfig *allocProfile;
+
+  /*!< Average interval of allocation sampling in bytes. */
+  TIntConfig *allocProfileInterval;
+
+  /*!< Number of allocation sites in allocation ranking. */
+  TIntConfig *allocProfileRank;
+
+  /*!< Number of stack frames which are recorded at each sample. */
+  TIntConfig *allocProfileStackDepth;
+
+  /*!< Is per-thread CPU time ranking enabled? */
+  TBooleanConfig *threadCpuProfile;
+
+  /*!< Number of threads in CPU time ranking. */
+  TIntConfig *threadCpuProfileRank;
+
+  /*!< Is performance counter sampler enabled? */
+  TBooleanConfig *perfSampler;
+
+  /*!< Interval of performance counter sampling (msec). */
+  TIntConfig *perfSamplerInterval;
+
+  /*!< Number of samples which are kept in the ring. */
+  TIntConfig *perfSamplerRecords;
+
+  /*!< Comma-separated names of additional performance counters. */
+  TStringConfig *perfSamplerCounters;
+
+  /*!< Publish the latest snapshot summary to shared memory. */
+  TBooleanConfig *liveCounter;
+
+  /*!< Path of shared memory file of live counters. */
+  TStringConfig *liveCounterFile;
+
+  /*!< Serve metrics in OpenMetrics text format. */
+  TBooleanConfig *metricsServer;
+
+  /*!< Path of Unix domain socket of metrics server. */
+  TStringConfig *metricsSocket;
+
   /*!< Logging on JVM error(Resoure exhausted). */
   TBooleanConfig *triggerOnLogError;
 
@@ -284,6 +386,12 @@ class TConfiguration {
   /*!< Class file for I/O tracing. */
   TStringConfig *threadRecordIOTracer;
 
+  /*!< Max number of endpoints in I/O statistics. */
+  TIntConfig *threadRecordIOStatsEntries;
+
+  /*!< I/O statistics filename. */
+  TStringConfig *threadRecordIOStatsFileName;
+
   /*!< Flag of SNMP trap send enable. */
   TBooleanConfig *snmpSend;
 
@@ -296,12 +404,33 @@ class TConfiguration {
   /*!< NET-SNMP client library path. */
   TStringConfig *snmpLibPath;
 
+  /*!< Max number of SNMP traps per second. 0 means unlimited. */
+  TIntConfig *snmpTrapRate;
+
   /*!< Path of working directory for log archive. */
   TStringConfig *logDir;
 
   /*!< Command was execute to making log archive. */
   TStringConfig *archiveCommand;
 
+  /*!< Make log archive in-process without working directory. */
+  TBooleanConfig *nativeArchive;
+
+  /*!< Execute archive command in helper process. */
+  TBooleanConfig *archiveHelper;
+
+  /*!< Write summary of memory map instead of raw smaps. */
+  TBooleanConfig *memMapSummary;
+
+  /*!< Output summary of memory map at each log_interval. */
+  TBooleanConfig *memMapSample;
+
+  /*!< Cache resolved symbols of libjvm per build-id. */
+  TBooleanConfig *symbolCache;
+
+  /*!< Directory of symbol cache. */
+  TStringConfig *symbolCacheDir;
+
   /*!< Abort JVM on resoure exhausted or deadlock. */
   TBooleanConfig *killOnError;
 
@@ -408,14 +537,48 @@ class TConfiguration {
   /* Accessors */
   TBooleanConfig *Attach() { return attach; }
   TStringConfig *FileName() { return fileName; }
+  TLongConfig *SnapShotRotateSize() { return snapShotRotateSize; }
+  TLongConfig *SnapShotRotateInterval() { return snapShotRotateInterval; }
+  TIntConfig *SnapShotRotateCount() { return snapShotRotateCount; }
+  TBooleanConfig *SnapShotPreallocate() { return snapShotPreallocate; }
+  TStringConfig *AsyncIO() { return asyncIO; }
+  TIntConfig *AsyncIOThreads() { return asyncIOThreads; }
+  TStringConfig *FsyncPolicy() { return fsyncPolicy; }
   TStringConfig *HeapLogFile() { return heapLogFile; }
+  TBooleanConfig *HeapLogBinary() { return heapLogBinary; }
+  TIntConfig *HeapLogBinaryRecords() { return heapLogBinaryRecords; }
   TStringConfig *ArchiveFile() { return archiveFile; }
   TStringConfig *LogFile() { return logFile; }
   TBooleanConfig *ReduceSnapShot() { return reduceSnapShot; }
   TBooleanConfig *CollectRefTree() { return collectRefTree; }
+  TIntConfig *SnapShotSampleRate() { return snapShotSampleRate; }
+  TBooleanConfig *GCOverheadGovernor() { return gcOverheadGovernor; }
+  TIntConfig *GCOverheadBudget() { return gcOverheadBudget; }
+  TIntConfig *GCOverheadSampleRate() { return gcOverheadSampleRate; }
+  TIntConfig *GCOverheadRecoverCount() { return gcOverheadRecoverCount; }
   TBooleanConfig *TriggerOnFullGC() { return triggerOnFullGC; }
   TBooleanConfig *TriggerOnDump() { return triggerOnDump; }
   TBooleanConfig *CheckDeadlock() { return checkDeadlock; }
+  TBooleanConfig *MonitorProfile() { return monitorProfile; }
+  TIntConfig *MonitorProfileRank() { return monitorProfileRank; }
+  TIntConfig *MonitorProfileStackDepth() { return monitorProfileStackDepth; }
+  TBooleanConfig *CpuProfile() { return cpuProfile; }
+  TIntConfig *CpuProfileFrequency() { return cpuProfileFrequency; }
+  TStringConfig *CpuProfileFileName() { return cpuProfileFileName; }
+  TBooleanConfig *AllocProfile() { return allocProfile; }
+  TIntConfig *AllocProfileInterval() { return allocProfileInterval; }
+  TIntConfig *AllocProfileRank() { return allocProfileRank; }
+  TIntConfig *AllocProfileStackDepth() { return allocProfileStackDepth; }
+  TBooleanConfig *ThreadCpuProfile() { return threadCpuProfile; }
+  TIntConfig *ThreadCpuProfileRank() { return threadCpuProfileRank; }
+  TBooleanConfig *PerfSampler() { return perfSampler; }
+  TIntConfig *PerfSamplerInterval() { return perfSamplerInterval; }
+  TIntConfig *PerfSamplerRecords() { return perfSamplerRecords; }
+  TStringConfig *PerfSamplerCounters() { return perfSamplerCounters; }
+  TBooleanConfig *LiveCounter() { return liveCounter; }
+  TStringConfig *LiveCounterFile() { return liveCounterFile; }
+  TBooleanConfig *MetricsServer() { return metricsServer; }
+  TStringConfig *MetricsSocket() { return metricsSocket; }
   TBooleanConfig *TriggerOnLogError() { return triggerOnLogError; }
   TBooleanConfig *TriggerOnLogSignal() { return triggerOnLogSignal; }
   TBooleanConfig *TriggerOnLogLock() { return triggerOnLogLock; }
@@ -435,12 +598,25 @@ class TConfiguration {
   TLongConfig *ThreadRecordBufferSize() { return threadRecordBufferSize; }
   TStringConfig *ThreadRecordFileName() { return threadRecordFileName; }
   TStringConfig *ThreadRecordIOTracer() { return threadRecordIOTracer; }
+  TIntConfig *ThreadRecordIOStatsEntries() {
+    return threadRecordIOStatsEntries;
+  }
+  TStringConfig *ThreadRecordIOStatsFileName() {
+    return threadRecordIOStatsFileName;
+  }
   TBooleanConfig *SnmpSend() { return snmpSend; }
   TStringConfig *SnmpTarget() { return snmpTarget; }
   TStringConfig *SnmpComName() { return snmpComName; }
   TStringConfig *SnmpLibPath() { return snmpLibPath; }
+  TIntConfig *SnmpTrapRate() { return snmpTrapRate; }
   TStringConfig *LogDir() { return logDir; }
   TStringConfig *ArchiveCommand() { return archiveCommand; }
+  TBooleanConfig *NativeArchive() { return nativeArchive; }
+  TBooleanConfig *ArchiveHelper() { return archiveHelper; }
+  TBooleanConfig *MemMapSummary() { return memMapSummary; }
+  TBooleanConfig *MemMapSample() { return memMapSample; }
+  TBooleanConfig *SymbolCache() { return symbolCache; }
+  TStringConfig *SymbolCacheDir() { return symbolCacheDir; }
   TBooleanConfig *KillOnError() { return killOnError; }
 
   jlong getHeapAlertThreshold() { return heapAlertThreshold; }
@@ -0,0 +1,755 @@
+/*!
+ * \file cpuProfiler.cpp
+ * \brief This file is used to sample Java stacks which consume CPU.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include <jvmti.h>
+#include <jni.h>
+
+#include <dlfcn.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "globals.hpp"
+#include "util.hpp"
+#include "cpuProfiler.hpp"
+
+#if PROCESSOR_ARCH == X86
+#include "arch/x86/lock.inline.hpp"
+#elif PROCESSOR_ARCH == ARM
+#include "arch/arm/lock.inline.hpp"
+#endif
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+/*!
+ * \brief Make clock ID of CPU time of the thread.<br>
+ *        CLOCK_THREAD_CPUTIME_ID can be used for current thread only.
+ * \sa MAKE_THREAD_CPUCLOCK in include/linux/posix-timers.h
+ */
+#define MAKE_THREAD_CPUCLOCK(tid) ((~(clockid_t)(tid) << 3) | 6)
+
+/*!
+ * \brief Names of error code of AsyncGetCallTrace().
+ * \sa enum in hotspot/src/share/vm/prims/forte.cpp
+ */
+static const char *asgctErrorName[] = {
+    "[no_Java_frame]",         "[no_class_load]",       "[GC_active]",
+    "[unknown_not_Java]",      "[not_walkable_not_Java]", "[unknown_Java]",
+    "[not_walkable_Java]",     "[unknown_state]",       "[thread_exit]",
+    "[deopt]",                 "[safepoint]",           "[non_Java_thread]"};
+
+/* Class static variables. */
+
+/*!
+ * \brief Singleton instance of TCpuProfiler.
+ */
+TCpuProfiler *TCpuProfiler::inst = NULL;
+
+/* Common methods. */
+
+/*!
+ * \brief Create jmethodIDs of all methods in the class.
+ * \param jvmti [in] JVMTI environment.
+ * \param klass [in] Target class.
+ */
+static inline void prepareMethodIDs(jvmtiEnv *jvmti, jclass klass) {
+  jint count = 0;
+  jmethodID *methods = NULL;
+
+  /* GetClassMethods() creates jmethodIDs as side effect. */
+  if (likely(!isError(jvmti,
+                      jvmti->GetClassMethods(klass, &count, &methods)))) {
+    jvmti->Deallocate((unsigned char *)methods);
+  }
+}
+
+/*!
+ * \brief Calculate hash value of TCpuStackNodeKey.
+ * \param key [in] Key of the node.
+ * \return Hash value.
+ */
+size_t TCpuStackNodeKeyHasher::operator()(const TCpuStackNodeKey &key) const {
+  return ((size_t)key.method >> 3) * 31 + (size_t)key.parent * 17 +
+         (size_t)key.errorCode;
+}
+
+/*!
+ * \brief Compare TCpuStackNodeKey.
+ * \param key1 [in] Key of the node.
+ * \param key2 [in] Key of the node.
+ * \return true if both keys are same.
+ */
+bool TCpuStackNodeKeyEqual::operator()(const TCpuStackNodeKey &key1,
+                                       const TCpuStackNodeKey &key2) const {
+  return (key1.parent == key2.parent) && (key1.method == key2.method) &&
+         (key1.errorCode == key2.errorCode);
+}
+
+/*!
+ * \brief JVMTI callback for ClassPrepare event.<br>
+ *        This function creates jmethodIDs of the class because
+ *        AsyncGetCallTrace() cannot create them.
+ * \param jvmti  [in] JVMTI environment.
+ * \param env    [in] JNI environment of the event (current) thread.
+ * \param thread [in] Current thread.
+ * \param klass  [in] Prepared class.
+ */
+void JNICALL OnClassPrepareForCpuProfile(jvmtiEnv *jvmti, JNIEnv *env,
+                                         jthread thread, jclass klass) {
+  prepareMethodIDs(jvmti, klass);
+}
+
+/*!
+ * \brief JVMTI callback for ThreadStart event.
+ * \param jvmti  [in] JVMTI environment.
+ * \param env    [in] JNI environment of the event (current) thread.
+ * \param thread [in] Started thread.
+ */
+void JNICALL OnThreadStartForCpuProfile(jvmtiEnv *jvmti, JNIEnv *env,
+                                        jthread thread) {
+  TCpuProfiler::getInstance()->onThreadStart();
+}
+
+/*!
+ * \brief JVMTI callback for ThreadEnd event.
+ * \param jvmti  [in] JVMTI environment.
+ * \param env    [in] JNI environment of the event (current) thread.
+ * \param thread [in] Terminated thread.
+ */
+void JNICALL OnThreadEndForCpuProfile(jvmtiEnv *jvmti, JNIEnv *env,
+                                      jthread thread) {
+  TCpuProfiler::getInstance()->onThreadEnd();
+}
+
+/* Class methods. */
+
+/*!
+ * \brief Global initialization.
+ * \param frequency [in] Sampling frequency in CPU time (Hz).
+ * \return Process result.
+ * \warning Please call only once from main thread.
+ */
+bool TCpuProfiler::globalInitialize(int frequency) {
+  /* AsyncGetCallTrace() is exported from libjvm.so . */
+  TAsyncGetCallTrace func =
+      (TAsyncGetCallTrace)dlsym(RTLD_DEFAULT, "AsyncGetCallTrace");
+  if (unlikely(func == NULL)) {
+    logger->printWarnMsg("Could not find AsyncGetCallTrace().");
+    return false;
+  }
+
+  try {
+    inst = new TCpuProfiler(func, frequency);
+  } catch (...) {
+    logger->printCritMsg("Cannot initialize TCpuProfiler.");
+    return false;
+  }
+
+  return true;
+}
+
+/*!
+ * \brief Global finalization.
+ */
+void TCpuProfiler::globalFinalize(void) {
+  delete inst;
+  inst = NULL;
+}
+
+/*!
+ * \brief TCpuProfiler constructor.
+ * \param func      [in] Function pointer of AsyncGetCallTrace().
+ * \param frequency [in] Sampling frequency in CPU time (Hz).
+ */
+TCpuProfiler::TCpuProfiler(TAsyncGetCallTrace func, int frequency)
+    : asyncGetCallTrace(func),
+      vm(NULL),
+      samplingInterval(1000000000L / frequency),
+      isRunning(false),
+      sigManager(NULL),
+      drainTimer(NULL),
+      buffers(),
+      retiredBuffers(),
+      deadBuffers(),
+      buffersLockVal(0),
+      nodes(),
+      nodeIndex(),
+      droppedSamples(0),
+      trieLockVal(0) {
+  /* Root of stack trie. */
+  TCpuStackNode root = {{-1, NULL, 0}, 0};
+  nodes.push_back(root);
+
+  drainTimer = new TTimer(&drainProc, "HeapStats CPU Profiler");
+}
+
+/*!
+ * \brief TCpuProfiler destructor.
+ */
+TCpuProfiler::~TCpuProfiler() {
+  stop();
+  delete drainTimer;
+  delete sigManager;
+
+  for (std::vector<TCpuSampleBuffer *>::iterator itr = retiredBuffers.begin();
+       itr != retiredBuffers.end(); itr++) {
+    free(*itr);
+  }
+  for (std::vector<TCpuSampleBuffer *>::iterator itr = deadBuffers.begin();
+       itr != deadBuffers.end(); itr++) {
+    free(*itr);
+  }
+}
+
+/*!
+ * \brief Signal handler of SIGPROF.
+ * \param signo   [in] Number of received signal.
+ * \param siginfo [in] Information of received signal.
+ * \param data    [in] ucontext of interrupted thread.
+ * \warning This function must be async-signal-safe.
+ */
+void TCpuProfiler::onSignal(int signo, siginfo_t *siginfo, void *data) {
+  /* SIGPROF from others (e.g. setitimer(2)) is not ours. */
+  if (unlikely((siginfo == NULL) || (siginfo->si_code != SI_TIMER))) {
+    return;
+  }
+
+  TCpuProfiler *profiler = inst;
+  TCpuSampleBuffer *buffer = (TCpuSampleBuffer *)siginfo->si_value.sival_ptr;
+  if (unlikely((profiler == NULL) || !profiler->isRunning ||
+               (buffer == NULL))) {
+    return;
+  }
+
+  int head = buffer->head;
+  if (unlikely((head - atomic_get((int *)&buffer->tail)) >=
+               CPU_PROFILE_BUFFER_SAMPLES)) {
+    buffer->dropped++;
+    return;
+  }
+
+  TCpuSample *sample =
+      &buffer->samples[head & (CPU_PROFILE_BUFFER_SAMPLES - 1)];
+  JNIEnv *env = NULL;
+
+  if (profiler->vm->GetEnv((void **)&env, JNI_VERSION_1_6) != JNI_OK) {
+    sample->numFrames = CPU_PROFILE_TICKS_NOT_ATTACHED;
+  } else {
+    TASGCTCallTrace trace = {env, 0, sample->frames};
+    profiler->asyncGetCallTrace(&trace, CPU_PROFILE_MAX_DEPTH, data);
+    sample->numFrames = trace.num_frames;
+  }
+
+  /* Publish the sample to drain timer. */
+  publish_barrier();
+  buffer->head = head + 1;
+}
+
+/*!
+ * \brief Entry point of drain timer.
+ * \param jvmti [in] JVMTI environment.
+ * \param env   [in] JNI environment.
+ * \param cause [in] Cause of invoke function.
+ */
+void TCpuProfiler::drainProc(jvmtiEnv *jvmti, JNIEnv *env,
+                             TInvokeCause cause) {
+  inst->drain();
+}
+
+/*!
+ * \brief Prepare to sample at JVM initialization.<br>
+ *        This function creates jmethodIDs of all loaded classes and
+ *        installs SIGPROF handler.
+ * \param jvmti [in] JVMTI environment.
+ * \param env   [in] JNI environment.
+ * \return Process result.
+ */
+bool TCpuProfiler::onVMInit(jvmtiEnv *jvmti, JNIEnv *env) {
+  if (unlikely(env->GetJavaVM(&vm) != JNI_OK)) {
+    logger->printWarnMsg("Could not get JavaVM for CPU profiler.");
+    return false;
+  }
+
+  /* Classes which are loaded before ClassPrepare event is enabled. */
+  jint classCount = 0;
+  jclass *classes = NULL;
+  if (likely(!isError(jvmti,
+                      jvmti->GetLoadedClasses(&classCount, &classes)))) {
+    for (int idx = 0; idx < classCount; idx++) {
+      prepareMethodIDs(jvmti, classes[idx]);
+      env->DeleteLocalRef(classes[idx]);
+    }
+    jvmti->Deallocate((unsigned char *)classes);
+  }
+
+  try {
+    sigManager = new TSignalManager("SIGPROF");
+    if (unlikely(!sigManager->addHandler(&onSignal))) {
+      logger->printWarnMsg("Could not install SIGPROF handler.");
+      return false;
+    }
+  } catch (...) {
+    logger->printWarnMsg("Could not install SIGPROF handler.");
+    return false;
+  }
+
+  return true;
+}
+
+/*!
+ * \brief Create CPU time timer for the thread.<br>
+ *        Caller must hold buffers lock.
+ * \param tid [in] Thread ID (LWP ID).
+ */
+void TCpuProfiler::addThread(pid_t tid) {
+  if (buffers.count(tid) > 0) {
+    return;
+  }
+
+  TCpuSampleBuffer *buffer =
+      (TCpuSampleBuffer *)calloc(1, sizeof(TCpuSampleBuffer));
+  if (unlikely(buffer == NULL)) {
+    return;
+  }
+  buffer->tid = tid;
+
+  struct sigevent sev;
+  memset(&sev, 0, sizeof(struct sigevent));
+  sev.sigev_notify = SIGEV_THREAD_ID;
+  sev.sigev_signo = SIGPROF;
+  sev.sigev_value.sival_ptr = buffer;
+  sev.sigev_notify_thread_id = tid;
+
+  /* The thread might be already terminated. */
+  if (unlikely(timer_create(MAKE_THREAD_CPUCLOCK(tid), &sev,
+                            &buffer->timer) != 0)) {
+    free(buffer);
+    return;
+  }
+
+  try {
+    buffers[tid] = buffer;
+  } catch (...) {
+    timer_delete(buffer->timer);
+    free(buffer);
+    return;
+  }
+
+  struct itimerspec its;
+  its.it_interval.tv_sec = samplingInterval / 1000000000L;
+  its.it_interval.tv_nsec = samplingInterval % 1000000000L;
+  its.it_value = its.it_interval;
+  timer_settime(buffer->timer, 0, &its, NULL);
+}
+
+/*!
+ * \brief Delete CPU time timer of the thread.<br>
+ *        Caller must hold buffers lock.
+ * \param buffer [in] Buffer of the thread.
+ */
+void TCpuProfiler::removeThread(TCpuSampleBuffer *buffer) {
+  timer_delete(buffer->timer);
+  buffers.erase(buffer->tid);
+
+  /*
+   * Samples in the buffer have not been drained yet.
+   * The buffer is released by drain timer.
+   */
+  try {
+    retiredBuffers.push_back(buffer);
+  } catch (...) {
+    /* Samples in the buffer are lost. */
+    free(buffer);
+  }
+}
+
+/*!
+ * \brief Start sampling of all threads.
+ * \param jvmti [in] JVMTI environment.
+ * \param env   [in] JNI environment.
+ */
+void TCpuProfiler::start(jvmtiEnv *jvmti, JNIEnv *env) {
+  if (isRunning) {
+    return;
+  }
+
+  DIR *dir = opendir("/proc/self/task");
+  if (unlikely(dir == NULL)) {
+    logger->printWarnMsgWithErrno("Could not open /proc/self/task");
+    return;
+  }
+
+  isRunning = true;
+
+  /* Sample all threads including GC and compiler threads. */
+  spinLockWait(&buffersLockVal);
+  {
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+      if (entry->d_name[0] != '.') {
+        addThread((pid_t)atoi(entry->d_name));
+      }
+    }
+  }
+  spinLockRelease(&buffersLockVal);
+
+  closedir(dir);
+
+  try {
+    drainTimer->start(jvmti, env, CPU_PROFILE_DRAIN_INTERVAL);
+  } catch (const char *errMsg) {
+    logger->printWarnMsg(errMsg);
+    stop();
+  }
+}
+
+/*!
+ * \brief Stop sampling.
+ */
+void TCpuProfiler::stop(void) {
+  if (!isRunning) {
+    return;
+  }
+
+  isRunning = false;
+  drainTimer->stop();
+
+  spinLockWait(&buffersLockVal);
+  {
+    while (!buffers.empty()) {
+      removeThread(buffers.begin()->second);
+    }
+  }
+  spinLockRelease(&buffersLockVal);
+
+  /* Collect samples in retired buffers. */
+  drain();
+}
+
+/*!
+ * \brief Start sampling of current thread.
+ */
+void TCpuProfiler::onThreadStart(void) {
+  if (!isRunning) {
+    return;
+  }
+
+  spinLockWait(&buffersLockVal);
+  { addThread((pid_t)syscall(SYS_gettid)); }
+  spinLockRelease(&buffersLockVal);
+}
+
+/*!
+ * \brief Stop sampling of current thread.
+ */
+void TCpuProfiler::onThreadEnd(void) {
+  pid_t tid = (pid_t)syscall(SYS_gettid);
+
+  spinLockWait(&buffersLockVal);
+  {
+    std::tr1::unordered_map<pid_t, TCpuSampleBuffer *,
+                            TNumericalHasher<pid_t> >::iterator itr =
+        buffers.find(tid);
+    if (itr != buffers.end()) {
+      removeThread(itr->second);
+    }
+  }
+  spinLockRelease(&buffersLockVal);
+}
+
+/*!
+ * \brief Find or create node in stack trie.<br>
+ *        Caller must hold trie lock.
+ * \param parent    [in] Index of parent node.
+ * \param method    [in] Method of the frame.
+ * \param errorCode [in] Error code of AsyncGetCallTrace().
+ * \return Index of the node. -1 if trie is full.
+ */
+int TCpuProfiler::getNode(int parent, jmethodID method, jint errorCode) {
+  TCpuStackNodeKey key = {parent, method, errorCode};
+
+  std::tr1::unordered_map<TCpuStackNodeKey, int, TCpuStackNodeKeyHasher,
+                          TCpuStackNodeKeyEqual>::iterator itr =
+      nodeIndex.find(key);
+  if (itr != nodeIndex.end()) {
+    return itr->second;
+  }
+
+  if (unlikely(nodes.size() >= CPU_PROFILE_MAX_NODES)) {
+    return -1;
+  }
+
+  TCpuStackNode node = {key, 0};
+  int idx = (int)nodes.size();
+  try {
+    nodes.push_back(node);
+    nodeIndex[key] = idx;
+  } catch (...) {
+    if ((int)nodes.size() > idx) {
+      nodes.pop_back();
+    }
+    return -1;
+  }
+
+  return idx;
+}
+
+/*!
+ * \brief Add sample to stack trie.<br>
+ *        Caller must hold trie lock.
+ * \param sample [in] Sampled stack.
+ */
+void TCpuProfiler::addSample(const TCpuSample *sample) {
+  int current;
+
+  if (sample->numFrames <= 0) {
+    current = getNode(0, NULL, sample->numFrames);
+  } else {
+    current = 0;
+
+    /* frames[0] is top of stack. Trie grows from bottom of stack. */
+    for (int idx = sample->numFrames - 1; (idx >= 0) && (current >= 0);
+         idx--) {
+      current = getNode(current, sample->frames[idx].method_id, 0);
+    }
+  }
+
+  if (unlikely(current < 0)) {
+    droppedSamples++;
+  } else {
+    nodes[current].count++;
+  }
+}
+
+/*!
+ * \brief Drain samples in all per-thread buffers to stack trie.<br>
+ *        Buffers lock is held only while buffers are listed, so thread
+ *        start and end are not blocked while the trie is built.
+ */
+void TCpuProfiler::drain(void) {
+  /* Trie lock serializes drains. */
+  spinLockWait(&trieLockVal);
+  {
+    std::vector<TCpuSampleBuffer *> targets;
+    std::vector<TCpuSampleBuffer *> releasable;
+    jlong retiredDropped = 0;
+
+    spinLockWait(&buffersLockVal);
+    {
+      bool isListed = false;
+
+      try {
+        for (std::tr1::unordered_map<pid_t, TCpuSampleBuffer *,
+                                     TNumericalHasher<pid_t> >::iterator itr =
+                 buffers.begin();
+             itr != buffers.end(); itr++) {
+          targets.push_back(itr->second);
+        }
+        targets.insert(targets.end(), retiredBuffers.begin(),
+                       retiredBuffers.end());
+        isListed = true;
+      } catch (...) {
+        /* Samples will be drained at next time. */
+      }
+
+      /*
+       * Signal might be delivered just after timer deletion.
+       * So retired buffers are released at next drain. Listed buffers
+       * are never released until this drain is finished.
+       */
+      if (likely(isListed)) {
+        for (std::vector<TCpuSampleBuffer *>::iterator itr =
+                 retiredBuffers.begin();
+             itr != retiredBuffers.end(); itr++) {
+          retiredDropped += (*itr)->dropped;
+        }
+
+        releasable.swap(deadBuffers);
+        deadBuffers.swap(retiredBuffers);
+      }
+    }
+    spinLockRelease(&buffersLockVal);
+
+    for (std::vector<TCpuSampleBuffer *>::iterator itr = releasable.begin();
+         itr != releasable.end(); itr++) {
+      free(*itr);
+    }
+
+    for (std::vector<TCpuSampleBuffer *>::iterator itr = targets.begin();
+         itr != targets.end(); itr++) {
+      TCpuSampleBuffer *buffer = *itr;
+      int head = atomic_get((int *)&buffer->head);
+      publish_barrier();
+
+      for (int pos = buffer->tail; pos != head; pos++) {
+        addSample(
+            &buffer->samples[pos & (CPU_PROFILE_BUFFER_SAMPLES - 1)]);
+      }
+
+      /* Release slots to signal handler. */
+      publish_barrier();
+      buffer->tail = head;
+    }
+
+    droppedSamples += retiredDropped;
+  }
+  spinLockRelease(&trieLockVal);
+}
+
+/*!
+ * \brief Get name of the frame in collapsed stack format.
+ * \param jvmti  [in] JVMTI environment.
+ * \param env    [in] JNI environment.
+ * \param method [in] Method of the frame.
+ * \return Name of the frame as "java/lang/Thread.run".<br>
+ *         Don't forget deallocate if value isn't null.
+ */
+char *TCpuProfiler::getFrameName(jvmtiEnv *jvmti, JNIEnv *env,
+                                 jmethodID method) {
+  jvmtiFrameInfo frame = {method, 0};
+  TJavaStackMethodInfo info;
+  getMethodFrameInfo(jvmti, env, frame, &info);
+
+  /* "Ljava/lang/Thread;" -> "java/lang/Thread" */
+  const char *className = "[unknown]";
+  int classLen = strlen(className);
+  if ((info.className != NULL) && (strlen(info.className) > 2)) {
+    className = info.className + 1;
+    classLen = strlen(className) - 1;
+  }
+
+  char buf[1024];
+  snprintf(buf, sizeof(buf), "%.*s.%s", classLen, className,
+           (info.methodName == NULL) ? "[unknown]" : info.methodName);
+
+  free(info.className);
+  free(info.methodName);
+  free(info.sourceFile);
+
+  return strdup(buf);
+}
+
+/*!
+ * \brief Output sampled stacks as collapsed stacks.
+ * \param jvmti [in] JVMTI environment.
+ * \param env   [in] JNI environment.
+ * \param fname [in] File name to output.
+ */
+void TCpuProfiler::dump(jvmtiEnv *jvmti, JNIEnv *env, const char *fname) {
+  drain();
+
+  /* Copy trie to resolve frame names without trie lock. */
+  std::vector<TCpuStackNode> work;
+  jlong dropped;
+  spinLockWait(&trieLockVal);
+  {
+    try {
+      work = nodes;
+    } catch (...) {
+      /* Output dropped samples only. */
+    }
+    dropped = droppedSamples;
+  }
+  spinLockRelease(&trieLockVal);
+
+  char tmpName[PATH_MAX];
+  snprintf(tmpName, PATH_MAX, "%s.tmp", fname);
+
+  FILE *out = fopen(tmpName, "w");
+  if (unlikely(out == NULL)) {
+    logger->printWarnMsgWithErrno("Could not open CPU profile: %s", tmpName);
+    return;
+  }
+
+  /* Frame names are resolved once per dump. */
+  std::tr1::unordered_map<jmethodID, char *, TNumericalHasher<jmethodID> >
+      names;
+  try {
+    int path[CPU_PROFILE_MAX_DEPTH];
+
+    for (size_t idx = 1; idx < work.size(); idx++) {
+      if (work[idx].count == 0) {
+        continue;
+      }
+
+      /* Walk to root. */
+      int depth = 0;
+      for (int current = (int)idx;
+           (current > 0) && (depth < CPU_PROFILE_MAX_DEPTH);
+           current = work[current].key.parent) {
+        path[depth++] = current;
+      }
+
+      for (int pos = depth - 1; pos >= 0; pos--) {
+        TCpuStackNodeKey *key = &work[path[pos]].key;
+        const char *name;
+
+        if (key->method == NULL) {
+          jint code = -key->errorCode;
+          name = ((code >= 0) &&
+                  (code < (jint)(sizeof(asgctErrorName) / sizeof(char *))))
+                     ? asgctErrorName[code]
+                     : "[unknown]";
+        } else {
+          std::tr1::unordered_map<jmethodID, char *,
+                                  TNumericalHasher<jmethodID> >::iterator
+              cache = names.find(key->method);
+          if (cache == names.end()) {
+            cache = names.insert(std::make_pair(
+                key->method, getFrameName(jvmti, env, key->method))).first;
+          }
+          name = (cache->second == NULL) ? "[unknown]" : cache->second;
+        }
+
+        fputs(name, out);
+        fputc((pos == 0) ? ' ' : ';', out);
+      }
+
+      fprintf(out, JLONG_FORMAT_STR "\n", work[idx].count);
+    }
+  } catch (...) {
+    logger->printWarnMsg("Couldn't allocate working memory!");
+  }
+
+  for (std::tr1::unordered_map<jmethodID, char *,
+                               TNumericalHasher<jmethodID> >::iterator itr =
+           names.begin();
+       itr != names.end(); itr++) {
+    free(itr->second);
+  }
+
+  if (dropped > 0) {
+    fprintf(out, "[dropped] " JLONG_FORMAT_STR "\n", dropped);
+  }
+
+  if (unlikely(fclose(out) != 0)) {
+    logger->printWarnMsgWithErrno("Could not write CPU profile: %s", tmpName);
+    unlink(tmpName);
+  } else if (unlikely(rename(tmpName, fname) != 0)) {
+    logger->printWarnMsgWithErrno("Could not rename CPU profile: %s", fname);
+    unlink(tmpName);
+  }
+}
@@ -0,0 +1,398 @@
+/*!
+ * \file cpuProfiler.hpp
+ * \brief This file is used to sample Java stacks which consume CPU.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#ifndef CPU_PROFILER_HPP
+#define CPU_PROFILER_HPP
+
+#include <jvmti.h>
+#include <jni.h>
+
+#include <signal.h>
+#include <time.h>
+#include <sys/types.h>
+
+#include <vector>
+#include <tr1/unordered_map>
+
+#include "util.hpp"
+#include "signalManager.hpp"
+#include "timer.hpp"
+
+/*!
+ * \brief Max number of frames in a sample.
+ */
+#define CPU_PROFILE_MAX_DEPTH 64
+
+/*!
+ * \brief Number of samples in per-thread buffer. This value is power of 2.
+ *        This value should be larger than samples which are taken by
+ *        a thread in CPU_PROFILE_DRAIN_INTERVAL.
+ */
+#define CPU_PROFILE_BUFFER_SAMPLES 16
+
+/*!
+ * \brief Interval to drain per-thread buffers (msec).
+ */
+#define CPU_PROFILE_DRAIN_INTERVAL 100
+
+/*!
+ * \brief Max number of nodes in stack trie.
+ */
+#define CPU_PROFILE_MAX_NODES 65536
+
+/*!
+ * \brief Pseudo error code of AsyncGetCallTrace() which means
+ *        the sampled thread is not attached to JVM.
+ */
+#define CPU_PROFILE_TICKS_NOT_ATTACHED -11
+
+/*!
+ * \brief Frame which is returned from AsyncGetCallTrace().
+ * \sa hotspot/src/share/vm/prims/forte.cpp
+ */
+typedef struct {
+  jint lineno;         /*!< BCI of the frame, or -3 for native method. */
+  jmethodID method_id; /*!< Method of the frame.                       */
+} TASGCTCallFrame;
+
+/*!
+ * \brief Call trace which is passed to AsyncGetCallTrace().
+ * \sa hotspot/src/share/vm/prims/forte.cpp
+ */
+typedef struct {
+  JNIEnv *env_id;          /*!< JNI environment of sampled thread.     */
+  jint num_frames;         /*!< Number of frames, or error code (<= 0). */
+  TASGCTCallFrame *frames; /*!< Frames. frames[0] is top of the stack. */
+} TASGCTCallTrace;
+
+/*!
+ * \brief Function type of AsyncGetCallTrace().
+ */
+typedef void (*TAsyncGetCallTrace)(TASGCTCallTrace *trace, jint depth,
+                                   void *ucontext);
+
+/*!
+ * \brief Sampled stack.
+ */
+typedef struct {
+  jint numFrames; /*!< Number of frames, or error code (<= 0). */
+  TASGCTCallFrame frames[CPU_PROFILE_MAX_DEPTH]; /*!< Sampled frames.  */
+} TCpuSample;
+
+/*!
+ * \brief Sample buffer of each thread.<br>
+ *        This is single producer (signal handler on the owner thread) and
+ *        single consumer (drain timer) ring buffer. So signal handler never
+ *        waits for lock.
+ */
+typedef struct {
+  pid_t tid;            /*!< Thread ID of the owner thread (LWP ID).   */
+  timer_t timer;        /*!< CPU time timer of the owner thread.       */
+  volatile int head;    /*!< Written by producer only.                 */
+  volatile int tail;    /*!< Written by consumer only.                 */
+  volatile int dropped; /*!< Samples which were dropped by full buffer. */
+  TCpuSample samples[CPU_PROFILE_BUFFER_SAMPLES]; /*!< Ring buffer.   */
+} TCpuSampleBuffer;
+
+/*!
+ * \brief Key of a node in stack trie.
+ */
+typedef struct {
+  int parent;       /*!< Index of parent node. 0 is root.           */
+  jmethodID method; /*!< Method of the frame. NULL for error frame. */
+  jint errorCode;   /*!< Error code of AsyncGetCallTrace().         */
+} TCpuStackNodeKey;
+
+/*!
+ * \brief Node in stack trie.
+ */
+typedef struct {
+  TCpuStackNodeKey key; /*!< Key of this node.                        */
+  jlong count;          /*!< Samples which this node is top of stack. */
+} TCpuStackNode;
+
+/*!
+ * \brief Hasher of TCpuStackNodeKey.
+ */
+struct TCpuStackNodeKeyHasher {
+  size_t operator()(const TCpuStackNodeKey &key) const;
+};
+
+/*!
+ * \brief Comparator of TCpuStackNodeKey.
+ */
+struct TCpuStackNodeKeyEqual {
+  bool operator()(const TCpuStackNodeKey &key1,
+                  const TCpuStackNodeKey &key2) const;
+};
+
+/*!
+ * \brief JVMTI callback for ClassPrepare event.<br>
+ *        This function creates jmethodIDs of the class because
+ *        AsyncGetCallTrace() cannot create them.
+ * \param jvmti  [in] JVMTI environment.
+ * \param env    [in] JNI environment of the event (current) thread.
+ * \param thread [in] Current thread.
+ * \param klass  [in] Prepared class.
+ */
+void JNICALL OnClassPrepareForCpuProfile(jvmtiEnv *jvmti, JNIEnv *env,
+                                         jthread thread, jclass klass);
+
+/*!
+ * \brief JVMTI callback for ThreadStart event.
+ * \param jvmti  [in] JVMTI environment.
+ * \param env    [in] JNI environment of the event (current) thread.
+ * \param thread [in] Started thread.
+ */
+void JNICALL OnThreadStartForCpuProfile(jvmtiEnv *jvmti, JNIEnv *env,
+                                        jthread thread);
+
+/*!
+ * \brief JVMTI callback for ThreadEnd event.
+ * \param jvmti  [in] JVMTI environment.
+ * \param env    [in] JNI environment of the event (current) thread.
+ * \param thread [in] Terminated thread.
+ */
+void JNICALL OnThreadEndForCpuProfile(jvmtiEnv *jvmti, JNIEnv *env,
+                                      jthread thread);
+
+/*!
+ * \brief This class samples stacks of threads which consume CPU time by
+ *        AsyncGetCallTrace(), and outputs them as collapsed stacks.
+ */
+class TCpuProfiler {
+ private:
+  /*!
+   * \brief Singleton instance of TCpuProfiler.
+   */
+  static TCpuProfiler *inst;
+
+  /*!
+   * \brief Function pointer of AsyncGetCallTrace().
+   */
+  TAsyncGetCallTrace asyncGetCallTrace;
+
+  /*!
+   * \brief JavaVM to get JNI environment in signal handler.
+   */
+  JavaVM *vm;
+
+  /*!
+   * \brief Sampling interval in CPU time (nsec).
+   */
+  long samplingInterval;
+
+  /*!
+   * \brief Profiler is running or not.
+   */
+  volatile bool isRunning;
+
+  /*!
+   * \brief Signal manager of SIGPROF.
+   */
+  TSignalManager *sigManager;
+
+  /*!
+   * \brief Timer to drain per-thread buffers.
+   */
+  TTimer *drainTimer;
+
+  /*!
+   * \brief Per-thread buffers.
+   */
+  std::tr1::unordered_map<pid_t, TCpuSampleBuffer *, TNumericalHasher<pid_t> >
+      buffers;
+
+  /*!
+   * \brief Buffers whose timer was deleted. They are drained at next drain.
+   */
+  std::vector<TCpuSampleBuffer *> retiredBuffers;
+
+  /*!
+   * \brief Retired buffers which were drained. They are released at next
+   *        drain.
+   */
+  std::vector<TCpuSampleBuffer *> deadBuffers;
+
+  /*!
+   * \brief SpinLock variable for buffers.
+   */
+  volatile int buffersLockVal;
+
+  /*!
+   * \brief Nodes of stack trie. nodes[0] is root.
+   */
+  std::vector<TCpuStackNode> nodes;
+
+  /*!
+   * \brief Index of child node for hash-consing.
+   */
+  std::tr1::unordered_map<TCpuStackNodeKey, int, TCpuStackNodeKeyHasher,
+                          TCpuStackNodeKeyEqual> nodeIndex;
+
+  /*!
+   * \brief Number of dropped samples.
+   */
+  jlong droppedSamples;
+
+  /*!
+   * \brief SpinLock variable for stack trie.
+   */
+  volatile int trieLockVal;
+
+  /*!
+   * \brief Signal handler of SIGPROF.
+   * \param signo   [in] Number of received signal.
+   * \param siginfo [in] Information of received signal.
+   * \param data    [in] ucontext of interrupted thread.
+   * \warning This function must be async-signal-safe.
+   */
+  static void onSignal(int signo, siginfo_t *siginfo, void *data);
+
+  /*!
+   * \brief Entry point of drain timer.
+   * \param jvmti [in] JVMTI environment.
+   * \param env   [in] JNI environment.
+   * \param cause [in] Cause of invoke function.
+   */
+  static void drainProc(jvmtiEnv *jvmti, JNIEnv *env, TInvokeCause cause);
+
+  /*!
+   * \brief Create CPU time timer for the thread.<br>
+   *        Caller must hold buffers lock.
+   * \param tid [in] Thread ID (LWP ID).
+   */
+  void addThread(pid_t tid);
+
+  /*!
+   * \brief Delete CPU time timer of the thread.<br>
+   *        Caller must hold buffers lock.
+   * \param buffer [in] Buffer of the thread.
+   */
+  void removeThread(TCpuSampleBuffer *buffer);
+
+  /*!
+   * \brief Find or create node in stack trie.<br>
+   *        Caller must hold trie lock.
+   * \param parent    [in] Index of parent node.
+   * \param method    [in] Method of the frame.
+   * \param errorCode [in] Error code of AsyncGetCallTrace().
+   * \return Index of the node. -1 if trie is full.
+   */
+  int getNode(int parent, jmethodID method, jint errorCode);
+
+  /*!
+   * \brief Add sample to stack trie.<br>
+   *        Caller must hold trie lock.
+   * \param sample [in] Sampled stack.
+   */
+  void addSample(const TCpuSample *sample);
+
+  /*!
+   * \brief Drain samples in all per-thread buffers to stack trie.
+   */
+  void drain(void);
+
+  /*!
+   * \brief Get name of the frame in collapsed stack format.
+   * \param jvmti  [in] JVMTI environment.
+   * \param env    [in] JNI environment.
+   * \param method [in] Method of the frame.
+   * \return Name of the frame as "java/lang/Thread.run".<br>
+   *         Don't forget deallocate if value isn't null.
+   */
+  static char *getFrameName(jvmtiEnv *jvmti, JNIEnv *env, jmethodID method);
+
+ protected:
+  /*!
+   * \brief TCpuProfiler constructor.
+   * \param func      [in] Function pointer of AsyncGetCallTrace().
+   * \param frequency [in] Sampling frequency in CPU time (Hz).
+   */
+  TCpuProfiler(TAsyncGetCallTrace func, int frequency);
+
+  /*!
+   * \brief TCpuProfiler destructor.
+   */
+  virtual ~TCpuProfiler();
+
+ public:
+  /*!
+   * \brief Global initialization.
+   * \param frequency [in] Sampling frequency in CPU time (Hz).
+   * \return Process result.
+   * \warning Please call only once from main thread.
+   */
+  static bool globalInitialize(int frequency);
+
+  /*!
+   * \brief Global finalization.
+   */
+  static void globalFinalize(void);
+
+  /*!
+   * \brief Get singleton instance of TCpuProfiler.
+   * \return Instance of TCpuProfiler.
+   */
+  inline static TCpuProfiler *getInstance() { return inst; };
+
+  /*!
+   * \brief Prepare to sample at JVM initialization.<br>
+   *        This function creates jmethodIDs of all loaded classes and
+   *        installs SIGPROF handler.
+   * \param jvmti [in] JVMTI environment.
+   * \param env   [in] JNI environment.
+   * \return Process result.
+   */
+  bool onVMInit(jvmtiEnv *jvmti, JNIEnv *env);
+
+  /*!
+   * \brief Start sampling of all threads.
+   * \param jvmti [in] JVMTI environment.
+   * \param env   [in] JNI environment.
+   */
+  void start(jvmtiEnv *jvmti, JNIEnv *env);
+
+  /*!
+   * \brief Stop sampling.
+   */
+  void stop(void);
+
+  /*!
+   * \brief Start sampling of current thread.
+   */
+  void onThreadStart(void);
+
+  /*!
+   * \brief Stop sampling of current thread.
+   */
+  void onThreadEnd(void);
+
+  /*!
+   * \brief Output sampled stacks as collapsed stacks.
+   * \param jvmti [in] JVMTI environment.
+   * \param env   [in] JNI environment.
+   * \param fname [in] File name to output.
+   */
+  void dump(jvmtiEnv *jvmti, JNIEnv *env, const char *fname);
+};
+
+#endif  // CPU_PROFILER_HPP
@@ -19,14 +19,18 @@
  *
  */
 
-#include <sys/syscall.h>
-
 #include "globals.hpp"
 #include "vmFunctions.hpp"
 #include "vmVariables.hpp"
 #include "libmain.hpp"
 #include "deadlockFinder.hpp"
 
+#if PROCESSOR_ARCH == X86
+#include "arch/x86/lock.inline.hpp"
+#elif PROCESSOR_ARCH == ARM
+#include "arch/arm/lock.inline.hpp"
+#endif
+
 /* Defines. */
 
 /*!
@@ -53,6 +57,14 @@
  */
 #define THREAD_IN_JAVA 8
 
+/*!
+ * \brief Lock bits value of markOop.<br>
+ *        This value means the object has inflated monitor.<br>
+ *        Definition of "markOopDesc::monitor_value".
+ * \sa hotspot/src/share/vm/oops/markOop.hpp
+ */
+#define MARK_MONITOR_VALUE 2
+
 
 /* Class static variables. */
 
@@ -85,14 +97,39 @@ inline bool isAtSafepoint(void) {
 void JNICALL OnMonitorContendedEnterForDeadlock(jvmtiEnv *jvmti, JNIEnv *env,
                                                 jthread thread,
                                                 jobject object) {
+  TDeadlockFinder *finder = TDeadlockFinder::inst;
+  jlong threadId = TVMFunctions::getInstance()->GetThreadId(*(void **)thread);
+  void *monitor = TDeadlockFinder::getInflatedMonitor(*(void **)object);
+
+  /*
+   * Deadlock cycle consists of blocked threads only.
+   * If no other thread is blocked, or no blocked thread is waiting for
+   * the monitor which is owned by this thread, this contention cannot
+   * close a cycle.
+   */
+  if (likely(!finder->addWaitForEdge(env, threadId, monitor, NULL) ||
+             !finder->isWaitedByOthers(threadId) ||
+             !finder->pruneWaitForGraph(jvmti, env))) {
+    return;
+  }
+
   /* Check deadlock. */
   TDeadlockList *list = NULL;
   int threadCnt = 0;
   char threadName[256] = {0};
-  threadCnt = TDeadlockFinder::checkDeadlock(object, &list);
+  if (likely(!finder->checkDeadlock(threadId, monitor, &list))) {
+    return;
+  }
+
+  /*
+   * Owners in the cycle are resolved one by one without stopping threads,
+   * so confirm all of them are still blocked.
+   */
+  threadCnt = TDeadlockFinder::countBlockedThreads(jvmti, threadId, list);
 
   /* Deadlock is not occurred. */
   if (likely(threadCnt == 0)) {
+    TDeadlockFinder::freeDeadlockList(list);
     return;
   }
 
@@ -154,6 +191,48 @@ void JNICALL OnMonitorContendedEnterForDeadlock(jvmtiEnv *jvmti, JNIEnv *env,
   }
 }
 
+/*!
+ * \brief Event handler of JVMTI MonitorContendedEntered for finding deadlock.
+ * \param jvmti  [in] JVMTI environment.
+ * \param env    [in] JNI environment of the event (current) thread.
+ * \param thread [in] JNI local reference to the thread entered the monitor.
+ * \param object [in] JNI local reference to the monitor.
+ */
+void JNICALL OnMonitorContendedEnteredForDeadlock(jvmtiEnv *jvmti,
+                                                  JNIEnv *env, jthread thread,
+                                                  jobject object) {
+  jlong threadId = TVMFunctions::getInstance()->GetThreadId(*(void **)thread);
+  TDeadlockFinder::inst->removeWaitForEdge(env, threadId);
+}
+
+/*!
+ * \brief Event handler of JVMTI MonitorWaited for finding deadlock.
+ * \param jvmti     [in] JVMTI environment.
+ * \param env       [in] JNI environment of the event (current) thread.
+ * \param thread    [in] JNI local reference to the thread finished waiting.
+ * \param object    [in] JNI local reference to the monitor.
+ * \param timed_out [in] True if the monitor timed out.
+ */
+void JNICALL OnMonitorWaitedForDeadlock(jvmtiEnv *jvmti, JNIEnv *env,
+                                        jthread thread, jobject object,
+                                        jboolean timed_out) {
+  /*
+   * The thread re-enters the monitor after this event. If the monitor is
+   * contended, the thread is blocked without MonitorContendedEnter and
+   * MonitorContendedEntered. So we add the edge here, and remove it when
+   * the thread is found not to be blocked.
+   * Most threads re-enter the monitor which is not owned by others, and
+   * they never join the graph.
+   */
+  void *monitor = TDeadlockFinder::getInflatedMonitor(*(void **)object);
+  if (likely(!TDeadlockFinder::isOwnedMonitor(monitor))) {
+    return;
+  }
+
+  jlong threadId = TVMFunctions::getInstance()->GetThreadId(*(void **)thread);
+  TDeadlockFinder::inst->addWaitForEdge(env, threadId, monitor, thread);
+}
+
 /* Class methods. */
 
 /*!
@@ -219,7 +298,13 @@ void TDeadlockFinder::setCapabilities(jvmtiCapabilities *capabilities,
 * \param event [in] Callback is used on deadlock occurred.
 */
 TDeadlockFinder::TDeadlockFinder(TDeadlockEventFunc event)
-    : TAgentThread("HeapStats Deadlock Finder"), occurTime(0) {
+    : TAgentThread("HeapStats Deadlock Finder"),
+      occurTime(0),
+      vm(NULL),
+      waitForGraph(),
+      untrackedEdges(0),
+      lastPruneTime(0),
+      graphLockVal(0) {
   /* Sanity check. */
   if (unlikely(event == NULL)) {
     throw "Event callback is NULL.";
@@ -285,20 +370,20 @@ void TDeadlockFinder::sendSNMPTrap(TMSecTime nowTime,
 
 /*!
  * \brief Check deadlock.
- * \param monitor [in]  Monitor object of thread contended.
- * \param list    [out] List of deadlock occurred threads.
- * \return Number of deadlock occurred threads.<br>
- *         Value is 0, if deadlock isn't occurred.
+ * \param threadId [in]  Thread ID of the thread contended.
+ * \param monitor  [in]  ObjectMonitor of thread contended.
+ * \param list     [out] List of deadlock occurred threads.
+ * \return Is found deadlock.
  */
-int TDeadlockFinder::checkDeadlock(jobject monitor, TDeadlockList **list) {
+bool TDeadlockFinder::checkDeadlock(jlong threadId, void *monitor,
+                                    TDeadlockList **list) {
   /* Sanity check. */
   if (unlikely(monitor == NULL || list == NULL)) {
-    return 0;
+    return false;
   }
 
   TVMFunctions *vmFunc = TVMFunctions::getInstance();
   TVMVariables *vmVal = TVMVariables::getInstance();
-  int deadlockCount = 0;
   void *thisThreadPtr = vmFunc->GetThread();
   void *thread_lock = *(void **)vmVal->getThreadsLock();
   if (unlikely(thisThreadPtr == NULL || thread_lock == NULL)) {
@@ -310,12 +395,9 @@ int TDeadlockFinder::checkDeadlock(jobject monitor, TDeadlockList **list) {
      */
     logger->printWarnMsg(
           "Deadlock detection failed: Cannot get current thread info.");
-    return 0;
+    return false;
   }
 
-  /* Get self thread id. */
-  pid_t threadId = syscall(SYS_gettid);
-
   int *status = (int *)incAddress(thisThreadPtr,
                                   vmVal->getOfsJavaThreadThreadState());
   int original_status = *status;
@@ -344,17 +426,7 @@ int TDeadlockFinder::checkDeadlock(jobject monitor, TDeadlockList **list) {
   *status = THREAD_IN_VM;
 
   /* Check deadlock. */
-  bool foundDeadlock = findDeadLock(threadId, monitor);
-
-  if (unlikely(foundDeadlock)) {
-    /* Get threads. */
-    getLockedThreads(threadId, monitor, list);
-
-    /* Count list item. */
-    for (TDeadlockList *item = (*list); item != NULL; item = item->next) {
-      deadlockCount++;
-    }
-  }
+  bool foundDeadlock = findWaitForCycle(threadId, monitor, list);
 
   if (*status == THREAD_IN_VM) {
     /*
@@ -393,7 +465,7 @@ int TDeadlockFinder::checkDeadlock(jobject monitor, TDeadlockList **list) {
     }
   }
 
-  return deadlockCount;
+  return foundDeadlock;
 }
 
 /*!
@@ -450,6 +522,12 @@ void JNICALL
  * \param env   [in] JNI environment object.
  */
 void TDeadlockFinder::start(jvmtiEnv *jvmti, JNIEnv *env) {
+  /* Keep JavaVM to rebuild wait-for graph from other thread. */
+  if (unlikely(env->GetJavaVM(&vm) != JNI_OK)) {
+    logger->printWarnMsg("Could not get JavaVM for deadlock finder.");
+    vm = NULL;
+  }
+
   /* Call super class's method. */
   TAgentThread::start(jvmti, env, TDeadlockFinder::entryPoint, this,
                       JVMTI_THREAD_MIN_PRIORITY);
@@ -488,129 +566,55 @@ void TDeadlockFinder::notify(jlong aTime) {
 }
 
 /*!
- * \brief DeadLock search (recursive call).
- * \param startId [in] Thread id of TDeadlockFinder caller.
- * \param monitor [in] Monitor object of thread contended.
+ * \brief Find cycle which is closed by new edge.
+ * \param startId [in]  Thread ID of the thread which added new edge.
+ * \param monitor [in]  ObjectMonitor of the new edge.
+ * \param list    [out] List of threads in the cycle.
+ * \return Is found cycle.
  */
-FASTCALL bool TDeadlockFinder::findDeadLock(pid_t startId, jobject monitor) {
-  TVMFunctions *vmFunc = TVMFunctions::getInstance();
-  TVMVariables *vmVal = TVMVariables::getInstance();
-  void *threadPtr = NULL;
-  int *status = NULL;
-  void *nativeThread = NULL;
-  pid_t *ownerId = NULL;
-  void *contendedMonitor = NULL;
-  jobject monitorOop = NULL;
-
-  /* Get owner thread of this monitor. */
-  threadPtr = vmFunc->GetLockOwner(monitor, !isAtSafepoint());
-
-  /* No deadlock (no owner thread of this monitor). */
-  if (unlikely(threadPtr == NULL)) {
-    return false;
-  }
-
-  /* Go deadlock check!!! */
-  /* Is owner thread is self ? */
-
-  /* Get OSThread ptr related to JavaThread. */
-  nativeThread =
-      (void *)*(ptrdiff_t *)incAddress(threadPtr,
-                                       vmVal->getOfsJavaThreadOsthread());
-
-  /* If failure get native thread. */
-  if (unlikely(nativeThread == NULL)) {
-    return false;
-  }
-
-  /* Get nid (LWP ID). */
-  ownerId = (pid_t *)incAddress(nativeThread, vmVal->getOfsOSThreadThreadId());
-
-  /* If occurred deadlock. */
-  if (unlikely(*ownerId == startId)) {
-    /* DeadLock !!! */
-    return true;
-  }
-
-  /* Thread status check. */
-  status = (int *)incAddress(threadPtr, vmVal->getOfsJavaThreadThreadState());
-  if ((*status == THREAD_IN_JAVA) || (*status == THREAD_IN_VM)) {
-    /* Owner thread is running. */
-    return false;
-  }
-
-  /* Get ObjectMonitor pointer. */
-  contendedMonitor = (void *)*(ptrdiff_t *)incAddress(
-                         threadPtr, vmVal->getOfsThreadCurrentPendingMonitor());
-  /* If pointer is illegal. */
-  if (unlikely(contendedMonitor == NULL)) {
-    return false;
-  }
-
-  monitorOop = (jobject)incAddress(contendedMonitor,
-                                   vmVal->getOfsObjectMonitorObject());
-  /* If java thread already has monitor. */
-  if (unlikely((monitorOop == NULL) || (monitorOop == monitor))) {
-    return false;
-  }
-
-  /* No deadlock in "this" thread. */
-
-  /* Execute recursive call. */
-  return findDeadLock(startId, monitorOop);
-}
-
-/*!
- * \brief Get threads which has occurred deadlock.
- * \param startId [in]  Thread id of TDeadlockFinder caller.
- * \param monitor [in]  Monitor object of thread contended.
- * \param list    [out] List of deadlock occurred threads.
- */
-void TDeadlockFinder::getLockedThreads(pid_t startId, jobject monitor,
+bool TDeadlockFinder::findWaitForCycle(jlong startId, void *monitor,
                                        TDeadlockList **list) {
   TVMFunctions *vmFunc = TVMFunctions::getInstance();
   TVMVariables *vmVal = TVMVariables::getInstance();
-  pid_t *ownerId = NULL;
   TDeadlockList *listHead = NULL;
   TDeadlockList *oldRec = NULL;
-  bool flagFailure = false;
+  jlong waiterId = startId;
+  bool foundCycle = false;
+  size_t maxDepth = 0;
 
-  /* Infinite loop. */
-  while (true) {
-    void *threadPtr = NULL;
-    void *nativeThread = NULL;
-    void *contendedMonitor = NULL;
-    jthread jThreadObj = NULL;
-    TDeadlockList *threadRec = NULL;
+  /* Each blocked thread appears in the cycle once at most. */
+  spinLockWait(&graphLockVal);
+  { maxDepth = waitForGraph.size(); }
+  spinLockRelease(&graphLockVal);
 
+  for (size_t depth = 0; depth < maxDepth; depth++) {
     /* Get owner thread of this monitor. */
-    threadPtr = vmFunc->GetLockOwner(monitor, !isAtSafepoint());
+    void *threadPtr = vmFunc->GetLockOwner(
+        incAddress(monitor, vmVal->getOfsObjectMonitorObject()),
+        !isAtSafepoint());
 
+    /* No deadlock (no owner thread of this monitor). */
     if (unlikely(threadPtr == NULL)) {
-      /* Shouldn't reach to here. */
-      logger->printDebugMsg(
-          "Deadlock detection failed: Cannot get lock owner thread.");
-      flagFailure = true;
       break;
     }
 
     /* Convert to jni object. */
-    jThreadObj = (jthread)incAddress(threadPtr,
-                                     vmVal->getOfsJavaThreadThreadObj());
+    jthread ownerThread =
+        (jthread)incAddress(threadPtr, vmVal->getOfsJavaThreadThreadObj());
+    jlong ownerId = vmFunc->GetThreadId(*(void **)ownerThread);
 
     /* Create list item. */
-    threadRec = (TDeadlockList *)malloc(sizeof(TDeadlockList));
+    TDeadlockList *threadRec =
+        (TDeadlockList *)malloc(sizeof(TDeadlockList));
     if (unlikely(threadRec == NULL)) {
-      /* Shouldn't reach to here. */
       logger->printWarnMsg(
           "Deadlock detection failed: Cannot allocate memory for "
           "TDeadLockList.");
-      flagFailure = true;
       break;
     }
 
     /* Store thread. */
-    threadRec->thread = jThreadObj;
+    threadRec->thread = ownerThread;
     threadRec->next = NULL;
     if (likely(oldRec != NULL)) {
       oldRec->next = threadRec;
@@ -619,61 +623,386 @@ void TDeadlockFinder::getLockedThreads(pid_t startId, jobject monitor,
     }
     oldRec = threadRec;
 
-    /* Get OSThread ptr related to JavaThread. */
-    nativeThread =
-        (void *)*(ptrdiff_t *)incAddress(threadPtr,
-                                         vmVal->getOfsJavaThreadOsthread());
+    /* Store owner to the edge, and get the edge of the owner. */
+    TWaitForEdge ownerEdge = {0};
+    bool isBlocked = false;
+    spinLockWait(&graphLockVal);
+    {
+      TWaitForGraph::iterator waiter = waitForGraph.find(waiterId);
+      if (likely(waiter != waitForGraph.end())) {
+        waiter->second.ownerId = ownerId;
+      }
 
-    if (unlikely(nativeThread == NULL)) {
-      /* Shouldn't reach to here. */
-      logger->printDebugMsg(
-          "Deadlock detection failed: Cannot get native thread.");
-      flagFailure = true;
-      break;
+      TWaitForGraph::iterator owner = waitForGraph.find(ownerId);
+      if (owner != waitForGraph.end()) {
+        ownerEdge = owner->second;
+        isBlocked = true;
+      }
     }
+    spinLockRelease(&graphLockVal);
 
-    /* Get nid (LWP ID). */
-    ownerId = (pid_t *)incAddress(nativeThread,
-                                  vmVal->getOfsOSThreadThreadId());
+    /* If occurred deadlock. */
+    if (unlikely(ownerId == startId)) {
+      foundCycle = true;
+      break;
+    }
 
-    /* If all thread already has collected. */
-    if (*ownerId == startId) {
+    /* Owner thread isn't blocked. */
+    int *status =
+        (int *)incAddress(threadPtr, vmVal->getOfsJavaThreadThreadState());
+    if (likely(!isBlocked || (*status == THREAD_IN_JAVA) ||
+               (*status == THREAD_IN_VM))) {
       break;
     }
 
-    /* Get ObjectMonitor pointer. */
-    contendedMonitor = (void *)*(ptrdiff_t *)incAddress(
-                         threadPtr, vmVal->getOfsThreadCurrentPendingMonitor());
+    /* Follow the edge of the owner. */
+    waiterId = ownerId;
+    monitor = ownerEdge.monitor;
+  }
 
-    if (unlikely(contendedMonitor == NULL)) {
-      /* Shouldn't reach to here. */
-      logger->printDebugMsg(
-          "Deadlock detection failed: Cannot get contended monitor.");
-      flagFailure = true;
-      break;
+  if (unlikely(foundCycle)) {
+    (*list) = listHead;
+  } else {
+    freeDeadlockList(listHead);
+  }
+
+  return foundCycle;
+}
+
+/*!
+ * \brief Check all threads in the cycle are blocked on monitor enter.
+ * \param jvmti    [in] JVMTI environment object.
+ * \param threadId [in] Thread ID of the thread which closed the cycle.
+ * \param list     [in] List of threads in the cycle.
+ * \return Number of deadlock occurred threads.<br>
+ *         Value is 0, if some thread in the cycle is running.
+ */
+int TDeadlockFinder::countBlockedThreads(jvmtiEnv *jvmti, jlong threadId,
+                                         TDeadlockList *list) {
+  TVMFunctions *vmFunc = TVMFunctions::getInstance();
+  int threadCnt = 0;
+
+  for (TDeadlockList *item = list; item != NULL; item = item->next) {
+    threadCnt++;
+
+    /* Current thread is in MonitorContendedEnter event. */
+    if (vmFunc->GetThreadId(*(void **)item->thread) == threadId) {
+      continue;
     }
 
-    monitor = (jobject)incAddress(contendedMonitor,
-                                  vmVal->getOfsObjectMonitorObject());
+    jint state = 0;
+    if ((jvmti->GetThreadState(item->thread, &state) != JVMTI_ERROR_NONE) ||
+        !(state & JVMTI_THREAD_STATE_BLOCKED_ON_MONITOR_ENTER)) {
+      return 0;
+    }
+  }
 
-    /* If illegal state. */
-    if (unlikely(monitor == NULL)) {
-      /* Shouldn't reach to here. */
-      logger->printDebugMsg(
-          "Deadlock detection failed: Cannot get monitor object.");
-      flagFailure = true;
-      break;
+  return threadCnt;
+}
+
+/*!
+ * \brief Get inflated monitor of the object.
+ * \param oop [in] Java object.
+ * \return ObjectMonitor of the object.<br>
+ *         Value is NULL, if the object isn't inflated.
+ */
+void *TDeadlockFinder::getInflatedMonitor(void *oop) {
+  TVMVariables *vmVal = TVMVariables::getInstance();
+
+  /* Sanity check. */
+  if (unlikely(oop == NULL)) {
+    return NULL;
+  }
+
+  /*
+   * Contended or waited monitor is always inflated, and it is not deflated
+   * while any thread is blocked on it or waiting for it.
+   */
+  ptrdiff_t markOop = *(ptrdiff_t *)incAddress(oop, vmVal->getOfsMarkAtOop());
+  if (unlikely((markOop & vmVal->getLockMaskInPlaceMarkOop()) !=
+               MARK_MONITOR_VALUE)) {
+    return NULL;
+  }
+
+  return (void *)(markOop ^ MARK_MONITOR_VALUE);
+}
+
+/*!
+ * \brief Check whether the monitor is owned by any thread.
+ * \param monitor [in] ObjectMonitor.
+ * \return false if the monitor is not owned.<br>
+ *         Value is true, if it cannot be determined.
+ */
+bool TDeadlockFinder::isOwnedMonitor(void *monitor) {
+  off_t ofsOwner = TVMVariables::getInstance()->getOfsObjectMonitorOwner();
+
+  /* Sanity check. */
+  if (unlikely(monitor == NULL)) {
+    return false;
+  }
+
+  if (unlikely(ofsOwner == -1)) {
+    return true;
+  }
+
+  return (*(void *volatile *)incAddress(monitor, ofsOwner) != NULL);
+}
+
+/*!
+ * \brief Add edge to wait-for graph.
+ * \param env      [in] JNI environment object.
+ * \param threadId [in] Thread ID of the thread which is blocked.
+ * \param monitor  [in] ObjectMonitor which the thread is waiting for.
+ * \param thread   [in] Thread which is not tracked by
+ *                      MonitorContendedEntered event, or NULL.
+ * \return true if other thread is blocked, so new edge could close
+ *         a cycle.
+ */
+bool TDeadlockFinder::addWaitForEdge(JNIEnv *env, jlong threadId,
+                                     void *monitor, jthread thread) {
+  /* Sanity check. */
+  if (unlikely(monitor == NULL)) {
+    return false;
+  }
+
+  /* Untracked edge is removed when the thread is found not blocked. */
+  jthread globalThread = NULL;
+  if (thread != NULL) {
+    globalThread = (jthread)env->NewGlobalRef(thread);
+    if (unlikely(globalThread == NULL)) {
+      return false;
     }
   }
 
-  /* If failure get deadlock threads. */
-  if (unlikely(flagFailure)) {
-    freeDeadlockList(listHead);
-  } else {
-    (*list) = listHead;
+  bool existsOtherWaiter = true;
+  jthread oldThread = NULL;
+
+  spinLockWait(&graphLockVal);
+  {
+    try {
+      TWaitForEdge &edge = waitForGraph[threadId];
+      oldThread = edge.thread;
+      edge.monitor = monitor;
+      edge.ownerId = 0;
+      edge.thread = globalThread;
+
+      untrackedEdges += ((globalThread != NULL) ? 1 : 0) -
+                        ((oldThread != NULL) ? 1 : 0);
+      existsOtherWaiter = (waitForGraph.size() > 1);
+    } catch (...) {
+      /*
+       * Maybe failed to allocate memory.
+       * We cannot determine whether the cycle is closed.
+       */
+      oldThread = globalThread;
+    }
+  }
+  spinLockRelease(&graphLockVal);
+
+  if (oldThread != NULL) {
+    env->DeleteGlobalRef(oldThread);
+  }
+
+  return existsOtherWaiter;
+}
+
+/*!
+ * \brief Remove edge from wait-for graph.
+ * \param env      [in] JNI environment object.
+ * \param threadId [in] Thread ID of the thread which entered monitor.
+ */
+void TDeadlockFinder::removeWaitForEdge(JNIEnv *env, jlong threadId) {
+  jthread oldThread = NULL;
+
+  spinLockWait(&graphLockVal);
+  {
+    TWaitForGraph::iterator edge = waitForGraph.find(threadId);
+    if (edge != waitForGraph.end()) {
+      oldThread = edge->second.thread;
+      if (oldThread != NULL) {
+        untrackedEdges--;
+      }
+
+      waitForGraph.erase(edge);
+    }
+  }
+  spinLockRelease(&graphLockVal);
+
+  if (oldThread != NULL) {
+    env->DeleteGlobalRef(oldThread);
+  }
+}
+
+/*!
+ * \brief Remove edges which are not tracked by MonitorContendedEntered
+ *        event if the thread isn't blocked anymore.
+ * \param jvmti [in] JVMTI environment object.
+ * \param env   [in] JNI environment object.
+ * \return true if other thread is blocked.
+ */
+bool TDeadlockFinder::pruneWaitForGraph(jvmtiEnv *jvmti, JNIEnv *env) {
+  bool existsOtherWaiter = true;
+  jlong now = getMonotonicTime();
+
+  spinLockWait(&graphLockVal);
+  {
+    /*
+     * Pruning calls GetThreadState() for each untracked edge, so it is
+     * rate limited. Stale edges make only false positives, and they are
+     * rejected by countBlockedThreads().
+     */
+    bool needsPrune = (untrackedEdges > 0) &&
+                      ((now - lastPruneTime) >= DEADLOCK_PRUNE_INTERVAL);
+    if (needsPrune) {
+      lastPruneTime = now;
+    }
+
+    /*
+     * GetThreadState() doesn't wait for other threads, and other holders
+     * of this lock are running on native. So it can be called in the lock.
+     */
+    for (TWaitForGraph::iterator edge = waitForGraph.begin();
+         needsPrune && (untrackedEdges > 0) && (edge != waitForGraph.end());) {
+      jthread thread = edge->second.thread;
+      jint state = 0;
+
+      if ((thread == NULL) ||
+          ((jvmti->GetThreadState(thread, &state) == JVMTI_ERROR_NONE) &&
+           (state & JVMTI_THREAD_STATE_BLOCKED_ON_MONITOR_ENTER))) {
+        ++edge;
+        continue;
+      }
+
+      /* The thread has already entered the monitor or terminated. */
+      env->DeleteGlobalRef(thread);
+      untrackedEdges--;
+      edge = waitForGraph.erase(edge);
+    }
+
+    existsOtherWaiter = (waitForGraph.size() > 1);
+  }
+  spinLockRelease(&graphLockVal);
+
+  return existsOtherWaiter;
+}
+
+/*!
+ * \brief Check whether current thread owns the monitor which other
+ *        blocked thread is waiting for.<br>
+ *        New edge of current thread can close a cycle only if it is true.
+ * \param threadId [in] Thread ID of current thread.
+ * \return false if current thread doesn't own such monitor.<br>
+ *         Value is true, if it cannot be determined.
+ */
+bool TDeadlockFinder::isWaitedByOthers(jlong threadId) {
+  TVMVariables *vmVal = TVMVariables::getInstance();
+  void *thisThreadPtr = TVMFunctions::getInstance()->GetThread();
+  off_t ofsOwner = vmVal->getOfsObjectMonitorOwner();
+  off_t ofsStackBase = vmVal->getOfsThreadStackBase();
+  off_t ofsStackSize = vmVal->getOfsThreadStackSize();
+
+  if (unlikely((thisThreadPtr == NULL) || (ofsOwner == -1) ||
+               (ofsStackBase == -1) || (ofsStackSize == -1))) {
+    return true;
+  }
+
+  /*
+   * Owner of the monitor is current thread, or BasicLock on its stack if
+   * the monitor is inflated from stack lock. Monitors which are owned by
+   * current thread are not changed while it is in this event.
+   */
+  char *stackBase = *(char **)incAddress(thisThreadPtr, ofsStackBase);
+  size_t stackSize = *(size_t *)incAddress(thisThreadPtr, ofsStackSize);
+  bool isWaited = false;
+
+  spinLockWait(&graphLockVal);
+  {
+    for (TWaitForGraph::iterator edge = waitForGraph.begin();
+         edge != waitForGraph.end(); ++edge) {
+      if (edge->first == threadId) {
+        continue;
+      }
+
+      char *owner =
+          *(char *volatile *)incAddress(edge->second.monitor, ofsOwner);
+      if ((owner == (char *)thisThreadPtr) ||
+          ((owner < stackBase) && (owner >= (stackBase - stackSize)))) {
+        isWaited = true;
+        break;
+      }
+    }
+  }
+  spinLockRelease(&graphLockVal);
+
+  return isWaited;
+}
+
+/*!
+ * \brief Rebuild wait-for graph when monitor events are switched.
+ * \param jvmti  [in] JVMTI environment object.
+ * \param enable [in] Monitor events are enabled or not.
+ * \warning Threads which are blocked while monitor events are disabled
+ *          cannot be tracked by event. So this function should be called
+ *          after monitor events are enabled.
+ */
+void TDeadlockFinder::resetWaitForGraph(jvmtiEnv *jvmti, bool enable) {
+  JNIEnv *env = NULL;
+  if (unlikely((vm == NULL) ||
+               (vm->GetEnv((void **)&env, JNI_VERSION_1_6) != JNI_OK))) {
+    logger->printWarnMsg("Could not get JNI environment for wait-for graph.");
+    env = NULL;
+  }
+
+  spinLockWait(&graphLockVal);
+  {
+    for (TWaitForGraph::iterator edge = waitForGraph.begin();
+         (env != NULL) && (edge != waitForGraph.end()); ++edge) {
+      if (edge->second.thread != NULL) {
+        env->DeleteGlobalRef(edge->second.thread);
+      }
+    }
+
+    waitForGraph.clear();
+    untrackedEdges = 0;
+  }
+  spinLockRelease(&graphLockVal);
+
+  if (!enable || (env == NULL)) {
+    return;
+  }
+
+  /* Register threads which are already blocked. */
+  jint threadCount = 0;
+  jthread *threads = NULL;
+  if (isError(jvmti, jvmti->GetAllThreads(&threadCount, &threads))) {
+    logger->printWarnMsg("Could not get threads for wait-for graph.");
+    return;
+  }
+
+  TVMFunctions *vmFunc = TVMFunctions::getInstance();
+  for (int Cnt = 0; Cnt < threadCount; Cnt++) {
+    jint state = 0;
+    jobject monitor = NULL;
+
+    /*
+     * GetCurrentContendedMonitor() needs the capability which can be added
+     * at OnLoad phase only. If it isn't available, the thread is tracked
+     * from next contention.
+     */
+    if ((jvmti->GetThreadState(threads[Cnt], &state) == JVMTI_ERROR_NONE) &&
+        (state & JVMTI_THREAD_STATE_BLOCKED_ON_MONITOR_ENTER) &&
+        (jvmti->GetCurrentContendedMonitor(threads[Cnt], &monitor) ==
+         JVMTI_ERROR_NONE) &&
+        (monitor != NULL)) {
+      addWaitForEdge(env, vmFunc->GetThreadId(*(void **)threads[Cnt]),
+                     getInflatedMonitor(*(void **)monitor), threads[Cnt]);
+      env->DeleteLocalRef(monitor);
+    }
+
+    env->DeleteLocalRef(threads[Cnt]);
   }
 
-  return;
+  jvmti->Deallocate((unsigned char *)threads);
 }
 
 /*!
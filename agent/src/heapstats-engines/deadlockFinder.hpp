@@ -26,6 +26,7 @@
 #include <jni.h>
 
 #include <queue>
+#include <tr1/unordered_map>
 
 #include "util.hpp"
 #include "agentThread.hpp"
@@ -39,6 +40,11 @@
 #define FASTCALL
 #endif
 
+/*!
+ * \brief Minimum interval to prune wait-for graph (in usec).
+ */
+#define DEADLOCK_PRUNE_INTERVAL 100000
+
 /*!
  * \brief This type is callback to periodic calling by timer.
  * \param jvmti [in] JVMTI environment object.
@@ -59,6 +65,27 @@ struct TDeadlockList {
   /*!< Next record item. */
 };
 
+/*!
+ * \brief This type is stored an edge of wait-for graph.
+ */
+struct TWaitForEdge {
+  void *monitor;
+  /*!< ObjectMonitor which the thread is waiting for. */
+  jlong ownerId;
+  /*!< Thread ID of the monitor owner. 0 if it is not resolved yet. */
+  jthread thread;
+  /*!< Global reference of the thread if no MonitorContendedEntered event
+       will be posted for this edge (re-entering after Object.wait() or
+       blocked before monitor events are enabled). Otherwise NULL. */
+};
+
+/*!
+ * \brief This type is wait-for graph.<br>
+ *        Key is thread ID of blocked thread.
+ */
+typedef std::tr1::unordered_map<jlong, TWaitForEdge, TNumericalHasher<jlong> >
+    TWaitForGraph;
+
 /*!
  * \brief Event handler of JVMTI MonitorContendedEnter for finding deadlock.
  * \param jvmti  [in] JVMTI environment.
@@ -72,6 +99,29 @@ struct TDeadlockList {
 void JNICALL OnMonitorContendedEnterForDeadlock(jvmtiEnv *jvmti, JNIEnv *env,
                                                 jthread thread, jobject object);
 
+/*!
+ * \brief Event handler of JVMTI MonitorContendedEntered for finding deadlock.
+ * \param jvmti  [in] JVMTI environment.
+ * \param env    [in] JNI environment of the event (current) thread.
+ * \param thread [in] JNI local reference to the thread entered the monitor.
+ * \param object [in] JNI local reference to the monitor.
+ */
+void JNICALL OnMonitorContendedEnteredForDeadlock(jvmtiEnv *jvmti,
+                                                  JNIEnv *env, jthread thread,
+                                                  jobject object);
+
+/*!
+ * \brief Event handler of JVMTI MonitorWaited for finding deadlock.
+ * \param jvmti     [in] JVMTI environment.
+ * \param env       [in] JNI environment of the event (current) thread.
+ * \param thread    [in] JNI local reference to the thread finished waiting.
+ * \param object    [in] JNI local reference to the monitor.
+ * \param timed_out [in] True if the monitor timed out.
+ */
+void JNICALL OnMonitorWaitedForDeadlock(jvmtiEnv *jvmti, JNIEnv *env,
+                                        jthread thread, jobject object,
+                                        jboolean timed_out);
+
 /*!
  * \brief This class is searching deadlock.
  */
@@ -122,21 +172,38 @@ class TDeadlockFinder : public TAgentThread {
    */
   void sendSNMPTrap(TMSecTime nowTime, int threadCnt, const char *name);
 
-  /*!
-   * \brief Check deadlock.
-   * \param monitor [in]  Monitor object of thread contended.
-   * \param list    [out] List of deadlock occurred threads.
-   * \return Number of deadlock occurred threads.<br>
-   *         Value is 0, if deadlock isn't occurred.
-   */
-  static int checkDeadlock(jobject monitor, TDeadlockList **list);
-
   /*!
    * \brief Deallocate deadlock thread list.
    * \param list [in] List of deadlock occurred threads.
    */
   static void freeDeadlockList(TDeadlockList *list);
 
+  /*!
+   * \brief Rebuild wait-for graph when monitor events are switched.
+   * \param jvmti  [in] JVMTI environment object.
+   * \param enable [in] Monitor events are enabled or not.
+   * \warning Threads which are blocked while monitor events are disabled
+   *          cannot be tracked by event. So this function should be called
+   *          after monitor events are enabled.
+   */
+  void resetWaitForGraph(jvmtiEnv *jvmti, bool enable);
+
+  /*!
+   * \brief Get inflated monitor of the object.
+   * \param oop [in] Java object.
+   * \return ObjectMonitor of the object.<br>
+   *         Value is NULL, if the object isn't inflated.
+   */
+  static void *getInflatedMonitor(void *oop);
+
+  /*!
+   * \brief Check whether the monitor is owned by any thread.
+   * \param monitor [in] ObjectMonitor.
+   * \return false if the monitor is not owned.<br>
+   *         Value is true, if it cannot be determined.
+   */
+  static bool isOwnedMonitor(void *monitor);
+
   /*!
    * \brief Get deadlock time.
    * \return Time of finally occurred deadlock until now.
@@ -178,29 +245,106 @@ class TDeadlockFinder : public TAgentThread {
                                          jthread thread, jobject object);
 
   /*!
-   * \brief JThread entry point.
+   * \brief Event handler of JVMTI MonitorContendedEntered for finding
+   *        deadlock.
+   * \param jvmti  [in] JVMTI environment.
+   * \param env    [in] JNI environment of the event (current) thread.
+   * \param thread [in] JNI local reference to the thread entered the monitor.
+   * \param object [in] JNI local reference to the monitor.
+   */
+  friend void JNICALL
+      OnMonitorContendedEnteredForDeadlock(jvmtiEnv *jvmti, JNIEnv *env,
+                                           jthread thread, jobject object);
+
+  /*!
+   * \brief Event handler of JVMTI MonitorWaited for finding deadlock.
+   * \param jvmti     [in] JVMTI environment.
+   * \param env       [in] JNI environment of the event (current) thread.
+   * \param thread    [in] JNI local reference to the thread finished
+   *                       waiting.
+   * \param object    [in] JNI local reference to the monitor.
+   * \param timed_out [in] True if the monitor timed out.
+   */
+  friend void JNICALL
+      OnMonitorWaitedForDeadlock(jvmtiEnv *jvmti, JNIEnv *env,
+                                 jthread thread, jobject object,
+                                 jboolean timed_out);
+
+  /*!
+   * \brief Add edge to wait-for graph.
+   * \param env      [in] JNI environment object.
+   * \param threadId [in] Thread ID of the thread which is blocked.
+   * \param monitor  [in] ObjectMonitor which the thread is waiting for.
+   * \param thread   [in] Thread which is not tracked by
+   *                      MonitorContendedEntered event, or NULL.
+   * \return true if other thread is blocked, so new edge could close
+   *         a cycle.
+   */
+  bool addWaitForEdge(JNIEnv *env, jlong threadId, void *monitor,
+                      jthread thread);
+
+  /*!
+   * \brief Remove edge from wait-for graph.
+   * \param env      [in] JNI environment object.
+   * \param threadId [in] Thread ID of the thread which entered monitor.
+   */
+  void removeWaitForEdge(JNIEnv *env, jlong threadId);
+
+  /*!
+   * \brief Remove edges which are not tracked by MonitorContendedEntered
+   *        event if the thread isn't blocked anymore.
    * \param jvmti [in] JVMTI environment object.
-   * \param jni   [in] JNI environment object.
-   * \param data  [in] Pointer of TDeadlockFinder.
+   * \param env   [in] JNI environment object.
+   * \return true if other thread is blocked.
    */
-  static void JNICALL entryPoint(jvmtiEnv *jvmti, JNIEnv *jni, void *data);
+  bool pruneWaitForGraph(jvmtiEnv *jvmti, JNIEnv *env);
+
+  /*!
+   * \brief Check whether current thread owns the monitor which other
+   *        blocked thread is waiting for.<br>
+   *        New edge of current thread can close a cycle only if it is true.
+   * \param threadId [in] Thread ID of current thread.
+   * \return false if current thread doesn't own such monitor.<br>
+   *         Value is true, if it cannot be determined.
+   */
+  bool isWaitedByOthers(jlong threadId);
 
   /*!
-   * \brief DeadLock search (recursive call).
-   * \param startId [in] Thread id of TDeadlockFinder caller.
-   * \param monitor [in] Monitor object of thread contended.
+   * \brief Find cycle which is closed by new edge.
+   * \param startId [in]  Thread ID of the thread which added new edge.
+   * \param monitor [in]  ObjectMonitor of the new edge.
+   * \param list    [out] List of threads in the cycle.
+   * \return Is found cycle.
+   */
+  bool findWaitForCycle(jlong startId, void *monitor, TDeadlockList **list);
+
+  /*!
+   * \brief Check deadlock.
+   * \param threadId [in]  Thread ID of the thread contended.
+   * \param monitor  [in]  ObjectMonitor of thread contended.
+   * \param list     [out] List of deadlock occurred threads.
    * \return Is found deadlock.
    */
-  static FASTCALL bool findDeadLock(pid_t startId, jobject monitor);
+  bool checkDeadlock(jlong threadId, void *monitor, TDeadlockList **list);
+
+  /*!
+   * \brief Check all threads in the cycle are blocked on monitor enter.
+   * \param jvmti    [in] JVMTI environment object.
+   * \param threadId [in] Thread ID of the thread which closed the cycle.
+   * \param list     [in] List of threads in the cycle.
+   * \return Number of deadlock occurred threads.<br>
+   *         Value is 0, if some thread in the cycle is running.
+   */
+  static int countBlockedThreads(jvmtiEnv *jvmti, jlong threadId,
+                                 TDeadlockList *list);
 
   /*!
-   * \brief Get threads which has occurred deadlock.
-   * \param startId [in]  Thread id of TDeadlockFinder caller.
-   * \param monitor [in]  Monitor object of thread contended.
-   * \param list    [out] List of deadlock occurred threads.
+   * \brief JThread entry point.
+   * \param jvmti [in] JVMTI environment object.
+   * \param jni   [in] JNI environment object.
+   * \param data  [in] Pointer of TDeadlockFinder.
    */
-  static void getLockedThreads(pid_t startId, jobject monitor,
-                               TDeadlockList **list);
+  static void JNICALL entryPoint(jvmtiEnv *jvmti, JNIEnv *jni, void *data);
 
  private:
   /*!
@@ -222,6 +366,36 @@ class TDeadlockFinder : public TAgentThread {
    * \brief Queue of occurred deadlock datetime.
    */
   std::queue<jlong> timeList;
+
+  /*!
+   * \brief JavaVM object to get JNI environment of the caller.
+   */
+  JavaVM *vm;
+
+  /*!
+   * \brief Wait-for graph.<br>
+   *        Key is thread ID of blocked thread, Value is the monitor which
+   *        the thread is waiting for and its owner. Deadlock cycle consists
+   *        of blocked threads only, so we need not to walk VM structures
+   *        while the graph has no other blocked thread.
+   */
+  TWaitForGraph waitForGraph;
+
+  /*!
+   * \brief Number of edges which are not tracked by
+   *        MonitorContendedEntered event.
+   */
+  int untrackedEdges;
+
+  /*!
+   * \brief Time of last pruning of wait-for graph (in usec).
+   */
+  jlong lastPruneTime;
+
+  /*!
+   * \brief SpinLock variable for wait-for graph operation.
+   */
+  volatile int graphLockVal;
 };
 
 #endif  // _DEADLOCK_FINDER_H
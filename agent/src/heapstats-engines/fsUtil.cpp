@@ -24,6 +24,7 @@
 #include <dirent.h>
 
 #include "globals.hpp"
+#include "asyncWriter.hpp"
 #include "fsUtil.hpp"
 
 /*!
@@ -116,15 +117,31 @@ int copyFile(char const *sourceFile, char const *destPath,
     char buf[1024];
     ssize_t read_size;
 
-    while ((read_size = read(sourceFd, buf, 1024)) > 0) {
-      if (write(destFd, buf, (size_t)read_size) == -1) {
-        read_size = -1;
-        break;
+    /* Next block is read while previous blocks are written. */
+    try {
+      TAsyncFile writer(destFd, 0);
+
+      while ((read_size = read(sourceFd, buf, 1024)) > 0) {
+        result = writer.write(buf, (size_t)read_size);
+        if (unlikely(result != 0)) {
+          break;
+        }
+      }
+
+      if (read_size == -1) {
+        result = errno;
+      }
+
+      int writtenResult = writer.finish();
+      if (result == 0) {
+        result = writtenResult;
       }
+    } catch (...) {
+      result = ENOMEM;
     }
 
-    if (read_size == -1) {
-      result = errno;
+    if (result != 0) {
+      errno = result;
       logger->printWarnMsgWithErrno("Couldn't copy file.");
     }
   }
@@ -602,3 +619,31 @@ bool isValidPath(const char *path) {
 
   return result;
 }
+
+/*!
+ * \brief Get runtime directory of the current user like hsperfdata.<br>
+ *        "/tmp/heapstats_<uid>" is created if it does not exist.
+ * \param dir [out] Path of runtime directory.
+ * \param len [in]  Size of buffer of "dir".
+ * \return Value is zero, if process is succeed.<br />
+ *         Value is error number a.k.a. "errno", if process is failure.
+ */
+int getRuntimeDirectory(char *dir, size_t len) {
+  snprintf(dir, len, "/tmp/heapstats_%d", geteuid());
+
+  if (unlikely((mkdir(dir, S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH) !=
+                0) &&
+               (errno != EEXIST))) {
+    return errno;
+  }
+
+  /* Directory which is owned by others is not used. */
+  struct stat st;
+  if (unlikely(lstat(dir, &st) != 0)) {
+    return errno;
+  } else if (unlikely(!S_ISDIR(st.st_mode) || (st.st_uid != geteuid()))) {
+    return EACCES;
+  }
+
+  return 0;
+}
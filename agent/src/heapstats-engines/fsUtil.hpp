@@ -22,6 +22,7 @@
 #define _FS_UTIL_H
 
 #include <errno.h>
+#include <stddef.h>
 
 /*!
  * \brief Copy data as avoid overwriting.
@@ -103,6 +104,16 @@ int isAccessibleDirectory(char const* path, bool needRead, bool needWrite);
  */
 bool isValidPath(const char* path);
 
+/*!
+ * \brief Get runtime directory of the current user like hsperfdata.<br>
+ *        "/tmp/heapstats_<uid>" is created if it does not exist.
+ * \param dir [out] Path of runtime directory.
+ * \param len [in]  Size of buffer of "dir".
+ * \return Value is zero, if process is succeed.<br />
+ *         Value is error number a.k.a. "errno", if process is failure.
+ */
+int getRuntimeDirectory(char* dir, size_t len);
+
 /*!
  * \brief Check disk full error.<br />
  *        If error is disk full, then print alert message.
@@ -46,6 +46,18 @@ extern TTimer *timer;
 #include "deadlockFinder.hpp"
 extern TDeadlockFinder *lockFinder;
 
+#include "monitorProfiler.hpp"
+
+#include "cpuProfiler.hpp"
+
+#include "allocProfiler.hpp"
+
+#include "threadCpuSampler.hpp"
+
+#include "perfCounterSampler.hpp"
+
+#include "cmdHelper.hpp"
+
 #include "symbolFinder.hpp"
 extern TSymbolFinder *symFinder;
 
@@ -61,6 +73,9 @@ extern TClassContainer *clsContainer;
 #include "snapShotProcessor.hpp"
 extern TSnapShotProcessor *snapShotProcessor;
 
+#include "liveCounter.hpp"
+#include "metricsServer.hpp"
+
 #include "gcWatcher.hpp"
 extern TGCWatcher *gcWatcher;
 
@@ -293,9 +293,12 @@ JNIEXPORT void JNICALL RegisterHeapStatsNative(JNIEnv *env, jclass cls) {
        (void *)InvokeLogCollection},
       {(char *)"invokeAllLogCollection0",
        (char *)"()Z",
-       (void *)InvokeAllLogCollection}};
+       (void *)InvokeAllLogCollection},
+      {(char *)"getPerfCounterSample0",
+       (char *)"()Ljava/util/Map;",
+       (void *)GetPerfCounterSample}};
 
-  if (env->RegisterNatives(cls, methods, 6) != 0) {
+  if (env->RegisterNatives(cls, methods, 7) != 0) {
     raiseException(env, "java/lang/UnsatisfiedLinkError",
                    "Native function for HeapStatsMBean failed.");
     return;
@@ -648,3 +651,75 @@ JNIEXPORT jboolean JNICALL InvokeAllLogCollection(JNIEnv *env, jobject obj) {
                                    (TMSecTime)getNowTimeSec(), "JMX event");
   return ret == 0 ? JNI_TRUE : JNI_FALSE;
 }
+
+/*!
+ * \brief Put jlong value to Map as Long object.
+ *
+ * \param env   Pointer of JNI environment.
+ * \param map   Map object to put.
+ * \param name  Key of the value.
+ * \param value Value to put.
+ * \return true if succeeded.
+ */
+static bool putLongToMap(JNIEnv *env, jobject map, const char *name,
+                         jlong value) {
+  jstring key = createString(env, name);
+  if (key == NULL) {
+    return false;
+  }
+
+  jobject longObj = env->CallStaticObjectMethod(longCls, longValueOf, value);
+  if (env->ExceptionCheck()) {
+    return false;
+  }
+
+  env->CallObjectMethod(map, map_put, key, longObj);
+  if (env->ExceptionCheck()) {
+    raiseException(env, "java/lang/RuntimeException",
+                   "Cannot put perf counter to Map instance.");
+    return false;
+  }
+
+  return true;
+}
+
+/*!
+ * \brief Get the latest sample of perf counter sampler from libheapstats.
+ *
+ * \param env   Pointer of JNI environment.
+ * \param obj   Instance of HeapStatsMBean implementation.
+ * \return Map of counter name and value.
+ *         It is empty if perf counter sampler is disabled.
+ */
+JNIEXPORT jobject JNICALL GetPerfCounterSample(JNIEnv *env, jobject obj) {
+  jobject result = env->NewObject(mapCls, map_ctor);
+  if (result == NULL) {
+    raiseException(env, "java/lang/RuntimeException",
+                   "Cannot create Map instance.");
+    return NULL;
+  }
+
+  TPerfCounterSampler *sampler = TPerfCounterSampler::getInstance();
+  TPerfSample sample;
+  if (!conf->PerfSampler()->get() || (sampler == NULL) ||
+      !sampler->getLatestSample(&sample)) {
+    return result;
+  }
+
+  if (!putLongToMap(env, result, "time", sample.time) ||
+      !putLongToMap(env, result, "allocation_rate", sample.allocationRate) ||
+      !putLongToMap(env, result, "promotion_rate", sample.promotionRate) ||
+      !putLongToMap(env, result, "safepoint_latency",
+                    sample.safepointLatency)) {
+    return NULL;
+  }
+
+  for (int idx = 0; idx < sampler->getNumCounters(); idx++) {
+    if (!putLongToMap(env, result, sampler->getCounterName(idx),
+                      sample.counters[idx])) {
+      return NULL;
+    }
+  }
+
+  return result;
+}
@@ -37,6 +37,7 @@ extern "C" {
       ChangeConfiguration(JNIEnv *env, jobject obj, jstring key, jobject value);
   JNIEXPORT jboolean JNICALL InvokeLogCollection(JNIEnv *env, jobject obj);
   JNIEXPORT jboolean JNICALL InvokeAllLogCollection(JNIEnv *env, jobject obj);
+  JNIEXPORT jobject JNICALL GetPerfCounterSample(JNIEnv *env, jobject obj);
 
 #ifdef __cplusplus
 }
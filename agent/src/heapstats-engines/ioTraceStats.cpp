@@ -0,0 +1,612 @@
+/*!
+ * \file ioTraceStats.cpp
+ * \brief Aggregate I/O statistics which are gathered by IoTrace.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include <jvmti.h>
+#include <jni.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <arpa/inet.h>
+
+#include "globals.hpp"
+#include "util.hpp"
+#include "ioTraceStats.hpp"
+
+#if PROCESSOR_ARCH == X86
+#include "arch/x86/lock.inline.hpp"
+#elif PROCESSOR_ARCH == ARM
+#include "arch/arm/lock.inline.hpp"
+#endif
+
+/*!
+ * \brief Name of each I/O kind in dump file.
+ */
+static const char *ioTraceKindName[] = {"FileRead", "FileWrite", "SocketRead",
+                                        "SocketWrite"};
+
+/*!
+ * \brief Calculate hash value of file path.
+ *
+ * \param path [in] File path.
+ * \return Hash value.
+ */
+static inline jint getPathHash(const char *path) {
+  unsigned int hash = 5381;
+  for (const char *c = path; *c != '\0'; c++) {
+    hash = (hash * 33) ^ (unsigned char)*c;
+  }
+
+  return (jint)hash;
+}
+
+/*!
+ * \brief Calculate hash value of raw address of remote peer.
+ *
+ * \param address [in] Raw address.
+ * \param len [in] Length of raw address.
+ * \return Hash value.
+ */
+static inline jint getAddressHash(const unsigned char *address, int len) {
+  unsigned int hash = 5381;
+  for (int Cnt = 0; Cnt < len; Cnt++) {
+    hash = (hash * 33) ^ address[Cnt];
+  }
+
+  return (jint)hash;
+}
+
+/*!
+ * \brief Get field ID. Pending exception is cleared if it does not exist.
+ *
+ * \param env [in] JNI environment.
+ * \param klass [in] Class which has the field.
+ * \param name [in] Field name.
+ * \param sig [in] Field signature.
+ * \return Field ID, or NULL if it does not exist.
+ */
+static jfieldID getOptionalFieldID(JNIEnv *env, jclass klass,
+                                   const char *name, const char *sig) {
+  if (klass == NULL) {
+    return NULL;
+  }
+
+  jfieldID field = env->GetFieldID(klass, name, sig);
+  if (field == NULL) {
+    env->ExceptionClear();
+  }
+
+  return field;
+}
+
+/*!
+ * \brief Write string to CSV as quoted field.
+ *        Double quotes in the string are escaped by doubling.
+ *
+ * \param out [in] Output stream.
+ * \param str [in] String to write.
+ */
+static void writeQuotedField(FILE *out, const char *str) {
+  fputc('"', out);
+  for (const char *c = str; *c != '\0'; c++) {
+    if (*c == '"') {
+      fputc('"', out);
+    }
+    fputc(*c, out);
+  }
+  fputc('"', out);
+}
+
+/*!
+ * \brief Constructor of TIoTraceStats.
+ *
+ * \param env [in] JNI environment.
+ * \param entries [in] Max number of entries.
+ */
+TIoTraceStats::TIoTraceStats(JNIEnv *env, int entries) {
+  maxEntries = entries;
+  numEntries = 0;
+  tableLockVal = 0;
+
+  /* Keep load factor of the table under 0.5 . */
+  tableSize = 1;
+  while (tableSize < (maxEntries * 2)) {
+    tableSize <<= 1;
+  }
+
+  table = (TIoTraceEntry *)calloc(tableSize, sizeof(TIoTraceEntry));
+  if (unlikely(table == NULL)) {
+    throw errno;
+  }
+
+  memset(overflow, 0, sizeof(overflow));
+  for (int kind = IoTraceFileRead; kind <= IoTraceSocketWrite; kind++) {
+    overflow[kind].kind = kind;
+    overflow[kind].label = (char *)"(others)";
+  }
+
+  int ret = pthread_key_create(&startTimeKey, &free);
+  if (unlikely(ret != 0)) {
+    free(table);
+    throw ret;
+  }
+
+  /*
+   * Raw fields of InetAddress are read instead of calling Java methods
+   * because socketEnd() is called at every socket I/O.
+   * JDK 8 or later (and recent JDK 7 updates) holds them in holder objects.
+   */
+  inetHolder = NULL;
+  inetAddress = NULL;
+  inetFamily = NULL;
+  inet6Holder = NULL;
+  inet6IpAddress = NULL;
+
+  jclass inetAddressClass = env->FindClass("java/net/InetAddress");
+  if (unlikely(inetAddressClass == NULL)) {
+    env->ExceptionClear();
+  }
+
+  inetHolder = getOptionalFieldID(env, inetAddressClass, "holder",
+                                  "Ljava/net/InetAddress$InetAddressHolder;");
+  if (inetHolder != NULL) {
+    jclass holderClass =
+        env->FindClass("java/net/InetAddress$InetAddressHolder");
+    if (unlikely(holderClass == NULL)) {
+      env->ExceptionClear();
+      inetHolder = NULL;
+    } else {
+      inetAddress = getOptionalFieldID(env, holderClass, "address", "I");
+      inetFamily = getOptionalFieldID(env, holderClass, "family", "I");
+      env->DeleteLocalRef(holderClass);
+    }
+  } else {
+    inetAddress = getOptionalFieldID(env, inetAddressClass, "address", "I");
+    inetFamily = getOptionalFieldID(env, inetAddressClass, "family", "I");
+  }
+
+  if (inetAddressClass != NULL) {
+    env->DeleteLocalRef(inetAddressClass);
+  }
+
+  jclass inet6AddressClass = env->FindClass("java/net/Inet6Address");
+  if (unlikely(inet6AddressClass == NULL)) {
+    env->ExceptionClear();
+  }
+
+  inet6Holder =
+      getOptionalFieldID(env, inet6AddressClass, "holder6",
+                         "Ljava/net/Inet6Address$Inet6AddressHolder;");
+  if (inet6Holder != NULL) {
+    jclass holderClass =
+        env->FindClass("java/net/Inet6Address$Inet6AddressHolder");
+    if (unlikely(holderClass == NULL)) {
+      env->ExceptionClear();
+      inet6Holder = NULL;
+    } else {
+      inet6IpAddress = getOptionalFieldID(env, holderClass, "ipaddress", "[B");
+      env->DeleteLocalRef(holderClass);
+    }
+  } else {
+    inet6IpAddress =
+        getOptionalFieldID(env, inet6AddressClass, "ipaddress", "[B");
+  }
+
+  if (inet6AddressClass != NULL) {
+    env->DeleteLocalRef(inet6AddressClass);
+  }
+
+  if ((inetAddress == NULL) || (inetFamily == NULL)) {
+    logger->printWarnMsg(
+        "Could not find fields of InetAddress. Socket peers are not "
+        "distinguished in I/O statistics.");
+  }
+}
+
+/*!
+ * \brief Destructor of TIoTraceStats.
+ */
+TIoTraceStats::~TIoTraceStats() {
+  for (int Cnt = 0; Cnt < tableSize; Cnt++) {
+    free(table[Cnt].label);
+  }
+
+  free(table);
+  pthread_key_delete(startTimeKey);
+}
+
+/*!
+ * \brief Record start time of I/O in current thread.
+ */
+void TIoTraceStats::begin(void) {
+  jlong *startTime = (jlong *)pthread_getspecific(startTimeKey);
+
+  if (unlikely(startTime == NULL)) {
+    startTime = (jlong *)malloc(sizeof(jlong));
+    if (unlikely((startTime == NULL) ||
+                 (pthread_setspecific(startTimeKey, startTime) != 0))) {
+      free(startTime);
+      return;
+    }
+  }
+
+  *startTime = getMonotonicTime();
+}
+
+/*!
+ * \brief Get elapsed time from begin() in current thread.
+ *
+ * \return Elapsed time in usecs.
+ */
+jlong TIoTraceStats::getElapsedTime(void) {
+  jlong *startTime = (jlong *)pthread_getspecific(startTimeKey);
+
+  if (unlikely((startTime == NULL) || (*startTime == 0))) {
+    return 0;
+  }
+
+  jlong elapsed = getMonotonicTime() - *startTime;
+  *startTime = 0;
+
+  return (elapsed > 0) ? elapsed : 0;
+}
+
+/*!
+ * \brief Find entry from the table. Caller must hold table lock.
+ *
+ * \param kind [in] Kind of I/O operation.
+ * \param hash [in] Hash of the endpoint.
+ * \param port [in] Remote port.
+ * \param path [in] File path. This value is NULL for socket I/O.
+ * \param address [in] Raw address of remote peer for socket I/O.
+ * \param addressLen [in] Length of raw address.
+ * \return Entry of the endpoint.
+ *         Label of new entry is created only at insertion.
+ */
+TIoTraceEntry *TIoTraceStats::findEntry(TIoTraceKind kind, jint hash,
+                                        jint port, const char *path,
+                                        const unsigned char *address,
+                                        int addressLen) {
+  int mask = tableSize - 1;
+
+  for (int idx = (((unsigned int)hash) ^ (kind * 31) ^ port) & mask;;
+       idx = (idx + 1) & mask) {
+    TIoTraceEntry *entry = &table[idx];
+
+    if (entry->label == NULL) {
+      /* Empty slot. */
+      if (numEntries >= maxEntries) {
+        return &overflow[kind];
+      }
+
+      if (path != NULL) {
+        entry->label = strdup(path);
+      } else {
+        char hostAddr[INET6_ADDRSTRLEN];
+        int family = (addressLen == 16) ? AF_INET6 : AF_INET;
+        if ((addressLen == 0) ||
+            (inet_ntop(family, address, hostAddr, sizeof(hostAddr)) == NULL)) {
+          strcpy(hostAddr, "(unknown)");
+        }
+
+        char label[INET6_ADDRSTRLEN + 16];
+        snprintf(label, sizeof(label), "%s:%d", hostAddr, port);
+        entry->label = strdup(label);
+      }
+
+      if (unlikely(entry->label == NULL)) {
+        return &overflow[kind];
+      }
+
+      entry->kind = kind;
+      entry->hash = hash;
+      entry->port = port;
+      entry->addressLen = addressLen;
+      if (addressLen > 0) {
+        memcpy(entry->address, address, addressLen);
+      }
+      numEntries++;
+      return entry;
+    }
+
+    if ((entry->kind == kind) && (entry->hash == hash) &&
+        (entry->port == port) && (entry->addressLen == addressLen) &&
+        ((addressLen == 0) ||
+         (memcmp(entry->address, address, addressLen) == 0)) &&
+        ((path == NULL) || (strcmp(entry->label, path) == 0))) {
+      return entry;
+    }
+  }
+}
+
+/*!
+ * \brief Add I/O operation to the entry. Caller must hold table lock.
+ *
+ * \param entry [in] Entry of the endpoint.
+ * \param bytes [in] Transferred bytes.
+ * \param latency [in] Latency in usecs.
+ */
+void TIoTraceStats::account(TIoTraceEntry *entry, jlong bytes,
+                            jlong latency) {
+  int bucket = 0;
+  for (jlong val = latency;
+       (val > 0) && (bucket < (IOTRACE_LATENCY_BUCKETS - 1)); val >>= 1) {
+    bucket++;
+  }
+
+  entry->count++;
+  if (likely(bytes > 0)) {  // bytes might be -1 at EOF.
+    entry->bytes += bytes;
+  }
+  entry->totalLatency += latency;
+  if (entry->maxLatency < latency) {
+    entry->maxLatency = latency;
+  }
+  entry->histogram[bucket]++;
+}
+
+/*!
+ * \brief Account file I/O.
+ *
+ * \param env [in] JNI environment.
+ * \param kind [in] Kind of I/O operation.
+ * \param path [in] Path of the file. This value might be NULL.
+ * \param bytes [in] Transferred bytes.
+ */
+void TIoTraceStats::fileEnd(JNIEnv *env, TIoTraceKind kind, jstring path,
+                            jlong bytes) {
+  jlong latency = getElapsedTime();
+  char pathStr[PATH_MAX];
+
+  if (unlikely(path == NULL)) {
+    strcpy(pathStr, "(unknown)");
+  } else {
+    jsize len = env->GetStringLength(path);
+    jsize utfLen = env->GetStringUTFLength(path);
+
+    if (likely(utfLen < PATH_MAX)) {
+      env->GetStringUTFRegion(path, 0, len, pathStr);
+    } else {
+      /* Too long path. Use the tail of it. */
+      const char *utfPath = env->GetStringUTFChars(path, NULL);
+      if (unlikely(utfPath == NULL)) {
+        env->ExceptionClear();
+        return;
+      }
+
+      memcpy(pathStr, utfPath + (utfLen - PATH_MAX + 1), PATH_MAX - 1);
+      env->ReleaseStringUTFChars(path, utfPath);
+      utfLen = PATH_MAX - 1;
+    }
+
+    pathStr[utfLen] = '\0';
+  }
+
+  jint hash = getPathHash(pathStr);
+
+  spinLockWait(&tableLockVal);
+  {
+    account(findEntry(kind, hash, 0, pathStr, NULL, 0), bytes, latency);
+  }
+  spinLockRelease(&tableLockVal);
+}
+
+/*!
+ * \brief Account socket I/O.
+ *
+ * \param env [in] JNI environment.
+ * \param kind [in] Kind of I/O operation.
+ * \param inetAddr [in] InetAddress of remote peer. This value might be NULL.
+ * \param port [in] Remote port.
+ * \param bytes [in] Transferred bytes.
+ */
+void TIoTraceStats::socketEnd(JNIEnv *env, TIoTraceKind kind,
+                              jobject inetAddr, jint port, jlong bytes) {
+  jlong latency = getElapsedTime();
+
+  /*
+   * Raw address and port are used as the key, and label of the peer is
+   * created only when new entry is inserted.
+   */
+  unsigned char address[IOTRACE_MAX_ADDRESS_LEN];
+  int addressLen =
+      (inetAddr == NULL) ? 0 : getRawAddress(env, inetAddr, address);
+  jint hash = getAddressHash(address, addressLen);
+
+  spinLockWait(&tableLockVal);
+  {
+    account(findEntry(kind, hash, port, NULL, address, addressLen), bytes,
+            latency);
+  }
+  spinLockRelease(&tableLockVal);
+}
+
+/*!
+ * \brief Get raw address from InetAddress without calling Java method.
+ *
+ * \param env [in] JNI environment.
+ * \param inetAddr [in] InetAddress of remote peer.
+ * \param address [out] Buffer of raw address.
+ *                       It must have IOTRACE_MAX_ADDRESS_LEN bytes.
+ * \return Length of raw address, or 0 if it could not be gotten.
+ */
+int TIoTraceStats::getRawAddress(JNIEnv *env, jobject inetAddr,
+                                 unsigned char *address) {
+  if (unlikely((inetAddress == NULL) || (inetFamily == NULL))) {
+    return 0;
+  }
+
+  jobject holder =
+      (inetHolder == NULL) ? inetAddr : env->GetObjectField(inetAddr,
+                                                            inetHolder);
+  if (unlikely(holder == NULL)) {
+    return 0;
+  }
+
+  int len = 0;
+  jint family = env->GetIntField(holder, inetFamily);
+
+  /* Values of family are InetAddress.IPv4 (1) and InetAddress.IPv6 (2). */
+  if (family == 1) {
+    jint ipv4 = env->GetIntField(holder, inetAddress);
+    address[0] = (unsigned char)((ipv4 >> 24) & 0xff);
+    address[1] = (unsigned char)((ipv4 >> 16) & 0xff);
+    address[2] = (unsigned char)((ipv4 >> 8) & 0xff);
+    address[3] = (unsigned char)(ipv4 & 0xff);
+    len = 4;
+  } else if ((family == 2) && (inet6IpAddress != NULL)) {
+    jobject holder6 = (inet6Holder == NULL)
+                          ? inetAddr
+                          : env->GetObjectField(inetAddr, inet6Holder);
+    jbyteArray ipaddress =
+        (holder6 == NULL)
+            ? NULL
+            : (jbyteArray)env->GetObjectField(holder6, inet6IpAddress);
+
+    if (likely((ipaddress != NULL) &&
+               (env->GetArrayLength(ipaddress) == IOTRACE_MAX_ADDRESS_LEN))) {
+      env->GetByteArrayRegion(ipaddress, 0, IOTRACE_MAX_ADDRESS_LEN,
+                              (jbyte *)address);
+      len = IOTRACE_MAX_ADDRESS_LEN;
+    }
+
+    if (ipaddress != NULL) {
+      env->DeleteLocalRef(ipaddress);
+    }
+    if ((holder6 != NULL) && (holder6 != inetAddr)) {
+      env->DeleteLocalRef(holder6);
+    }
+  }
+
+  if (holder != inetAddr) {
+    env->DeleteLocalRef(holder);
+  }
+
+  return len;
+}
+
+/*!
+ * \brief Dump I/O statistics to file as CSV.
+ *
+ * \param fname [in] File name to dump.
+ */
+void TIoTraceStats::dump(const char *fname) {
+  /* Copy entries to release the lock as soon as possible. */
+  TIoTraceEntry *entries = (TIoTraceEntry *)malloc(
+      sizeof(TIoTraceEntry) * (tableSize + IoTraceSocketWrite + 1));
+  if (unlikely(entries == NULL)) {
+    logger->printWarnMsg("Could not allocate memory for I/O statistics.");
+    return;
+  }
+
+  int count = 0;
+  spinLockWait(&tableLockVal);
+  {
+    for (int Cnt = 0; Cnt < tableSize; Cnt++) {
+      if (table[Cnt].label != NULL) {
+        entries[count++] = table[Cnt];
+      }
+    }
+
+    for (int kind = IoTraceFileRead; kind <= IoTraceSocketWrite; kind++) {
+      if (overflow[kind].count > 0) {
+        entries[count++] = overflow[kind];
+      }
+    }
+  }
+  spinLockRelease(&tableLockVal);
+
+  FILE *out = fopen(fname, "w");
+  if (unlikely(out == NULL)) {
+    logger->printWarnMsgWithErrno("Could not open I/O statistics file: %s",
+                                  fname);
+    free(entries);
+    return;
+  }
+
+  /* Labels never be freed until destruction, so we can refer them here. */
+  fprintf(out, "kind,endpoint,count,bytes,total_latency_us,max_latency_us");
+  for (int bucket = 0; bucket < (IOTRACE_LATENCY_BUCKETS - 1); bucket++) {
+    fprintf(out, ",lt_%ldus", 1L << bucket);
+  }
+  fprintf(out, ",ge_%ldus", 1L << (IOTRACE_LATENCY_BUCKETS - 2));
+  fputc('\n', out);
+
+  for (int Cnt = 0; Cnt < count; Cnt++) {
+    TIoTraceEntry *entry = &entries[Cnt];
+    fprintf(out, "%s,", ioTraceKindName[entry->kind]);
+    writeQuotedField(out, entry->label);
+    fprintf(out, "," JLONG_FORMAT_STR "," JLONG_FORMAT_STR "," JLONG_FORMAT_STR
+                 "," JLONG_FORMAT_STR,
+            entry->count, entry->bytes, entry->totalLatency,
+            entry->maxLatency);
+    for (int bucket = 0; bucket < IOTRACE_LATENCY_BUCKETS; bucket++) {
+      fprintf(out, "," JLONG_FORMAT_STR, entry->histogram[bucket]);
+    }
+    fputc('\n', out);
+  }
+
+  if (unlikely(fclose(out) != 0)) {
+    logger->printWarnMsgWithErrno("Could not write I/O statistics file: %s",
+                                  fname);
+  }
+
+  free(entries);
+}
+
+/*!
+ * \brief Get total of all endpoints for each kind of I/O operation.
+ *
+ * \param totals [out] Totals which are indexed by TIoTraceKind.
+ *                     It must have (IoTraceSocketWrite + 1) elements.
+ *                     "label" of them is always NULL.
+ */
+void TIoTraceStats::getTotals(TIoTraceEntry *totals) {
+  memset(totals, 0, sizeof(TIoTraceEntry) * (IoTraceSocketWrite + 1));
+
+  spinLockWait(&tableLockVal);
+  {
+    for (int Cnt = 0; Cnt < (tableSize + IoTraceSocketWrite + 1); Cnt++) {
+      TIoTraceEntry *entry =
+          (Cnt < tableSize) ? &table[Cnt] : &overflow[Cnt - tableSize];
+      if (entry->count == 0) {
+        continue;
+      }
+
+      TIoTraceEntry *total = &totals[entry->kind];
+      total->kind = entry->kind;
+      total->count += entry->count;
+      total->bytes += entry->bytes;
+      total->totalLatency += entry->totalLatency;
+      if (total->maxLatency < entry->maxLatency) {
+        total->maxLatency = entry->maxLatency;
+      }
+
+      for (int bucket = 0; bucket < IOTRACE_LATENCY_BUCKETS; bucket++) {
+        total->histogram[bucket] += entry->histogram[bucket];
+      }
+    }
+  }
+  spinLockRelease(&tableLockVal);
+}
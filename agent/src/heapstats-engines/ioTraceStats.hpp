@@ -0,0 +1,241 @@
+/*!
+ * \file ioTraceStats.hpp
+ * \brief Aggregate I/O statistics which are gathered by IoTrace.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#ifndef IOTRACE_STATS_HPP
+#define IOTRACE_STATS_HPP
+
+#include <jvmti.h>
+#include <jni.h>
+
+#include <pthread.h>
+
+/*!
+ * \brief Number of latency histogram buckets.
+ *        Bucket N counts operations which took [2^(N-1), 2^N) usecs,
+ *        and the last bucket counts all slower operations.
+ */
+#define IOTRACE_LATENCY_BUCKETS 24
+
+/*!
+ * \brief Max length of raw address of remote peer (IPv6).
+ */
+#define IOTRACE_MAX_ADDRESS_LEN 16
+
+/*!
+ * \brief Kind of I/O operation.
+ */
+typedef enum {
+  IoTraceFileRead = 0,
+  IoTraceFileWrite,
+  IoTraceSocketRead,
+  IoTraceSocketWrite
+} TIoTraceKind;
+
+/*!
+ * \brief Aggregated statistics of one endpoint (file path or remote peer).
+ */
+typedef struct {
+  int kind;              /*!< This value presents TIoTraceKind.            */
+  jint hash;             /*!< Hash of file path or raw address.            */
+  jint port;             /*!< Remote port. This value is 0 for file I/O.   */
+  jint addressLen;       /*!< Length of raw address. 0 for file I/O.       */
+  unsigned char address[IOTRACE_MAX_ADDRESS_LEN]; /*!< Raw address.        */
+  char *label;           /*!< File path or "address:port" string.          */
+  jlong count;           /*!< Number of operations.                        */
+  jlong bytes;           /*!< Total bytes which are transferred.           */
+  jlong totalLatency;    /*!< Total latency in usecs.                      */
+  jlong maxLatency;      /*!< Max latency in usecs.                        */
+  jlong histogram[IOTRACE_LATENCY_BUCKETS]; /*!< Latency histogram.        */
+} TIoTraceEntry;
+
+/*!
+ * \brief Aggregator of I/O statistics.
+ *        Memory usage is bounded by the number of entries which is given at
+ *        construction. Operations to endpoints which cannot be stored any
+ *        more are accounted to overflow entry for each kind.
+ */
+class TIoTraceStats {
+ private:
+  /*!
+   * \brief Hash table of entries (open addressing).
+   */
+  TIoTraceEntry *table;
+
+  /*!
+   * \brief Number of slots in hash table. This value is power of 2.
+   */
+  int tableSize;
+
+  /*!
+   * \brief Max number of entries which can be stored.
+   */
+  int maxEntries;
+
+  /*!
+   * \brief Number of stored entries.
+   */
+  int numEntries;
+
+  /*!
+   * \brief Entries for operations which are not stored to the table.
+   */
+  TIoTraceEntry overflow[IoTraceSocketWrite + 1];
+
+  /*!
+   * \brief SpinLock variable for table operation.
+   */
+  volatile int tableLockVal;
+
+  /*!
+   * \brief Key of thread specific data to store start time of I/O.
+   */
+  pthread_key_t startTimeKey;
+
+  /*!
+   * \brief Field ID of InetAddress#holder (JDK 8 or later).
+   *        If this value is NULL, fields are read from InetAddress directly.
+   */
+  jfieldID inetHolder;
+
+  /*!
+   * \brief Field ID of "address" in InetAddress (or its holder).
+   */
+  jfieldID inetAddress;
+
+  /*!
+   * \brief Field ID of "family" in InetAddress (or its holder).
+   */
+  jfieldID inetFamily;
+
+  /*!
+   * \brief Field ID of Inet6Address#holder6 (JDK 8 or later).
+   *        If this value is NULL, ipaddress is read from Inet6Address directly.
+   */
+  jfieldID inet6Holder;
+
+  /*!
+   * \brief Field ID of "ipaddress" in Inet6Address (or its holder).
+   */
+  jfieldID inet6IpAddress;
+
+ protected:
+  /*!
+   * \brief Get elapsed time from begin() in current thread.
+   *
+   * \return Elapsed time in usecs.
+   */
+  jlong getElapsedTime(void);
+
+  /*!
+   * \brief Find entry from the table. Caller must hold table lock.
+   *
+   * \param kind [in] Kind of I/O operation.
+   * \param hash [in] Hash of the endpoint.
+   * \param port [in] Remote port.
+   * \param path [in] File path. This value is NULL for socket I/O.
+   * \param address [in] Raw address of remote peer for socket I/O.
+   * \param addressLen [in] Length of raw address.
+   * \return Entry of the endpoint.
+   *         Label of new entry is created only at insertion.
+   */
+  TIoTraceEntry *findEntry(TIoTraceKind kind, jint hash, jint port,
+                           const char *path, const unsigned char *address,
+                           int addressLen);
+
+  /*!
+   * \brief Get raw address from InetAddress without calling Java method.
+   *
+   * \param env [in] JNI environment.
+   * \param inetAddr [in] InetAddress of remote peer.
+   * \param address [out] Buffer of raw address.
+   *                       It must have IOTRACE_MAX_ADDRESS_LEN bytes.
+   * \return Length of raw address, or 0 if it could not be gotten.
+   */
+  int getRawAddress(JNIEnv *env, jobject inetAddr, unsigned char *address);
+
+  /*!
+   * \brief Add I/O operation to the entry. Caller must hold table lock.
+   *
+   * \param entry [in] Entry of the endpoint.
+   * \param bytes [in] Transferred bytes.
+   * \param latency [in] Latency in usecs.
+   */
+  void account(TIoTraceEntry *entry, jlong bytes, jlong latency);
+
+ public:
+  /*!
+   * \brief Constructor of TIoTraceStats.
+   *
+   * \param env [in] JNI environment.
+   * \param entries [in] Max number of entries.
+   */
+  TIoTraceStats(JNIEnv *env, int entries);
+
+  /*!
+   * \brief Destructor of TIoTraceStats.
+   */
+  virtual ~TIoTraceStats();
+
+  /*!
+   * \brief Record start time of I/O in current thread.
+   */
+  void begin(void);
+
+  /*!
+   * \brief Account file I/O.
+   *
+   * \param env [in] JNI environment.
+   * \param kind [in] Kind of I/O operation.
+   * \param path [in] Path of the file. This value might be NULL.
+   * \param bytes [in] Transferred bytes.
+   */
+  void fileEnd(JNIEnv *env, TIoTraceKind kind, jstring path, jlong bytes);
+
+  /*!
+   * \brief Account socket I/O.
+   *
+   * \param env [in] JNI environment.
+   * \param kind [in] Kind of I/O operation.
+   * \param inetAddr [in] InetAddress of remote peer. This value might be NULL.
+   * \param port [in] Remote port.
+   * \param bytes [in] Transferred bytes.
+   */
+  void socketEnd(JNIEnv *env, TIoTraceKind kind, jobject inetAddr, jint port,
+                 jlong bytes);
+
+  /*!
+   * \brief Dump I/O statistics to file as CSV.
+   *
+   * \param fname [in] File name to dump.
+   */
+  void dump(const char *fname);
+
+  /*!
+   * \brief Get total of all endpoints for each kind of I/O operation.
+   *
+   * \param totals [out] Totals which are indexed by TIoTraceKind.
+   *                     It must have (IoTraceSocketWrite + 1) elements.
+   *                     "label" of them is always NULL.
+   */
+  void getTotals(TIoTraceEntry *totals);
+};
+
+#endif  // IOTRACE_STATS_HPP
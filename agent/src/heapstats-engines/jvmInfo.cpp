@@ -72,6 +72,7 @@ TJvmInfo::TJvmInfo(void) {
   _threadLive = NULL;
   _safePointTime = NULL;
   _safePoints = NULL;
+  _unloadedClasses = NULL;
   _vmVersion = NULL;
   _vmName = NULL;
   _classPath = NULL;
@@ -488,6 +489,11 @@ void TJvmInfo::detectInfoAddress(JNIEnv *env) {
   int entryCount = sizeof(entries) / sizeof(VMStructSearchEntry);
   SearchInfoInVMStruct(entries, entryCount);
 
+  /* Unloaded class count is optional. It is used to invalidate caches. */
+  VMStructSearchEntry classEntry[] = {
+      {"java.cls.unloadedClasses", 'J', (void **)&this->_unloadedClasses}};
+  SearchInfoInVMStruct(classEntry, 1);
+
   /* Refresh log data load flag. */
   loadLogFlag = (_syncPark != NULL) && (_threadLive != NULL) &&
                 (_safePointTime != NULL) && (_safePoints != NULL);
@@ -269,6 +269,14 @@ class TJvmInfo {
     return ((_safePoints == NULL) ? -1 : *_safePoints);
   }
 
+  /*!
+   * \brief Get unloaded class count.
+   * \return Total number of unloaded classes, or -1 if it is unknown.
+   */
+  inline jlong getUnloadedClasses(void) {
+    return ((_unloadedClasses == NULL) ? -1 : *_unloadedClasses);
+  }
+
   /*!
    * \brief Get JVM version.
    * \return JVM version.
@@ -466,6 +474,22 @@ class TJvmInfo {
 
   void SetUnknownGCCause(void);
 
+  /*!
+   * \brief Search arbitrary counters in JVM performance data.<br>
+   *        Entries which are not found are left as is.
+   * \param entries [in,out] List of search target entries.
+   * \param count   [in]     Count of search target list.
+   * \return false if performance data is not available.
+   */
+  inline bool findPerfCounters(VMStructSearchEntry *entries, int count) {
+    if (this->perfAddr == 0) {
+      return false;
+    }
+
+    SearchInfoInVMStruct(entries, count);
+    return (this->perfAddr != 0);
+  }
+
  protected:
   /*!
    * \brief Address of java.lang.getMaxMemory().
@@ -603,6 +627,10 @@ class TJvmInfo {
    * \brief Count of work in safepoint.
    */
   jlong *_safePoints;
+  /*!
+   * \brief Total number of unloaded classes.
+   */
+  jlong *_unloadedClasses;
 
   /*!
    * \brief JVM version as uint
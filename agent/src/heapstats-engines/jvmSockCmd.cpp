@@ -73,6 +73,22 @@ int TJVMSockCmd::exec(char const* cmd, char const* filename) {
   return execute(cmd, conf, filename);
 }
 
+/*!
+ * \brief Execute command without params, and write response to stream.
+ * \param cmd [in] Execute command string.
+ * \param fd  [in] Output file descriptor.
+ * \return Response code of execute commad line.<br>
+ *         Execute command is succeed, if value is 0.<br>
+ *         Value is error code, if failure execute command.<br>
+ *         Even so the stream was written response data, if failure.
+ */
+int TJVMSockCmd::exec(char const* cmd, int fd) {
+  /* Empty paramters. */
+  const TJVMSockCmdArgs conf = {{0}, {0}, {0}};
+
+  return execute(cmd, conf, fd);
+}
+
 /*!
  * \brief Execute command, and save response.
  * \param cmd      [in] Execute command string.
@@ -85,6 +101,59 @@ int TJVMSockCmd::exec(char const* cmd, char const* filename) {
  */
 int TJVMSockCmd::execute(char const* cmd, const TJVMSockCmdArgs conf,
                          char const* filename) {
+  /* Open socket. */
+  int socketFD = connectJvmSock();
+  if (unlikely(socketFD < 0)) {
+    return -1;
+  }
+
+  int returnCode = 0;
+  /* Create response file. */
+  int fd = open(filename, O_CREAT | O_WRONLY | O_EXCL, S_IRUSR | S_IWUSR);
+  if (unlikely(fd < 0)) {
+    returnCode = errno;
+    logger->printWarnMsgWithErrno("Could not create threaddump file");
+    close(socketFD);
+    return returnCode;
+  }
+
+  returnCode = sendCommand(socketFD, cmd, conf, fd);
+
+  /* Cleanup. */
+  if (unlikely(close(fd) < 0 && returnCode == 0)) {
+    returnCode = errno;
+    logger->printWarnMsgWithErrno("Could not close socket to JVM");
+  }
+
+  return returnCode;
+}
+
+/*!
+ * \brief Execute command, and write response to stream.
+ * \param cmd  [in] Execute command string.
+ * \param conf [in] Execute command arguments.
+ * \param fd   [in] Output file descriptor.
+ * \return Response code of execute commad line.<br>
+ *         Execute command is succeed, if value is 0.<br>
+ *         Value is error code, if failure execute command.<br>
+ *         Even so the stream was written response data, if failure.
+ */
+int TJVMSockCmd::execute(char const* cmd, const TJVMSockCmdArgs conf,
+                         int fd) {
+  /* Open socket. */
+  int socketFD = connectJvmSock();
+  if (unlikely(socketFD < 0)) {
+    return -1;
+  }
+
+  return sendCommand(socketFD, cmd, conf, fd);
+}
+
+/*!
+ * \brief Open socket to JVM with creating socket file if it is needed.
+ * \return Socket file descriptor, or -1 if failure.
+ */
+int TJVMSockCmd::connectJvmSock(void) {
   /* If don't open socket yet. */
   if (unlikely(!isConnectable())) {
     /* If failure open JVM socket. */
@@ -102,15 +171,22 @@ int TJVMSockCmd::execute(char const* cmd, const TJVMSockCmdArgs conf,
     return -1;
   }
 
+  return socketFD;
+}
+
+/*!
+ * \brief Send command to JVM, and write response to stream.
+ * \param socketFD [in] Socket to JVM. It is closed in this function.
+ * \param cmd      [in] Execute command string.
+ * \param conf     [in] Execute command arguments.
+ * \param fd       [in] Output file descriptor.
+ * \return Response code of execute commad line.<br>
+ *         Execute command is succeed, if value is 0.<br>
+ *         Value is error code, if failure execute command.
+ */
+int TJVMSockCmd::sendCommand(int socketFD, char const* cmd,
+                             const TJVMSockCmdArgs conf, int fd) {
   int returnCode = 0;
-  /* Create response file. */
-  int fd = open(filename, O_CREAT | O_WRONLY | O_EXCL, S_IRUSR | S_IWUSR);
-  if (unlikely(fd < 0)) {
-    returnCode = errno;
-    logger->printWarnMsgWithErrno("Could not create threaddump file");
-    close(socketFD);
-    return returnCode;
-  }
 
   /*
    * About JVM socket command
@@ -189,10 +265,6 @@ int TJVMSockCmd::execute(char const* cmd, const TJVMSockCmdArgs conf,
 
   /* Cleanup. */
   close(socketFD);
-  if (unlikely(close(fd) < 0 && returnCode == 0)) {
-    returnCode = errno;
-    logger->printWarnMsgWithErrno("Could not close socket to JVM");
-  }
 
   /* Check command execute result. */
   if (unlikely(waitCount > WAIT_LIMIT)) {
@@ -57,6 +57,17 @@ class TJVMSockCmd {
    */
   int exec(char const* cmd, char const* filename);
 
+  /*!
+   * \brief Execute command without params, and write response to stream.
+   * \param cmd [in] Execute command string.
+   * \param fd  [in] Output file descriptor.
+   * \return Response code of execute commad line.<br>
+   *         Execute command is succeed, if value is 0.<br>
+   *         Value is error code, if failure execute command.<br>
+   *         Even so the stream was written response data, if failure.
+   */
+  int exec(char const* cmd, int fd);
+
   /*!
    * \brief Get connectable socket to JVM.
    * \return Is connectable socket.
@@ -77,6 +88,18 @@ class TJVMSockCmd {
   virtual int execute(char const* cmd, const TJVMSockCmdArgs conf,
                       char const* filename);
 
+  /*!
+   * \brief Execute command, and write response to stream.
+   * \param cmd  [in] Execute command string.
+   * \param conf [in] Execute command arguments.
+   * \param fd   [in] Output file descriptor.
+   * \return Response code of execute commad line.<br>
+   *         Execute command is succeed, if value is 0.<br>
+   *         Value is error code, if failure execute command.<br>
+   *         Even so the stream was written response data, if failure.
+   */
+  virtual int execute(char const* cmd, const TJVMSockCmdArgs conf, int fd);
+
   /*!
    * \brief Create JVM socket file.
    * \return Process result.
@@ -107,6 +130,25 @@ class TJVMSockCmd {
   virtual bool createAttachFile(char* path, int pathLen);
 
  private:
+  /*!
+   * \brief Open socket to JVM with creating socket file if it is needed.
+   * \return Socket file descriptor, or -1 if failure.
+   */
+  int connectJvmSock(void);
+
+  /*!
+   * \brief Send command to JVM, and write response to stream.
+   * \param socketFD [in] Socket to JVM. It is closed in this function.
+   * \param cmd      [in] Execute command string.
+   * \param conf     [in] Execute command arguments.
+   * \param fd       [in] Output file descriptor.
+   * \return Response code of execute commad line.<br>
+   *         Execute command is succeed, if value is 0.<br>
+   *         Value is error code, if failure execute command.
+   */
+  int sendCommand(int socketFD, char const* cmd, const TJVMSockCmdArgs conf,
+                  int fd);
+
   /*!
    * \brief Socket file path.
    */
@@ -27,12 +27,16 @@
 #include <signal.h>
 
 #include "globals.hpp"
+#include "oopUtil.hpp"
 #include "elapsedTimer.hpp"
+#include "startupProfiler.hpp"
 #include "snapShotMain.hpp"
 #include "logMain.hpp"
 #include "deadlockFinder.hpp"
 #include "callbackRegister.hpp"
 #include "threadRecorder.hpp"
+#include "asyncWriter.hpp"
+#include "cmdHelper.hpp"
 #include "heapstatsMBean.hpp"
 #include "libmain.hpp"
 
@@ -73,6 +77,31 @@ int flagRunning = 0;
  */
 long TElapsedTimer::clock_ticks = sysconf(_SC_CLK_TCK);
 
+/*!
+ * \brief Time of agent loading.
+ */
+jlong TStartupProfiler::baseTime = 0;
+
+/*!
+ * \brief Recorded startup phases.
+ */
+TStartupPhase TStartupProfiler::phases[STARTUP_PROFILER_MAX_PHASES];
+
+/*!
+ * \brief Number of recorded startup phases.
+ */
+int TStartupProfiler::phaseCount = 0;
+
+/*!
+ * \brief Mutex of recorded startup phases.
+ */
+pthread_mutex_t TStartupProfiler::mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*!
+ * \brief Result of initialization which is processed by background thread.
+ */
+static jint backgroundInitResult = SUCCESS;
+
 /*!
  * \brief Path of load configuration file at agent initialization.
  */
@@ -252,10 +281,13 @@ void JNICALL OnVMInit(jvmtiEnv *jvmti, JNIEnv *env, jthread thread) {
 #endif
 
   /* Get all values from HotSpot VM */
-  if (!TVMVariables::getInstance()->getValuesAfterVMInit()) {
-    logger->printCritMsg(
-        "Cannot gather all values from HotSpot to work HeapStats");
-    return;
+  {
+    TStartupPhaseTimer phase("VM values after VMInit");
+    if (!TVMVariables::getInstance()->getValuesAfterVMInit()) {
+      logger->printCritMsg(
+          "Cannot gather all values from HotSpot to work HeapStats");
+      return;
+    }
   }
 
   if (!conf->validate()) {
@@ -297,12 +329,21 @@ void JNICALL OnVMInit(jvmtiEnv *jvmti, JNIEnv *env, jthread thread) {
   }
 
   /* Invoke JVM initialize event of snapshot function. */
-  onVMInitForSnapShot(jvmti, env);
+  {
+    TStartupPhaseTimer phase("Snapshot function (VMInit)");
+    onVMInitForSnapShot(jvmti, env);
+  }
+
   /* Invoke JVM initialize event of log function. */
-  onVMInitForLog(jvmti, env);
+  {
+    TStartupPhaseTimer phase("Log function (VMInit)");
+    onVMInitForLog(jvmti, env);
+  }
 
   /* If agent is attaching now. */
   if (likely(conf->Attach()->get())) {
+    TStartupPhaseTimer phase("Agent threads and events");
+
     /* Start and enable each agent threads. */
     SetThreadEnable(jvmti, env, true);
 
@@ -330,6 +371,11 @@ void JNICALL OnVMInit(jvmtiEnv *jvmti, JNIEnv *env, jthread thread) {
   conf->printSetting();
   logger->flush();
 
+  /* Symbols of libjvm are resolved until here. */
+  if (symFinder != NULL) {
+    symFinder->saveCache();
+  }
+
   /* Start reload signal watcher. */
   try {
     intervalSigTimer->start(jvmti, env, SIG_WATCHER_INTERVAL);
@@ -354,6 +400,10 @@ void JNICALL OnVMInit(jvmtiEnv *jvmti, JNIEnv *env, jthread thread) {
   if (jniFuncs != NULL) {
     jvmti->Deallocate((unsigned char *)jniFuncs);
   }
+
+  /* Show breakdown of startup time. */
+  TStartupProfiler::print(jvmInfo->getVmVersion());
+  logger->flush();
 }
 
 /*!
@@ -470,11 +520,50 @@ jint InitEventSetting(jvmtiEnv *jvmti, bool isOnLoad) {
     TResourceExhaustedCallback::registerCallback(&OnResourceExhausted);
   }
 
-  /* Setup MonitorContendedEnter event. */
+  /* Setup MonitorContendedEnter/Entered and MonitorWaited event. */
   if (conf->CheckDeadlock()->get()) {
     TMonitorContendedEnterCallback::mergeCapabilities(&capabilities);
     TMonitorContendedEnterCallback::registerCallback(
         &OnMonitorContendedEnterForDeadlock);
+    TMonitorContendedEnteredCallback::mergeCapabilities(&capabilities);
+    TMonitorContendedEnteredCallback::registerCallback(
+        &OnMonitorContendedEnteredForDeadlock);
+    TMonitorWaitedCallback::mergeCapabilities(&capabilities);
+    TMonitorWaitedCallback::registerCallback(&OnMonitorWaitedForDeadlock);
+  }
+
+  /* Setup MonitorContendedEnter/Entered event for monitor profiler. */
+  if (conf->MonitorProfile()->get()) {
+    TMonitorContendedEnterCallback::mergeCapabilities(&capabilities);
+    TMonitorContendedEnterCallback::registerCallback(
+        &OnMonitorContendedEnterForProfile);
+    TMonitorContendedEnteredCallback::mergeCapabilities(&capabilities);
+    TMonitorContendedEnteredCallback::registerCallback(
+        &OnMonitorContendedEnteredForProfile);
+  }
+
+  /* Setup ClassPrepare/ThreadStart/ThreadEnd event for CPU profiler. */
+  if (conf->CpuProfile()->get()) {
+    TClassPrepareCallback::registerCallback(&OnClassPrepareForCpuProfile);
+    TThreadStartCallback::mergeCapabilities(&capabilities);
+    TThreadStartCallback::registerCallback(&OnThreadStartForCpuProfile);
+    TThreadEndCallback::mergeCapabilities(&capabilities);
+    TThreadEndCallback::registerCallback(&OnThreadEndForCpuProfile);
+  }
+
+  /* Setup ThreadStart/ThreadEnd event for thread CPU profiler. */
+  if (conf->ThreadCpuProfile()->get()) {
+    TThreadStartCallback::mergeCapabilities(&capabilities);
+    TThreadStartCallback::registerCallback(&OnThreadStartForThreadCpu);
+    TThreadEndCallback::mergeCapabilities(&capabilities);
+    TThreadEndCallback::registerCallback(&OnThreadEndForThreadCpu);
+  }
+
+  /* Setup SampledObjectAlloc event for allocation profiler. */
+  if (conf->AllocProfile()->get()) {
+    if (!TAllocationProfiler::setCapabilities(jvmti, &capabilities)) {
+      conf->AllocProfile()->set(false);
+    }
   }
 
   /* Setup VMInit event. */
@@ -504,6 +593,26 @@ jint InitEventSetting(jvmtiEnv *jvmti, bool isOnLoad) {
   return SUCCESS;
 }
 
+/*!
+ * \brief Initialization which does not depend on libjvm.<br>
+ *        This function is processed by background thread concurrently with
+ *        scanning symbols and VMStructs. Result is stored to
+ *        backgroundInitResult.
+ * \param data [in] Unused.
+ * \return Always NULL.
+ */
+static void *BackgroundInitialization(void *data) {
+  if (conf->SnmpSend()->get()) {
+    TStartupPhaseTimer phase("SNMP trap sender (background)");
+    if (!TTrapSender::initialize(SNMP_VERSION_2c, conf->SnmpTarget()->get(),
+                                 conf->SnmpComName()->get(), 162)) {
+      backgroundInitResult = SNMP_SETUP_FAILED;
+    }
+  }
+
+  return NULL;
+}
+
 /*!
  * \brief Common initialization function.
  * \param vm    [in]  JavaVM object.
@@ -513,6 +622,8 @@ jint InitEventSetting(jvmtiEnv *jvmti, bool isOnLoad) {
  * \return Initialize process result.
  */
 jint CommonInitialization(JavaVM *vm, jvmtiEnv **jvmti, char *options) {
+  TStartupProfiler::begin();
+
   /* Initialize logger */
   logger = new TLogger();
 
@@ -535,18 +646,21 @@ jint CommonInitialization(JavaVM *vm, jvmtiEnv **jvmti, char *options) {
   }
 
   /* Initialize configuration */
-  conf = new TConfiguration(jvmInfo);
+  {
+    TStartupPhaseTimer phase("Configuration");
+    conf = new TConfiguration(jvmInfo);
 
-  /* Parse arguments. */
-  if (options == NULL || strlen(options) == 0) {
-    /* Make default configuration path. */
-    char confPath[PATH_MAX + 1] = {0};
-    snprintf(confPath, PATH_MAX, "%s/heapstats.conf", DEFAULT_CONF_DIR);
+    /* Parse arguments. */
+    if (options == NULL || strlen(options) == 0) {
+      /* Make default configuration path. */
+      char confPath[PATH_MAX + 1] = {0};
+      snprintf(confPath, PATH_MAX, "%s/heapstats.conf", DEFAULT_CONF_DIR);
 
-    conf->loadConfiguration(confPath);
-  } else {
-    conf->loadConfiguration(options);
-    loadConfigPath = strdup(options);
+      conf->loadConfiguration(confPath);
+    } else {
+      conf->loadConfiguration(options);
+      loadConfigPath = strdup(options);
+    }
   }
 
   logger->setLogLevel(conf->LogLevel()->get());
@@ -579,10 +693,22 @@ jint CommonInitialization(JavaVM *vm, jvmtiEnv **jvmti, char *options) {
 
   logger->flush();
 
-  if (conf->SnmpSend()->get() &&
-      !TTrapSender::initialize(SNMP_VERSION_2c, conf->SnmpTarget()->get(),
-                               conf->SnmpComName()->get(), 162)) {
-    return SNMP_SETUP_FAILED;
+  /*
+   * Spawn archive helper while JVM is still small.
+   * It must be forked before any agent thread is started, and before
+   * configuration is read by other threads.
+   */
+  if (conf->ArchiveHelper()->get()) {
+    TStartupPhaseTimer phase("Archive helper");
+    if (unlikely(!TCmdHelper::globalInitialize())) {
+      logger->printWarnMsg("Failed to initialize archive helper.");
+      conf->ArchiveHelper()->set(false);
+    }
+  }
+
+  /* Backend of output files is shared by snapshot and log function. */
+  if (unlikely(!TAsyncWriter::globalInitialize())) {
+    return AGENT_THREAD_INITIALIZE_FAILED;
   }
 
   /* Create thread instances that controlled snapshot trigger. */
@@ -596,10 +722,62 @@ jint CommonInitialization(JavaVM *vm, jvmtiEnv **jvmti, char *options) {
     return AGENT_THREAD_INITIALIZE_FAILED;
   }
 
+  /*
+   * SNMP trap sender only reads its own options, and does not depend on
+   * libjvm. So it is initialized concurrently with scanning symbols and
+   * VMStructs which dominates startup time.
+   * Signals are blocked in the thread as other agent threads.
+   */
+  pthread_t initThread;
+  sigset_t allSignals;
+  sigset_t oldMask;
+  sigfillset(&allSignals);
+  pthread_sigmask(SIG_BLOCK, &allSignals, &oldMask);
+  bool isThreadStarted = (pthread_create(&initThread, NULL,
+                                         &BackgroundInitialization,
+                                         NULL) == 0);
+  pthread_sigmask(SIG_SETMASK, &oldMask, NULL);
+
+  if (unlikely(!isThreadStarted)) {
+    logger->printWarnMsg(
+        "Could not start initialization thread. Initialize serially.");
+    BackgroundInitialization(NULL);
+  }
+
+  /* Initialize oop util. */
+  jint result = SUCCESS;
+  {
+    TStartupPhaseTimer phase("Symbols and VMStructs");
+    if (unlikely(!oopUtilInitialize(*jvmti))) {
+      logger->printCritMsg(
+          "Please check installation and version of java and debuginfo "
+          "packages.");
+      result = GET_LOW_LEVEL_INFO_FAILED;
+    }
+  }
+
+  /*
+   * Snapshot function sends traps from TClassContainer, so it has to wait
+   * for SNMP. JVMTI callbacks and GC hooks are set after this function
+   * returns, so they are never armed until all initialization is finished.
+   */
+  if (likely(isThreadStarted)) {
+    TStartupPhaseTimer phase("Waiting for background init");
+    pthread_join(initThread, NULL);
+  }
+
+  if (result == SUCCESS) {
+    result = backgroundInitResult;
+  }
+
   /* Invoke agent initialize of each function. */
-  jint result;
-  result = onAgentInitForSnapShot(*jvmti);
   if (result == SUCCESS) {
+    TStartupPhaseTimer phase("Snapshot function");
+    result = onAgentInitForSnapShot(*jvmti);
+  }
+
+  if (result == SUCCESS) {
+    TStartupPhaseTimer phase("Log function");
     result = onAgentInitForLog();
   }
 
@@ -643,6 +821,12 @@ JNIEXPORT void JNICALL Agent_OnUnload(JavaVM *vm) {
   /* Invoke agent finalize of log function. */
   onAgentFinalForLog(env);
 
+  /* Wait for in-flight output. */
+  TAsyncWriter::globalFinalize();
+
+  /* Terminate archive helper process. */
+  TCmdHelper::globalFinalize();
+
   /* Destroy object is JVM running informations. */
   delete jvmInfo;
   jvmInfo = NULL;
@@ -0,0 +1,208 @@
+/*!
+ * \file liveCounter.cpp
+ * \brief This file is used to publish live counters to shared memory.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "globals.hpp"
+#include "util.hpp"
+#include "fsUtil.hpp"
+#include "liveCounter.hpp"
+
+/*!
+ * \brief Singleton instance.
+ */
+TLiveCounter *TLiveCounter::inst = NULL;
+
+/*!
+ * \brief TLiveCounter constructor.
+ * \param path [in] Path of live counter file.
+ */
+TLiveCounter::TLiveCounter(const char *path) {
+  this->path = strdup(path);
+  if (unlikely(this->path == NULL)) {
+    throw errno;
+  }
+
+  /* Stale file of previous process which had the same pid is replaced. */
+  unlink(path);
+  int fd = open(path, O_RDWR | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC,
+                S_IRUSR | S_IWUSR);
+  if (unlikely(fd < 0)) {
+    int raisedErrNum = errno;
+    free(this->path);
+    throw raisedErrNum;
+  }
+
+  if (unlikely(ftruncate(fd, sizeof(TLiveCounterHeader)) != 0)) {
+    int raisedErrNum = errno;
+    close(fd);
+    unlink(path);
+    free(this->path);
+    throw raisedErrNum;
+  }
+
+  void *addr = mmap(NULL, sizeof(TLiveCounterHeader), PROT_READ | PROT_WRITE,
+                    MAP_SHARED, fd, 0);
+  int raisedErrNum = errno;
+  close(fd);
+  if (unlikely(addr == MAP_FAILED)) {
+    unlink(path);
+    free(this->path);
+    throw raisedErrNum;
+  }
+
+  /* New file is filled with zero. */
+  header = (TLiveCounterHeader *)addr;
+  header->version = LIVE_COUNTER_VERSION;
+  header->byteOrderMark = LIVE_COUNTER_BYTE_ORDER_MARK;
+  header->pid = getpid();
+
+  /* Magic number is written at last to show the file is ready. */
+  publish_barrier();
+  memcpy(header->magic, LIVE_COUNTER_MAGIC, sizeof(header->magic));
+}
+
+/*!
+ * \brief TLiveCounter destructor.<br>
+ *        Live counter file is removed.
+ */
+TLiveCounter::~TLiveCounter(void) {
+  munmap(header, sizeof(TLiveCounterHeader));
+  unlink(path);
+  free(path);
+}
+
+/*!
+ * \brief Publish summary of snapshot.
+ * \param hdr         [in] Header of merged snapshot.
+ * \param ranking     [in] Heap ranking of snapshot. It can be NULL.
+ * \param elapsedTime [in] Time to process snapshot (usec).
+ * \param cpuTime     [in] CPU time to process snapshot (usec).
+ * \warning This function is not thread-safe.
+ */
+void TLiveCounter::publish(const TSnapShotFileHeader *hdr,
+                           TSorter<THeapDelta> *ranking, jlong elapsedTime,
+                           jlong cpuTime) {
+  /* Begin update. Readers retry while sequence is odd. */
+  header->sequence++;
+  publish_barrier();
+
+  header->updateTime = getNowTimeSec();
+  header->snapShotTime = hdr->snapShotTime;
+  header->cause = hdr->cause;
+
+  size_t gcCauseLen = (hdr->gcCauseLen < LIVE_COUNTER_GC_CAUSE_LEN)
+                          ? hdr->gcCauseLen
+                          : LIVE_COUNTER_GC_CAUSE_LEN - 1;
+  memcpy(header->gcCause, hdr->gcCause, gcCauseLen);
+  header->gcCause[gcCauseLen] = '\0';
+
+  header->FGCCount = hdr->FGCCount;
+  header->YGCCount = hdr->YGCCount;
+  header->gcWorktime = hdr->gcWorktime;
+  header->newAreaSize = hdr->newAreaSize;
+  header->oldAreaSize = hdr->oldAreaSize;
+  header->totalHeapSize = hdr->totalHeapSize;
+  header->metaspaceUsage = hdr->metaspaceUsage;
+  header->metaspaceCapacity = hdr->metaspaceCapacity;
+  header->safepointTime = jvmInfo->getSafepointTime();
+
+  header->snapShotCount++;
+  header->processTime += elapsedTime;
+  header->processCpuTime += cpuTime;
+  header->lastProcessTime = elapsedTime;
+
+  /* Ranking is stored in descending order as well as log. */
+  int rankCount = 0;
+  if (ranking != NULL) {
+    for (Node<THeapDelta> *aNode = ranking->lastNode();
+         (aNode != NULL) && (rankCount < LIVE_COUNTER_MAX_RANKS) &&
+         (rankCount < ranking->getCount());
+         aNode = aNode->prev, rankCount++) {
+      TLiveCounterClass *entry = &header->ranking[rankCount];
+      entry->usage = aNode->value.usage;
+      entry->delta = aNode->value.delta;
+      strncpy(entry->className, ((TObjectData *)aNode->value.tag)->className,
+              LIVE_COUNTER_CLASS_NAME_LEN - 1);
+      entry->className[LIVE_COUNTER_CLASS_NAME_LEN - 1] = '\0';
+    }
+  }
+  header->rankCount = rankCount;
+
+  /* End update. */
+  publish_barrier();
+  header->sequence++;
+}
+
+/*!
+ * \brief Global initialization.<br>
+ *        Default path is "/tmp/heapstats_<uid>/<pid>" like hsperfdata.
+ * \param path [in] Path of live counter file, or NULL to use default.
+ * \return Process result.
+ * \warning Please call only once from main thread.
+ */
+bool TLiveCounter::globalInitialize(const char *path) {
+  char defaultPath[PATH_MAX];
+
+  if ((path == NULL) || (path[0] == '\0')) {
+    char dir[PATH_MAX];
+    int result = getRuntimeDirectory(dir, PATH_MAX);
+    if (unlikely(result != 0)) {
+      errno = result;
+      logger->printWarnMsgWithErrno("%s is not usable for live counter.", dir);
+      return false;
+    }
+
+    snprintf(defaultPath, PATH_MAX, "%s/%d", dir, getpid());
+    path = defaultPath;
+  }
+
+  try {
+    inst = new TLiveCounter(path);
+  } catch (int errNum) {
+    errno = errNum;
+    logger->printWarnMsgWithErrno("Could not create live counter file: %s",
+                                  path);
+    return false;
+  } catch (...) {
+    logger->printWarnMsg("Cannot initialize TLiveCounter.");
+    return false;
+  }
+
+  logger->printInfoMsg("Live counter is published to %s", inst->getPath());
+  return true;
+}
+
+/*!
+ * \brief Global finalization.
+ */
+void TLiveCounter::globalFinalize(void) {
+  delete inst;
+  inst = NULL;
+}
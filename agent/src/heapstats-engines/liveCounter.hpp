@@ -0,0 +1,102 @@
+/*!
+ * \file liveCounter.hpp
+ * \brief This file is used to publish live counters to shared memory.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#ifndef LIVE_COUNTER_HPP
+#define LIVE_COUNTER_HPP
+
+#include <jni.h>
+
+#include "classContainer.hpp"
+#include "liveCounterFormat.hpp"
+
+/*!
+ * \brief This class publishes the latest snapshot summary and overhead of
+ *        agent to memory-mapped file like hsperfdata.<br>
+ *        Monitoring tools can poll it without attaching to JVM.
+ */
+class TLiveCounter {
+ public:
+  /*!
+   * \brief TLiveCounter constructor.
+   * \param path [in] Path of live counter file.
+   */
+  TLiveCounter(const char *path);
+
+  /*!
+   * \brief TLiveCounter destructor.<br>
+   *        Live counter file is removed.
+   */
+  virtual ~TLiveCounter(void);
+
+  /*!
+   * \brief Publish summary of snapshot.
+   * \param hdr         [in] Header of merged snapshot.
+   * \param ranking     [in] Heap ranking of snapshot. It can be NULL.
+   * \param elapsedTime [in] Time to process snapshot (usec).
+   * \param cpuTime     [in] CPU time to process snapshot (usec).
+   * \warning This function is not thread-safe.
+   */
+  void publish(const TSnapShotFileHeader *hdr, TSorter<THeapDelta> *ranking,
+               jlong elapsedTime, jlong cpuTime);
+
+  /*!
+   * \brief Get path of live counter file.
+   * \return Path of live counter file.
+   */
+  inline const char *getPath(void) { return path; };
+
+  /*!
+   * \brief Global initialization.
+   * \param path [in] Path of live counter file, or NULL to use default.
+   * \return Process result.
+   * \warning Please call only once from main thread.
+   */
+  static bool globalInitialize(const char *path);
+
+  /*!
+   * \brief Global finalization.
+   */
+  static void globalFinalize(void);
+
+  /*!
+   * \brief Get singleton instance.
+   * \return Instance of TLiveCounter, or NULL if it is disabled.
+   */
+  inline static TLiveCounter *getInstance() { return inst; };
+
+ private:
+  /*!
+   * \brief Singleton instance.
+   */
+  static TLiveCounter *inst;
+
+  /*!
+   * \brief Path of live counter file.
+   */
+  char *path;
+
+  /*!
+   * \brief Mapped live counter file.
+   */
+  TLiveCounterHeader *header;
+};
+
+#endif  // LIVE_COUNTER_HPP
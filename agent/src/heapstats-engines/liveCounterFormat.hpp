@@ -0,0 +1,109 @@
+/*!
+ * \file liveCounterFormat.hpp
+ * \brief This file defines layout of live counter file.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#ifndef LIVE_COUNTER_FORMAT_HPP
+#define LIVE_COUNTER_FORMAT_HPP
+
+#include <jni.h>
+
+/*!
+ * \brief Magic number of live counter file.
+ */
+#define LIVE_COUNTER_MAGIC "HSLIVECN"
+
+/*!
+ * \brief Format version of live counter file.
+ */
+#define LIVE_COUNTER_VERSION 1
+
+/*!
+ * \brief Value to detect byte order of live counter file.
+ */
+#define LIVE_COUNTER_BYTE_ORDER_MARK 0x01020304
+
+/*!
+ * \brief Max number of classes in ranking.
+ */
+#define LIVE_COUNTER_MAX_RANKS 64
+
+/*!
+ * \brief Max length of class name including NULL.<br>
+ *        Longer name is truncated.
+ */
+#define LIVE_COUNTER_CLASS_NAME_LEN 256
+
+/*!
+ * \brief Max length of GC cause including NULL.
+ */
+#define LIVE_COUNTER_GC_CAUSE_LEN 80
+
+/*!
+ * \brief Class in heap ranking.
+ */
+typedef struct {
+  jlong usage;  /*!< Heap usage of the class (bytes).                */
+  jlong delta;  /*!< Increment from the previous snapshot (bytes).   */
+  char className[LIVE_COUNTER_CLASS_NAME_LEN]; /*!< Class name.      */
+} TLiveCounterClass;
+
+/*!
+ * \brief Layout of live counter file.<br>
+ *        Values are protected by seqlock. The writer makes "sequence" odd
+ *        while it updates values, and makes it even after that.
+ *        Readers should copy values between two reads of the same even
+ *        "sequence", otherwise they should retry.
+ */
+typedef struct {
+  char magic[8];        /*!< LIVE_COUNTER_MAGIC without NULL.           */
+  jint version;         /*!< LIVE_COUNTER_VERSION.                      */
+  jint byteOrderMark;   /*!< LIVE_COUNTER_BYTE_ORDER_MARK in writer's
+                             byte order.                                */
+  jint pid;             /*!< Process ID of JVM.                         */
+  volatile jint sequence; /*!< Sequence number of seqlock.              */
+  jlong updateTime;     /*!< Time of the last update (msec).            */
+
+  /* Values of the latest snapshot. */
+  jlong snapShotTime;      /*!< Datetime of take snapshot (msec).       */
+  jint cause;              /*!< Cause of snapshot.                      */
+  jint rankCount;          /*!< Number of valid entries in ranking.     */
+  char gcCause[LIVE_COUNTER_GC_CAUSE_LEN]; /*!< GC cause.               */
+  jlong FGCCount;          /*!< Full-GC count.                          */
+  jlong YGCCount;          /*!< Young-GC count.                         */
+  jlong gcWorktime;        /*!< GC worktime.                            */
+  jlong newAreaSize;       /*!< New area using size.                    */
+  jlong oldAreaSize;       /*!< Old area using size.                    */
+  jlong totalHeapSize;     /*!< Total heap size.                        */
+  jlong metaspaceUsage;    /*!< Usage of PermGen or Metaspace.          */
+  jlong metaspaceCapacity; /*!< Max capacity of PermGen or Metaspace.   */
+  jlong safepointTime;     /*!< Safepoint time (msec).                  */
+
+  /* Overhead of HeapStats agent. */
+  jlong snapShotCount;     /*!< Number of processed snapshots.          */
+  jlong processTime;       /*!< Total time to process snapshots (usec). */
+  jlong processCpuTime;    /*!< Total CPU time to process snapshots
+                                (usec).                                 */
+  jlong lastProcessTime;   /*!< Time to process the latest snapshot
+                                (usec).                                 */
+
+  TLiveCounterClass ranking[LIVE_COUNTER_MAX_RANKS]; /*!< Heap ranking. */
+} TLiveCounterHeader;
+
+#endif  // LIVE_COUNTER_FORMAT_HPP
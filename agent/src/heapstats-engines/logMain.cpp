@@ -23,6 +23,7 @@
 
 #include "globals.hpp"
 #include "elapsedTimer.hpp"
+#include "memMapSummary.hpp"
 #include "util.hpp"
 #include "libmain.hpp"
 #include "callbackRegister.hpp"
@@ -102,6 +103,41 @@ void intervalLogProc(jvmtiEnv *jvmti, JNIEnv *env, TInvokeCause cause) {
                             (TMSecTime)getNowTimeSec(), ""))) {
     logger->printWarnMsg("Failure interval collect log.");
   }
+
+  /* Output contended monitors in this interval. */
+  if (conf->MonitorProfile()->get()) {
+    TMonitorProfiler::getInstance()->showRanking(
+        jvmti, env, conf->MonitorProfileRank()->get());
+  }
+
+  /* Output sampled CPU stacks. */
+  if (conf->CpuProfile()->get()) {
+    TCpuProfiler::getInstance()->dump(jvmti, env,
+                                      conf->CpuProfileFileName()->get());
+  }
+
+  /* Output threads which consumed CPU in this interval. */
+  if (conf->ThreadCpuProfile()->get()) {
+    TThreadCpuSampler::getInstance()->showRanking(
+        conf->ThreadCpuProfileRank()->get());
+  }
+
+  /* Output summary of perf counters in this interval. */
+  if (conf->PerfSampler()->get()) {
+    TPerfCounterSampler::getInstance()->printSummary();
+  }
+
+  /* Output summary of memory map. */
+  if (conf->MemMapSample()->get()) {
+    try {
+      TMemMapSummary summary;
+      if (likely(summary.collect() == 0)) {
+        summary.print();
+      }
+    } catch (...) {
+      logger->printWarnMsg("Could not summarize memory map.");
+    }
+  }
 }
 
 /*!
@@ -287,8 +323,26 @@ jint setEventEnableForLog(jvmtiEnv *jvmti, bool enable) {
 
   /* If collect log when occurred deadlock. */
   if (conf->CheckDeadlock()->get()) {
-    /* Enable monitor contended event. */
+    /* Enable monitor contended and waited event. */
+    TMonitorContendedEnterCallback::switchEventNotification(jvmti, mode);
+    TMonitorContendedEnteredCallback::switchEventNotification(jvmti, mode);
+    TMonitorWaitedCallback::switchEventNotification(jvmti, mode);
+    TDeadlockFinder::getInstance()->resetWaitForGraph(jvmti, enable);
+  }
+
+  /* If profile contended monitors. */
+  if (conf->MonitorProfile()->get()) {
     TMonitorContendedEnterCallback::switchEventNotification(jvmti, mode);
+    TMonitorContendedEnteredCallback::switchEventNotification(jvmti, mode);
+  }
+
+  /* If sample CPU stacks or rank threads by CPU time. */
+  if (conf->CpuProfile()->get() || conf->ThreadCpuProfile()->get()) {
+    /* Thread recorder switches these events by itself. */
+    if (enable || !conf->ThreadRecordEnable()->get()) {
+      TThreadStartCallback::switchEventNotification(jvmti, mode);
+      TThreadEndCallback::switchEventNotification(jvmti, mode);
+    }
   }
 
   return SUCCESS;
@@ -324,8 +378,31 @@ void setThreadEnableForLog(jvmtiEnv *jvmti, JNIEnv *env, bool enable) {
         TDeadlockFinder::getInstance()->stop();
       }
     }
+
+    if (conf->CpuProfile()->get()) {
+      /* Switch CPU profiler state. */
+      if (enable) {
+        TCpuProfiler::getInstance()->start(jvmti, env);
+      } else {
+        TCpuProfiler::getInstance()->stop();
+      }
+    }
+  } catch (const char *errMsg) {
+    logger->printWarnMsg(errMsg);
+  }
+
+  /* Switch perf counter sampler state. */
+  try {
+    if (conf->PerfSampler()->get()) {
+      if (enable) {
+        TPerfCounterSampler::getInstance()->start(jvmti, env);
+      } else {
+        TPerfCounterSampler::getInstance()->stop();
+      }
+    }
   } catch (const char *errMsg) {
     logger->printWarnMsg(errMsg);
+    conf->PerfSampler()->set(false);
   }
 }
 
@@ -357,6 +434,14 @@ void onVMInitForLog(jvmtiEnv *jvmti, JNIEnv *env) {
     conf->LogInterval()->set(0);
   }
 
+  /* Prepare CPU profiler. */
+  if (conf->CpuProfile()->get()) {
+    if (unlikely(!TCpuProfiler::getInstance()->onVMInit(jvmti, env))) {
+      logger->printWarnMsg("CPU profiler is disabled.");
+      conf->CpuProfile()->set(false);
+    }
+  }
+
   /* Initialize signal flag. */
   flagLogSignal = 0;
   flagAllLogSignal = 0;
@@ -426,6 +511,39 @@ jint onAgentInitForLog(void) {
       }
     }
 
+    if (conf->MonitorProfile()->get()) {
+      if (unlikely(!TMonitorProfiler::globalInitialize(
+                       conf->MonitorProfileStackDepth()->get()))) {
+        logger->printWarnMsg("Failed to initialize monitor profiler.");
+        conf->MonitorProfile()->set(false);
+      }
+    }
+
+    if (conf->CpuProfile()->get()) {
+      if (unlikely(!TCpuProfiler::globalInitialize(
+                       conf->CpuProfileFrequency()->get()))) {
+        logger->printWarnMsg("Failed to initialize CPU profiler.");
+        conf->CpuProfile()->set(false);
+      }
+    }
+
+    if (conf->ThreadCpuProfile()->get()) {
+      if (unlikely(!TThreadCpuSampler::globalInitialize())) {
+        logger->printWarnMsg("Failed to initialize thread CPU profiler.");
+        conf->ThreadCpuProfile()->set(false);
+      }
+    }
+
+    if (conf->PerfSampler()->get()) {
+      if (unlikely(!TPerfCounterSampler::globalInitialize(
+                       conf->PerfSamplerInterval()->get(),
+                       conf->PerfSamplerRecords()->get(),
+                       conf->PerfSamplerCounters()->get()))) {
+        logger->printWarnMsg("Failed to initialize perf counter sampler.");
+        conf->PerfSampler()->set(false);
+      }
+    }
+
     logTimer = new TTimer(&intervalLogProc, "HeapStats Log Timer");
   } catch (const char *errMsg) {
     logger->printCritMsg(errMsg);
@@ -458,6 +576,30 @@ void onAgentFinalForLog(JNIEnv *env) {
     TDeadlockFinder::globalFinalize();
   }
 
+  /* Destroy monitor profiler object. */
+  if (conf->MonitorProfile()->get()) {
+    TMonitorProfiler::globalFinalize();
+  }
+
+  /*
+   * Destroy CPU profiler object.
+   * cpu_profile might be turned off at VMInit after initialization.
+   */
+  TCpuProfiler::globalFinalize();
+
+  /*
+   * Destroy thread CPU profiler object.
+   * thread_cpu_profile might be turned off by reloading after
+   * initialization.
+   */
+  TThreadCpuSampler::globalFinalize();
+
+  /*
+   * Destroy perf counter sampler object.
+   * perf_sampler might be turned off at start after initialization.
+   */
+  TPerfCounterSampler::globalFinalize();
+
   /* Destroy log manager. */
   delete logManager;
   logManager = NULL;
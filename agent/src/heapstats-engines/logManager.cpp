@@ -22,7 +22,9 @@
 #include <gnu/libc-version.h>
 #include <dirent.h>
 #include <pthread.h>
+#include <signal.h>
 #include <fcntl.h>
+#include <sys/syscall.h>
 #include <sys/utsname.h>
 #include <sys/wait.h>
 
@@ -30,6 +32,9 @@
 
 #include "globals.hpp"
 #include "fsUtil.hpp"
+#include "resourceLog.hpp"
+#include "elapsedTimer.hpp"
+#include "memMapSummary.hpp"
 #include "logManager.hpp"
 
 /* Static variables. */
@@ -45,6 +50,12 @@ pthread_mutex_t TLogManager::logMutex = PTHREAD_ADAPTIVE_MUTEX_INITIALIZER_NP;
 pthread_mutex_t TLogManager::archiveMutex =
     PTHREAD_ADAPTIVE_MUTEX_INITIALIZER_NP;
 
+/*!
+ * \brief Mutex of JVMTI thread dump and method information cache.
+ */
+pthread_mutex_t TLogManager::threadDumpMutex =
+    PTHREAD_ADAPTIVE_MUTEX_INITIALIZER_NP;
+
 /* Macro defines. */
 
 /*!
@@ -57,11 +68,155 @@ pthread_mutex_t TLogManager::archiveMutex =
  */
 #define ENVIRON_VALUE_SEPARATOR "="
 
+/*!
+ * \brief Name of systemd-journald log which shows command to output it.
+ */
+#define JOURNAL_LOG_NAME \
+  "journalctl_-q_--all_--this-boot_--no-pager_-o_verbose.log"
+
+/* Collected files. */
+
+/*!
+ * \brief Distribution release files. The first existing file is collected.
+ */
+static const char distFileList[][255] = {/* Distribution release. */
+                                         "/etc/redhat-release",
+                                         /* For other distribution. */
+                                         "/etc/sun-release",
+                                         "/etc/mandrake-release",
+                                         "/etc/SuSE-release",
+                                         "/etc/turbolinux-release",
+                                         "/etc/gentoo-release",
+                                         "/etc/debian_version",
+                                         "/etc/ltib-release",
+                                         "/etc/angstrom-version",
+                                         "/etc/fedora-release",
+                                         "/etc/vine-release",
+                                         "/etc/issue",
+                                         /* End flag. */
+                                         {0}};
+
+/*!
+ * \brief Process and network information files.
+ */
+static const char copyFileList[][255] = {/* Process information. */
+                                         "/proc/self/limits",
+                                         "/proc/self/cmdline",
+                                         "/proc/self/status",
+                                         /* Netstat infomation. */
+                                         "/proc/net/tcp",
+                                         "/proc/net/tcp6",
+                                         "/proc/net/udp",
+                                         "/proc/net/udp6",
+                                         /* End flag. */
+                                         {0}};
+
+/*!
+ * \brief Memory map file. It is collected when memmap_summary is false.
+ */
+#define SMAPS_FILE "/proc/self/smaps"
+
+/*!
+ * \brief File name of summary of memory map in log archive.
+ */
+#define MEMMAP_SUMMARY_NAME "smaps_summary.txt"
+
+/*!
+ * \brief Number of standard streams which are collected.
+ */
+#define STREAM_FILE_NUM 2
+
+/*!
+ * \brief Standard streams.
+ */
+static const char streamList[STREAM_FILE_NUM][255] = {"/proc/self/fd/1",
+                                                      "/proc/self/fd/2"};
+
+/*!
+ * \brief File names of standard streams in log archive.
+ */
+static const char fdFile[STREAM_FILE_NUM][10] = {"fd1", "fd2"};
+
+/*!
+ * \brief Create anonymous file to stage generated log before archiving.<br>
+ *        memfd is used if it is available. Otherwise unlinked file in
+ *        logdir is used.
+ * \return File descriptor, or -1 if failure.
+ */
+static int createStagingFd(void) {
+  int fd = -1;
+
+#ifdef SYS_memfd_create
+  /* 1 is MFD_CLOEXEC. */
+  fd = (int)syscall(SYS_memfd_create, "heapstats-log", 1);
+  if (likely(fd >= 0)) {
+    return fd;
+  }
+#endif
+
+  char *path = createFilename(conf->LogDir()->get(), "heapstats-log-XXXXXX");
+  if (unlikely(path == NULL)) {
+    return -1;
+  }
+
+  fd = mkstemp(path);
+  if (likely(fd >= 0)) {
+    unlink(path);
+  }
+
+  free(path);
+  return fd;
+}
+
+/*!
+ * \brief Discard data in staging file.
+ * \param fd [in] File descriptor of staging file.
+ * \return Value is zero, if process is succeed.<br />
+ *         Value is error number a.k.a. "errno", if process is failure.
+ */
+static int resetStagingFd(int fd) {
+  if (unlikely((ftruncate(fd, 0) != 0) || (lseek(fd, 0, SEEK_SET) != 0))) {
+    return errno;
+  }
+
+  return 0;
+}
+
+/*!
+ * \brief Add data in staging file to log archive.
+ * \param writer    [in] Log archive.
+ * \param fd        [in] File descriptor of staging file.
+ * \param entryName [in] Entry name in log archive.
+ * \param mtime     [in] Modification time of entry.
+ * \return Value is zero, if process is succeed.<br />
+ *         Value is error number a.k.a. "errno", if process is failure.
+ */
+static int addStagedFile(TZipStreamWriter *writer, int fd,
+                         const char *entryName, time_t mtime) {
+  if (unlikely(lseek(fd, 0, SEEK_SET) != 0)) {
+    return errno;
+  }
+
+  return writer->addFromFd(fd, entryName, mtime);
+}
+
 /*!
  * \brief Symbol string mcaro of GC log filename.
  */
 #define GCLOG_FILENAME_SYMBOL "_ZN9Arguments16_gc_log_filenameE"
 
+/*!
+ * \brief Size of buffer to read process status file.<br>
+ *        "/proc/self/stat" has 52 numeric fields at most.
+ */
+#define PROC_STAT_BUFFER_SIZE 1024
+
+/*!
+ * \brief Size of buffer to read machine status file.<br>
+ *        Only the first line ("cpu ...") of "/proc/stat" is needed.
+ */
+#define SYS_STAT_BUFFER_SIZE 512
+
 /* Util method for log manager. */
 
 /*!
@@ -98,6 +253,76 @@ inline int logCauseToInt(TInvokeCause cause) {
   return logCause;
 }
 
+/*!
+ * \brief Read /proc file from its head into fixed buffer.
+ * \param fd  [in]  File descriptor of /proc file.
+ * \param buf [out] Buffer to store content. It is terminated by NULL.
+ * \param len [in]  Length of buf.
+ * \return Value is true, if process is succeed.
+ */
+inline bool readProcFile(int fd, char *buf, size_t len) {
+  /* pread(2) at offset 0 makes kernel regenerate the content. */
+  ssize_t readLen = pread(fd, buf, len - 1, 0);
+  if (unlikely(readLen <= 0)) {
+    return false;
+  }
+
+  buf[readLen] = '\0';
+  return true;
+}
+
+/*!
+ * \brief Skip fields which are separated by space.
+ * \param str [in] Head of the field.
+ * \param num [in] Number of fields to skip.
+ * \return Head of the next field.<br>
+ *         Value is null, if line has shortage.
+ */
+inline const char *skipProcFields(const char *str, int num) {
+  for (int cnt = 0; cnt < num; cnt++) {
+    while ((*str != ' ') && (*str != '\n') && (*str != '\0')) {
+      str++;
+    }
+
+    if (unlikely(*str != ' ')) {
+      return NULL;
+    }
+
+    while (*str == ' ') {
+      str++;
+    }
+  }
+
+  return str;
+}
+
+/*!
+ * \brief Parse unsigned decimal field and move to the next field.
+ * \param str   [in,out] Head of the field.
+ * \param value [out]    Parsed value.
+ * \return Value is true, if field is decimal.
+ */
+inline bool parseProcValue(const char **str, TLargeUInt *value) {
+  const char *pos = *str;
+  if (unlikely((pos == NULL) || (*pos < '0') || (*pos > '9'))) {
+    return false;
+  }
+
+  TLargeUInt result = 0;
+  while ((*pos >= '0') && (*pos <= '9')) {
+    result = result * 10 + (*pos - '0');
+    pos++;
+  }
+
+  while (*pos == ' ') {
+    pos++;
+  }
+
+  *value = result;
+  *str = pos;
+  return true;
+}
+
 /* Class method. */
 
 /*!
@@ -114,6 +339,13 @@ TLogManager::TLogManager(JNIEnv *env, TJvmInfo *info) {
   jvmCmd = NULL;
   arcMaker = NULL;
   jniArchiver = NULL;
+  procStatFd = -1;
+  sysStatFd = -1;
+  heapLogFd = -1;
+  heapLogWriter = NULL;
+  heapLogPath = NULL;
+  resourceLog = NULL;
+  methodInfoCache = NULL;
 
   char *tempdirPath = NULL;
   /* Get temporary path of java */
@@ -128,6 +360,9 @@ TLogManager::TLogManager(JNIEnv *env, TJvmInfo *info) {
     /* Archive file maker to use zip library in java. */
     jniArchiver = new TJniZipArchiver();
 
+    /* Cache of method information for thread dump. */
+    methodInfoCache = new TMethodInfoCache();
+
     /* Get GC log filename pointer. */
     gcLogFilename = (char **)symFinder->findSymbol(GCLOG_FILENAME_SYMBOL);
     if (unlikely(gcLogFilename == NULL)) {
@@ -138,10 +373,18 @@ TLogManager::TLogManager(JNIEnv *env, TJvmInfo *info) {
     delete jvmCmd;
     delete arcMaker;
     delete jniArchiver;
+    delete methodInfoCache;
 
     throw "TLogManager initialize failed!";
   }
   free(tempdirPath);
+
+  /*
+   * Status files are kept opening to re-read them at each interval.
+   * They will be opened at collecting log if we fail to open them here.
+   */
+  openProcFile(&procStatFd, "/proc/self/stat");
+  openProcFile(&sysStatFd, "/proc/stat");
 }
 
 /*!
@@ -152,6 +395,18 @@ TLogManager::~TLogManager(void) {
   delete jvmCmd;
   delete arcMaker;
   delete jniArchiver;
+  delete methodInfoCache;
+
+  /* Close persistent file descriptors. */
+  if (procStatFd >= 0) {
+    close(procStatFd);
+  }
+  if (sysStatFd >= 0) {
+    close(sysStatFd);
+  }
+  closeHeapLog();
+  free(heapLogPath);
+  delete resourceLog;
 }
 
 /*!
@@ -228,6 +483,46 @@ int TLogManager::collectNormalLog(TInvokeCause cause, TMSecTime nowTime,
     logger->printWarnMsg("Failure getting machine cpu times.");
   }
 
+  /* Record of binary resource log. It is also rendered as metrics. */
+  jlong record[RESOURCE_LOG_COLUMNS] = {
+      /* Logging information. */
+      (jlong)nowTime, logCauseToInt(cause),
+      /* Java process information. */
+      (jlong)usrtime, (jlong)systime, (jlong)vmsize, (jlong)rssize,
+      /* Machine CPU times. Order is same as CSV. */
+      (jlong)cpuTimes.usrTime, (jlong)cpuTimes.lowUsrTime,
+      (jlong)cpuTimes.sysTime, (jlong)cpuTimes.idleTime,
+      (jlong)cpuTimes.iowaitTime, (jlong)cpuTimes.irqTime,
+      (jlong)cpuTimes.sortIrqTime, (jlong)cpuTimes.stealTime,
+      (jlong)cpuTimes.guestTime,
+      /* JVM running information. */
+      jvmInfo->getSyncPark(), jvmInfo->getSafepointTime(),
+      jvmInfo->getSafepoints(), jvmInfo->getThreadLive()};
+
+  if (conf->MetricsServer()->get()) {
+    TMetricsServer::getInstance()->updateResource(record);
+  }
+
+  /* Append fixed-width record to binary resource log. */
+  if (conf->HeapLogBinary()->get()) {
+    /* Get mutex. */
+    ENTER_PTHREAD_SECTION(&logMutex) {
+      TResourceLog *resLog = getResourceLog();
+
+      /* If failure open file. */
+      if (unlikely(resLog == NULL)) {
+        result = errno;
+        logger->printWarnMsgWithErrno("Could not open log file");
+      } else {
+        resLog->append(record);
+        result = 0;
+      }
+    }
+    /* Release mutex. */
+    EXIT_PTHREAD_SECTION(&logMutex)
+    return result;
+  }
+
   /* Make write log line. */
   char logData[4097] = {0};
   snprintf(logData, 4096,
@@ -258,27 +553,29 @@ int TLogManager::collectNormalLog(TInvokeCause cause, TMSecTime nowTime,
   /* Get mutex. */
   ENTER_PTHREAD_SECTION(&logMutex) {
 
-    /* Open log file. */
-    int fd = open(conf->HeapLogFile()->get(), O_CREAT | O_WRONLY | O_APPEND,
-                  S_IRUSR | S_IWUSR);
+    /* Get opened log file. */
+    TAsyncFile *writer = getHeapLogWriter();
 
     /* If failure open file. */
-    if (unlikely(fd < 0)) {
+    if (unlikely(writer == NULL)) {
       result = errno;
       logger->printWarnMsgWithErrno("Could not open log file");
     } else {
-      result = 0;
+      /*
+       * Write line to log file without waiting for disk.
+       * Error of the previous line is reported at this time.
+       */
+      result = writer->write(logData, strlen(logData));
+      if (likely(result == 0)) {
+        result = writer->flush();
+      }
 
-      /* Write line to log file. */
-      if (unlikely(write(fd, logData, strlen(logData)) < 0)) {
-        result = errno;
+      if (unlikely(result != 0)) {
+        errno = result;
         logger->printWarnMsgWithErrno("Could not write to log file");
-      }
 
-      /* Cleanup. */
-      if (unlikely(close(fd) < 0 && (result == 0))) {
-        result = errno;
-        logger->printWarnMsgWithErrno("Could not close log file");
+        /* Log file will be re-opened at next logging. */
+        closeHeapLog();
       }
     }
   }
@@ -287,6 +584,114 @@ int TLogManager::collectNormalLog(TInvokeCause cause, TMSecTime nowTime,
   return result;
 }
 
+/*!
+ * \brief Get writer of heap log file.<br>
+ *        The file is kept opening until its path is changed.
+ * \return Writer of heap log file.<br>
+ *         Value is null, if process is failure.
+ * \warning Caller must hold logMutex.
+ */
+TAsyncFile *TLogManager::getHeapLogWriter(void) {
+  const char *path = conf->HeapLogFile()->get();
+
+  /* heaplogfile might be changed by reloading configuration. */
+  if (likely((heapLogWriter != NULL) && (heapLogPath != NULL) &&
+             (strcmp(heapLogPath, path) == 0))) {
+    return heapLogWriter;
+  }
+
+  closeHeapLog();
+  free(heapLogPath);
+  heapLogPath = NULL;
+
+  /* Binary log might be mapped before switching heaplog_binary. */
+  delete resourceLog;
+  resourceLog = NULL;
+
+  int fd = open(path, O_CREAT | O_WRONLY | O_APPEND | O_CLOEXEC,
+                S_IRUSR | S_IWUSR);
+  if (unlikely(fd < 0)) {
+    return NULL;
+  }
+
+  heapLogPath = strdup(path);
+  if (unlikely(heapLogPath == NULL)) {
+    /* Path is needed to detect change of heaplogfile. */
+    close(fd);
+    errno = ENOMEM;
+    return NULL;
+  }
+
+  /* Only one record is in-flight to keep order of appended records. */
+  try {
+    heapLogWriter = new TAsyncFile(fd, 0, 1);
+  } catch (...) {
+    close(fd);
+    errno = ENOMEM;
+    return NULL;
+  }
+
+  heapLogFd = fd;
+  return heapLogWriter;
+}
+
+/*!
+ * \brief Close heap log file after in-flight record is written.
+ * \warning Caller must hold logMutex.
+ */
+void TLogManager::closeHeapLog(void) {
+  if (heapLogWriter != NULL) {
+    int result = heapLogWriter->finish();
+    if (unlikely(result != 0)) {
+      errno = result;
+      logger->printWarnMsgWithErrno("Could not write to log file");
+    }
+
+    delete heapLogWriter;
+    heapLogWriter = NULL;
+  }
+
+  if (heapLogFd >= 0) {
+    close(heapLogFd);
+    heapLogFd = -1;
+  }
+}
+
+/*!
+ * \brief Get binary resource log.<br>
+ *        The log is kept mapping until its path or size is changed.
+ * \return Binary resource log.<br>
+ *         Value is null, if process is failure.
+ * \warning Caller must hold logMutex.
+ */
+TResourceLog *TLogManager::getResourceLog(void) {
+  const char *path = conf->HeapLogFile()->get();
+  jlong capacity = conf->HeapLogBinaryRecords()->get();
+
+  /* heaplogfile might be changed by reloading configuration. */
+  if (likely((resourceLog != NULL) &&
+             (strcmp(resourceLog->getPath(), path) == 0) &&
+             (resourceLog->getCapacity() == capacity))) {
+    return resourceLog;
+  }
+
+  delete resourceLog;
+  resourceLog = NULL;
+
+  /* CSV log might be opened before switching heaplog_binary. */
+  closeHeapLog();
+
+  try {
+    resourceLog = new TResourceLog(path, capacity);
+  } catch (int errNum) {
+    errno = errNum;
+  } catch (...) {
+    errno = ENOMEM;
+  }
+
+  return resourceLog;
+}
+
 /*!
  * \brief Collect all log.
  * \param jvmti       [in]  JVMTI environment object.
@@ -303,6 +708,8 @@ int TLogManager::collectNormalLog(TInvokeCause cause, TMSecTime nowTime,
 int TLogManager::collectAllLog(jvmtiEnv *jvmti, JNIEnv *env, TInvokeCause cause,
                                TMSecTime nowTime, char *archivePath,
                                size_t pathLen, const char *description) {
+  TElapsedTimer elapsedTime("Collect all log");
+
   /* Variable for process result. */
   int result = 0;
   /* Working directory path. */
@@ -310,6 +717,17 @@ int TLogManager::collectAllLog(jvmtiEnv *jvmti, JNIEnv *env, TInvokeCause cause,
   /* Archive file path. */
   char *uniqArcName = NULL;
 
+  /* Make archive directly if it is enabled. */
+  if (likely(conf->NativeArchive()->get())) {
+    result = collectAllLogDirectly(jvmti, env, cause, nowTime, archivePath,
+                                   pathLen, description);
+    if (likely(result == 0)) {
+      return 0;
+    }
+
+    logger->printWarnMsg("Retry to collect log through working directory.");
+  }
+
   /* Make directory. */
   result = createTempDir(&basePath, conf->LogDir()->get());
   if (unlikely(result != 0)) {
@@ -317,59 +735,27 @@ int TLogManager::collectAllLog(jvmtiEnv *jvmti, JNIEnv *env, TInvokeCause cause,
     return result;
   }
 
-  try {
-    /* Create enviroment report file. */
-    result = makeEnvironFile(basePath, cause, nowTime, description);
-    if (unlikely(result != 0)) {
-      logger->printWarnMsg("Failure create enviroment file.");
-
-      /* If raise disk full error. */
-      if (unlikely(isRaisedDiskFull(result))) {
-        throw 1;
-      }
-    }
-
-    /* Copy many files. */
-    result = copyInfoFiles(basePath);
-    /* If raise disk full error. */
-    if (unlikely(isRaisedDiskFull(result))) {
-      throw 1;
-    }
+  /* Collect files in parallel. */
+  TLogStage stages[LOG_STAGE_NUM];
+  initLogStages(stages, cause, nowTime, description, basePath);
+  startLogStages(stages);
 
-    /* Create thread dump file. */
-    result = makeThreadDumpFile(jvmti, env, basePath, cause, nowTime);
-    if (unlikely(result != 0)) {
-      logger->printWarnMsg("Failure thread dumping.");
-
-      /* If raise disk full error. */
-      if (unlikely(isRaisedDiskFull(result))) {
-        throw 1;
-      }
-    }
-
-    /* Copy gc log file. */
-    result = copyGCLogFile(basePath);
-    if (unlikely(result != 0)) {
-      logger->printWarnMsgWithErrno("Could not copy GC log.");
-
-      /* If raise disk full error. */
-      if (unlikely(isRaisedDiskFull(result))) {
-        throw 1;
-      }
-    }
+  /* Create thread dump file in this thread because it might use JVMTI. */
+  result = makeThreadDumpFile(jvmti, env, basePath, cause, nowTime);
+  if (unlikely(result != 0)) {
+    logger->printWarnMsg("Failure thread dumping.");
+  }
 
-    /* Create socket owner file. */
-    result = makeSocketOwnerFile(basePath);
-    if (unlikely(result != 0)) {
-      logger->printWarnMsgWithErrno("Could not create socket owner file.");
+  joinLogStages(stages);
 
-      /* If raise disk full error. */
-      if (unlikely(isRaisedDiskFull(result))) {
-        throw 1;
-      }
+  /* Give up to make archive only if disk is full. */
+  if (likely(!isRaisedDiskFull(result))) {
+    result = 0;
+  }
+  for (int i = 0; i < LOG_STAGE_NUM; i++) {
+    if (unlikely(isRaisedDiskFull(stages[i].result))) {
+      result = stages[i].result;
     }
-  } catch (...) {
-    ; /* Failed collect files by disk full. */
   }
 
   if (likely(result == 0)) {
@@ -453,6 +839,379 @@ int TLogManager::collectAllLog(jvmtiEnv *jvmti, JNIEnv *env, TInvokeCause cause,
   return result;
 }
 
+/*!
+ * \brief Collect all log to archive directly without working directory.
+ * \param jvmti       [in]  JVMTI environment object.
+ * \param env         [in]  JNI environment object.
+ * \param cause       [in]  Invoke function cause.<br>
+ *                          E.g. ResourceExhausted, Signal, Interval.
+ * \param nowTime     [in]  Log collect time.
+ * \param archivePath [out] Archive file path.
+ * \param pathLen     [in]  Max size of paramter"archivePath".
+ * \param description [in]  Description of the event.
+ * \return Value is zero, if process is succeed.<br />
+ *         Value is error number a.k.a. "errno", if process is failure.
+ */
+int TLogManager::collectAllLogDirectly(jvmtiEnv *jvmti, JNIEnv *env,
+                                       TInvokeCause cause, TMSecTime nowTime,
+                                       char *archivePath, size_t pathLen,
+                                       const char *description) {
+  /*
+   * Set value mean failed to create archive,
+   * For if failed to get "archiveMutex" mutex.
+   */
+  int result = -1;
+  /* Archive file path. */
+  char *uniqArcName = NULL;
+
+  /* Get mutex. */
+  ENTER_PTHREAD_SECTION(&archiveMutex) {
+
+    /* Create archive file name. */
+    uniqArcName = createArchiveName(nowTime);
+    if (unlikely(uniqArcName == NULL)) {
+      /* Failure make archive uniq name. */
+      logger->printWarnMsg("Failure create archive name.");
+    } else {
+      result = writeAllLogToArchive(jvmti, env, cause, nowTime, uniqArcName,
+                                    description);
+    }
+  }
+  /* Release mutex. */
+  EXIT_PTHREAD_SECTION(&archiveMutex)
+
+  /* Partial archive has been removed. */
+  if (unlikely(result != 0)) {
+    free(uniqArcName);
+    return result;
+  }
+
+  /* Copy archive file name without directory path. */
+  char *filePos = strrchr(uniqArcName, '/');
+  strncpy(archivePath, (filePos != NULL) ? filePos + 1 : uniqArcName,
+          pathLen);
+
+  /* Send log archive trap. */
+  if (unlikely(!sendLogArchiveTrap(cause, nowTime, uniqArcName, false))) {
+    logger->printWarnMsg("Send SNMP log archive trap failed!");
+  }
+
+  free(uniqArcName);
+  return 0;
+}
+
+/*!
+ * \brief Write all log to archive file.<br>
+ *        Each stage makes own part of archive in parallel, and thread dump
+ *        is made in this thread. Files are read into archive directly, and
+ *        generated logs are staged in anonymous file. Archive is removed if
+ *        it cannot be completed.
+ * \param jvmti       [in] JVMTI environment object.
+ * \param env         [in] JNI environment object.
+ * \param cause       [in] Invoke function cause.<br>
+ *                         E.g. ResourceExhausted, Signal, Interval.
+ * \param nowTime     [in] Log collect time.
+ * \param archiveFile [in] Path of archive file.
+ * \param description [in] Description of the event.
+ * \return Value is zero, if process is succeed.<br />
+ *         Value is error number a.k.a. "errno", if process is failure.
+ */
+int TLogManager::writeAllLogToArchive(jvmtiEnv *jvmti, JNIEnv *env,
+                                      TInvokeCause cause, TMSecTime nowTime,
+                                      const char *archiveFile,
+                                      const char *description) {
+  int result = 0;
+  time_t mtime = (time_t)(nowTime / 1000);
+
+  TZipStreamWriter *writer = NULL;
+  try {
+    writer = new TZipStreamWriter(archiveFile);
+  } catch (int errNum) {
+    errno = errNum;
+    logger->printWarnMsgWithErrno("Could not create archive file.");
+    return errNum;
+  } catch (...) {
+    logger->printWarnMsg("Could not create archive file.");
+    return ENOMEM;
+  }
+
+  /* Prepare parts of archive for each stage. */
+  TLogStage stages[LOG_STAGE_NUM];
+  initLogStages(stages, cause, nowTime, description, NULL);
+  for (int i = 0; (i < LOG_STAGE_NUM) && (result == 0); i++) {
+    int partFd = createStagingFd();
+    if (unlikely(partFd < 0)) {
+      result = errno;
+      break;
+    }
+
+    try {
+      stages[i].writer = new TZipStreamWriter(partFd);
+    } catch (int errNum) {
+      result = errNum;
+    } catch (...) {
+      result = ENOMEM;
+    }
+  }
+
+  int stagingFd = -1;
+  if (likely(result == 0)) {
+    stagingFd = createStagingFd();
+    if (unlikely(stagingFd < 0)) {
+      result = errno;
+    }
+  }
+
+  if (unlikely(result != 0)) {
+    errno = result;
+    logger->printWarnMsgWithErrno("Could not create staging file.");
+
+    for (int i = 0; i < LOG_STAGE_NUM; i++) {
+      delete stages[i].writer;
+    }
+    delete writer;
+    return result;
+  }
+
+  startLogStages(stages);
+
+  /* Create thread dump. */
+  if (unlikely(writeThreadDump(jvmti, env, stagingFd, cause) != 0)) {
+    logger->printWarnMsg("Failure thread dumping.");
+  }
+  result = addStagedFile(writer, stagingFd, "threaddump.txt", mtime);
+  close(stagingFd);
+
+  joinLogStages(stages);
+
+  /*
+   * Failure of each log is reported as warning same as working directory.
+   * Only failure of writing archive aborts collection.
+   */
+  for (int i = 0; i < LOG_STAGE_NUM; i++) {
+    if (likely(result == 0)) {
+      result = stages[i].result;
+    }
+    if (likely(result == 0)) {
+      result = writer->append(stages[i].writer);
+    }
+
+    delete stages[i].writer;
+  }
+
+  /* Write central directory. */
+  if (likely(result == 0)) {
+    result = writer->finish();
+  }
+
+  if (unlikely(result != 0)) {
+    errno = result;
+    logger->printWarnMsgWithErrno("Could not write archive file.");
+  }
+
+  /* Cleanup. */
+  delete writer;
+
+  return result;
+}
+
+/*!
+ * \brief Initialize stages of collecting all log.
+ * \param stages      [out] Array of LOG_STAGE_NUM stages.
+ * \param cause       [in]  Invoke function cause.<br>
+ *                          E.g. ResourceExhausted, Signal, Interval.
+ * \param nowTime     [in]  Log collect time.
+ * \param description [in]  Description of the event.
+ * \param basePath    [in]  Working directory, or NULL to make parts of
+ *                          archive.
+ */
+void TLogManager::initLogStages(TLogStage *stages, TInvokeCause cause,
+                                TMSecTime nowTime, const char *description,
+                                const char *basePath) {
+  for (int i = 0; i < LOG_STAGE_NUM; i++) {
+    stages[i].manager = this;
+    stages[i].kind = (TLogStageKind)i;
+    stages[i].cause = cause;
+    stages[i].nowTime = nowTime;
+    stages[i].description = description;
+    stages[i].basePath = basePath;
+    stages[i].writer = NULL;
+    stages[i].result = 0;
+    stages[i].isStarted = false;
+  }
+}
+
+/*!
+ * \brief Start all stages of collecting all log in parallel.<br>
+ *        Stage is run in the caller if thread cannot be created.
+ * \param stages [in] Array of LOG_STAGE_NUM stages.
+ */
+void TLogManager::startLogStages(TLogStage *stages) {
+  /* Signals should be handled by threads of JVM. */
+  sigset_t allSignals;
+  sigset_t oldMask;
+  sigfillset(&allSignals);
+  pthread_sigmask(SIG_BLOCK, &allSignals, &oldMask);
+
+  for (int i = 0; i < LOG_STAGE_NUM; i++) {
+    stages[i].isStarted = (pthread_create(&stages[i].thread, NULL,
+                                          &logStageEntryPoint,
+                                          &stages[i]) == 0);
+  }
+
+  pthread_sigmask(SIG_SETMASK, &oldMask, NULL);
+
+  for (int i = 0; i < LOG_STAGE_NUM; i++) {
+    if (unlikely(!stages[i].isStarted)) {
+      logger->printWarnMsg("Could not create thread for collecting log.");
+      logStageEntryPoint(&stages[i]);
+    }
+  }
+}
+
+/*!
+ * \brief Wait for all stages of collecting all log.
+ * \param stages [in] Array of LOG_STAGE_NUM stages.
+ */
+void TLogManager::joinLogStages(TLogStage *stages) {
+  for (int i = 0; i < LOG_STAGE_NUM; i++) {
+    if (likely(stages[i].isStarted)) {
+      pthread_join(stages[i].thread, NULL);
+      stages[i].isStarted = false;
+    }
+  }
+}
+
+/*!
+ * \brief Entry point of thread which runs a stage of collecting all log.
+ * \param data [in] Stage to run.
+ * \return Always NULL.
+ */
+void *TLogManager::logStageEntryPoint(void *data) {
+  TLogStage *stage = (TLogStage *)data;
+  stage->result = stage->manager->runLogStage(stage);
+
+  return NULL;
+}
+
+/*!
+ * \brief Run a stage of collecting all log.<br>
+ *        If the stage has working directory, files are made in it.
+ *        Otherwise the stage writes its part of archive. In this case,
+ *        failure of each log is reported as warning, and only failure of
+ *        writing archive is returned.
+ * \param stage [in] Stage to run.
+ * \return Value is zero, if process is succeed.<br />
+ *         Value is error number a.k.a. "errno", if process is failure.
+ */
+int TLogManager::runLogStage(TLogStage *stage) {
+  int result = 0;
+  char rpath[PATH_MAX];
+  time_t mtime = (time_t)(stage->nowTime / 1000);
+  bool isDirectory = (stage->basePath != NULL);
+  int stagingFd = -1;
+
+  switch (stage->kind) {
+    case LOG_STAGE_ENVIRON:
+      if (isDirectory) {
+        result = makeEnvironFile((char *)stage->basePath, stage->cause,
+                                 stage->nowTime, stage->description);
+        if (unlikely(result != 0)) {
+          logger->printWarnMsg("Failure create enviroment file.");
+        }
+        break;
+      }
+
+      stagingFd = createStagingFd();
+      if (unlikely(stagingFd < 0)) {
+        result = errno;
+        break;
+      }
+      if (unlikely(writeEnvironFile(stagingFd, stage->cause, stage->nowTime,
+                                    stage->description) != 0)) {
+        logger->printWarnMsg("Failure create enviroment file.");
+      }
+      result = addStagedFile(stage->writer, stagingFd, "envInfo.txt", mtime);
+      break;
+
+    case LOG_STAGE_INFO_FILES:
+      result = isDirectory ? copyInfoFiles(stage->basePath)
+                           : addInfoFilesToArchive(stage->writer, mtime);
+      break;
+
+    case LOG_STAGE_GC_LOG:
+      if (isDirectory) {
+        result = copyGCLogFile(stage->basePath);
+        if (unlikely(result != 0)) {
+          logger->printWarnMsgWithErrno("Could not copy GC log.");
+        }
+      } else if (((*gcLogFilename) != NULL) &&
+                 isCopiablePath(*gcLogFilename, rpath)) {
+        result = stage->writer->addFile(*gcLogFilename);
+      }
+      break;
+
+    case LOG_STAGE_SOCKET_OWNER:
+      if (isDirectory) {
+        result = makeSocketOwnerFile(stage->basePath);
+        if (unlikely(result != 0)) {
+          logger->printWarnMsgWithErrno("Could not create socket owner file.");
+        }
+        break;
+      }
+
+      stagingFd = createStagingFd();
+      if (unlikely(stagingFd < 0)) {
+        result = errno;
+        break;
+      }
+      if (unlikely(writeSocketOwnerFile(stagingFd) != 0)) {
+        logger->printWarnMsgWithErrno("Could not create socket owner file.");
+      }
+      result = addStagedFile(stage->writer, stagingFd, "sockowner", mtime);
+      break;
+
+    case LOG_STAGE_MEMORY_MAP:
+      if (!conf->MemMapSummary()->get()) {
+        result = isDirectory ? copyFile(SMAPS_FILE, stage->basePath)
+                             : stage->writer->addFile(SMAPS_FILE);
+        if (unlikely(result != 0)) {
+          logger->printWarnMsg("Could not copy file: %s", SMAPS_FILE);
+        }
+        break;
+      }
+
+      if (isDirectory) {
+        result = makeMemMapFile(stage->basePath);
+        if (unlikely(result != 0)) {
+          logger->printWarnMsg("Could not create memory map summary.");
+        }
+        break;
+      }
+
+      stagingFd = createStagingFd();
+      if (unlikely(stagingFd < 0)) {
+        result = errno;
+        break;
+      }
+      if (unlikely(writeMemMapFile(stagingFd) != 0)) {
+        logger->printWarnMsg("Could not create memory map summary.");
+      }
+      result = addStagedFile(stage->writer, stagingFd, MEMMAP_SUMMARY_NAME,
+                             mtime);
+      break;
+
+    default:
+      break;
+  }
+
+  if (stagingFd >= 0) {
+    close(stagingFd);
+  }
+
+  return result;
+}
+
 /*!
  * \brief Create file about JVM running environment.
  * \param basePath [in] Path of directory put report file.
@@ -467,23 +1226,6 @@ int TLogManager::makeEnvironFile(char *basePath, TInvokeCause cause,
                                  TMSecTime nowTime, const char *description) {
   int raisedErrNum = 0;
 
-  /* Invoke OS version function. */
-  struct utsname uInfo;
-  memset(&uInfo, 0, sizeof(struct utsname));
-  if (unlikely(uname(&uInfo) != 0)) {
-    logger->printWarnMsgWithErrno("Could not get kernel information.");
-  }
-
-  /* Invoke glibc information function. */
-  const char *glibcVersion = NULL;
-  const char *glibcRelease = NULL;
-
-  glibcVersion = gnu_get_libc_version();
-  glibcRelease = gnu_get_libc_release();
-  if (unlikely(glibcVersion == NULL || glibcRelease == NULL)) {
-    logger->printWarnMsgWithErrno("Could not get glibc version.");
-  }
-
   /* Create filename. */
   char *envInfoName = createFilename(basePath, "envInfo.txt");
   /* If failure create file name. */
@@ -504,6 +1246,49 @@ int TLogManager::makeEnvironFile(char *basePath, TInvokeCause cause,
   }
   free(envInfoName);
 
+  /* Output enviroment information. */
+  raisedErrNum = writeEnvironFile(fd, cause, nowTime, description);
+
+  /* Cleanup. */
+  if (unlikely(close(fd) < 0 && raisedErrNum == 0)) {
+    raisedErrNum = errno;
+    logger->printWarnMsgWithErrno("Could not create environment file.");
+  }
+
+  return raisedErrNum;
+}
+
+/*!
+ * \brief Write information about JVM running environment to stream.
+ * \param fd          [in] Output file descriptor.
+ * \param cause       [in] Invoke function cause.<br>
+ *                         E.g. Signal, ResourceExhausted, Interval.
+ * \param nowTime     [in] Log collect time.
+ * \param description [in] Description of the event.
+ * \return Value is zero, if process is succeed.<br />
+ *         Value is error number a.k.a. "errno", if process is failure.
+ */
+int TLogManager::writeEnvironFile(int fd, TInvokeCause cause,
+                                  TMSecTime nowTime, const char *description) {
+  int raisedErrNum = 0;
+
+  /* Invoke OS version function. */
+  struct utsname uInfo;
+  memset(&uInfo, 0, sizeof(struct utsname));
+  if (unlikely(uname(&uInfo) != 0)) {
+    logger->printWarnMsgWithErrno("Could not get kernel information.");
+  }
+
+  /* Invoke glibc information function. */
+  const char *glibcVersion = NULL;
+  const char *glibcRelease = NULL;
+
+  glibcVersion = gnu_get_libc_version();
+  glibcRelease = gnu_get_libc_release();
+  if (unlikely(glibcVersion == NULL || glibcRelease == NULL)) {
+    logger->printWarnMsgWithErrno("Could not get glibc version.");
+  }
+
   /* Output enviroment information. */
   try {
     /* Output list. */
@@ -573,25 +1358,22 @@ int TLogManager::makeEnvironFile(char *basePath, TInvokeCause cause,
     logger->printWarnMsgWithErrno("Could not create environment file.");
   }
 
-  /* Cleanup. */
-  if (unlikely(close(fd) < 0 && raisedErrNum == 0)) {
-    raisedErrNum = errno;
-    logger->printWarnMsgWithErrno("Could not create environment file.");
-  }
-
   return raisedErrNum;
 }
 
 /*!
- * \brief Dump thread and stack information to stream.
+ * \brief Dump thread and stack information to stream.<br>
+ *        Method information is shared through methodInfoCache, so caller
+ *        must hold threadDumpMutex.
  * \param jvmti     [in] JVMTI environment object.
  * \param env       [in] JNI environment object.
- * \param fd        [in] Output file descriptor.
+ * \param out       [in] Buffered output stream.
  * \param stackInfo [in] Stack frame of java thread.
  * \return Value is zero, if process is succeed.<br />
  *         Value is error number a.k.a. "errno", if process is failure.
  */
-int TLogManager::dumpThreadInformation(jvmtiEnv *jvmti, JNIEnv *env, int fd,
+int TLogManager::dumpThreadInformation(jvmtiEnv *jvmti, JNIEnv *env,
+                                       TBufferedFdWriter *out,
                                        jvmtiStackInfo stackInfo) {
   /* Get JVMTI capabilities for getting monitor information. */
   jvmtiCapabilities capabilities;
@@ -604,35 +1386,17 @@ int TLogManager::dumpThreadInformation(jvmtiEnv *jvmti, JNIEnv *env, int fd,
   getThreadDetailInfo(jvmti, env, stackInfo.thread, &threadInfo);
 
   char const EMPTY_STR[] = "";
-  char lineBuf[PATH_MAX + 1] = {0};
-
-  /* Output thread information. */
 
-  try {
-    /* Output thread name, thread type and priority. */
-    snprintf(lineBuf, PATH_MAX, "\"%s\"%s prio=%d\n",
-             ((threadInfo.name != NULL) ? threadInfo.name : EMPTY_STR),
-             ((threadInfo.isDaemon) ? " daemon" : EMPTY_STR),
-             threadInfo.priority);
-    if (unlikely(write(fd, lineBuf, strlen(lineBuf)) < 0)) {
-      throw 1;
-    }
-
-    /* Output thread state. */
-    snprintf(lineBuf, PATH_MAX, "   java.lang.Thread.State: %s\n",
-             ((threadInfo.state != NULL) ? threadInfo.state : EMPTY_STR));
-    if (unlikely(write(fd, lineBuf, strlen(lineBuf)) < 0)) {
-      throw 1;
-    }
-  } catch (...) {
-    int raisedErrNum = errno;
-    logger->printWarnMsgWithErrno("Could not create threaddump through JVMTI.");
+  /* Output thread name, thread type and priority. */
+  out->printf("\"%s\"%s prio=%d\n",
+              ((threadInfo.name != NULL) ? threadInfo.name : EMPTY_STR),
+              ((threadInfo.isDaemon) ? " daemon" : EMPTY_STR),
+              threadInfo.priority);
 
-    free(threadInfo.name);
-    free(threadInfo.state);
+  /* Output thread state. */
+  out->printf("   java.lang.Thread.State: %s\n",
+              ((threadInfo.state != NULL) ? threadInfo.state : EMPTY_STR));
 
-    return raisedErrNum;
-  }
   free(threadInfo.name);
   free(threadInfo.state);
 
@@ -647,153 +1411,132 @@ int TLogManager::dumpThreadInformation(jvmtiEnv *jvmti, JNIEnv *env, int fd,
     monitorInfo = NULL;
   }
 
-  int result = 0;
-  try {
-    /* Output thread flame trace. */
-    for (jint flameIdx = 0, flameSize = stackInfo.frame_count;
-         flameIdx < flameSize; flameIdx++) {
-      jvmtiFrameInfo frameInfo = stackInfo.frame_buffer[flameIdx];
-      TJavaStackMethodInfo methodInfo = {0};
-
-      /* Get method information. */
-      getMethodFrameInfo(jvmti, env, frameInfo, &methodInfo);
-
-      /* Output method class, name and source file location. */
-
-      char *srcLocation = NULL;
-      if (!methodInfo.isNative) {
-        char locationBuf[PATH_MAX + 1] = {0};
-        if (likely(methodInfo.lineNumber >= 0)) {
-          snprintf(locationBuf, PATH_MAX, "%d", methodInfo.lineNumber);
-          srcLocation = strdup(locationBuf);
-        }
-
-        snprintf(locationBuf, PATH_MAX, "%s:%s",
-                 (methodInfo.sourceFile != NULL) ? methodInfo.sourceFile
-                                                 : "UnknownFile",
-                 (srcLocation != NULL) ? srcLocation : "UnknownLine");
-        free(srcLocation);
-        srcLocation = strdup(locationBuf);
-      }
-      snprintf(lineBuf, PATH_MAX, "\tat %s.%s(%s)\n",
-               (methodInfo.className != NULL) ? methodInfo.className
-                                              : "UnknownClass",
-               (methodInfo.methodName != NULL) ? methodInfo.methodName
-                                               : "UnknownMethod",
-               (srcLocation != NULL) ? srcLocation : "Native method");
-
-      /* Cleanup. */
-      free(methodInfo.className);
-      free(methodInfo.methodName);
-      free(methodInfo.sourceFile);
-      free(srcLocation);
+  /* Output thread flame trace. */
+  for (jint flameIdx = 0, flameSize = stackInfo.frame_count;
+       (flameIdx < flameSize) && likely(out->getError() == 0); flameIdx++) {
+    jvmtiFrameInfo frameInfo = stackInfo.frame_buffer[flameIdx];
+
+    /* Get method information. */
+    const TMethodInfo *methodInfo =
+        methodInfoCache->get(jvmti, env, frameInfo.method);
+    const char *className = NULL;
+    const char *methodName = NULL;
+    if (likely(methodInfo != NULL)) {
+      className = methodInfo->className;
+      methodName = methodInfo->methodName;
+    }
 
-      if (unlikely(write(fd, lineBuf, strlen(lineBuf)) < 0)) {
-        throw 1;
+    /* Output method class, name and source file location. */
+    if (unlikely((methodInfo == NULL) || methodInfo->isNative)) {
+      out->printf("\tat %s.%s(Native method)\n",
+                  (className != NULL) ? className : "UnknownClass",
+                  (methodName != NULL) ? methodName : "UnknownMethod");
+    } else {
+      const char *sourceFile = (methodInfo->sourceFile != NULL)
+                                   ? methodInfo->sourceFile
+                                   : "UnknownFile";
+      int lineNumber =
+          TMethodInfoCache::getLineNumber(methodInfo, frameInfo.location);
+      if (likely(lineNumber >= 0)) {
+        out->printf("\tat %s.%s(%s:%d)\n",
+                    (className != NULL) ? className : "UnknownClass",
+                    (methodName != NULL) ? methodName : "UnknownMethod",
+                    sourceFile, lineNumber);
+      } else {
+        out->printf("\tat %s.%s(%s:UnknownLine)\n",
+                    (className != NULL) ? className : "UnknownClass",
+                    (methodName != NULL) ? methodName : "UnknownMethod",
+                    sourceFile);
       }
+    }
 
-      /* If current stack frame. */
-      if (unlikely(hasCapability && flameIdx == 0)) {
-        jobject jMonitor = NULL;
-        jvmti->GetCurrentContendedMonitor(stackInfo.thread, &jMonitor);
-
-        /* If contented monitor is existing now. */
-        if (likely(jMonitor != NULL)) {
-          jclass monitorClass = NULL;
-          char *tempStr = NULL;
-          char ownerThreadName[1025] = "UNKNOWN";
-          char monitorClsName[1025] = "UNKNOWN";
-
-          /* Get monitor class. */
-          monitorClass = env->GetObjectClass(jMonitor);
-          if (likely(monitorClass != NULL)) {
-            /* Get class signature. */
-            jvmti->GetClassSignature(monitorClass, &tempStr, NULL);
-
-            if (likely(tempStr != NULL)) {
-              snprintf(monitorClsName, 1024, "%s", tempStr);
-              jvmti->Deallocate((unsigned char *)tempStr);
-            }
-
-            /* Cleanup. */
-            env->DeleteLocalRef(monitorClass);
+    /* If current stack frame. */
+    if (unlikely(hasCapability && flameIdx == 0)) {
+      jobject jMonitor = NULL;
+      jvmti->GetCurrentContendedMonitor(stackInfo.thread, &jMonitor);
+
+      /* If contented monitor is existing now. */
+      if (likely(jMonitor != NULL)) {
+        jclass monitorClass = NULL;
+        char *tempStr = NULL;
+        char ownerThreadName[1025] = "UNKNOWN";
+        char monitorClsName[1025] = "UNKNOWN";
+
+        /* Get monitor class. */
+        monitorClass = env->GetObjectClass(jMonitor);
+        if (likely(monitorClass != NULL)) {
+          /* Get class signature. */
+          jvmti->GetClassSignature(monitorClass, &tempStr, NULL);
+
+          if (likely(tempStr != NULL)) {
+            snprintf(monitorClsName, 1024, "%s", tempStr);
+            jvmti->Deallocate((unsigned char *)tempStr);
           }
 
-          /* Get monitor owner. */
-          jvmtiMonitorUsage monitorInfo = {0};
-          if (unlikely(!isError(jvmti, jvmti->GetObjectMonitorUsage(
-                                           jMonitor, &monitorInfo)))) {
-            /* Get owner thread information. */
-            getThreadDetailInfo(jvmti, env, monitorInfo.owner, &threadInfo);
+          /* Cleanup. */
+          env->DeleteLocalRef(monitorClass);
+        }
 
-            if (likely(threadInfo.name != NULL)) {
-              strncpy(ownerThreadName, threadInfo.name, 1024);
-            }
+        /* Get monitor owner. */
+        jvmtiMonitorUsage monitorInfo = {0};
+        if (unlikely(!isError(jvmti, jvmti->GetObjectMonitorUsage(
+                                         jMonitor, &monitorInfo)))) {
+          /* Get owner thread information. */
+          getThreadDetailInfo(jvmti, env, monitorInfo.owner, &threadInfo);
 
-            /* Cleanup. */
-            free(threadInfo.name);
-            free(threadInfo.state);
+          if (likely(threadInfo.name != NULL)) {
+            strncpy(ownerThreadName, threadInfo.name, 1024);
           }
-          env->DeleteLocalRef(jMonitor);
 
-          /* Output contented monitor information. */
-          snprintf(lineBuf, PATH_MAX, "\t- waiting to lock <owner:%s> (a %s)\n",
-                   ownerThreadName, monitorClsName);
-          if (unlikely(write(fd, lineBuf, strlen(lineBuf)) < 0)) {
-            throw 1;
-          }
+          /* Cleanup. */
+          free(threadInfo.name);
+          free(threadInfo.state);
         }
+        env->DeleteLocalRef(jMonitor);
+
+        /* Output contented monitor information. */
+        out->printf("\t- waiting to lock <owner:%s> (a %s)\n", ownerThreadName,
+                    monitorClsName);
       }
+    }
 
-      if (likely(monitorInfo != NULL)) {
-        /* Search monitor. */
-        jint monitorIdx = 0;
-        for (; monitorIdx < monitorCount; monitorIdx++) {
-          if (monitorInfo[monitorIdx].stack_depth == flameIdx) {
-            break;
-          }
+    if (likely(monitorInfo != NULL)) {
+      /* Search monitor. */
+      jint monitorIdx = 0;
+      for (; monitorIdx < monitorCount; monitorIdx++) {
+        if (monitorInfo[monitorIdx].stack_depth == flameIdx) {
+          break;
         }
+      }
 
-        /* If locked monitor is found. */
-        if (likely(monitorIdx < monitorCount)) {
-          jobject jMonitor = monitorInfo[monitorIdx].monitor;
-          jclass monitorClass = NULL;
-          char *tempStr = NULL;
-          char monitorClsName[1025] = "UNKNOWN";
-
-          /* Get object class. */
-          monitorClass = env->GetObjectClass(jMonitor);
-          if (likely(monitorClass != NULL)) {
-            /* Get class signature. */
-            jvmti->GetClassSignature(monitorClass, &tempStr, NULL);
-            if (likely(tempStr != NULL)) {
-              snprintf(monitorClsName, 1024, "%s", tempStr);
-              jvmti->Deallocate((unsigned char *)tempStr);
-            }
-            env->DeleteLocalRef(monitorClass);
-          }
-
-          /* Output owned monitor information. */
-          snprintf(lineBuf, PATH_MAX, "\t- locked (a %s)\n", monitorClsName);
-          if (unlikely(write(fd, lineBuf, strlen(lineBuf)) < 0)) {
-            throw 1;
+      /* If locked monitor is found. */
+      if (likely(monitorIdx < monitorCount)) {
+        jobject jMonitor = monitorInfo[monitorIdx].monitor;
+        jclass monitorClass = NULL;
+        char *tempStr = NULL;
+        char monitorClsName[1025] = "UNKNOWN";
+
+        /* Get object class. */
+        monitorClass = env->GetObjectClass(jMonitor);
+        if (likely(monitorClass != NULL)) {
+          /* Get class signature. */
+          jvmti->GetClassSignature(monitorClass, &tempStr, NULL);
+          if (likely(tempStr != NULL)) {
+            snprintf(monitorClsName, 1024, "%s", tempStr);
+            jvmti->Deallocate((unsigned char *)tempStr);
           }
+          env->DeleteLocalRef(monitorClass);
         }
-      }
-    }
 
-    /* Output separator for each thread. */
-    snprintf(lineBuf, PATH_MAX, "\n");
-    if (unlikely(write(fd, lineBuf, strlen(lineBuf)) < 0)) {
-      throw 1;
+        /* Output owned monitor information. */
+        out->printf("\t- locked (a %s)\n", monitorClsName);
+      }
     }
-  } catch (...) {
-    result = errno;
-
-    /* Raise write error. */
-    logger->printWarnMsgWithErrno("Could not create threaddump through JVMTI.");
   }
 
+  /* Output separator for each thread. */
+  out->printf("\n");
+
   /* Cleanup. */
   if (likely(monitorInfo != NULL)) {
     for (jint monitorIdx = 0; monitorIdx < monitorCount; monitorIdx++) {
@@ -801,6 +1544,14 @@ int TLogManager::dumpThreadInformation(jvmtiEnv *jvmti, JNIEnv *env, int fd,
     }
     jvmti->Deallocate((unsigned char *)monitorInfo);
   }
+
+  int result = out->getError();
+  if (unlikely(result != 0)) {
+    /* Raise write error. */
+    errno = result;
+    logger->printWarnMsgWithErrno("Could not create threaddump through JVMTI.");
+  }
+
   return result;
 }
 
@@ -825,6 +1576,28 @@ int TLogManager::makeJvmtiThreadDump(jvmtiEnv *jvmti, JNIEnv *env,
     return result;
   }
 
+  /* Output stack trace. */
+  result = writeJvmtiThreadDump(jvmti, env, fd);
+
+  /* Cleanup. */
+  if (unlikely(close(fd) < 0 && result == 0)) {
+    result = errno;
+    logger->printWarnMsgWithErrno("Could not create threaddump through JVMTI.");
+  }
+
+  return result;
+}
+
+/*!
+ * \brief Write thread dump with JVMTI to stream.
+ * \param jvmti [in] JVMTI environment object.
+ * \param env   [in] JNI environment object.
+ * \param fd    [in] Output file descriptor.
+ * \return Value is zero, if process is succeed.<br />
+ *         Value is error number a.k.a. "errno", if process is failure.
+ */
+int TLogManager::writeJvmtiThreadDump(jvmtiEnv *jvmti, JNIEnv *env, int fd) {
+  int result = 0;
   const jint MAX_STACK_COUNT = 100;
   jvmtiStackInfo *stackList = NULL;
   jint threadCount = 0;
@@ -833,27 +1606,46 @@ int TLogManager::makeJvmtiThreadDump(jvmtiEnv *jvmti, JNIEnv *env,
           isError(jvmti, jvmti->GetAllStackTraces(MAX_STACK_COUNT, &stackList,
                                                   &threadCount)))) {
     logger->printWarnMsg("Couldn't get thread stack trace.");
-    close(fd);
     return -1;
   }
 
-  /* Output stack trace. */
-  for (jint i = 0; i < threadCount; i++) {
-    jvmtiStackInfo stackInfo = stackList[i];
+  /* Get mutex. */
+  ENTER_PTHREAD_SECTION(&threadDumpMutex) {
+    /* Method information is shared until any class is unloaded. */
+    methodInfoCache->validate(jvmInfo->getUnloadedClasses());
 
-    /* Output thread information. */
-    result = dumpThreadInformation(jvmti, env, fd, stackInfo);
-    if (unlikely(result != 0)) {
-      break;
+    try {
+      TBufferedFdWriter out(fd);
+
+      /* Output stack trace. */
+      for (jint i = 0; i < threadCount; i++) {
+        jvmtiStackInfo stackInfo = stackList[i];
+
+        /* Output thread information. */
+        result = dumpThreadInformation(jvmti, env, &out, stackInfo);
+        if (unlikely(result != 0)) {
+          break;
+        }
+      }
+
+      /* Write remaining data. */
+      if (likely(result == 0)) {
+        result = out.flush();
+        if (unlikely(result != 0)) {
+          errno = result;
+          logger->printWarnMsgWithErrno(
+              "Could not create threaddump through JVMTI.");
+        }
+      }
+    } catch (int errNum) {
+      result = errNum;
+      logger->printWarnMsg("Failure allocate working memory.");
     }
   }
+  /* Release mutex. */
+  EXIT_PTHREAD_SECTION(&threadDumpMutex)
 
   /* Cleanup. */
-  if (unlikely(close(fd) < 0 && result == 0)) {
-    result = errno;
-    logger->printWarnMsgWithErrno("Could not create threaddump through JVMTI.");
-  }
-
   jvmti->Deallocate((unsigned char *)stackList);
 
   return result;
@@ -907,6 +1699,44 @@ int TLogManager::makeThreadDumpFile(jvmtiEnv *jvmti, JNIEnv *env,
   return result;
 }
 
+/*!
+ * \brief Write thread dump to stream.
+ * \param jvmti [in] JVMTI environment object.
+ * \param env   [in] JNI environment object.
+ * \param fd    [in] Output file descriptor.
+ * \param cause [in] Invoke function cause.<br>
+ *                   E.g. Signal, ResourceExhausted, Interval.
+ * \return Value is zero, if process is succeed.<br />
+ *         Value is error number a.k.a. "errno", if process is failure.
+ */
+int TLogManager::writeThreadDump(jvmtiEnv *jvmti, JNIEnv *env, int fd,
+                                 TInvokeCause cause) {
+  int result = -1;
+
+  if (unlikely(cause == ThreadExhausted && !jvmCmd->isConnectable())) {
+    /*
+     * JVM is aborted when reserve signal SIGQUIT,
+     * if JVM can't make new thread (e.g. RLIMIT_NPROC).
+     * So we need avoid to send SIGQUIT signal.
+     */
+    ;
+  } else {
+    /* Write thread dump through attach listener. */
+    result = jvmCmd->exec("threaddump", fd);
+  }
+
+  /* If need original thread dump. */
+  if (unlikely((result != 0) && (jvmti != NULL))) {
+    /* Discard partial response. */
+    result = resetStagingFd(fd);
+    if (likely(result == 0)) {
+      result = writeJvmtiThreadDump(jvmti, env, fd);
+    }
+  }
+
+  return result;
+}
+
 /*!
  * \brief Getting java process information.
  * \param systime [out] System used cpu time in java process.
@@ -934,44 +1764,49 @@ bool TLogManager::getProcInfo(TLargeUInt *systime, TLargeUInt *usrtime,
   *vmsize = -1;
   *rssize = -1;
 
-  /* Make path of process status file. */
-  char path[256] = {0};
-  snprintf(path, 255, "/proc/%d/stat", getpid());
-  /* Open process status file. */
-  FILE *proc = fopen(path, "r");
-
   /* If failure open process status file. */
-  if (unlikely(proc == NULL)) {
+  if (unlikely(!openProcFile(&procStatFd, "/proc/self/stat"))) {
     logger->printWarnMsgWithErrno("Could not open process status.");
     return false;
   }
 
-  char *line = NULL;
-  size_t len = 0;
-  /* Get line from process status file. */
-  if (likely(getline(&line, &len, proc) > 0)) {
-    /* Parse line. */
-    if (likely(
-            sscanf(
-                line,
-                "%*d %*s %*c %*d %*d %*d %*d %*d %*u %*u"
-                " %*u %*u %*u %llu %llu %*d %*d %*d %*d %*d %*d %*u %llu %llu",
-                usrtime, systime, vmsize, rssize) == 4)) {
-      /* Convert real page count to real page size. */
-      *rssize = *rssize * pageSize;
-    } else {
-      /* Kernel may be old or customized. */
-      logger->printWarnMsg("Process data has shortage.");
-    }
-  } else {
-    logger->printWarnMsg("Couldn't read process status.");
+  char buf[PROC_STAT_BUFFER_SIZE];
+  /* Read process status file. */
+  if (unlikely(!readProcFile(procStatFd, buf, sizeof(buf)))) {
+    logger->printWarnMsgWithErrno("Couldn't read process status.");
+    return true;
   }
 
-  /* Cleanup. */
-  if (likely(line != NULL)) {
-    free(line);
+  /*
+   * Process name (2nd field) might contain space.
+   * So we parse fields after the last ')'.
+   */
+  const char *pos = strrchr(buf, ')');
+  if (likely(pos != NULL)) {
+    /* Skip to utime (14th field) from the tail of process name. */
+    pos = skipProcFields(pos, 12);
   }
-  fclose(proc);
+
+  TLargeUInt utime, stime, vsize, rss;
+  bool isParsed =
+      parseProcValue(&pos, &utime) && parseProcValue(&pos, &stime);
+  if (likely(isParsed)) {
+    /* Skip to vsize (23rd field). */
+    pos = skipProcFields(pos, 7);
+    isParsed = parseProcValue(&pos, &vsize) && parseProcValue(&pos, &rss);
+  }
+
+  if (likely(isParsed)) {
+    *usrtime = utime;
+    *systime = stime;
+    *vmsize = vsize;
+    /* Convert real page count to real page size. */
+    *rssize = rss * pageSize;
+  } else {
+    /* Kernel may be old or customized. */
+    logger->printWarnMsg("Process data has shortage.");
+  }
+
   return true;
 }
 
@@ -984,53 +1819,53 @@ bool TLogManager::getSysTimes(TMachineTimes *times) {
   /* Initialize. */
   memset(times, 0, sizeof(TMachineTimes));
 
-  /* Open machine status file. */
-  FILE *proc = fopen("/proc/stat", "r");
   /* If failure open machine status file. */
-  if (unlikely(proc == NULL)) {
+  if (unlikely(!openProcFile(&sysStatFd, "/proc/stat"))) {
     logger->printWarnMsgWithErrno("Could not open /proc/stat");
     return false;
   }
 
-  char *line = NULL;
-  size_t len = 0;
-  bool flagFound = false;
+  /* "cpu" line is always the first line of /proc/stat . */
+  char buf[SYS_STAT_BUFFER_SIZE];
+  if (unlikely(!readProcFile(sysStatFd, buf, sizeof(buf)) ||
+               (strncmp(buf, "cpu ", 4) != 0))) {
+    /* Maybe the kernel is modified. */
+    logger->printWarnMsg("Not found cpu status data.");
+    return false;
+  }
 
-  /* Loop for find "cpu" line. */
-  while (likely(getline(&line, &len, proc) > 0)) {
-    /* Check line. */
-    if (unlikely(strncmp(line, "cpu ", 4) != 0)) {
-      /* This line is non-target. */
-      continue;
-    }
+  /* Order of fields in "cpu" line. */
+  TLargeUInt *fields[] = {&times->usrTime,     &times->lowUsrTime,
+                          &times->sysTime,     &times->idleTime,
+                          &times->iowaitTime,  &times->sortIrqTime,
+                          &times->irqTime,     &times->stealTime,
+                          &times->guestTime};
 
-    /* Parse cpu time information. */
-    if (unlikely(sscanf(line,
-                        "cpu %llu %llu %llu %llu %llu %llu %llu %llu %llu",
-                        &times->usrTime, &times->lowUsrTime, &times->sysTime,
-                        &times->idleTime, &times->iowaitTime,
-                        &times->sortIrqTime, &times->irqTime, &times->stealTime,
-                        &times->guestTime) != 9)) {
+  const char *pos = skipProcFields(buf, 1);
+  for (size_t idx = 0; idx < sizeof(fields) / sizeof(fields[0]); idx++) {
+    if (unlikely(!parseProcValue(&pos, fields[idx]))) {
       /* Maybe the kernel is old version. */
       logger->printWarnMsg("CPU status data has shortage.");
+      break;
     }
-
-    flagFound = true;
-    break;
   }
 
-  /* If not found cpu information. */
-  if (unlikely(!flagFound)) {
-    /* Maybe the kernel is modified. */
-    logger->printWarnMsg("Not found cpu status data.");
-  }
+  return true;
+}
 
-  /* Cleanup. */
-  if (likely(line != NULL)) {
-    free(line);
+/*!
+ * \brief Open /proc file which is re-read at each collecting normal log.
+ * \param fd   [in,out] File descriptor of /proc file.
+ * \param path [in]     Path of /proc file.
+ * \return Value is true, if file descriptor is available.
+ */
+bool TLogManager::openProcFile(int *fd, const char *path) {
+  if (likely(*fd >= 0)) {
+    return true;
   }
-  fclose(proc);
-  return flagFound;
+
+  *fd = open(path, O_RDONLY | O_CLOEXEC);
+  return (*fd >= 0);
 }
 
 /*!
@@ -1125,23 +1960,6 @@ bool TLogManager::sendLogArchiveTrap(TInvokeCause cause, TMSecTime nowTime,
 int TLogManager::copyInfoFiles(char const *basePath) {
   int result = 0;
 
-  /* Copy distribution file list. */
-  const char distFileList[][255] = {/* Distribution release. */
-                                    "/etc/redhat-release",
-                                    /* For other distribution. */
-                                    "/etc/sun-release",
-                                    "/etc/mandrake-release",
-                                    "/etc/SuSE-release",
-                                    "/etc/turbolinux-release",
-                                    "/etc/gentoo-release",
-                                    "/etc/debian_version",
-                                    "/etc/ltib-release",
-                                    "/etc/angstrom-version",
-                                    "/etc/fedora-release",
-                                    "/etc/vine-release",
-                                    "/etc/issue",
-                                    /* End flag. */
-                                    {0}};
   bool flagCopyedDistFile = false;
 
   /* Copy distribution file. */
@@ -1164,20 +1982,6 @@ int TLogManager::copyInfoFiles(char const *basePath) {
     return result;
   }
 
-  /* Copy file list. */
-  const char copyFileList[][255] = {/* Process information. */
-                                    "/proc/self/smaps",
-                                    "/proc/self/limits",
-                                    "/proc/self/cmdline",
-                                    "/proc/self/status",
-                                    /* Netstat infomation. */
-                                    "/proc/net/tcp",
-                                    "/proc/net/tcp6",
-                                    "/proc/net/udp",
-                                    "/proc/net/udp6",
-                                    /* End flag. */
-                                    {0}};
-
   /* Copy files in list. */
   for (int i = 0; strlen(copyFileList[i]) > 0; i++) {
     /* Copy file. */
@@ -1222,8 +2026,7 @@ int TLogManager::copyInfoFiles(char const *basePath) {
       /* Child process */
       /* logfile name shows what command is used to output it.*/
       char logfile[PATH_MAX];
-      sprintf(logfile, "%s%s", basePath,
-              "/journalctl_-q_--all_--this-boot_--no-pager_-o_verbose.log");
+      sprintf(logfile, "%s/%s", basePath, JOURNAL_LOG_NAME);
       /* Redirect child process' stdout/stderr to logfile */
       int fd = open(logfile, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
       if (dup2(fd, 1) < 0) {
@@ -1276,16 +2079,10 @@ int TLogManager::copyInfoFiles(char const *basePath) {
   }
 
   /* Copy file descriptors, i.e. stdout and stderr, as avoid double work. */
-  const int fdNum = 2;
-  const char streamList[fdNum][255] = {/* Standard streams */
-                                       "/proc/self/fd/1", "/proc/self/fd/2",
-  };
+  char fdPath[STREAM_FILE_NUM][PATH_MAX];
+  struct stat fdStat[STREAM_FILE_NUM];
 
-  const char fdFile[fdNum][10] = {"fd1", "fd2"};
-  char fdPath[fdNum][PATH_MAX];
-  struct stat fdStat[fdNum];
-
-  for (int i = 0; i < fdNum; i++) {
+  for (int i = 0; i < STREAM_FILE_NUM; i++) {
     realpath(streamList[i], fdPath[i]);
 
     if (unlikely(stat(fdPath[i], &fdStat[i]) != 0)) {
@@ -1315,6 +2112,148 @@ int TLogManager::copyInfoFiles(char const *basePath) {
   return result;
 }
 
+/*!
+ * \brief Add files about JVM enviroment to log archive.
+ * \param writer [in] Log archive.
+ * \param mtime  [in] Modification time of generated entries.
+ * \return Value is zero, if process is succeed.<br />
+ *         Value is error number a.k.a. "errno", if failure to write archive.
+ */
+int TLogManager::addInfoFilesToArchive(TZipStreamWriter *writer,
+                                       time_t mtime) {
+  int result = 0;
+  char rpath[PATH_MAX];
+
+  /* Add distribution file. */
+  bool flagCopyedDistFile = false;
+  for (int i = 0; strlen(distFileList[i]) > 0; i++) {
+    if (isCopiablePath(distFileList[i], rpath)) {
+      result = writer->addFile(distFileList[i]);
+      if (unlikely(result != 0)) {
+        return result;
+      }
+
+      flagCopyedDistFile = true;
+      break;
+    }
+  }
+
+  /* If failure copy distribution file. */
+  if (unlikely(!flagCopyedDistFile)) {
+    logger->printWarnMsg("Could not copy distribution release file.");
+  }
+
+  /* Add files in list. */
+  for (int i = 0; strlen(copyFileList[i]) > 0; i++) {
+    if (unlikely(!isCopiablePath(copyFileList[i], rpath))) {
+      logger->printWarnMsg("Could not copy file: %s", copyFileList[i]);
+      continue;
+    }
+
+    result = writer->addFile(copyFileList[i]);
+    if (unlikely(result != 0)) {
+      return result;
+    }
+  }
+
+  /* Collect Syslog or Systemd-Journald */
+  if (isCopiablePath("/var/log/messages", rpath)) {
+    result = writer->addFile("/var/log/messages");
+  } else {
+    logger->printWarnMsg("Could not copy /var/log/messages");
+    result = addJournalToArchive(writer, mtime);
+  }
+
+  if (unlikely(result != 0)) {
+    return result;
+  }
+
+  /* Add standard streams, as avoid double work. */
+  struct stat fdStat[STREAM_FILE_NUM];
+  bool isStdoutAdded = false;
+  for (int i = 0; i < STREAM_FILE_NUM; i++) {
+    if (unlikely(!isCopiablePath(streamList[i], rpath) ||
+                 (stat(rpath, &fdStat[i]) != 0))) {
+      logger->printWarnMsg("Could not copy file: %s", streamList[i]);
+      continue;
+    }
+
+    /*
+     * If stdout and stderr are redirected to same file, no need to copy the
+     * file again.
+     */
+    if ((i == 1) && isStdoutAdded && (fdStat[0].st_ino == fdStat[1].st_ino)) {
+      break;
+    }
+
+    result = writer->addFile(streamList[i], fdFile[i]);
+    if (unlikely(result != 0)) {
+      return result;
+    }
+    isStdoutAdded = (i == 0);
+  }
+
+  return 0;
+}
+
+/*!
+ * \brief Add systemd-journald log to log archive.<br>
+ *        Output of journalctl is streamed into archive through pipe.
+ * \param writer [in] Log archive.
+ * \param mtime  [in] Modification time of the entry.
+ * \return Value is zero, if process is succeed.<br />
+ *         Value is error number a.k.a. "errno", if failure to write archive.
+ */
+int TLogManager::addJournalToArchive(TZipStreamWriter *writer, time_t mtime) {
+  int pipeFd[2];
+  if (unlikely(pipe2(pipeFd, O_CLOEXEC) != 0)) {
+    logger->printWarnMsgWithErrno(
+        "Could not collect systemd-journald log by pipe().");
+    return 0;
+  }
+
+  /* Select vfork() as copyInfoFiles(). */
+  pid_t child = vfork();
+  if (child == 0) {
+    /* Child process */
+    /* Redirect child process' stdout/stderr to pipe. */
+    if ((dup2(pipeFd[1], 1) < 0) || (dup2(pipeFd[1], 2) < 0)) {
+      _exit(errno);
+    }
+
+    /* Use execve() for journalctl to prevent command injection */
+    const char *argv[] = {"journalctl", "-q", "--all",   "--this-boot",
+                          "--no-pager", "-o", "verbose", NULL};
+    extern char **environ;
+    execve("/bin/journalctl", (char *const *)argv, environ);
+    /* if execve returns, it has failed */
+    _exit(errno);
+  }
+
+  close(pipeFd[1]);
+  if (unlikely(child < 0)) {
+    /* vfork failed */
+    logger->printWarnMsgWithErrno(
+        "Could not collect systemd-journald log by vfork().");
+    close(pipeFd[0]);
+    return 0;
+  }
+
+  /* Parent process */
+  int result = writer->addFromFd(pipeFd[0], JOURNAL_LOG_NAME, mtime);
+  close(pipeFd[0]);
+
+  int status;
+  if (unlikely(waitpid(child, &status, 0) < 0)) {
+    logger->printWarnMsgWithErrno(
+        "Could not collect systemd-journald log by process error.");
+  } else if (unlikely(!WIFEXITED(status) || (WEXITSTATUS(status) != 0))) {
+    logger->printWarnMsg("Could not collect systemd-journald log.");
+  }
+
+  return result;
+}
+
 /*!
  * \brief Copy GC log file.
  * \param basePath [in] Path of temporary directory.
@@ -1361,6 +2300,27 @@ int TLogManager::makeSocketOwnerFile(char const *basePath) {
     return result;
   }
 
+  /* Output i-node numbers. */
+  result = writeSocketOwnerFile(fd);
+
+  /* Cleanup. */
+  if (unlikely(close(fd) != 0 && result == 0)) {
+    result = errno;
+    logger->printWarnMsgWithErrno("Could not close socket owner.");
+  }
+
+  return result;
+}
+
+/*!
+ * \brief Write i-node numbers of sockets which are used by JVM to stream.
+ * \param fd [in] Output file descriptor.
+ * \return Value is zero, if process is succeed.<br />
+ *         Value is error number a.k.a. "errno", if process is failure.
+ */
+int TLogManager::writeSocketOwnerFile(int fd) {
+  int result = 0;
+
   /* Open directory. */
   DIR *dir = opendir("/proc/self/fd");
 
@@ -1368,7 +2328,6 @@ int TLogManager::makeSocketOwnerFile(char const *basePath) {
   if (unlikely(dir == NULL)) {
     result = errno;
     logger->printWarnMsgWithErrno("Could not open directory: /proc/self/fd");
-    close(fd);
     return result;
   }
 
@@ -1409,14 +2368,78 @@ int TLogManager::makeSocketOwnerFile(char const *basePath) {
     }
   }
 
-  /* If failure in read directory. */
-  if (unlikely(close(fd) != 0 && result == 0)) {
+  /* Cleanup. */
+  closedir(dir);
+
+  return result;
+}
+
+/*!
+ * \brief Create file about summary of memory map.
+ * \param basePath [in] Path of directory put report file.
+ * \return Value is zero, if process is succeed.<br />
+ *         Value is error number a.k.a. "errno", if process is failure.
+ */
+int TLogManager::makeMemMapFile(char const *basePath) {
+  int result = 0;
+
+  /* Create filename. */
+  char *summaryName = createFilename(basePath, MEMMAP_SUMMARY_NAME);
+  /* If failure create file name. */
+  if (unlikely(summaryName == NULL)) {
     result = errno;
-    logger->printWarnMsgWithErrno("Could not close socket owner.");
+    logger->printWarnMsg("Couldn't allocate filename.");
+    return result;
+  }
+
+  /* Create memory map summary. */
+  int fd = open(summaryName, O_CREAT | O_WRONLY | O_EXCL, S_IRUSR | S_IWUSR);
+  free(summaryName);
+  if (unlikely(fd < 0)) {
+    result = errno;
+    logger->printWarnMsgWithErrno("Could not open memory map summary.");
+
+    return result;
   }
 
+  /* Output summary. */
+  result = writeMemMapFile(fd);
+
   /* Cleanup. */
-  closedir(dir);
+  if (unlikely(close(fd) != 0 && result == 0)) {
+    result = errno;
+    logger->printWarnMsgWithErrno("Could not close memory map summary.");
+  }
+
+  return result;
+}
+
+/*!
+ * \brief Write summary of memory map to stream.<br>
+ *        smaps is aggregated by category of mapping, so the summary is
+ *        small even if JVM has a lot of mappings.
+ * \param fd [in] Output file descriptor.
+ * \return Value is zero, if process is succeed.<br />
+ *         Value is error number a.k.a. "errno", if process is failure.
+ */
+int TLogManager::writeMemMapFile(int fd) {
+  int result = 0;
+
+  try {
+    TMemMapSummary summary;
+
+    result = summary.collect();
+    if (likely(result == 0)) {
+      result = summary.write(fd);
+      if (unlikely(result != 0)) {
+        errno = result;
+        logger->printWarnMsgWithErrno("Could not write memory map summary.");
+      }
+    }
+  } catch (int errNum) {
+    result = errNum;
+    logger->printWarnMsg("Failure allocate working memory.");
+  }
 
   return result;
 }
@@ -22,13 +22,20 @@
 #ifndef _LOG_MANAGER_H
 #define _LOG_MANAGER_H
 
+#include <pthread.h>
+
 #include <queue>
 
+#include "asyncWriter.hpp"
+#include "bufferedFdWriter.hpp"
 #include "cmdArchiver.hpp"
 #include "jniZipArchiver.hpp"
 #include "jvmSockCmd.hpp"
 #include "jvmInfo.hpp"
+#include "methodInfoCache.hpp"
+#include "resourceLog.hpp"
 #include "util.hpp"
+#include "zipStreamWriter.hpp"
 
 /*!
  * \brief This structure is used to get and store machine cpu time.
@@ -45,6 +52,38 @@ typedef struct {
   TLargeUInt guestTime;   /*!< Time used by guest OS under kernel control. */
 } TMachineTimes;
 
+/*!
+ * \brief Stages of collecting all log which run in parallel.<br>
+ *        Thread dump is not included because it is made in the caller
+ *        thread which is able to use JVMTI.
+ */
+typedef enum {
+  LOG_STAGE_ENVIRON,      /*!< envInfo.txt                     */
+  LOG_STAGE_INFO_FILES,   /*!< Files in /proc, /etc and syslog */
+  LOG_STAGE_GC_LOG,       /*!< GC log                          */
+  LOG_STAGE_SOCKET_OWNER, /*!< sockowner                       */
+  LOG_STAGE_MEMORY_MAP,   /*!< smaps or its summary            */
+  LOG_STAGE_NUM           /*!< Number of stages.               */
+} TLogStageKind;
+
+class TLogManager;
+
+/*!
+ * \brief This structure is used to run a stage of collecting all log.
+ */
+typedef struct {
+  TLogManager *manager;     /*!< Log manager.                              */
+  TLogStageKind kind;       /*!< Kind of this stage.                       */
+  TInvokeCause cause;       /*!< Invoke function cause.                    */
+  TMSecTime nowTime;        /*!< Log collect time.                         */
+  const char *description;  /*!< Description of the event.                 */
+  const char *basePath;     /*!< Working directory, or NULL.               */
+  TZipStreamWriter *writer; /*!< Part of archive if basePath is NULL.      */
+  int result;               /*!< Result of this stage.                     */
+  pthread_t thread;         /*!< Thread which runs this stage.             */
+  bool isStarted;           /*!< Is this stage run in other thread?        */
+} TLogStage;
+
 /*!
  * \brief This class collect and make log.
  */
@@ -108,6 +147,82 @@ class TLogManager {
 
   RELEASE_ONLY(private :)
 
+  /*!
+   * \brief Initialize stages of collecting all log.
+   * \param stages      [out] Array of LOG_STAGE_NUM stages.
+   * \param cause       [in]  Invoke function cause.<br>
+   *                          E.g. ResourceExhausted, Signal, Interval.
+   * \param nowTime     [in]  Log collect time.
+   * \param description [in]  Description of the event.
+   * \param basePath    [in]  Working directory, or NULL to make parts of
+   *                          archive.
+   */
+  virtual void initLogStages(TLogStage *stages, TInvokeCause cause,
+                             TMSecTime nowTime, const char *description,
+                             const char *basePath);
+
+  /*!
+   * \brief Start all stages of collecting all log in parallel.
+   * \param stages [in] Array of LOG_STAGE_NUM stages.
+   */
+  virtual void startLogStages(TLogStage *stages);
+
+  /*!
+   * \brief Wait for all stages of collecting all log.
+   * \param stages [in] Array of LOG_STAGE_NUM stages.
+   */
+  virtual void joinLogStages(TLogStage *stages);
+
+  /*!
+   * \brief Run a stage of collecting all log.
+   * \param stage [in] Stage to run.
+   * \return Value is zero, if process is succeed.<br />
+   *         Value is error number a.k.a. "errno", if process is failure.
+   */
+  virtual int runLogStage(TLogStage *stage);
+
+  /*!
+   * \brief Entry point of thread which runs a stage of collecting all log.
+   * \param data [in] Stage to run.
+   * \return Always NULL.
+   */
+  static void *logStageEntryPoint(void *data);
+
+  /*!
+   * \brief Collect all log to archive directly without working directory.
+   * \param jvmti       [in]  JVMTI environment object.
+   * \param env         [in]  JNI environment object.
+   * \param cause       [in]  Invoke function cause.<br>
+   *                          E.g. ResourceExhausted, Signal, Interval.
+   * \param nowTime     [in]  Log collect time.
+   * \param archivePath [out] Archive file path.
+   * \param pathLen     [in]  Max size of paramter"archivePath".
+   * \param description [in]  Description of the event.
+   * \return Value is zero, if process is succeed.<br />
+   *         Value is error number a.k.a. "errno", if process is failure.
+   */
+  virtual int collectAllLogDirectly(jvmtiEnv *jvmti, JNIEnv *env,
+                                    TInvokeCause cause, TMSecTime nowTime,
+                                    char *archivePath, size_t pathLen,
+                                    const char *description);
+
+  /*!
+   * \brief Write all log to archive file.
+   * \param jvmti       [in] JVMTI environment object.
+   * \param env         [in] JNI environment object.
+   * \param cause       [in] Invoke function cause.<br>
+   *                         E.g. ResourceExhausted, Signal, Interval.
+   * \param nowTime     [in] Log collect time.
+   * \param archiveFile [in] Path of archive file.
+   * \param description [in] Description of the event.
+   * \return Value is zero, if process is succeed.<br />
+   *         Value is error number a.k.a. "errno", if process is failure.
+   */
+  virtual int writeAllLogToArchive(jvmtiEnv *jvmti, JNIEnv *env,
+                                   TInvokeCause cause, TMSecTime nowTime,
+                                   const char *archiveFile,
+                                   const char *description);
+
   /*!
    * \brief Create file about JVM running environment.
    * \param basePath [in] Path of directory put report file.
@@ -121,16 +236,30 @@ class TLogManager {
   virtual int makeEnvironFile(char *basePath, TInvokeCause cause,
                               TMSecTime nowTime, const char *description);
 
+  /*!
+   * \brief Write information about JVM running environment to stream.
+   * \param fd          [in] Output file descriptor.
+   * \param cause       [in] Invoke function cause.<br>
+   *                         E.g. Signal, ResourceExhausted, Interval.
+   * \param nowTime     [in] Log collect time.
+   * \param description [in] Description of the event.
+   * \return Value is zero, if process is succeed.<br />
+   *         Value is error number a.k.a. "errno", if process is failure.
+   */
+  virtual int writeEnvironFile(int fd, TInvokeCause cause, TMSecTime nowTime,
+                               const char *description);
+
   /*!
    * \brief Dump thread and stack information to stream.
    * \param jvmti     [in] JVMTI environment object.
    * \param env       [in] JNI environment object.
-   * \param fd        [in] Output file descriptor.
+   * \param out       [in] Buffered output stream.
    * \param stackInfo [in] Stack frame of java thread.
    * \return Value is zero, if process is succeed.<br />
    *         Value is error number a.k.a. "errno", if process is failure.
    */
-  virtual int dumpThreadInformation(jvmtiEnv *jvmti, JNIEnv *env, int fd,
+  virtual int dumpThreadInformation(jvmtiEnv *jvmti, JNIEnv *env,
+                                    TBufferedFdWriter *out,
                                     jvmtiStackInfo stackInfo);
 
   /*!
@@ -145,6 +274,16 @@ class TLogManager {
   virtual int makeJvmtiThreadDump(jvmtiEnv *jvmti, JNIEnv *env, char *filename,
                                   TMSecTime nowTime);
 
+  /*!
+   * \brief Write thread dump with JVMTI to stream.
+   * \param jvmti [in] JVMTI environment object.
+   * \param env   [in] JNI environment object.
+   * \param fd    [in] Output file descriptor.
+   * \return Value is zero, if process is succeed.<br />
+   *         Value is error number a.k.a. "errno", if process is failure.
+   */
+  virtual int writeJvmtiThreadDump(jvmtiEnv *jvmti, JNIEnv *env, int fd);
+
   /*!
    * \brief Create thread dump file.
    * \param jvmti    [in] JVMTI environment object.
@@ -159,6 +298,51 @@ class TLogManager {
   virtual int makeThreadDumpFile(jvmtiEnv *jvmti, JNIEnv *env, char *basePath,
                                  TInvokeCause cause, TMSecTime nowTime);
 
+  /*!
+   * \brief Write thread dump to stream.
+   * \param jvmti [in] JVMTI environment object.
+   * \param env   [in] JNI environment object.
+   * \param fd    [in] Output file descriptor.
+   * \param cause [in] Invoke function cause.<br>
+   *                   E.g. Signal, ResourceExhausted, Interval.
+   * \return Value is zero, if process is succeed.<br />
+   *         Value is error number a.k.a. "errno", if process is failure.
+   */
+  virtual int writeThreadDump(jvmtiEnv *jvmti, JNIEnv *env, int fd,
+                              TInvokeCause cause);
+
+  /*!
+   * \brief Open /proc file which is re-read at each collecting normal log.
+   * \param fd   [in,out] File descriptor of /proc file.
+   * \param path [in]     Path of /proc file.
+   * \return Value is true, if file descriptor is available.
+   */
+  virtual bool openProcFile(int *fd, const char *path);
+
+  /*!
+   * \brief Get writer of heap log file.<br>
+   *        The file is kept opening until its path is changed.
+   * \return Writer of heap log file.<br>
+   *         Value is null, if process is failure.
+   * \warning Caller must hold logMutex.
+   */
+  virtual TAsyncFile *getHeapLogWriter(void);
+
+  /*!
+   * \brief Close heap log file after in-flight record is written.
+   * \warning Caller must hold logMutex.
+   */
+  virtual void closeHeapLog(void);
+
+  /*!
+   * \brief Get binary resource log.<br>
+   *        The log is kept mapping until its path or size is changed.
+   * \return Binary resource log.<br>
+   *         Value is null, if process is failure.
+   * \warning Caller must hold logMutex.
+   */
+  virtual TResourceLog *getResourceLog(void);
+
   /*!
    * \brief Getting java process information.
    * \param systime [out] System used cpu time in java process.
@@ -197,6 +381,24 @@ class TLogManager {
    */
   virtual int copyInfoFiles(char const *basePath);
 
+  /*!
+   * \brief Add files about JVM enviroment to log archive.
+   * \param writer [in] Log archive.
+   * \param mtime  [in] Modification time of generated entries.
+   * \return Value is zero, if process is succeed.<br />
+   *         Value is error number a.k.a. "errno", if failure to write archive.
+   */
+  virtual int addInfoFilesToArchive(TZipStreamWriter *writer, time_t mtime);
+
+  /*!
+   * \brief Add systemd-journald log to log archive.
+   * \param writer [in] Log archive.
+   * \param mtime  [in] Modification time of the entry.
+   * \return Value is zero, if process is succeed.<br />
+   *         Value is error number a.k.a. "errno", if failure to write archive.
+   */
+  virtual int addJournalToArchive(TZipStreamWriter *writer, time_t mtime);
+
   /*!
    * \brief Copy GC log file.
    * \param basePath [in] Path of temporary directory.
@@ -213,6 +415,30 @@ class TLogManager {
    */
   virtual int makeSocketOwnerFile(char const *basePath);
 
+  /*!
+   * \brief Write i-node numbers of sockets which are used by JVM to stream.
+   * \param fd [in] Output file descriptor.
+   * \return Value is zero, if process is succeed.<br />
+   *         Value is error number a.k.a. "errno", if process is failure.
+   */
+  virtual int writeSocketOwnerFile(int fd);
+
+  /*!
+   * \brief Create file about summary of memory map.
+   * \param basePath [in] Path of directory put report file.
+   * \return Value is zero, if process is succeed.<br />
+   *         Value is error number a.k.a. "errno", if process is failure.
+   */
+  virtual int makeMemMapFile(char const *basePath);
+
+  /*!
+   * \brief Write summary of memory map to stream.
+   * \param fd [in] Output file descriptor.
+   * \return Value is zero, if process is succeed.<br />
+   *         Value is error number a.k.a. "errno", if process is failure.
+   */
+  virtual int writeMemMapFile(int fd);
+
   /*!
    * \brief Create archive file path.
    * \param nowTime [in] Log collect time.
@@ -232,6 +458,11 @@ class TLogManager {
    */
   static pthread_mutex_t archiveMutex;
 
+  /*!
+   * \brief Mutex of JVMTI thread dump and method information cache.
+   */
+  static pthread_mutex_t threadDumpMutex;
+
   /*!
    * \brief Archive file maker.
    */
@@ -256,6 +487,42 @@ class TLogManager {
    * \brief Pointer of string of GC log file path.
    */
   char **gcLogFilename;
+
+  /*!
+   * \brief File descriptor of process status file (/proc/self/stat).
+   */
+  int procStatFd;
+
+  /*!
+   * \brief File descriptor of machine status file (/proc/stat).
+   */
+  int sysStatFd;
+
+  /*!
+   * \brief File descriptor of heap log file.
+   */
+  int heapLogFd;
+
+  /*!
+   * \brief Writer of heap log file.<br>
+   *        A record is written while next record is collected.
+   */
+  TAsyncFile *heapLogWriter;
+
+  /*!
+   * \brief Path of heap log file which is opened as heapLogFd.
+   */
+  char *heapLogPath;
+
+  /*!
+   * \brief Binary resource log which is used when heaplog_binary is true.
+   */
+  TResourceLog *resourceLog;
+
+  /*!
+   * \brief Cache of method information which is shared by thread dumps.
+   */
+  TMethodInfoCache *methodInfoCache;
 };
 
 #endif  // _LOG_MANAGER_H
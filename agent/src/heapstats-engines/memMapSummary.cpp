@@ -0,0 +1,368 @@
+/*!
+ * \file memMapSummary.cpp
+ * \brief This file is used to summarize memory map of JVM process.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "globals.hpp"
+#include "vmVariables.hpp"
+#include "memMapSummary.hpp"
+
+/*!
+ * \brief Names of categories.
+ */
+static const char *categoryNames[MEMMAP_CATEGORY_NUM] = {
+    "Java heap", "Metaspace", "Code cache", "Thread stacks",
+    "Malloc arenas", "Libraries", "Other"};
+
+/*!
+ * \brief TMemMapSummary constructor.
+ */
+TMemMapSummary::TMemMapSummary(void) {
+  buffer = (char *)malloc(MEMMAP_BUFFER_SIZE);
+  if (unlikely(buffer == NULL)) {
+    throw ENOMEM;
+  }
+
+  heapStart = 0;
+  heapEnd = 0;
+  classSpaceAddr = 0;
+
+  /* Ranges of Java heap and class space are known by JVM. */
+  TVMVariables *vmVal = TVMVariables::getInstance();
+  if (likely(vmVal != NULL)) {
+    heapStart = (uintptr_t)vmVal->getHeapStartAddr();
+    heapEnd = heapStart + vmVal->getHeapSize();
+
+    if (vmVal->getIsCOOP()) {
+      /*
+       * Compressed class space is placed just after Java heap if
+       * narrow klass base is zero.
+       */
+      classSpaceAddr = (vmVal->getNarrowKlassOffsetBase() != 0)
+                           ? (uintptr_t)vmVal->getNarrowKlassOffsetBase()
+                           : heapEnd;
+    }
+  }
+
+  reset();
+}
+
+/*!
+ * \brief TMemMapSummary destructor.
+ */
+TMemMapSummary::~TMemMapSummary(void) { free(buffer); }
+
+/*!
+ * \brief Get name of category.
+ * \param category [in] Category of mappings.
+ * \return Name of category.
+ */
+const char *TMemMapSummary::getCategoryName(TMemMapCategory category) {
+  return categoryNames[category];
+}
+
+/*!
+ * \brief Reset aggregated values.
+ */
+void TMemMapSummary::reset(void) {
+  memset(usage, 0, sizeof(usage));
+  current = -1;
+  prevEnd = 0;
+  prevGuardSize = 0;
+  arenaEnd = 0;
+}
+
+/*!
+ * \brief Read /proc/self/smaps and aggregate it.<br>
+ *        smaps is read through fixed buffer line by line, so memory usage
+ *        does not depend on the number of mappings.
+ * \return Value is zero, if process is succeed.<br />
+ *         Value is error number a.k.a. "errno", if process is failure.
+ */
+int TMemMapSummary::collect(void) {
+  reset();
+
+  int fd = open("/proc/self/smaps", O_RDONLY);
+  if (unlikely(fd < 0)) {
+    int raisedErrNum = errno;
+    logger->printWarnMsgWithErrno("Could not open /proc/self/smaps");
+    return raisedErrNum;
+  }
+
+  int result = 0;
+  size_t len = 0;
+  while (true) {
+    ssize_t readSize = read(fd, buffer + len, MEMMAP_BUFFER_SIZE - 1 - len);
+    if (unlikely(readSize < 0)) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      result = errno;
+      logger->printWarnMsgWithErrno("Could not read /proc/self/smaps");
+      break;
+    } else if (readSize == 0) {
+      /* Parse the last line which does not have line feed. */
+      if (len > 0) {
+        buffer[len] = '\0';
+        parseLine(buffer);
+      }
+      break;
+    }
+
+    len += readSize;
+    buffer[len] = '\0';
+
+    /* Parse all complete lines. */
+    char *line = buffer;
+    char *lineEnd;
+    while ((lineEnd = strchr(line, '\n')) != NULL) {
+      *lineEnd = '\0';
+      parseLine(line);
+      line = lineEnd + 1;
+    }
+
+    /* Keep incomplete line for next read. */
+    len -= (line - buffer);
+    if (unlikely(len >= MEMMAP_BUFFER_SIZE - 1)) {
+      /* Too long line. It is not a line which should be parsed. */
+      len = 0;
+    } else {
+      memmove(buffer, line, len);
+    }
+  }
+
+  close(fd);
+  return result;
+}
+
+/*!
+ * \brief Parse a line of smaps.<br>
+ *        Header of mapping starts with hexadecimal address, and field of
+ *        mapping starts with capitalized name.
+ * \param line [in] A line without line feed.
+ */
+void TMemMapSummary::parseLine(char *line) {
+  if ((*line >= 'A') && (*line <= 'Z')) {
+    if (unlikely(current < 0)) {
+      return;
+    }
+
+    jlong *target;
+    if (strncmp(line, "Rss:", 4) == 0) {
+      target = &usage[current].rss;
+    } else if (strncmp(line, "Pss:", 4) == 0) {
+      target = &usage[current].pss;
+    } else if (strncmp(line, "Swap:", 5) == 0) {
+      target = &usage[current].swap;
+    } else {
+      return;
+    }
+
+    char *value = strchr(line, ':');
+    *target += strtoll(value + 1, NULL, 10);
+    return;
+  }
+
+  unsigned long start;
+  unsigned long end;
+  char perms[8];
+  unsigned long inode;
+  int pathPos = 0;
+  if (unlikely(sscanf(line, "%lx-%lx %7s %*x %*s %lu %n", &start, &end, perms,
+                      &inode, &pathPos) < 4)) {
+    return;
+  }
+
+  TMemMapCategory category = classify(start, end, perms, inode,
+                                      (pathPos > 0) ? line + pathPos : "");
+  usage[category].mappings++;
+  usage[category].size += (end - start) / 1024;
+
+  /* Keep state of this mapping to classify next mapping. */
+  current = category;
+  prevEnd = end;
+  prevGuardSize = ((inode == 0) && (strncmp(perms, "---", 3) == 0))
+                      ? end - start
+                      : 0;
+}
+
+/*!
+ * \brief Decide category of mapping.<br>
+ *        Anonymous mappings are classified by heuristics:
+ *        <ul>
+ *        <li>Executable mapping is code cache.</li>
+ *        <li>Mapping which is aligned to arena size of glibc, and mappings
+ *            in it are malloc arena.</li>
+ *        <li>Writable mapping just above small inaccessible mapping (guard
+ *            pages) is thread stack.</li>
+ *        </ul>
+ * \param start [in] Start address of mapping.
+ * \param end   [in] End address of mapping.
+ * \param perms [in] Permission string, e.g. "rw-p".
+ * \param inode [in] Inode of mapped file.
+ * \param path  [in] Path or name of mapping. It might be empty string.
+ * \return Category of mapping.
+ */
+TMemMapCategory TMemMapSummary::classify(uintptr_t start, uintptr_t end,
+                                         const char *perms,
+                                         unsigned long inode,
+                                         const char *path) {
+  /* "current" is still category of the previous mapping. */
+  bool isAdjacent = (start == prevEnd);
+
+  if ((start < heapEnd) && (end > heapStart)) {
+    return MEMMAP_JAVA_HEAP;
+  }
+
+  /* Class space is reserved as contiguous mappings. */
+  if ((classSpaceAddr != 0) &&
+      (((start <= classSpaceAddr) && (classSpaceAddr < end)) ||
+       (isAdjacent && (current == MEMMAP_METASPACE) && (inode == 0) &&
+        (*path == '\0')))) {
+    return MEMMAP_METASPACE;
+  }
+
+  if ((inode != 0) || (*path == '/')) {
+    return MEMMAP_LIBRARY;
+  }
+
+  if (*path == '[') {
+    if (strcmp(path, "[heap]") == 0) {
+      return MEMMAP_MALLOC_ARENA;
+    } else if (strncmp(path, "[stack", 6) == 0) {
+      return MEMMAP_THREAD_STACK;
+    }
+
+    return MEMMAP_OTHER;
+  }
+
+  if (perms[2] == 'x') {
+    return MEMMAP_CODE_CACHE;
+  }
+
+  if ((start < arenaEnd) && isAdjacent && (current == MEMMAP_MALLOC_ARENA)) {
+    return MEMMAP_MALLOC_ARENA;
+  }
+
+  if ((perms[0] == 'r') && (perms[1] == 'w')) {
+    if (((start & (MEMMAP_ARENA_SIZE - 1)) == 0) &&
+        ((end - start) <= MEMMAP_ARENA_SIZE)) {
+      arenaEnd = start + MEMMAP_ARENA_SIZE;
+      return MEMMAP_MALLOC_ARENA;
+    }
+
+    if (isAdjacent && (prevGuardSize > 0) &&
+        (prevGuardSize <= MEMMAP_MAX_GUARD_SIZE)) {
+      return MEMMAP_THREAD_STACK;
+    }
+  }
+
+  return MEMMAP_OTHER;
+}
+
+/*!
+ * \brief Write summary and smaps_rollup to file.
+ * \param fd [in] FD of output.
+ * \return Value is zero, if process is succeed.<br />
+ *         Value is error number a.k.a. "errno", if process is failure.
+ */
+int TMemMapSummary::write(int fd) {
+  char line[256];
+  TMemMapUsage total = {0};
+
+  snprintf(line, sizeof(line), "%-16s %10s %14s %14s %14s %14s\n",
+           "Category", "Mappings", "Size(KB)", "Rss(KB)", "Pss(KB)",
+           "Swap(KB)");
+  if (unlikely(::write(fd, line, strlen(line)) < 0)) {
+    return errno;
+  }
+
+  for (int i = 0; i <= MEMMAP_CATEGORY_NUM; i++) {
+    const TMemMapUsage *target = &total;
+    const char *name = "Total";
+
+    if (i < MEMMAP_CATEGORY_NUM) {
+      target = &usage[i];
+      name = categoryNames[i];
+
+      total.mappings += target->mappings;
+      total.size += target->size;
+      total.rss += target->rss;
+      total.pss += target->pss;
+      total.swap += target->swap;
+    }
+
+    snprintf(line, sizeof(line), "%-16s %10lld %14lld %14lld %14lld %14lld\n",
+             name, (long long)target->mappings, (long long)target->size,
+             (long long)target->rss, (long long)target->pss,
+             (long long)target->swap);
+    if (unlikely(::write(fd, line, strlen(line)) < 0)) {
+      return errno;
+    }
+  }
+
+  /* Append smaps_rollup which is available since Linux 4.14. */
+  int rollupFd = open("/proc/self/smaps_rollup", O_RDONLY);
+  if (rollupFd < 0) {
+    return 0;
+  }
+
+  int result = 0;
+  const char *title = "\n/proc/self/smaps_rollup:\n";
+  if (unlikely(::write(fd, title, strlen(title)) < 0)) {
+    result = errno;
+  }
+
+  ssize_t readSize;
+  while (likely(result == 0) &&
+         ((readSize = read(rollupFd, buffer, MEMMAP_BUFFER_SIZE)) != 0)) {
+    if (unlikely(readSize < 0)) {
+      if (errno != EINTR) {
+        result = errno;
+      }
+    } else if (unlikely(::write(fd, buffer, readSize) < 0)) {
+      result = errno;
+    }
+  }
+
+  close(rollupFd);
+  return result;
+}
+
+/*!
+ * \brief Output summary to log.
+ */
+void TMemMapSummary::print(void) {
+  logger->printInfoMsg("Memory map summary (KB):");
+  for (int i = 0; i < MEMMAP_CATEGORY_NUM; i++) {
+    logger->printInfoMsg("  %-16s mappings = %lld, size = %lld, "
+                         "rss = %lld, pss = %lld, swap = %lld",
+                         categoryNames[i], (long long)usage[i].mappings,
+                         (long long)usage[i].size, (long long)usage[i].rss,
+                         (long long)usage[i].pss, (long long)usage[i].swap);
+  }
+}
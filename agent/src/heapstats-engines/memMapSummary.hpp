@@ -0,0 +1,200 @@
+/*!
+ * \file memMapSummary.hpp
+ * \brief This file is used to summarize memory map of JVM process.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#ifndef MEM_MAP_SUMMARY_HPP
+#define MEM_MAP_SUMMARY_HPP
+
+#include <jni.h>
+
+#include <stdint.h>
+#include <sys/types.h>
+
+/*!
+ * \brief Size of buffer for reading smaps.
+ */
+#define MEMMAP_BUFFER_SIZE 65536
+
+/*!
+ * \brief Max size of a malloc arena.<br>
+ *        Arena of glibc is aligned to this size (HEAP_MAX_SIZE).
+ */
+#ifdef __LP64__
+#define MEMMAP_ARENA_SIZE (64UL * 1024 * 1024)
+#else
+#define MEMMAP_ARENA_SIZE (1UL * 1024 * 1024)
+#endif
+
+/*!
+ * \brief Max size of guard area which is placed below a thread stack.
+ */
+#define MEMMAP_MAX_GUARD_SIZE (1UL * 1024 * 1024)
+
+/*!
+ * \brief Categories of memory mappings.
+ */
+typedef enum {
+  MEMMAP_JAVA_HEAP = 0, /*!< Reserved region of Java heap.             */
+  MEMMAP_METASPACE,     /*!< Compressed class space of Metaspace.      */
+  MEMMAP_CODE_CACHE,    /*!< Executable anonymous mappings.            */
+  MEMMAP_THREAD_STACK,  /*!< Anonymous mappings above guard area.      */
+  MEMMAP_MALLOC_ARENA,  /*!< [heap] and arenas of glibc malloc.        */
+  MEMMAP_LIBRARY,       /*!< File-backed mappings (libraries, jars).   */
+  MEMMAP_OTHER,         /*!< Other anonymous and special mappings.     */
+  MEMMAP_CATEGORY_NUM   /*!< Number of categories.                     */
+} TMemMapCategory;
+
+/*!
+ * \brief Usage of memory mappings in a category. Sizes are in KB.
+ */
+typedef struct {
+  jlong mappings; /*!< Number of mappings.            */
+  jlong size;     /*!< Virtual size.                  */
+  jlong rss;      /*!< Resident set size.             */
+  jlong pss;      /*!< Proportional set size.         */
+  jlong swap;     /*!< Swapped out size.              */
+} TMemMapUsage;
+
+/*!
+ * \brief This class aggregates /proc/self/smaps by category of mapping
+ *        in a single streaming pass.<br>
+ *        Raw smaps of JVM might be tens of MB, so only the summary and
+ *        /proc/self/smaps_rollup (if the kernel has it) are written.
+ */
+class TMemMapSummary {
+ public:
+  /*!
+   * \brief TMemMapSummary constructor.
+   */
+  TMemMapSummary(void);
+
+  /*!
+   * \brief TMemMapSummary destructor.
+   */
+  virtual ~TMemMapSummary(void);
+
+  /*!
+   * \brief Read /proc/self/smaps and aggregate it.
+   * \return Value is zero, if process is succeed.<br />
+   *         Value is error number a.k.a. "errno", if process is failure.
+   */
+  int collect(void);
+
+  /*!
+   * \brief Write summary and smaps_rollup to file.
+   * \param fd [in] FD of output.
+   * \return Value is zero, if process is succeed.<br />
+   *         Value is error number a.k.a. "errno", if process is failure.
+   */
+  int write(int fd);
+
+  /*!
+   * \brief Output summary to log.
+   */
+  void print(void);
+
+  /*!
+   * \brief Get usage of category.
+   * \param category [in] Category of mappings.
+   * \return Aggregated usage.
+   */
+  inline const TMemMapUsage *getUsage(TMemMapCategory category) {
+    return &usage[category];
+  };
+
+  /*!
+   * \brief Get name of category.
+   * \param category [in] Category of mappings.
+   * \return Name of category.
+   */
+  static const char *getCategoryName(TMemMapCategory category);
+
+ private:
+  /*!
+   * \brief Buffer for reading smaps.
+   */
+  char *buffer;
+
+  /*!
+   * \brief Aggregated usage of each category.
+   */
+  TMemMapUsage usage[MEMMAP_CATEGORY_NUM];
+
+  /*!
+   * \brief Start address of reserved Java heap.
+   */
+  uintptr_t heapStart;
+
+  /*!
+   * \brief End address of reserved Java heap.
+   */
+  uintptr_t heapEnd;
+
+  /*!
+   * \brief Address in compressed class space, or 0 if it is unknown.
+   */
+  uintptr_t classSpaceAddr;
+
+  /*!
+   * \brief Category of the current mapping, or -1 before first mapping.
+   */
+  int current;
+
+  /*!
+   * \brief End address of the previous mapping.
+   */
+  uintptr_t prevEnd;
+
+  /*!
+   * \brief Size of the previous mapping if it is inaccessible anonymous
+   *        mapping, or 0.
+   */
+  uintptr_t prevGuardSize;
+
+  /*!
+   * \brief End of malloc arena which the previous mapping belongs to.
+   */
+  uintptr_t arenaEnd;
+
+  /*!
+   * \brief Reset aggregated values.
+   */
+  void reset(void);
+
+  /*!
+   * \brief Parse a line of smaps.
+   * \param line [in] A line without line feed.
+   */
+  void parseLine(char *line);
+
+  /*!
+   * \brief Decide category of mapping.
+   * \param start [in] Start address of mapping.
+   * \param end   [in] End address of mapping.
+   * \param perms [in] Permission string, e.g. "rw-p".
+   * \param inode [in] Inode of mapped file.
+   * \param path  [in] Path or name of mapping. It might be empty string.
+   * \return Category of mapping.
+   */
+  TMemMapCategory classify(uintptr_t start, uintptr_t end, const char *perms,
+                           unsigned long inode, const char *path);
+};
+
+#endif  // MEM_MAP_SUMMARY_HPP
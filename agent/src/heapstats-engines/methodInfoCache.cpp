@@ -0,0 +1,192 @@
+/*!
+ * \file methodInfoCache.cpp
+ * \brief This file is used to cache resolved information of Java methods.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "globals.hpp"
+#include "methodInfoCache.hpp"
+
+/*!
+ * \brief TMethodInfoCache constructor.
+ */
+TMethodInfoCache::TMethodInfoCache(void) : cache() { unloadedClasses = -1; }
+
+/*!
+ * \brief TMethodInfoCache destructor.
+ */
+TMethodInfoCache::~TMethodInfoCache(void) { clear(); }
+
+/*!
+ * \brief Discard all entries.
+ */
+void TMethodInfoCache::clear(void) {
+  for (std::tr1::unordered_map<jmethodID, TMethodInfo *,
+                               TNumericalHasher<jmethodID> >::iterator itr =
+           cache.begin();
+       itr != cache.end(); itr++) {
+    TMethodInfo *info = itr->second;
+    free(info->className);
+    free(info->methodName);
+    free(info->sourceFile);
+    free(info->lines);
+    free(info);
+  }
+
+  cache.clear();
+}
+
+/*!
+ * \brief Discard all entries if any class has been unloaded since the
+ *        last call.
+ * \param unloadedClasses [in] Total number of unloaded classes, or -1 if
+ *                             it is unknown.
+ */
+void TMethodInfoCache::validate(jlong unloadedClasses) {
+  /* Entries cannot be shared if class unloading is not observable. */
+  if ((unloadedClasses < 0) || (unloadedClasses != this->unloadedClasses)) {
+    clear();
+  }
+
+  this->unloadedClasses = unloadedClasses;
+}
+
+/*!
+ * \brief Get information of method.<br>
+ *        Information is resolved through JVMTI at the first time.
+ * \param jvmti  [in] JVMTI environment object.
+ * \param env    [in] JNI environment object.
+ * \param method [in] Method ID.
+ * \return Information of method. It is valid until validate() is called.
+ */
+const TMethodInfo *TMethodInfoCache::get(jvmtiEnv *jvmti, JNIEnv *env,
+                                         jmethodID method) {
+  std::tr1::unordered_map<jmethodID, TMethodInfo *,
+                          TNumericalHasher<jmethodID> >::iterator itr =
+      cache.find(method);
+  if (likely(itr != cache.end())) {
+    return itr->second;
+  }
+
+  TMethodInfo *info = resolve(jvmti, env, method);
+  if (likely(info != NULL)) {
+    try {
+      cache[method] = info;
+    } catch (...) {
+      /* Information cannot be cached. It is leaked to keep it valid. */
+      logger->printWarnMsg("Could not cache method information.");
+    }
+  }
+
+  return info;
+}
+
+/*!
+ * \brief Resolve information of method through JVMTI.
+ * \param jvmti  [in] JVMTI environment object.
+ * \param env    [in] JNI environment object.
+ * \param method [in] Method ID.
+ * \return Resolved information, or NULL if memory cannot be allocated.
+ */
+TMethodInfo *TMethodInfoCache::resolve(jvmtiEnv *jvmti, JNIEnv *env,
+                                       jmethodID method) {
+  TMethodInfo *info = (TMethodInfo *)calloc(1, sizeof(TMethodInfo));
+  if (unlikely(info == NULL)) {
+    return NULL;
+  }
+
+  char *tempStr = NULL;
+  jclass declareClass = NULL;
+
+  /* Get method class. */
+  if (likely(!isError(jvmti,
+                      jvmti->GetMethodDeclaringClass(method, &declareClass)))) {
+    /* Get class signature. */
+    if (likely(!isError(jvmti, jvmti->GetClassSignature(declareClass,
+                                                        &tempStr, NULL)))) {
+      info->className = strdup(tempStr);
+      jvmti->Deallocate((unsigned char *)tempStr);
+    }
+
+    /* Get source filename. */
+    if (likely(!isError(jvmti,
+                        jvmti->GetSourceFileName(declareClass, &tempStr)))) {
+      info->sourceFile = strdup(tempStr);
+      jvmti->Deallocate((unsigned char *)tempStr);
+    }
+
+    env->DeleteLocalRef(declareClass);
+  }
+
+  /* Get method name. */
+  if (likely(!isError(jvmti,
+                      jvmti->GetMethodName(method, &tempStr, NULL, NULL)))) {
+    info->methodName = strdup(tempStr);
+    jvmti->Deallocate((unsigned char *)tempStr);
+  }
+
+  /* Check method is native. */
+  jboolean isNativeMethod = JNI_TRUE;
+  jvmti->IsMethodNative(method, &isNativeMethod);
+  info->isNative = (isNativeMethod == JNI_TRUE);
+
+  /* Copy line number table to resolve line of each frame. */
+  jint entryCount = 0;
+  jvmtiLineNumberEntry *entries = NULL;
+  if (!info->isNative &&
+      likely(!isError(jvmti, jvmti->GetLineNumberTable(method, &entryCount,
+                                                       &entries)))) {
+    size_t tableSize = entryCount * sizeof(jvmtiLineNumberEntry);
+    info->lines = (jvmtiLineNumberEntry *)malloc(tableSize);
+    if (likely(info->lines != NULL)) {
+      memcpy(info->lines, entries, tableSize);
+      info->lineCount = entryCount;
+    }
+
+    jvmti->Deallocate((unsigned char *)entries);
+  }
+
+  return info;
+}
+
+/*!
+ * \brief Get line number of location in method.<br>
+ *        Line is searched same as getMethodFrameInfo().
+ * \param info     [in] Information of method.
+ * \param location [in] Location in method.
+ * \return Line number, or -1 if it is unknown.
+ */
+int TMethodInfoCache::getLineNumber(const TMethodInfo *info,
+                                    jlocation location) {
+  if (unlikely(info->lineCount <= 0)) {
+    return -1;
+  }
+
+  jint lineIdx = 0;
+  jint lastIdx = info->lineCount - 1;
+  for (; lineIdx < lastIdx; lineIdx++) {
+    if (location <= info->lines[lineIdx].start_location) {
+      break;
+    }
+  }
+
+  return info->lines[lineIdx].line_number;
+}
@@ -0,0 +1,117 @@
+/*!
+ * \file methodInfoCache.hpp
+ * \brief This file is used to cache resolved information of Java methods.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#ifndef METHOD_INFO_CACHE_HPP
+#define METHOD_INFO_CACHE_HPP
+
+#include <jvmti.h>
+#include <jni.h>
+
+#include <tr1/unordered_map>
+
+#include "util.hpp"
+
+/*!
+ * \brief Resolved information of a Java method.
+ */
+typedef struct {
+  char *className;              /*!< Signature of declaring class.        */
+  char *methodName;             /*!< Name of method.                      */
+  char *sourceFile;             /*!< Source file of declaring class.      */
+  bool isNative;                /*!< Is native method?                    */
+  jint lineCount;               /*!< Number of entries in lines.          */
+  jvmtiLineNumberEntry *lines;  /*!< Line number table, or NULL.          */
+} TMethodInfo;
+
+/*!
+ * \brief This class caches class signature, method name, source file and
+ *        line number table of each jmethodID.<br>
+ *        jmethodID of unloaded class might be reused by other method, so
+ *        all entries are discarded when the number of unloaded classes is
+ *        changed.
+ * \warning This class is not thread-safe.
+ */
+class TMethodInfoCache {
+ public:
+  /*!
+   * \brief TMethodInfoCache constructor.
+   */
+  TMethodInfoCache(void);
+
+  /*!
+   * \brief TMethodInfoCache destructor.
+   */
+  virtual ~TMethodInfoCache(void);
+
+  /*!
+   * \brief Discard all entries if any class has been unloaded since the
+   *        last call.
+   * \param unloadedClasses [in] Total number of unloaded classes, or -1 if
+   *                             it is unknown.
+   */
+  void validate(jlong unloadedClasses);
+
+  /*!
+   * \brief Get information of method.<br>
+   *        Information is resolved through JVMTI at the first time.
+   * \param jvmti  [in] JVMTI environment object.
+   * \param env    [in] JNI environment object.
+   * \param method [in] Method ID.
+   * \return Information of method. It is valid until validate() is called.
+   */
+  const TMethodInfo *get(jvmtiEnv *jvmti, JNIEnv *env, jmethodID method);
+
+  /*!
+   * \brief Get line number of location in method.
+   * \param info     [in] Information of method.
+   * \param location [in] Location in method.
+   * \return Line number, or -1 if it is unknown.
+   */
+  static int getLineNumber(const TMethodInfo *info, jlocation location);
+
+  /*!
+   * \brief Discard all entries.
+   */
+  void clear(void);
+
+ private:
+  /*!
+   * \brief Map of cached method information.
+   */
+  std::tr1::unordered_map<jmethodID, TMethodInfo *,
+                          TNumericalHasher<jmethodID> > cache;
+
+  /*!
+   * \brief Number of unloaded classes when entries are resolved.
+   */
+  jlong unloadedClasses;
+
+  /*!
+   * \brief Resolve information of method through JVMTI.
+   * \param jvmti  [in] JVMTI environment object.
+   * \param env    [in] JNI environment object.
+   * \param method [in] Method ID.
+   * \return Resolved information, or NULL if memory cannot be allocated.
+   */
+  TMethodInfo *resolve(jvmtiEnv *jvmti, JNIEnv *env, jmethodID method);
+};
+
+#endif  // METHOD_INFO_CACHE_HPP
@@ -0,0 +1,767 @@
+/*!
+ * \file metricsServer.cpp
+ * \brief This file is used to serve metrics in OpenMetrics text format
+ *        through Unix domain socket.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+#include "globals.hpp"
+#include "util.hpp"
+#include "fsUtil.hpp"
+#include "resourceLog.hpp"
+#include "threadRecorder.hpp"
+#include "metricsServer.hpp"
+
+/*!
+ * \brief Content type of OpenMetrics text format.
+ */
+#define METRICS_CONTENT_TYPE \
+  "application/openmetrics-text; version=1.0.0; charset=utf-8"
+
+/*!
+ * \brief Names of snapshot cause. Index is TInvokeCause of snapshot.
+ */
+static const char *snapShotCauseName[] = {"unknown", "gc", "dump_request",
+                                          "interval"};
+
+/*!
+ * \brief Names of TThreadEvent. Index is value of TThreadEvent.
+ */
+static const char *threadEventName[THREAD_EVENT_KINDS] = {
+    NULL,
+    "thread_start",
+    "thread_end",
+    "monitor_wait",
+    "monitor_waited",
+    "monitor_contended_enter",
+    "monitor_contended_entered",
+    "thread_sleep_start",
+    "thread_sleep_end",
+    "park",
+    "unpark",
+    "file_write_start",
+    "file_write_end",
+    "file_read_start",
+    "file_read_end",
+    "socket_write_start",
+    "socket_write_end",
+    "socket_read_start",
+    "socket_read_end"};
+
+/*!
+ * \brief Names of TIoTraceKind. Index is value of TIoTraceKind.
+ */
+static const char *ioTraceKindLabel[] = {"file_read", "file_write",
+                                         "socket_read", "socket_write"};
+
+/*!
+ * \brief Names of machine CPU time in resource log. Order is same as
+ *        columns from "sys_usr_time".
+ */
+static const char *cpuModeName[] = {"user", "nice",    "system",
+                                    "idle", "iowait",  "irq",
+                                    "softirq", "steal", "guest"};
+
+/*!
+ * \brief Singleton instance.
+ */
+TMetricsServer *TMetricsServer::inst = NULL;
+
+/*!
+ * \brief Make room in the buffer.
+ * \param size [in] Required size after the current text.
+ * \return true if the buffer has enough room.
+ */
+bool TMetricsBuffer::reserve(size_t size) {
+  if (unlikely(error)) {
+    return false;
+  }
+
+  if (likely(len + size <= capacity)) {
+    return true;
+  }
+
+  size_t newCapacity = (capacity == 0) ? 4096 : capacity;
+  while (newCapacity < len + size) {
+    newCapacity *= 2;
+  }
+
+  char *newData = (char *)realloc(data, newCapacity);
+  if (unlikely(newData == NULL)) {
+    error = true;
+    return false;
+  }
+
+  data = newData;
+  capacity = newCapacity;
+  return true;
+}
+
+/*!
+ * \brief Append formatted string.
+ * \param format [in] Format string of printf(3).
+ */
+void TMetricsBuffer::printf(const char *format, ...) {
+  /* Almost all lines are short, so the first try succeeds in most cases. */
+  size_t room = 256;
+  while (reserve(room)) {
+    va_list args;
+    va_start(args, format);
+    int ret = vsnprintf(data + len, room, format, args);
+    va_end(args);
+
+    if (unlikely(ret < 0)) {
+      return;
+    } else if (likely((size_t)ret < room)) {
+      len += ret;
+      return;
+    }
+
+    room = ret + 1;
+  }
+}
+
+/*!
+ * \brief Append label value with escaping backslash, double quote and
+ *        line feed.
+ * \param value [in] Label value.
+ */
+void TMetricsBuffer::printLabelValue(const char *value) {
+  /* Each character is escaped to 2 characters at most. */
+  if (unlikely(!reserve(strlen(value) * 2 + 1))) {
+    return;
+  }
+
+  for (const char *pos = value; *pos != '\0'; pos++) {
+    switch (*pos) {
+      case '\\':
+      case '"':
+        data[len++] = '\\';
+        data[len++] = *pos;
+        break;
+
+      case '\n':
+        data[len++] = '\\';
+        data[len++] = 'n';
+        break;
+
+      default:
+        data[len++] = *pos;
+    }
+  }
+}
+
+/*!
+ * \brief Take buffer from this instance.
+ * \param length [out] Length of text.
+ * \return Text which is allocated by malloc(3), or NULL if any error is
+ *         raised. Caller must free it.
+ */
+char *TMetricsBuffer::detach(size_t *length) {
+  char *result = error ? NULL : data;
+  *length = error ? 0 : len;
+
+  if (error) {
+    free(data);
+  }
+
+  data = NULL;
+  len = 0;
+  capacity = 0;
+  error = false;
+  return result;
+}
+
+/*!
+ * \brief TMetricsServer constructor.
+ * \param path [in] Path of Unix domain socket.
+ */
+TMetricsServer::TMetricsServer(const char *path) {
+  struct sockaddr_un addr;
+  if (unlikely(strlen(path) >= sizeof(addr.sun_path))) {
+    throw ENAMETOOLONG;
+  }
+
+  this->path = strdup(path);
+  if (unlikely(this->path == NULL)) {
+    throw errno;
+  }
+
+  if (unlikely(pipe2(wakeupFd, O_CLOEXEC) != 0)) {
+    int raisedErrNum = errno;
+    free(this->path);
+    throw raisedErrNum;
+  }
+
+  listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (unlikely(listenFd < 0)) {
+    int raisedErrNum = errno;
+    close(wakeupFd[0]);
+    close(wakeupFd[1]);
+    free(this->path);
+    throw raisedErrNum;
+  }
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+
+  /* Stale socket of previous process which had the same pid is replaced. */
+  struct stat st;
+  if ((lstat(path, &st) == 0) && S_ISSOCK(st.st_mode)) {
+    unlink(path);
+  }
+
+  int ret = bind(listenFd, (struct sockaddr *)&addr, sizeof(addr));
+  int raisedErrNum = errno;
+
+  /*
+   * Socket is accessible only by the current user.
+   * umask(2) is not used because it affects all threads in JVM.
+   */
+  if (likely(ret == 0)) {
+    ret = chmod(path, S_IRUSR | S_IWUSR);
+    if (likely(ret == 0)) {
+      ret = listen(listenFd, SOMAXCONN);
+    }
+
+    raisedErrNum = errno;
+    if (unlikely(ret != 0)) {
+      unlink(path);
+    }
+  }
+
+  if (unlikely(ret != 0)) {
+    close(listenFd);
+    close(wakeupFd[0]);
+    close(wakeupFd[1]);
+    free(this->path);
+    throw raisedErrNum;
+  }
+
+  isStarted = false;
+  pthread_mutex_init(&sectionMutex, NULL);
+  memset(sections, 0, sizeof(sections));
+  memset(sectionLens, 0, sizeof(sectionLens));
+  snapShotCount = 0;
+  processTime = 0;
+  processCpuTime = 0;
+}
+
+/*!
+ * \brief TMetricsServer destructor.<br>
+ *        Server thread is stopped, and socket file is removed.
+ */
+TMetricsServer::~TMetricsServer(void) {
+  if (isStarted) {
+    char wakeup = 0;
+    while ((write(wakeupFd[1], &wakeup, 1) < 0) && (errno == EINTR)) {
+      /* Retry. */
+    }
+
+    pthread_join(thread, NULL);
+  }
+
+  close(listenFd);
+  close(wakeupFd[0]);
+  close(wakeupFd[1]);
+  unlink(path);
+  free(path);
+
+  for (int idx = 0; idx < MetricsSectionCount; idx++) {
+    free(sections[idx]);
+  }
+
+  pthread_mutex_destroy(&sectionMutex);
+}
+
+/*!
+ * \brief Replace section with rendered text.
+ * \param section [in] Section to replace.
+ * \param buffer  [in] Rendered text. Its buffer is taken by this function.
+ */
+void TMetricsServer::update(TMetricsSection section, TMetricsBuffer *buffer) {
+  size_t length;
+  char *text = buffer->detach(&length);
+  if (unlikely(text == NULL)) {
+    logger->printWarnMsg("Could not render metrics.");
+    return;
+  }
+
+  /* New text is released if the lock cannot be taken. */
+  char *oldText = text;
+  ENTER_PTHREAD_SECTION(&sectionMutex) {
+    oldText = sections[section];
+    sections[section] = text;
+    sectionLens[section] = length;
+  }
+  EXIT_PTHREAD_SECTION(&sectionMutex)
+
+  free(oldText);
+}
+
+/*!
+ * \brief Render snapshot section.
+ * \param hdr         [in] Header of merged snapshot.
+ * \param ranking     [in] Heap ranking of snapshot. It can be NULL.
+ * \param elapsedTime [in] Time to process snapshot (usec).
+ * \param cpuTime     [in] CPU time to process snapshot (usec).
+ * \warning This function must be called only from snapshot processor.
+ */
+void TMetricsServer::updateSnapShot(const TSnapShotFileHeader *hdr,
+                                    TSorter<THeapDelta> *ranking,
+                                    jlong elapsedTime, jlong cpuTime) {
+  snapShotCount++;
+  processTime += elapsedTime;
+  processCpuTime += cpuTime;
+
+  TMetricsBuffer buffer;
+  const char *causeName = ((hdr->cause >= GC) && (hdr->cause <= Interval))
+                              ? snapShotCauseName[hdr->cause]
+                              : snapShotCauseName[0];
+
+  buffer.printf(
+      "# TYPE heapstats_snapshot_timestamp_seconds gauge\n"
+      "heapstats_snapshot_timestamp_seconds{cause=\"%s\"} %.3f\n",
+      causeName, hdr->snapShotTime / 1000.0);
+  buffer.printf(
+      "# TYPE heapstats_snapshots counter\n"
+      "heapstats_snapshots_total " JLONG_FORMAT_STR "\n"
+      "# TYPE heapstats_snapshot_processing_seconds counter\n"
+      "heapstats_snapshot_processing_seconds_total %.6f\n"
+      "# TYPE heapstats_snapshot_processing_cpu_seconds counter\n"
+      "heapstats_snapshot_processing_cpu_seconds_total %.6f\n",
+      snapShotCount, processTime / 1000000.0, processCpuTime / 1000000.0);
+  buffer.printf(
+      "# TYPE heapstats_gc_full counter\n"
+      "heapstats_gc_full_total " JLONG_FORMAT_STR "\n"
+      "# TYPE heapstats_gc_young counter\n"
+      "heapstats_gc_young_total " JLONG_FORMAT_STR "\n"
+      "# TYPE heapstats_gc_last_worktime_seconds gauge\n"
+      "heapstats_gc_last_worktime_seconds %.3f\n",
+      hdr->FGCCount, hdr->YGCCount, hdr->gcWorktime / 1000.0);
+  buffer.printf(
+      "# TYPE heapstats_heap_usage_bytes gauge\n"
+      "heapstats_heap_usage_bytes{area=\"new\"} " JLONG_FORMAT_STR "\n"
+      "heapstats_heap_usage_bytes{area=\"old\"} " JLONG_FORMAT_STR "\n"
+      "# TYPE heapstats_heap_size_bytes gauge\n"
+      "heapstats_heap_size_bytes " JLONG_FORMAT_STR "\n"
+      "# TYPE heapstats_metaspace_usage_bytes gauge\n"
+      "heapstats_metaspace_usage_bytes " JLONG_FORMAT_STR "\n"
+      "# TYPE heapstats_metaspace_capacity_bytes gauge\n"
+      "heapstats_metaspace_capacity_bytes " JLONG_FORMAT_STR "\n",
+      hdr->newAreaSize, hdr->oldAreaSize, hdr->totalHeapSize,
+      hdr->metaspaceUsage, hdr->metaspaceCapacity);
+
+  /* Ranking is rendered in descending order as well as log. */
+  if (ranking != NULL) {
+    buffer.printf("# TYPE heapstats_class_usage_bytes gauge\n");
+    int rankCnt = ranking->getCount();
+    Node<THeapDelta> *aNode = ranking->lastNode();
+    for (int Cnt = 0; (Cnt < rankCnt) && (aNode != NULL);
+         Cnt++, aNode = aNode->prev) {
+      buffer.printf("heapstats_class_usage_bytes{class=\"");
+      buffer.printLabelValue(((TObjectData *)aNode->value.tag)->className);
+      buffer.printf("\"} " JLONG_FORMAT_STR "\n", aNode->value.usage);
+    }
+
+    buffer.printf("# TYPE heapstats_class_delta_bytes gauge\n");
+    aNode = ranking->lastNode();
+    for (int Cnt = 0; (Cnt < rankCnt) && (aNode != NULL);
+         Cnt++, aNode = aNode->prev) {
+      buffer.printf("heapstats_class_delta_bytes{class=\"");
+      buffer.printLabelValue(((TObjectData *)aNode->value.tag)->className);
+      buffer.printf("\"} " JLONG_FORMAT_STR "\n", aNode->value.delta);
+    }
+  }
+
+  update(MetricsSnapShot, &buffer);
+}
+
+/*!
+ * \brief Render resource section.
+ * \param record [in] Values of resource log.
+ *                    It must have RESOURCE_LOG_COLUMNS elements.
+ */
+void TMetricsServer::updateResource(const jlong *record) {
+  TMetricsBuffer buffer;
+
+  /* Column order is same as binary resource log. */
+  buffer.printf(
+      "# TYPE heapstats_process_cpu_ticks counter\n"
+      "heapstats_process_cpu_ticks_total{mode=\"user\"} " JLONG_FORMAT_STR
+      "\n"
+      "heapstats_process_cpu_ticks_total{mode=\"system\"} " JLONG_FORMAT_STR
+      "\n"
+      "# TYPE heapstats_process_virtual_memory_bytes gauge\n"
+      "heapstats_process_virtual_memory_bytes " JLONG_FORMAT_STR "\n"
+      "# TYPE heapstats_process_resident_memory_bytes gauge\n"
+      "heapstats_process_resident_memory_bytes " JLONG_FORMAT_STR "\n",
+      record[2], record[3], record[4], record[5]);
+
+  buffer.printf("# TYPE heapstats_machine_cpu_ticks counter\n");
+  for (int idx = 0; idx < 9; idx++) {
+    buffer.printf(
+        "heapstats_machine_cpu_ticks_total{mode=\"%s\"} " JLONG_FORMAT_STR
+        "\n",
+        cpuModeName[idx], record[6 + idx]);
+  }
+
+  buffer.printf(
+      "# TYPE heapstats_jvm_sync_parks counter\n"
+      "heapstats_jvm_sync_parks_total " JLONG_FORMAT_STR "\n"
+      "# TYPE heapstats_jvm_safepoint_seconds counter\n"
+      "heapstats_jvm_safepoint_seconds_total %.3f\n"
+      "# TYPE heapstats_jvm_safepoints counter\n"
+      "heapstats_jvm_safepoints_total " JLONG_FORMAT_STR "\n"
+      "# TYPE heapstats_jvm_live_threads gauge\n"
+      "heapstats_jvm_live_threads " JLONG_FORMAT_STR "\n",
+      record[15], record[16] / 1000.0, record[17], record[18]);
+
+  update(MetricsResource, &buffer);
+}
+
+/*!
+ * \brief Render thread recorder section from the current aggregates.
+ */
+void TMetricsServer::updateThreadRecorder(void) {
+  TThreadRecorder *recorder = TThreadRecorder::getInstance();
+  if (recorder == NULL) {
+    return;
+  }
+
+  TMetricsBuffer buffer;
+  jlong counts[THREAD_EVENT_KINDS];
+  recorder->getEventCounts(counts);
+
+  buffer.printf(
+      "# TYPE heapstats_thread_recorder_threads gauge\n"
+      "heapstats_thread_recorder_threads %d\n"
+      "# TYPE heapstats_thread_recorder_events counter\n",
+      recorder->getThreadCount());
+  for (int event = ThreadStart; event < THREAD_EVENT_KINDS; event++) {
+    buffer.printf(
+        "heapstats_thread_recorder_events_total{event=\"%s\"} "
+        JLONG_FORMAT_STR "\n",
+        threadEventName[event], counts[event]);
+  }
+
+  TIoTraceStats *ioTraceStats = recorder->getIoTraceStats();
+  if (ioTraceStats != NULL) {
+    TIoTraceEntry totals[IoTraceSocketWrite + 1];
+    ioTraceStats->getTotals(totals);
+
+    buffer.printf("# TYPE heapstats_io_operations counter\n");
+    for (int kind = IoTraceFileRead; kind <= IoTraceSocketWrite; kind++) {
+      buffer.printf(
+          "heapstats_io_operations_total{kind=\"%s\"} " JLONG_FORMAT_STR "\n",
+          ioTraceKindLabel[kind], totals[kind].count);
+    }
+
+    buffer.printf("# TYPE heapstats_io_bytes counter\n");
+    for (int kind = IoTraceFileRead; kind <= IoTraceSocketWrite; kind++) {
+      buffer.printf(
+          "heapstats_io_bytes_total{kind=\"%s\"} " JLONG_FORMAT_STR "\n",
+          ioTraceKindLabel[kind], totals[kind].bytes);
+    }
+
+    buffer.printf("# TYPE heapstats_io_latency_seconds counter\n");
+    for (int kind = IoTraceFileRead; kind <= IoTraceSocketWrite; kind++) {
+      buffer.printf("heapstats_io_latency_seconds_total{kind=\"%s\"} %.6f\n",
+                    ioTraceKindLabel[kind],
+                    totals[kind].totalLatency / 1000000.0);
+    }
+
+    buffer.printf("# TYPE heapstats_io_max_latency_seconds gauge\n");
+    for (int kind = IoTraceFileRead; kind <= IoTraceSocketWrite; kind++) {
+      buffer.printf("heapstats_io_max_latency_seconds{kind=\"%s\"} %.6f\n",
+                    ioTraceKindLabel[kind],
+                    totals[kind].maxLatency / 1000000.0);
+    }
+  }
+
+  update(MetricsThreadRecorder, &buffer);
+}
+
+/*!
+ * \brief Concatenate all sections.
+ * \param length [out] Length of concatenated text.
+ * \return Text which is allocated by malloc(3), or NULL if memory
+ *         allocation is failed. Caller must free it.
+ */
+char *TMetricsServer::copySections(size_t *length) {
+  static const char eofMarker[] = "# EOF\n";
+  char *result = NULL;
+  *length = 0;
+
+  ENTER_PTHREAD_SECTION(&sectionMutex) {
+    size_t total = sizeof(eofMarker) - 1;
+    for (int idx = 0; idx < MetricsSectionCount; idx++) {
+      total += sectionLens[idx];
+    }
+
+    /* Only memcpy() is done under the lock. */
+    result = (char *)malloc(total);
+    if (likely(result != NULL)) {
+      for (int idx = 0; idx < MetricsSectionCount; idx++) {
+        if (sections[idx] != NULL) {
+          memcpy(result + *length, sections[idx], sectionLens[idx]);
+          *length += sectionLens[idx];
+        }
+      }
+
+      memcpy(result + *length, eofMarker, sizeof(eofMarker) - 1);
+      *length += sizeof(eofMarker) - 1;
+    }
+  }
+  EXIT_PTHREAD_SECTION(&sectionMutex)
+
+  return result;
+}
+
+/*!
+ * \brief Write all data to socket.
+ * \param fd     [in] Socket of client.
+ * \param data   [in] Data to write.
+ * \param length [in] Length of data.
+ * \return true if all data is written.
+ */
+static bool sendFully(int fd, const char *data, size_t length) {
+  while (length > 0) {
+    ssize_t ret = send(fd, data, length, MSG_NOSIGNAL);
+    if (unlikely(ret < 0)) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      return false;
+    }
+
+    data += ret;
+    length -= ret;
+  }
+
+  return true;
+}
+
+/*!
+ * \brief Handle a request from client.
+ * \param fd [in] Socket of client.
+ */
+void TMetricsServer::serve(int fd) {
+  /* Client which does not send request must not stop the server. */
+  struct timeval timeout = {METRICS_SERVER_IO_TIMEOUT, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+  /* Read request line and headers. Body is not expected. */
+  char request[METRICS_SERVER_MAX_REQUEST];
+  size_t len = 0;
+  while (len < sizeof(request) - 1) {
+    ssize_t ret = recv(fd, request + len, sizeof(request) - 1 - len, 0);
+    if (ret < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      logger->printDebugMsg("Could not read request of metrics: %s",
+                            strerror(errno));
+      return;
+    } else if (ret == 0) {
+      break;
+    }
+
+    len += ret;
+    request[len] = '\0';
+    if ((strstr(request, "\r\n\r\n") != NULL) ||
+        (strstr(request, "\n\n") != NULL)) {
+      break;
+    }
+  }
+  request[len] = '\0';
+
+  const char *status = "200 OK";
+  bool isHead = (strncmp(request, "HEAD ", 5) == 0);
+  const char *target = isHead ? request + 5 : request + 4;
+  if (!isHead && (strncmp(request, "GET ", 4) != 0)) {
+    status = "405 Method Not Allowed";
+  } else {
+    size_t targetLen = strcspn(target, " ?\r\n");
+    if (!(((targetLen == 1) && (target[0] == '/')) ||
+          ((targetLen == 8) && (strncmp(target, "/metrics", 8) == 0)))) {
+      status = "404 Not Found";
+    }
+  }
+
+  char *body = NULL;
+  size_t bodyLen = 0;
+  if (strcmp(status, "200 OK") == 0) {
+    body = copySections(&bodyLen);
+    if (unlikely(body == NULL)) {
+      status = "503 Service Unavailable";
+    }
+  }
+
+  char header[256];
+  int headerLen =
+      snprintf(header, sizeof(header),
+               "HTTP/1.0 %s\r\n"
+               "Content-Type: %s\r\n"
+               "Content-Length: %lu\r\n"
+               "Connection: close\r\n"
+               "\r\n",
+               status, (body != NULL) ? METRICS_CONTENT_TYPE : "text/plain",
+               (unsigned long)bodyLen);
+
+  if (likely(sendFully(fd, header, headerLen)) && (body != NULL) && !isHead) {
+    sendFully(fd, body, bodyLen);
+  }
+
+  free(body);
+}
+
+/*!
+ * \brief Entry point of server thread.
+ * \param data [in] Instance of TMetricsServer.
+ * \return Always NULL.
+ */
+void *TMetricsServer::entryPoint(void *data) {
+  TMetricsServer *server = (TMetricsServer *)data;
+  struct pollfd fds[2];
+  fds[0].fd = server->listenFd;
+  fds[0].events = POLLIN;
+  fds[1].fd = server->wakeupFd[0];
+  fds[1].events = POLLIN;
+
+  while (true) {
+    int ret = poll(fds, 2, -1);
+    if (unlikely(ret < 0)) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      logger->printWarnMsgWithErrno("Metrics server is stopped");
+      break;
+    }
+
+    if (fds[1].revents != 0) {
+      /* Termination is requested. */
+      break;
+    }
+
+    if (fds[0].revents & POLLIN) {
+      int clientFd = accept4(server->listenFd, NULL, NULL, SOCK_CLOEXEC);
+      if (likely(clientFd >= 0)) {
+        server->serve(clientFd);
+        close(clientFd);
+      }
+    }
+  }
+
+  return NULL;
+}
+
+/*!
+ * \brief Start server thread.
+ * \return Value is zero, if process is succeed.<br />
+ *         Value is error number a.k.a. "errno", if process is failure.
+ */
+int TMetricsServer::start(void) {
+  /* Signals for JVM must not be delivered to server thread. */
+  sigset_t allSignals;
+  sigset_t oldMask;
+  sigfillset(&allSignals);
+  pthread_sigmask(SIG_BLOCK, &allSignals, &oldMask);
+  int result = pthread_create(&thread, NULL, &entryPoint, this);
+  pthread_sigmask(SIG_SETMASK, &oldMask, NULL);
+
+  isStarted = (result == 0);
+  return result;
+}
+
+/*!
+ * \brief Global initialization.<br>
+ *        Default path is "/tmp/heapstats_<uid>/<pid>.sock".<br>
+ *        Server thread is started in this function.
+ * \param path [in] Path of Unix domain socket, or NULL to use default.
+ * \return Process result.
+ * \warning Please call only once from main thread.
+ */
+bool TMetricsServer::globalInitialize(const char *path) {
+  char defaultPath[PATH_MAX];
+
+  if ((path == NULL) || (path[0] == '\0')) {
+    char dir[PATH_MAX];
+    int result = getRuntimeDirectory(dir, PATH_MAX);
+    if (unlikely(result != 0)) {
+      errno = result;
+      logger->printWarnMsgWithErrno("%s is not usable for metrics server.",
+                                    dir);
+      return false;
+    }
+
+    snprintf(defaultPath, PATH_MAX, "%s/%d.sock", dir, getpid());
+    path = defaultPath;
+  }
+
+  try {
+    inst = new TMetricsServer(path);
+  } catch (int errNum) {
+    errno = errNum;
+    logger->printWarnMsgWithErrno("Could not listen metrics socket: %s", path);
+    return false;
+  } catch (...) {
+    logger->printWarnMsg("Cannot initialize TMetricsServer.");
+    return false;
+  }
+
+  int result = inst->start();
+  if (unlikely(result != 0)) {
+    errno = result;
+    logger->printWarnMsgWithErrno("Could not start metrics server");
+    delete inst;
+    inst = NULL;
+    return false;
+  }
+
+  logger->printInfoMsg("Metrics are served at %s", inst->getPath());
+  return true;
+}
+
+/*!
+ * \brief Global finalization.
+ */
+void TMetricsServer::globalFinalize(void) {
+  delete inst;
+  inst = NULL;
+}
@@ -0,0 +1,289 @@
+/*!
+ * \file metricsServer.hpp
+ * \brief This file is used to serve metrics in OpenMetrics text format
+ *        through Unix domain socket.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#ifndef METRICS_SERVER_HPP
+#define METRICS_SERVER_HPP
+
+#include <jni.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "classContainer.hpp"
+
+/*!
+ * \brief Max size of HTTP request which is read from client.
+ */
+#define METRICS_SERVER_MAX_REQUEST 4096
+
+/*!
+ * \brief Timeout of reading request and writing response (in sec).
+ */
+#define METRICS_SERVER_IO_TIMEOUT 5
+
+/*!
+ * \brief Sections of metrics.<br>
+ *        Each section is rendered by its producer, and is concatenated in
+ *        this order when metrics are scraped.
+ */
+typedef enum {
+  MetricsSnapShot = 0,   /*!< Snapshot ranking and GC counters.      */
+  MetricsResource,       /*!< Values of resource log.                */
+  MetricsThreadRecorder, /*!< Aggregates of thread recorder.         */
+  MetricsSectionCount    /*!< Number of sections.                    */
+} TMetricsSection;
+
+/*!
+ * \brief This class builds text of metrics in growable buffer.<br>
+ *        The first allocation failure is kept, and later writes are ignored.
+ */
+class TMetricsBuffer {
+ public:
+  /*!
+   * \brief TMetricsBuffer constructor.
+   */
+  TMetricsBuffer(void) : data(NULL), len(0), capacity(0), error(false) {}
+
+  /*!
+   * \brief TMetricsBuffer destructor.
+   */
+  ~TMetricsBuffer() { free(data); }
+
+  /*!
+   * \brief Append formatted string.
+   * \param format [in] Format string of printf(3).
+   */
+  void printf(const char *format, ...)
+      __attribute__((format(printf, 2, 3)));
+
+  /*!
+   * \brief Append label value with escaping backslash, double quote and
+   *        line feed.
+   * \param value [in] Label value.
+   */
+  void printLabelValue(const char *value);
+
+  /*!
+   * \brief Take buffer from this instance.
+   * \param length [out] Length of text.
+   * \return Text which is allocated by malloc(3), or NULL if any error is
+   *         raised. Caller must free it.
+   */
+  char *detach(size_t *length);
+
+ private:
+  /*!
+   * \brief Text of metrics.
+   */
+  char *data;
+
+  /*!
+   * \brief Length of text.
+   */
+  size_t len;
+
+  /*!
+   * \brief Size of buffer.
+   */
+  size_t capacity;
+
+  /*!
+   * \brief Was memory allocation failed?
+   */
+  bool error;
+
+  /*!
+   * \brief Make room in the buffer.
+   * \param size [in] Required size after the current text.
+   * \return true if the buffer has enough room.
+   */
+  bool reserve(size_t size);
+};
+
+/*!
+ * \brief This class serves metrics in OpenMetrics text format through
+ *        Unix domain socket.<br>
+ *        Producers render their section into TMetricsBuffer and swap it
+ *        with the previous one, so scrapes never wait for producers.
+ */
+class TMetricsServer {
+ public:
+  /*!
+   * \brief TMetricsServer constructor.
+   * \param path [in] Path of Unix domain socket.
+   */
+  TMetricsServer(const char *path);
+
+  /*!
+   * \brief TMetricsServer destructor.<br>
+   *        Server thread is stopped, and socket file is removed.
+   */
+  virtual ~TMetricsServer(void);
+
+  /*!
+   * \brief Replace section with rendered text.
+   * \param section [in] Section to replace.
+   * \param buffer  [in] Rendered text. Its buffer is taken by this function.
+   */
+  void update(TMetricsSection section, TMetricsBuffer *buffer);
+
+  /*!
+   * \brief Render snapshot section.
+   * \param hdr         [in] Header of merged snapshot.
+   * \param ranking     [in] Heap ranking of snapshot. It can be NULL.
+   * \param elapsedTime [in] Time to process snapshot (usec).
+   * \param cpuTime     [in] CPU time to process snapshot (usec).
+   * \warning This function must be called only from snapshot processor.
+   */
+  void updateSnapShot(const TSnapShotFileHeader *hdr,
+                      TSorter<THeapDelta> *ranking, jlong elapsedTime,
+                      jlong cpuTime);
+
+  /*!
+   * \brief Render resource section.
+   * \param record [in] Values of resource log.
+   *                    It must have RESOURCE_LOG_COLUMNS elements.
+   */
+  void updateResource(const jlong *record);
+
+  /*!
+   * \brief Render thread recorder section from the current aggregates.
+   */
+  void updateThreadRecorder(void);
+
+  /*!
+   * \brief Get path of Unix domain socket.
+   * \return Path of Unix domain socket.
+   */
+  inline const char *getPath(void) { return path; };
+
+  /*!
+   * \brief Global initialization.<br>
+   *        Server thread is started in this function.
+   * \param path [in] Path of Unix domain socket, or NULL to use default.
+   * \return Process result.
+   * \warning Please call only once from main thread.
+   */
+  static bool globalInitialize(const char *path);
+
+  /*!
+   * \brief Global finalization.
+   */
+  static void globalFinalize(void);
+
+  /*!
+   * \brief Get singleton instance.
+   * \return Instance of TMetricsServer, or NULL if it is disabled.
+   */
+  inline static TMetricsServer *getInstance() { return inst; };
+
+ private:
+  /*!
+   * \brief Singleton instance.
+   */
+  static TMetricsServer *inst;
+
+  /*!
+   * \brief Path of Unix domain socket.
+   */
+  char *path;
+
+  /*!
+   * \brief Listening socket.
+   */
+  int listenFd;
+
+  /*!
+   * \brief Pipe to wake up server thread at termination.
+   */
+  int wakeupFd[2];
+
+  /*!
+   * \brief Server thread.
+   */
+  pthread_t thread;
+
+  /*!
+   * \brief Is server thread started?
+   */
+  bool isStarted;
+
+  /*!
+   * \brief Mutex of sections.
+   */
+  pthread_mutex_t sectionMutex;
+
+  /*!
+   * \brief Rendered text of each section.
+   */
+  char *sections[MetricsSectionCount];
+
+  /*!
+   * \brief Length of each section.
+   */
+  size_t sectionLens[MetricsSectionCount];
+
+  /*!
+   * \brief Number of processed snapshots.
+   */
+  jlong snapShotCount;
+
+  /*!
+   * \brief Total time to process snapshots (usec).
+   */
+  jlong processTime;
+
+  /*!
+   * \brief Total CPU time to process snapshots (usec).
+   */
+  jlong processCpuTime;
+
+  /*!
+   * \brief Start server thread.
+   * \return Value is zero, if process is succeed.<br />
+   *         Value is error number a.k.a. "errno", if process is failure.
+   */
+  int start(void);
+
+  /*!
+   * \brief Entry point of server thread.
+   * \param data [in] Instance of TMetricsServer.
+   * \return Always NULL.
+   */
+  static void *entryPoint(void *data);
+
+  /*!
+   * \brief Handle a request from client.
+   * \param fd [in] Socket of client.
+   */
+  void serve(int fd);
+
+  /*!
+   * \brief Concatenate all sections.
+   * \param length [out] Length of concatenated text.
+   * \return Text which is allocated by malloc(3), or NULL if memory
+   *         allocation is failed. Caller must free it.
+   */
+  char *copySections(size_t *length);
+};
+
+#endif  // METRICS_SERVER_HPP
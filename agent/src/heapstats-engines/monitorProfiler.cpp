@@ -0,0 +1,643 @@
+/*!
+ * \file monitorProfiler.cpp
+ * \brief This file is used to profile contended Java monitors.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include <jvmti.h>
+#include <jni.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "globals.hpp"
+#include "vmFunctions.hpp"
+#include "util.hpp"
+#include "oopUtil.hpp"
+#include "sorter.hpp"
+#include "monitorProfiler.hpp"
+
+#if PROCESSOR_ARCH == X86
+#include "arch/x86/lock.inline.hpp"
+#elif PROCESSOR_ARCH == ARM
+#include "arch/arm/lock.inline.hpp"
+#endif
+
+/* Class static variables. */
+
+/*!
+ * \brief Singleton instance of TMonitorProfiler.
+ */
+TMonitorProfiler *TMonitorProfiler::inst = NULL;
+
+/* Common methods. */
+
+/*!
+ * \brief Calculate hash value of the key.
+ * \param key [in] Key of contended monitor.
+ * \return Hash value.
+ */
+static inline size_t hashContentionKey(const TMonitorContentionKey *key) {
+  size_t hash = (size_t)key->classTag >> 3;
+
+  for (int idx = 0; idx < key->depth; idx++) {
+    hash = hash * 31 + ((size_t)key->frames[idx] >> 3);
+  }
+
+  return hash;
+}
+
+/*!
+ * \brief Compare contention keys.
+ * \param key1 [in] Key of contended monitor.
+ * \param key2 [in] Key of contended monitor.
+ * \return true if both keys are same.
+ */
+static inline bool isSameContentionKey(const TMonitorContentionKey *key1,
+                                       const TMonitorContentionKey *key2) {
+  return (key1->classTag == key2->classTag) &&
+         (key1->depth == key2->depth) &&
+         (memcmp(key1->frames, key2->frames,
+                 sizeof(jmethodID) * key1->depth) == 0);
+}
+
+/*!
+ * \brief Check whether the key refers the class.
+ * \param key      [in] Key of contended monitor.
+ * \param classTag [in] TObjectData of target class.
+ * \return true if the monitor or any frame belongs to the class.
+ */
+static inline bool isReferredClass(const TMonitorContentionKey *key,
+                                   void *classTag) {
+  if (key->classTag == classTag) {
+    return true;
+  }
+
+  for (int idx = 0; idx < key->depth; idx++) {
+    if (key->frameClassTags[idx] == classTag) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/*!
+ * \brief Get class tag of the class.<br>
+ *        TObjectData is used instead of klassOop because klassOop might be
+ *        moved by GC (e.g. PermGen on JDK 7), but TObjectData follows it.
+ * \param klassOop [in] Target class.
+ * \return TObjectData of the class. NULL if it cannot be registered.
+ */
+static inline void *getClassTag(void *klassOop) {
+  if (unlikely(klassOop == NULL)) {
+    return NULL;
+  }
+
+  TObjectData *objData = clsContainer->findClass(klassOop);
+  if (unlikely(objData == NULL)) {
+    objData = clsContainer->pushNewClass(klassOop);
+  }
+
+  return objData;
+}
+
+/*!
+ * \brief Comparator of blocked time for TSorter.
+ * \param arg1 [in] Target of comparison.
+ * \param arg2 [in] Target of comparison.
+ * \return Difference of arg1 and arg2.
+ */
+int MonitorBlockedTimeCmp(const void *arg1, const void *arg2) {
+  jlong cmp = ((TMonitorContentionStat *)arg2)->blockedTime -
+              ((TMonitorContentionStat *)arg1)->blockedTime;
+  if (cmp > 0) {
+    /* arg2 is bigger than arg1. */
+    return -1;
+  } else if (cmp < 0) {
+    /* arg1 is bigger than arg2. */
+    return 1;
+  } else {
+    /* arg2 is equal arg1. */
+    return 0;
+  }
+}
+
+/*!
+ * \brief Calculate hash value of TMonitorContentionKey.
+ * \param key [in] Key of contended monitor.
+ * \return Hash value.
+ */
+size_t TMonitorContentionKeyHasher::operator()(
+    const TMonitorContentionKey &key) const {
+  return hashContentionKey(&key);
+}
+
+/*!
+ * \brief Compare TMonitorContentionKey.
+ * \param key1 [in] Key of contended monitor.
+ * \param key2 [in] Key of contended monitor.
+ * \return true if both keys are same.
+ */
+bool TMonitorContentionKeyEqual::operator()(
+    const TMonitorContentionKey &key1,
+    const TMonitorContentionKey &key2) const {
+  return isSameContentionKey(&key1, &key2);
+}
+
+/*!
+ * \brief Event handler of JVMTI MonitorContendedEnter for monitor profiler.
+ * \param jvmti  [in] JVMTI environment.
+ * \param env    [in] JNI environment of the event (current) thread.
+ * \param thread [in] JNI local reference to the thread attempting to enter
+ *                    the monitor.
+ * \param object [in] JNI local reference to the monitor.
+ */
+void JNICALL OnMonitorContendedEnterForProfile(jvmtiEnv *jvmti, JNIEnv *env,
+                                               jthread thread, jobject object) {
+  TMonitorProfiler::getInstance()->enter(jvmti, env, thread, object);
+}
+
+/*!
+ * \brief Event handler of JVMTI MonitorContendedEntered for monitor profiler.
+ * \param jvmti  [in] JVMTI environment.
+ * \param env    [in] JNI environment of the event (current) thread.
+ * \param thread [in] JNI local reference to the thread entered the monitor.
+ * \param object [in] JNI local reference to the monitor.
+ */
+void JNICALL OnMonitorContendedEnteredForProfile(jvmtiEnv *jvmti,
+                                                 JNIEnv *env, jthread thread,
+                                                 jobject object) {
+  TMonitorProfiler::getInstance()->entered();
+}
+
+/* Class methods. */
+
+/*!
+ * \brief Global initialization.
+ * \param depth [in] Number of frames which are used as a part of key.
+ * \return Process result.
+ * \warning Please call only once from main thread.
+ */
+bool TMonitorProfiler::globalInitialize(int depth) {
+  try {
+    inst = new TMonitorProfiler(depth);
+  } catch (...) {
+    logger->printCritMsg("Cannot initialize TMonitorProfiler.");
+    return false;
+  }
+
+  return true;
+}
+
+/*!
+ * \brief Global finalization.
+ */
+void TMonitorProfiler::globalFinalize(void) {
+  delete inst;
+  inst = NULL;
+}
+
+/*!
+ * \brief TMonitorProfiler constructor.
+ * \param depth [in] Number of frames which are used as a part of key.
+ */
+TMonitorProfiler::TMonitorProfiler(int depth)
+    : stackDepth(depth), tables(), stats() {
+  memset(&overflow, 0, sizeof(TMonitorContentionStat));
+
+  if (unlikely(pthread_key_create(&tableKey, &onThreadTerminated) != 0)) {
+    throw errno;
+  }
+
+  pthread_mutex_init(&tablesMutex, NULL);
+}
+
+/*!
+ * \brief TMonitorProfiler destructor.
+ */
+TMonitorProfiler::~TMonitorProfiler() {
+  pthread_key_delete(tableKey);
+
+  ENTER_PTHREAD_SECTION(&tablesMutex) {
+    for (std::list<TMonitorThreadTable *>::iterator itr = tables.begin();
+         itr != tables.end(); itr++) {
+      free(*itr);
+    }
+    tables.clear();
+  }
+  EXIT_PTHREAD_SECTION(&tablesMutex)
+
+  pthread_mutex_destroy(&tablesMutex);
+}
+
+/*!
+ * \brief Destructor of thread specific data.
+ * \param data [in] TMonitorThreadTable of terminated thread.
+ */
+void TMonitorProfiler::onThreadTerminated(void *data) {
+  TMonitorThreadTable *table = (TMonitorThreadTable *)data;
+
+  /* The table is released by aggregator after its statistics are merged. */
+  spinLockWait(&table->lockVal);
+  { table->isFinished = true; }
+  spinLockRelease(&table->lockVal);
+}
+
+/*!
+ * \brief Get table of current thread.<br>
+ *        New table will be created if it does not exist.
+ * \return Table of current thread. NULL if it cannot be allocated.
+ */
+TMonitorThreadTable *TMonitorProfiler::getThreadTable(void) {
+  TMonitorThreadTable *table =
+      (TMonitorThreadTable *)pthread_getspecific(tableKey);
+
+  if (likely(table != NULL)) {
+    return table;
+  }
+
+  table = (TMonitorThreadTable *)calloc(1, sizeof(TMonitorThreadTable));
+  if (unlikely(table == NULL)) {
+    return NULL;
+  }
+
+  bool isRegistered = false;
+  ENTER_PTHREAD_SECTION(&tablesMutex) {
+    try {
+      tables.push_back(table);
+      isRegistered = true;
+    } catch (...) {
+      /* Maybe failed to allocate memory at "std::list<T>::push_back()". */
+    }
+  }
+  EXIT_PTHREAD_SECTION(&tablesMutex)
+
+  if (unlikely(!isRegistered)) {
+    free(table);
+    return NULL;
+  }
+
+  if (unlikely(pthread_setspecific(tableKey, table) != 0)) {
+    /* This table will be released at next merge. */
+    table->isFinished = true;
+    return NULL;
+  }
+
+  return table;
+}
+
+/*!
+ * \brief Record monitor which current thread is going to wait for.
+ * \param jvmti  [in] JVMTI environment.
+ * \param env    [in] JNI environment of current thread.
+ * \param thread [in] Current thread.
+ * \param object [in] Contended monitor.
+ */
+void TMonitorProfiler::enter(jvmtiEnv *jvmti, JNIEnv *env, jthread thread,
+                             jobject object) {
+  TMonitorThreadTable *table = getThreadTable();
+  if (unlikely(table == NULL)) {
+    return;
+  }
+
+  /* Pending key is accessed by owner thread only. */
+  TMonitorContentionKey *key = &table->pending;
+  key->classTag = getClassTag(getKlassOopFromOop(*(void **)object));
+  key->depth = 0;
+
+  if (stackDepth > 0) {
+    jvmtiFrameInfo frames[MONITOR_PROFILE_MAX_DEPTH];
+    jint count = 0;
+
+    if (likely(!isError(jvmti, jvmti->GetStackTrace(thread, 0, stackDepth,
+                                                    frames, &count)))) {
+      TVMFunctions *vmFunc = TVMFunctions::getInstance();
+
+      for (int idx = 0; idx < count; idx++) {
+        jclass declaringClass = NULL;
+        key->frames[idx] = frames[idx].method;
+        key->frameClassTags[idx] = NULL;
+
+        /* Declaring class is needed to remove the key at class unloading. */
+        if (likely(!isError(jvmti, jvmti->GetMethodDeclaringClass(
+                                       frames[idx].method, &declaringClass)))) {
+          key->frameClassTags[idx] =
+              getClassTag(vmFunc->AsKlassOop(*(void **)declaringClass));
+          env->DeleteLocalRef(declaringClass);
+        }
+      }
+      key->depth = count;
+    }
+  }
+
+  table->hasPending = true;
+  table->enterTime = getMonotonicTime();
+}
+
+/*!
+ * \brief Account blocked time of current thread.
+ */
+void TMonitorProfiler::entered(void) {
+  TMonitorThreadTable *table =
+      (TMonitorThreadTable *)pthread_getspecific(tableKey);
+
+  /* MonitorContendedEnter might be notified before profiler is enabled. */
+  if (unlikely((table == NULL) || !table->hasPending)) {
+    return;
+  }
+
+  jlong blockedTime = getMonotonicTime() - table->enterTime;
+  if (unlikely(blockedTime < 0)) {
+    blockedTime = 0;
+  }
+  table->hasPending = false;
+
+  size_t mask = MONITOR_PROFILE_THREAD_SLOTS - 1;
+  size_t idx = hashContentionKey(&table->pending) & mask;
+
+  spinLockWait(&table->lockVal);
+  {
+    TMonitorContentionStat *stat = NULL;
+
+    for (int cnt = 0; cnt < MONITOR_PROFILE_THREAD_SLOTS; cnt++) {
+      TMonitorContentionStat *slot = &table->slots[idx];
+
+      if (slot->count == 0) {
+        /* Keep load factor lower than 3/4 to bound probing. */
+        if (table->numSlots < (MONITOR_PROFILE_THREAD_SLOTS / 4 * 3)) {
+          slot->key = table->pending;
+          table->numSlots++;
+          stat = slot;
+        }
+        break;
+      } else if (isSameContentionKey(&slot->key, &table->pending)) {
+        stat = slot;
+        break;
+      }
+
+      idx = (idx + 1) & mask;
+    }
+
+    if (unlikely(stat == NULL)) {
+      stat = &table->overflow;
+    }
+
+    stat->count++;
+    stat->blockedTime += blockedTime;
+    if (stat->maxBlockedTime < blockedTime) {
+      stat->maxBlockedTime = blockedTime;
+    }
+  }
+  spinLockRelease(&table->lockVal);
+}
+
+/*!
+ * \brief Remove statistics which refer the unloaded class.<br>
+ *        TObjectData of the class and jmethodIDs of its methods might be
+ *        reused by other class.
+ * \param classTag [in] TObjectData of unloaded class.
+ */
+void TMonitorProfiler::removeClass(void *classTag) {
+  ENTER_PTHREAD_SECTION(&tablesMutex) {
+    for (std::list<TMonitorThreadTable *>::iterator itr = tables.begin();
+         itr != tables.end(); itr++) {
+      TMonitorThreadTable *table = *itr;
+
+      /*
+       * Emptied slot might break probing sequence of other key, and then
+       * the key might be stored twice. It is summed up at merge, and
+       * numSlots is not decreased to keep the load factor.
+       */
+      spinLockWait(&table->lockVal);
+      {
+        for (int idx = 0; idx < MONITOR_PROFILE_THREAD_SLOTS; idx++) {
+          TMonitorContentionStat *slot = &table->slots[idx];
+          if ((slot->count > 0) && isReferredClass(&slot->key, classTag)) {
+            memset(slot, 0, sizeof(TMonitorContentionStat));
+          }
+        }
+      }
+      spinLockRelease(&table->lockVal);
+    }
+
+    std::tr1::unordered_map<TMonitorContentionKey, TMonitorContentionStat,
+                            TMonitorContentionKeyHasher,
+                            TMonitorContentionKeyEqual>::iterator stat =
+        stats.begin();
+    while (stat != stats.end()) {
+      if (isReferredClass(&stat->first, classTag)) {
+        stat = stats.erase(stat);
+      } else {
+        stat++;
+      }
+    }
+  }
+  EXIT_PTHREAD_SECTION(&tablesMutex)
+}
+
+/*!
+ * \brief Add statistics to the stat.
+ * \param dest [in] Destination of statistics.
+ * \param src  [in] Source of statistics.
+ */
+void TMonitorProfiler::addStat(TMonitorContentionStat *dest,
+                               const TMonitorContentionStat *src) {
+  dest->count += src->count;
+  dest->blockedTime += src->blockedTime;
+  dest->intervalBlockedTime += src->blockedTime;
+  if (dest->maxBlockedTime < src->maxBlockedTime) {
+    dest->maxBlockedTime = src->maxBlockedTime;
+  }
+}
+
+/*!
+ * \brief Merge statistics of all thread tables to stats.<br>
+ *        Each table is drained to local buffer at first, so memory for
+ *        stats is not allocated while holding spinlock of the table.
+ */
+void TMonitorProfiler::merge(void) {
+  TMonitorContentionStat drained[MONITOR_PROFILE_THREAD_SLOTS];
+
+  ENTER_PTHREAD_SECTION(&tablesMutex) {
+    std::list<TMonitorThreadTable *>::iterator itr = tables.begin();
+
+    while (itr != tables.end()) {
+      TMonitorThreadTable *table = *itr;
+      int numDrained = 0;
+      bool isFinished;
+
+      spinLockWait(&table->lockVal);
+      {
+        for (int idx = 0; idx < MONITOR_PROFILE_THREAD_SLOTS; idx++) {
+          if (table->slots[idx].count > 0) {
+            drained[numDrained++] = table->slots[idx];
+          }
+        }
+
+        if (table->overflow.count > 0) {
+          addStat(&overflow, &table->overflow);
+        }
+
+        /* Drain the table. Pending key is kept for the owner thread. */
+        memset(table->slots, 0, sizeof(table->slots));
+        memset(&table->overflow, 0, sizeof(TMonitorContentionStat));
+        table->numSlots = 0;
+        isFinished = table->isFinished;
+      }
+      spinLockRelease(&table->lockVal);
+
+      for (int idx = 0; idx < numDrained; idx++) {
+        TMonitorContentionStat *slot = &drained[idx];
+        TMonitorContentionStat *dest = &overflow;
+
+        try {
+          if (stats.count(slot->key) > 0) {
+            dest = &stats[slot->key];
+          } else if (stats.size() < MONITOR_PROFILE_MAX_ENTRIES) {
+            dest = &stats[slot->key];
+            memset(dest, 0, sizeof(TMonitorContentionStat));
+            dest->key = slot->key;
+          }
+        } catch (...) {
+          /* Maybe failed to allocate memory. Account to overflow. */
+        }
+
+        addStat(dest, slot);
+      }
+
+      if (isFinished) {
+        free(table);
+        itr = tables.erase(itr);
+      } else {
+        itr++;
+      }
+    }
+  }
+  EXIT_PTHREAD_SECTION(&tablesMutex)
+}
+
+/*!
+ * \brief Format the frame as "Lfoo/Bar;.method" .
+ * \param jvmti  [in]  JVMTI environment.
+ * \param env    [in]  JNI environment.
+ * \param method [in]  Method ID of the frame.
+ * \param buf    [out] Buffer to store string.
+ * \param len    [in]  Length of buf.
+ */
+void TMonitorProfiler::getFrameName(jvmtiEnv *jvmti, JNIEnv *env,
+                                    jmethodID method, char *buf, size_t len) {
+  jclass declaringClass = NULL;
+  char *classSig = NULL;
+  char *methodName = NULL;
+
+  /* Method might be unloaded after contention. */
+  if (likely(!isError(jvmti, jvmti->GetMethodDeclaringClass(
+                                 method, &declaringClass)))) {
+    jvmti->GetClassSignature(declaringClass, &classSig, NULL);
+    env->DeleteLocalRef(declaringClass);
+  }
+  jvmti->GetMethodName(method, &methodName, NULL, NULL);
+
+  snprintf(buf, len, "%s.%s", (classSig == NULL) ? "(unknown)" : classSig,
+           (methodName == NULL) ? "(unknown)" : methodName);
+
+  jvmti->Deallocate((unsigned char *)classSig);
+  jvmti->Deallocate((unsigned char *)methodName);
+}
+
+/*!
+ * \brief Merge statistics of all threads, and output ranking of
+ *        contended monitors by total blocked time.
+ * \param jvmti [in] JVMTI environment.
+ * \param env   [in] JNI environment.
+ * \param rank  [in] Number of monitors to output.
+ */
+void TMonitorProfiler::showRanking(jvmtiEnv *jvmti, JNIEnv *env, int rank) {
+  merge();
+
+  TSorter<TMonitorContentionStat> *sortArray;
+  try {
+    sortArray = new TSorter<TMonitorContentionStat>(
+        rank, (TComparator)&MonitorBlockedTimeCmp);
+  } catch (...) {
+    logger->printWarnMsg("Couldn't allocate working memory!");
+    return;
+  }
+
+  /* Stats might be purged by class unloading. */
+  ENTER_PTHREAD_SECTION(&tablesMutex) {
+    for (std::tr1::unordered_map<
+             TMonitorContentionKey, TMonitorContentionStat,
+             TMonitorContentionKeyHasher,
+             TMonitorContentionKeyEqual>::iterator itr = stats.begin();
+         itr != stats.end(); itr++) {
+      sortArray->push(itr->second);
+      itr->second.intervalBlockedTime = 0;
+    }
+
+    if (overflow.count > 0) {
+      sortArray->push(overflow);
+      overflow.intervalBlockedTime = 0;
+    }
+  }
+  EXIT_PTHREAD_SECTION(&tablesMutex)
+
+  /* Output ranking header. */
+  logger->printInfoMsg("Monitor Contention Ranking (caused by Interval)");
+  logger->printInfoMsg(
+      "Rank   blocked(msec)   interval(msec)     count   max(msec)  "
+      "Class name");
+  logger->printInfoMsg(
+      "----  ---------------  ---------------  --------  ----------  "
+      "----------");
+
+  /* Output high-rank monitor information. */
+  int rankCnt = sortArray->getCount();
+  Node<TMonitorContentionStat> *aNode = sortArray->lastNode();
+  for (int Cnt = 0; Cnt < rankCnt && aNode != NULL;
+       Cnt++, aNode = aNode->prev) {
+    TMonitorContentionStat *stat = &aNode->value;
+    const char *className = "(others)";
+
+    if (stat->key.classTag != NULL) {
+      className = ((TObjectData *)stat->key.classTag)->className;
+    }
+
+#ifdef LP64
+    logger->printInfoMsg("%4d  %15ld  %15ld  %8ld  %10ld  %s",
+#else
+    logger->printInfoMsg("%4d  %15lld  %15lld  %8lld  %10lld  %s",
+#endif
+                         Cnt + 1, stat->blockedTime / 1000,
+                         stat->intervalBlockedTime / 1000, stat->count,
+                         stat->maxBlockedTime / 1000, className);
+
+    for (int idx = 0; idx < stat->key.depth; idx++) {
+      char frameName[1024];
+      getFrameName(jvmti, env, stat->key.frames[idx], frameName,
+                   sizeof(frameName));
+      logger->printInfoMsg("                at %s", frameName);
+    }
+  }
+
+  /* Clean up after ranking output. */
+  logger->flush();
+  delete sortArray;
+}
@@ -0,0 +1,275 @@
+/*!
+ * \file monitorProfiler.hpp
+ * \brief This file is used to profile contended Java monitors.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#ifndef MONITOR_PROFILER_HPP
+#define MONITOR_PROFILER_HPP
+
+#include <jvmti.h>
+#include <jni.h>
+
+#include <pthread.h>
+
+#include <list>
+#include <tr1/unordered_map>
+
+/*!
+ * \brief Max number of stack frames which are used as a part of key.
+ */
+#define MONITOR_PROFILE_MAX_DEPTH 8
+
+/*!
+ * \brief Number of slots in per-thread table. This value is power of 2.
+ */
+#define MONITOR_PROFILE_THREAD_SLOTS 64
+
+/*!
+ * \brief Max number of entries in global statistics.
+ */
+#define MONITOR_PROFILE_MAX_ENTRIES 4096
+
+/*!
+ * \brief Key of contended monitor.
+ */
+typedef struct {
+  void *classTag;  /*!< Pointer of TObjectData of monitor class.
+                        NULL means "others".                          */
+  int depth;       /*!< Number of stored frames.                      */
+  jmethodID frames[MONITOR_PROFILE_MAX_DEPTH]; /*!< Top frames of the
+                                                    blocked thread.       */
+  void *frameClassTags[MONITOR_PROFILE_MAX_DEPTH]; /*!< TObjectData of
+                                                        declaring classes of
+                                                        frames. They are not
+                                                        a part of key.     */
+} TMonitorContentionKey;
+
+/*!
+ * \brief Statistics of contended monitor.
+ */
+typedef struct {
+  TMonitorContentionKey key; /*!< Key of this statistics.            */
+  jlong count;               /*!< Number of contentions.             */
+  jlong blockedTime;         /*!< Total blocked time in usecs.       */
+  jlong maxBlockedTime;      /*!< Max blocked time in usecs.         */
+  jlong intervalBlockedTime; /*!< Blocked time in current interval.  */
+} TMonitorContentionStat;
+
+/*!
+ * \brief Contention table which is owned by each Java thread.<br>
+ *        Only the owner thread writes statistics to this table, and
+ *        aggregator drains it at each log interval. So the lock of this
+ *        table is not contended in most cases.
+ */
+typedef struct {
+  volatile int lockVal;     /*!< SpinLock variable for this table.       */
+  bool isFinished;          /*!< The owner thread has been terminated.   */
+  bool hasPending;          /*!< Thread is waiting for the monitor.      */
+  jlong enterTime;          /*!< Time of MonitorContendedEnter in usecs. */
+  TMonitorContentionKey pending; /*!< Key of waiting monitor.           */
+  int numSlots;             /*!< Number of used slots.                   */
+  TMonitorContentionStat slots[MONITOR_PROFILE_THREAD_SLOTS];
+  /*!< Hash table of statistics (open addressing).                      */
+  TMonitorContentionStat overflow; /*!< Statistics which cannot be stored
+                                        to slots.                        */
+} TMonitorThreadTable;
+
+/*!
+ * \brief Hasher of TMonitorContentionKey.
+ */
+struct TMonitorContentionKeyHasher {
+  size_t operator()(const TMonitorContentionKey &key) const;
+};
+
+/*!
+ * \brief Comparator of TMonitorContentionKey.
+ */
+struct TMonitorContentionKeyEqual {
+  bool operator()(const TMonitorContentionKey &key1,
+                  const TMonitorContentionKey &key2) const;
+};
+
+/*!
+ * \brief Event handler of JVMTI MonitorContendedEnter for monitor profiler.
+ * \param jvmti  [in] JVMTI environment.
+ * \param env    [in] JNI environment of the event (current) thread.
+ * \param thread [in] JNI local reference to the thread attempting to enter
+ *                    the monitor.
+ * \param object [in] JNI local reference to the monitor.
+ */
+void JNICALL OnMonitorContendedEnterForProfile(jvmtiEnv *jvmti, JNIEnv *env,
+                                               jthread thread, jobject object);
+
+/*!
+ * \brief Event handler of JVMTI MonitorContendedEntered for monitor profiler.
+ * \param jvmti  [in] JVMTI environment.
+ * \param env    [in] JNI environment of the event (current) thread.
+ * \param thread [in] JNI local reference to the thread entered the monitor.
+ * \param object [in] JNI local reference to the monitor.
+ */
+void JNICALL OnMonitorContendedEnteredForProfile(jvmtiEnv *jvmti,
+                                                 JNIEnv *env, jthread thread,
+                                                 jobject object);
+
+/*!
+ * \brief This class aggregates blocked time of contended Java monitors
+ *        per monitor class (and optionally top frames of blocked thread).
+ */
+class TMonitorProfiler {
+ private:
+  /*!
+   * \brief Singleton instance of TMonitorProfiler.
+   */
+  static TMonitorProfiler *inst;
+
+  /*!
+   * \brief Number of frames which are used as a part of key.
+   */
+  int stackDepth;
+
+  /*!
+   * \brief Key of thread specific data to store TMonitorThreadTable.
+   */
+  pthread_key_t tableKey;
+
+  /*!
+   * \brief Tables of all threads which have been contended.
+   */
+  std::list<TMonitorThreadTable *> tables;
+
+  /*!
+   * \brief Mutex for tables and stats.<br>
+   *        Mutex is used because memory is allocated while holding it.
+   */
+  pthread_mutex_t tablesMutex;
+
+  /*!
+   * \brief Aggregated statistics.
+   */
+  std::tr1::unordered_map<TMonitorContentionKey, TMonitorContentionStat,
+                          TMonitorContentionKeyHasher,
+                          TMonitorContentionKeyEqual> stats;
+
+  /*!
+   * \brief Statistics which cannot be stored to stats.
+   */
+  TMonitorContentionStat overflow;
+
+  /*!
+   * \brief Get table of current thread.<br>
+   *        New table will be created if it does not exist.
+   * \return Table of current thread. NULL if it cannot be allocated.
+   */
+  TMonitorThreadTable *getThreadTable(void);
+
+  /*!
+   * \brief Add statistics to the stat.
+   * \param dest [in] Destination of statistics.
+   * \param src  [in] Source of statistics.
+   */
+  static void addStat(TMonitorContentionStat *dest,
+                      const TMonitorContentionStat *src);
+
+  /*!
+   * \brief Merge statistics of all thread tables to stats.
+   */
+  void merge(void);
+
+  /*!
+   * \brief Format the frame as "Lfoo/Bar;.method" .
+   * \param jvmti  [in]  JVMTI environment.
+   * \param env    [in]  JNI environment.
+   * \param method [in]  Method ID of the frame.
+   * \param buf    [out] Buffer to store string.
+   * \param len    [in]  Length of buf.
+   */
+  static void getFrameName(jvmtiEnv *jvmti, JNIEnv *env, jmethodID method,
+                           char *buf, size_t len);
+
+  /*!
+   * \brief Destructor of thread specific data.
+   * \param data [in] TMonitorThreadTable of terminated thread.
+   */
+  static void onThreadTerminated(void *data);
+
+ protected:
+  /*!
+   * \brief TMonitorProfiler constructor.
+   * \param depth [in] Number of frames which are used as a part of key.
+   */
+  TMonitorProfiler(int depth);
+
+  /*!
+   * \brief TMonitorProfiler destructor.
+   */
+  virtual ~TMonitorProfiler();
+
+ public:
+  /*!
+   * \brief Global initialization.
+   * \param depth [in] Number of frames which are used as a part of key.
+   * \return Process result.
+   * \warning Please call only once from main thread.
+   */
+  static bool globalInitialize(int depth);
+
+  /*!
+   * \brief Global finalization.
+   */
+  static void globalFinalize(void);
+
+  /*!
+   * \brief Get singleton instance of TMonitorProfiler.
+   * \return Instance of TMonitorProfiler.
+   */
+  inline static TMonitorProfiler *getInstance() { return inst; };
+
+  /*!
+   * \brief Record monitor which current thread is going to wait for.
+   * \param jvmti  [in] JVMTI environment.
+   * \param env    [in] JNI environment of current thread.
+   * \param thread [in] Current thread.
+   * \param object [in] Contended monitor.
+   */
+  void enter(jvmtiEnv *jvmti, JNIEnv *env, jthread thread, jobject object);
+
+  /*!
+   * \brief Account blocked time of current thread.
+   */
+  void entered(void);
+
+  /*!
+   * \brief Remove statistics which refer the unloaded class.<br>
+   *        TObjectData of the class and jmethodIDs of its methods might be
+   *        reused by other class.
+   * \param classTag [in] TObjectData of unloaded class.
+   */
+  void removeClass(void *classTag);
+
+  /*!
+   * \brief Merge statistics of all threads, and output ranking of
+   *        contended monitors by total blocked time.
+   * \param jvmti [in] JVMTI environment.
+   * \param env   [in] JNI environment.
+   * \param rank  [in] Number of monitors to output.
+   */
+  void showRanking(jvmtiEnv *jvmti, JNIEnv *env, int rank);
+};
+
+#endif  // MONITOR_PROFILER_HPP
@@ -19,6 +19,9 @@
  *
  */
 
+#include <limits.h>
+#include <stdlib.h>
+
 #include "globals.hpp"
 #include "vmFunctions.hpp"
 #include "oopUtil.hpp"
@@ -516,6 +519,23 @@ void iterateFieldObject(THeapObjectCallback event, void *oop, TOopType oopType,
  * \return Process result.
  */
 bool oopUtilInitialize(jvmtiEnv *jvmti) {
+  /* Directory of symbol cache. */
+  char cacheDirBuf[PATH_MAX];
+  const char *cacheDir = NULL;
+  if (conf->SymbolCache()->get()) {
+    cacheDir = conf->SymbolCacheDir()->get();
+
+    if ((cacheDir == NULL) || (cacheDir[0] == '\0')) {
+      const char *home = getenv("HOME");
+      cacheDir = NULL;
+
+      if (home != NULL) {
+        snprintf(cacheDirBuf, PATH_MAX, "%s/.cache/heapstats", home);
+        cacheDir = cacheDirBuf;
+      }
+    }
+  }
+
   /* Search symbol in libjvm. */
   char *libPath = NULL;
   jvmti->GetSystemProperty("sun.boot.library.path", &libPath);
@@ -523,7 +543,7 @@ bool oopUtilInitialize(jvmtiEnv *jvmti) {
     /* Create symbol finder instance. */
     symFinder = new TSymbolFinder();
 
-    if (unlikely(!symFinder->loadLibrary(libPath, "libjvm.so"))) {
+    if (unlikely(!symFinder->loadLibrary(libPath, "libjvm.so", cacheDir))) {
       throw 1;
     }
 
@@ -563,6 +583,8 @@ bool oopUtilInitialize(jvmtiEnv *jvmti) {
 
   } catch (...) {
     /* Deallocate memory. */
+    delete vmScanner;
+    vmScanner = NULL;
     delete symFinder;
     symFinder = NULL;
 
@@ -582,6 +604,11 @@ bool oopUtilInitialize(jvmtiEnv *jvmti) {
  * \brief Finailization of this util.
  */
 void oopUtilFinalize(void) {
+  /* Keep symbols which are resolved after VMInit. */
+  if (symFinder != NULL) {
+    symFinder->saveCache();
+  }
+
   delete symFinder;
   symFinder = NULL;
   delete vmScanner;
@@ -0,0 +1,191 @@
+/*!
+ * \file overheadGovernor.cpp
+ * \brief This file is used to adapt heap census to overhead in GC.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include "globals.hpp"
+#include "overheadGovernor.hpp"
+
+/*!
+ * \brief Singleton instance.
+ */
+TOverheadGovernor *TOverheadGovernor::inst = NULL;
+
+/*!
+ * \brief Names of each level for log.
+ */
+static const char *levelNames[] = {"full census",
+                                   "census without reference tree",
+                                   "sampled census", "no snapshot at GC"};
+
+/*!
+ * \brief TOverheadGovernor constructor.
+ */
+TOverheadGovernor::TOverheadGovernor(void) {
+  level = GOVERNOR_FULL;
+  recoverCount = 0;
+  pthread_mutex_init(&mutex, NULL);
+}
+
+/*!
+ * \brief TOverheadGovernor destructor.
+ */
+TOverheadGovernor::~TOverheadGovernor(void) { pthread_mutex_destroy(&mutex); }
+
+/*!
+ * \brief Get census mode of level.
+ * \param level          [in]  Level of degradation.
+ * \param sampleRate     [out] Percentage of objects to count.
+ * \param collectRefTree [out] Collect reference tree of objects.
+ */
+static void getCensusMode(TGovernorLevel level, int *sampleRate,
+                          bool *collectRefTree) {
+  *sampleRate = conf->SnapShotSampleRate()->get();
+  *collectRefTree = conf->CollectRefTree()->get() && (level == GOVERNOR_FULL);
+
+  if (level == GOVERNOR_SKIP) {
+    *sampleRate = 0;
+  } else if ((level == GOVERNOR_SAMPLING) &&
+             (conf->GCOverheadSampleRate()->get() < *sampleRate)) {
+    *sampleRate = conf->GCOverheadSampleRate()->get();
+  }
+}
+
+/*!
+ * \brief Set census mode of current level to snapshot.
+ * \param snapshot [in] Snapshot container which is used in next GC.
+ */
+void TOverheadGovernor::prepare(TSnapShotContainer *snapshot) {
+  int sampleRate;
+  bool collectRefTree;
+  getCensusMode(level, &sampleRate, &collectRefTree);
+
+  snapshot->setCensusMode(sampleRate, collectRefTree);
+}
+
+/*!
+ * \brief Update level by overhead of the last snapshot at GC.
+ * \param snapshot [in] Snapshot container which is merged.
+ * \warning This function is called only by snapshot processor.
+ */
+void TOverheadGovernor::update(TSnapShotContainer *snapshot) {
+  /* GC pause is counted in msec. Shorter pause is regarded as 1 msec. */
+  jlong pauseTime = snapshot->getHeader()->gcWorktime;
+  double overhead = snapshot->getHookTime() * 100.0 /
+                    (((pauseTime > 0) ? pauseTime : 1) * 1000000.0);
+  jint budget = conf->GCOverheadBudget()->get();
+
+  ENTER_PTHREAD_SECTION(&mutex) {
+    int sampleRate;
+    bool collectRefTree;
+    getCensusMode(level, &sampleRate, &collectRefTree);
+
+    /*
+     * Snapshots are processed after GC. Snapshot which was taken before
+     * the last transition does not show overhead of current level.
+     */
+    if ((snapshot->getSampleRate() == sampleRate) &&
+        (snapshot->isCollectRefTree() == collectRefTree)) {
+      if (overhead > budget) {
+        recoverCount = 0;
+
+        if (level < GOVERNOR_SKIP) {
+          changeLevel((TGovernorLevel)(level + 1), overhead);
+        }
+      } else if ((level > GOVERNOR_FULL) && (overhead * 2 < budget)) {
+        /* Restore only after overhead keeps small enough. */
+        if (++recoverCount >= conf->GCOverheadRecoverCount()->get()) {
+          recoverCount = 0;
+          changeLevel((TGovernorLevel)(level - 1), overhead);
+        }
+      } else {
+        recoverCount = 0;
+      }
+    }
+  }
+  EXIT_PTHREAD_SECTION(&mutex)
+}
+
+/*!
+ * \brief Notify that snapshot at GC was skipped.<br>
+ *        Heap census is restored to sampling after some skips to
+ *        measure overhead again.
+ */
+void TOverheadGovernor::skipCollection(void) {
+  ENTER_PTHREAD_SECTION(&mutex) {
+    if ((level == GOVERNOR_SKIP) &&
+        (++recoverCount >= conf->GCOverheadRecoverCount()->get())) {
+      recoverCount = 0;
+      changeLevel(GOVERNOR_SAMPLING, -1.0);
+    }
+  }
+  EXIT_PTHREAD_SECTION(&mutex)
+}
+
+/*!
+ * \brief Change level, and log the transition.
+ * \param newLevel [in] New level.
+ * \param overhead [in] Overhead which causes the transition (in %).<br>
+ *                      Value is negative if it is not measured.
+ */
+void TOverheadGovernor::changeLevel(TGovernorLevel newLevel,
+                                    double overhead) {
+  if (newLevel > level) {
+    logger->printWarnMsg(
+        "GC overhead governor: HeapStats took %.1f %% of GC pause "
+        "(budget: %d %%). Degrade to %s.",
+        overhead, conf->GCOverheadBudget()->get(), levelNames[newLevel]);
+  } else if (overhead >= 0.0) {
+    logger->printInfoMsg(
+        "GC overhead governor: HeapStats took %.1f %% of GC pause "
+        "(budget: %d %%). Restore to %s.",
+        overhead, conf->GCOverheadBudget()->get(), levelNames[newLevel]);
+  } else {
+    logger->printInfoMsg(
+        "GC overhead governor: %d snapshots at GC were skipped. "
+        "Restore to %s to measure overhead.",
+        conf->GCOverheadRecoverCount()->get(), levelNames[newLevel]);
+  }
+
+  level = newLevel;
+}
+
+/*!
+ * \brief Global initialization.
+ * \return Process result.
+ * \warning Please call only once from main thread.
+ */
+bool TOverheadGovernor::globalInitialize(void) {
+  try {
+    inst = new TOverheadGovernor();
+  } catch (...) {
+    logger->printWarnMsg("Cannot initialize TOverheadGovernor.");
+    return false;
+  }
+
+  return true;
+}
+
+/*!
+ * \brief Global finalization.
+ */
+void TOverheadGovernor::globalFinalize(void) {
+  delete inst;
+  inst = NULL;
+}
@@ -0,0 +1,201 @@
+/*!
+ * \file overheadGovernor.hpp
+ * \brief This file is used to adapt heap census to overhead in GC.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#ifndef OVERHEAD_GOVERNOR_HPP
+#define OVERHEAD_GOVERNOR_HPP
+
+#include <jni.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "snapShotContainer.hpp"
+
+/*!
+ * \brief Level of degradation of heap census in GC.
+ */
+typedef enum {
+  GOVERNOR_FULL,       /*!< Heap census is done as configured.         */
+  GOVERNOR_NO_REFTREE, /*!< Reference tree is not collected.           */
+  GOVERNOR_SAMPLING,   /*!< Objects are sampled, too.                  */
+  GOVERNOR_SKIP        /*!< Snapshot at GC is skipped.                 */
+} TGovernorLevel;
+
+/*!
+ * \brief This class adapts heap census in GC to its overhead.<br>
+ *        Time spent in GC hooks is compared with GC pause time at each
+ *        snapshot. Heap census is degraded a level if it exceeds
+ *        "gc_overhead_budget", and is restored a level after
+ *        "gc_overhead_recover_count" light collections.
+ */
+class TOverheadGovernor {
+ public:
+  /*!
+   * \brief TOverheadGovernor constructor.
+   */
+  TOverheadGovernor(void);
+
+  /*!
+   * \brief TOverheadGovernor destructor.
+   */
+  virtual ~TOverheadGovernor(void);
+
+  /*!
+   * \brief Set census mode of current level to snapshot.
+   * \param snapshot [in] Snapshot container which is used in next GC.
+   */
+  void prepare(TSnapShotContainer *snapshot);
+
+  /*!
+   * \brief Update level by overhead of the last snapshot at GC.
+   * \param snapshot [in] Snapshot container which is merged.
+   * \warning This function is called only by snapshot processor.
+   */
+  void update(TSnapShotContainer *snapshot);
+
+  /*!
+   * \brief Notify that snapshot at GC was skipped.<br>
+   *        Heap census is restored to sampling after some skips to
+   *        measure overhead again.
+   */
+  void skipCollection(void);
+
+  /*!
+   * \brief Get current level.
+   * \return Level of degradation.
+   */
+  inline TGovernorLevel getLevel(void) { return level; };
+
+  /*!
+   * \brief Global initialization.
+   * \return Process result.
+   * \warning Please call only once from main thread.
+   */
+  static bool globalInitialize(void);
+
+  /*!
+   * \brief Global finalization.
+   */
+  static void globalFinalize(void);
+
+  /*!
+   * \brief Get singleton instance.
+   * \return Instance of TOverheadGovernor.
+   */
+  inline static TOverheadGovernor *getInstance() { return inst; };
+
+ private:
+  /*!
+   * \brief Singleton instance.
+   */
+  static TOverheadGovernor *inst;
+
+  /*!
+   * \brief Current level of degradation.
+   */
+  volatile TGovernorLevel level;
+
+  /*!
+   * \brief Number of consecutive light or skipped collections.
+   */
+  int recoverCount;
+
+  /*!
+   * \brief Mutex for level transition.
+   */
+  pthread_mutex_t mutex;
+
+  /*!
+   * \brief Change level, and log the transition.
+   * \param newLevel [in] New level.
+   * \param overhead [in] Overhead which causes the transition (in %).<br>
+   *                      Value is negative if it is not measured.
+   */
+  void changeLevel(TGovernorLevel newLevel, double overhead);
+};
+
+/*!
+ * \brief This class measures time of a call of GC hook.<br>
+ *        Only one in GC_HOOK_TIMING_INTERVAL objects is timed to keep the
+ *        cost of clock small, and elapsed time is added to local snapshot
+ *        container.
+ */
+class TGCHookTimer {
+ public:
+  /*!
+   * \brief TGCHookTimer constructor.<br>
+   *        Please construct it at entry of hook, because lookup of local
+   *        containers is a part of the cost.
+   * \param oop [in] Java heap object which is processed by the hook.
+   */
+  inline TGCHookTimer(void *oop) {
+    /*
+     * Local container is not known yet, so objects are selected by hash.
+     * Bits under the ones which are used by sampling of heap census are
+     * used not to time sampled objects only.
+     */
+    uint64_t hash = ((uint64_t)((uintptr_t)oop >> 3) *
+                     0x9E3779B97F4A7C15ULL) >> 24;
+    isTimed = ((hash % GC_HOOK_TIMING_INTERVAL) == 0);
+    snapshot = NULL;
+    if (unlikely(isTimed)) {
+      clock_gettime(CLOCK_MONOTONIC, &startTime);
+    }
+  }
+
+  /*!
+   * \brief Set container which elapsed time is added to.
+   * \param localSnapshot [in] Local snapshot container of this thread.
+   */
+  inline void setSnapshot(TSnapShotContainer *localSnapshot) {
+    snapshot = localSnapshot;
+  }
+
+  /*!
+   * \brief TGCHookTimer destructor.
+   */
+  inline ~TGCHookTimer(void) {
+    if (unlikely(isTimed && (snapshot != NULL))) {
+      struct timespec endTime;
+      clock_gettime(CLOCK_MONOTONIC, &endTime);
+      snapshot->FastAddHookTime(
+          (jlong)(endTime.tv_sec - startTime.tv_sec) * 1000000000L +
+          (endTime.tv_nsec - startTime.tv_nsec));
+    }
+  }
+
+ private:
+  /*!
+   * \brief Is this call timed?
+   */
+  bool isTimed;
+
+  /*!
+   * \brief Local snapshot container, or NULL if it is not known yet.
+   */
+  TSnapShotContainer *snapshot;
+
+  /*!
+   * \brief Time when hook is started.
+   */
+  struct timespec startTime;
+};
+
+#endif  // OVERHEAD_GOVERNOR_HPP
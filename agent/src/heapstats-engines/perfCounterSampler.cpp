@@ -0,0 +1,469 @@
+/*!
+ * \file perfCounterSampler.cpp
+ * \brief This file is used to sample JVM performance counters periodically.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "globals.hpp"
+#include "util.hpp"
+#include "perfCounterSampler.hpp"
+
+/* Class static variables. */
+
+/*!
+ * \brief Singleton instance of TPerfCounterSampler.
+ */
+TPerfCounterSampler *TPerfCounterSampler::inst = NULL;
+
+/*!
+ * \brief Names of base counters. The order is same as TPerfBaseCounter.
+ */
+static const char *baseCounterNames[PERF_BASE_COUNTERS] = {
+    "sun.gc.generation.0.space.0.used",
+    "sun.gc.generation.0.space.0.capacity",
+    "sun.gc.generation.1.space.0.used",
+    "sun.gc.collector.0.invocations",
+    "sun.gc.collector.1.invocations",
+    "sun.rt.safepointTime",
+    "sun.rt.safepoints",
+    "sun.os.hrt.frequency"};
+
+/*!
+ * \brief Read a counter in hsperfdata.
+ * \param counter [in] Pointer of the counter.
+ * \return Value of the counter. -1 if the counter is not found.
+ */
+inline jlong readCounter(jlong *counter) {
+  return (counter == NULL) ? -1 : *(volatile jlong *)counter;
+}
+
+/*!
+ * \brief Global initialization.
+ * \param interval [in] Interval of sampling (msec).
+ * \param records  [in] Number of samples in the ring.
+ * \param names    [in] Comma-separated names of additional counters.
+ * \return Process result.
+ * \warning Please call only once from main thread.
+ */
+bool TPerfCounterSampler::globalInitialize(int interval, int records,
+                                           const char *names) {
+  try {
+    inst = new TPerfCounterSampler(interval, records, names);
+  } catch (...) {
+    logger->printCritMsg("Cannot initialize TPerfCounterSampler.");
+    return false;
+  }
+
+  return true;
+}
+
+/*!
+ * \brief Global finalization.
+ */
+void TPerfCounterSampler::globalFinalize(void) {
+  delete inst;
+  inst = NULL;
+}
+
+/*!
+ * \brief TPerfCounterSampler constructor.
+ * \param interval [in] Interval of sampling (msec).
+ * \param records  [in] Number of samples in the ring.
+ * \param names    [in] Comma-separated names of additional counters.
+ */
+TPerfCounterSampler::TPerfCounterSampler(int interval, int records,
+                                         const char *names)
+    : TAgentThread("HeapStats Perf Counter Sampler"),
+      interval(interval),
+      capacity(records),
+      count(0),
+      reportedCount(0),
+      isResolved(false),
+      prevTime(0),
+      numCounters(0) {
+  memset(baseCounters, 0, sizeof(baseCounters));
+  memset(prevBase, 0, sizeof(prevBase));
+  memset(counterNames, 0, sizeof(counterNames));
+  memset(counters, 0, sizeof(counters));
+
+  ring = (TPerfSample *)calloc(capacity, sizeof(TPerfSample));
+  if (unlikely(ring == NULL)) {
+    throw errno;
+  }
+
+  if ((names == NULL) || (names[0] == '\0')) {
+    return;
+  }
+
+  /* Split counter names. */
+  char *buf = strdup(names);
+  if (unlikely(buf == NULL)) {
+    int raisedErrNum = errno;
+    free(ring);
+    throw raisedErrNum;
+  }
+
+  char *savePtr = NULL;
+  for (char *name = strtok_r(buf, ", ", &savePtr); name != NULL;
+       name = strtok_r(NULL, ", ", &savePtr)) {
+    if (numCounters == PERF_SAMPLER_MAX_COUNTERS) {
+      logger->printWarnMsg("Too many perf counters. %s is ignored.", name);
+      continue;
+    }
+
+    counterNames[numCounters] = strdup(name);
+    if (likely(counterNames[numCounters] != NULL)) {
+      numCounters++;
+    }
+  }
+
+  free(buf);
+}
+
+/*!
+ * \brief TPerfCounterSampler destructor.
+ */
+TPerfCounterSampler::~TPerfCounterSampler(void) {
+  for (int idx = 0; idx < numCounters; idx++) {
+    free(counterNames[idx]);
+  }
+
+  free(ring);
+}
+
+/*!
+ * \brief Resolve addresses of counters in hsperfdata.
+ * \return false if hsperfdata is not available.
+ */
+bool TPerfCounterSampler::resolveCounters(void) {
+  if (isResolved) {
+    return true;
+  }
+
+  VMStructSearchEntry entries[PERF_BASE_COUNTERS] = {
+      {baseCounterNames[PERF_EDEN_USED], 'J',
+       (void **)&baseCounters[PERF_EDEN_USED]},
+      {baseCounterNames[PERF_EDEN_CAPACITY], 'J',
+       (void **)&baseCounters[PERF_EDEN_CAPACITY]},
+      {baseCounterNames[PERF_OLD_USED], 'J',
+       (void **)&baseCounters[PERF_OLD_USED]},
+      {baseCounterNames[PERF_YGC_COUNT], 'J',
+       (void **)&baseCounters[PERF_YGC_COUNT]},
+      {baseCounterNames[PERF_FGC_COUNT], 'J',
+       (void **)&baseCounters[PERF_FGC_COUNT]},
+      {baseCounterNames[PERF_SAFEPOINT_TIME], 'J',
+       (void **)&baseCounters[PERF_SAFEPOINT_TIME]},
+      {baseCounterNames[PERF_SAFEPOINTS], 'J',
+       (void **)&baseCounters[PERF_SAFEPOINTS]},
+      {baseCounterNames[PERF_HRT_FREQUENCY], 'J',
+       (void **)&baseCounters[PERF_HRT_FREQUENCY]}};
+
+  if (unlikely(!jvmInfo->findPerfCounters(entries, PERF_BASE_COUNTERS))) {
+    logger->printWarnMsg("Performance data is not available.");
+    return false;
+  }
+
+  for (int idx = 0; idx < numCounters; idx++) {
+    VMStructSearchEntry entry = {counterNames[idx], 'J',
+                                 (void **)&counters[idx]};
+    jvmInfo->findPerfCounters(&entry, 1);
+
+    if (unlikely(counters[idx] == NULL)) {
+      logger->printWarnMsg("Perf counter is not found: %s",
+                           counterNames[idx]);
+    }
+  }
+
+  isResolved = true;
+  return true;
+}
+
+/*!
+ * \brief Read counters and append a sample to the ring.
+ */
+void TPerfCounterSampler::sample(void) {
+  jlong nowBase[PERF_BASE_COUNTERS];
+  for (int idx = 0; idx < PERF_BASE_COUNTERS; idx++) {
+    nowBase[idx] = readCounter(baseCounters[idx]);
+  }
+
+  jlong nowTime = getMonotonicTime();
+  jlong current = count;
+  TPerfSample *target = &ring[current % capacity];
+
+  target->time = getNowTimeSec();
+  target->allocationRate = -1;
+  target->promotionRate = -1;
+  target->safepointLatency = -1;
+
+  /* Derive rates from previous sample. */
+  jlong elapsed = nowTime - prevTime;
+  if ((prevTime != 0) && (elapsed > 0)) {
+    bool isGCOccurred =
+        (nowBase[PERF_YGC_COUNT] != prevBase[PERF_YGC_COUNT]) ||
+        (nowBase[PERF_FGC_COUNT] != prevBase[PERF_FGC_COUNT]);
+
+    if (nowBase[PERF_EDEN_USED] >= 0) {
+      jlong allocated = nowBase[PERF_EDEN_USED] - prevBase[PERF_EDEN_USED];
+
+      if (isGCOccurred || (allocated < 0)) {
+        /*
+         * Eden was cleared by GC. We assume that eden was filled up to
+         * its capacity before GC.
+         */
+        allocated = nowBase[PERF_EDEN_USED];
+        if (nowBase[PERF_EDEN_CAPACITY] > prevBase[PERF_EDEN_USED]) {
+          allocated +=
+              nowBase[PERF_EDEN_CAPACITY] - prevBase[PERF_EDEN_USED];
+        }
+      }
+
+      target->allocationRate = allocated * 1000000 / elapsed;
+    }
+
+    if (nowBase[PERF_OLD_USED] >= 0) {
+      jlong promoted = 0;
+
+      /* Old gen grows by promotion only at young GC. */
+      if ((nowBase[PERF_YGC_COUNT] != prevBase[PERF_YGC_COUNT]) &&
+          (nowBase[PERF_FGC_COUNT] == prevBase[PERF_FGC_COUNT]) &&
+          (nowBase[PERF_OLD_USED] > prevBase[PERF_OLD_USED])) {
+        promoted = nowBase[PERF_OLD_USED] - prevBase[PERF_OLD_USED];
+      }
+
+      target->promotionRate = promoted * 1000000 / elapsed;
+    }
+
+    if ((nowBase[PERF_SAFEPOINTS] >= 0) &&
+        (nowBase[PERF_HRT_FREQUENCY] >= 1000000)) {
+      jlong safepoints =
+          nowBase[PERF_SAFEPOINTS] - prevBase[PERF_SAFEPOINTS];
+      jlong ticks =
+          nowBase[PERF_SAFEPOINT_TIME] - prevBase[PERF_SAFEPOINT_TIME];
+
+      target->safepointLatency =
+          (safepoints > 0)
+              ? ticks / (nowBase[PERF_HRT_FREQUENCY] / 1000000) / safepoints
+              : 0;
+    }
+  }
+
+  for (int idx = 0; idx < numCounters; idx++) {
+    target->counters[idx] = readCounter(counters[idx]);
+  }
+
+  /* Readers see the sample only after all values are stored. */
+  publish_barrier();
+  count = current + 1;
+
+  memcpy(prevBase, nowBase, sizeof(prevBase));
+  prevTime = nowTime;
+}
+
+/*!
+ * \brief Copy a sample from the ring.
+ * \param idx    [in]  Index of sample.
+ * \param sample [out] Buffer to store the sample.
+ * \return false if the sample does not exist or has been overwritten.
+ */
+bool TPerfCounterSampler::readSample(jlong idx, TPerfSample *sample) {
+  if ((idx < 0) || (idx >= count)) {
+    return false;
+  }
+
+  memcpy(sample, &ring[idx % capacity], sizeof(TPerfSample));
+
+  /*
+   * Sampler thread starts to overwrite this slot when count reaches
+   * (idx + capacity). So the copy is valid if count is less than it
+   * after copying.
+   */
+  publish_barrier();
+  return (count - idx) < capacity;
+}
+
+/*!
+ * \brief JThread entry point.
+ * \param jvmti [in] JVMTI environment object.
+ * \param jni   [in] JNI environment object.
+ * \param data  [in] Pointer of TPerfCounterSampler.
+ */
+void JNICALL
+    TPerfCounterSampler::entryPoint(jvmtiEnv *jvmti, JNIEnv *jni, void *data) {
+  /* Get self. */
+  TPerfCounterSampler *controller = (TPerfCounterSampler *)data;
+
+  /* Change running state. */
+  controller->_isRunning = true;
+
+  /* The first sample after restart has no previous one. */
+  controller->prevTime = 0;
+
+  /* Loop for agent run. */
+  while (!controller->_terminateRequest) {
+    controller->sample();
+
+    ENTER_PTHREAD_SECTION(&controller->mutex) {
+      if (likely(!controller->_terminateRequest)) {
+        /* Create limit datetime. */
+        struct timespec limitTs = {0};
+        struct timeval nowTv = {0};
+        gettimeofday(&nowTv, NULL);
+        TIMEVAL_TO_TIMESPEC(&nowTv, &limitTs);
+        limitTs.tv_sec += controller->interval / 1000;
+        limitTs.tv_nsec += (controller->interval % 1000) * 1000000L;
+        if (limitTs.tv_nsec >= 1000000000L) {
+          limitTs.tv_sec++;
+          limitTs.tv_nsec -= 1000000000L;
+        }
+
+        /* Wait for termination or timeout. */
+        pthread_cond_timedwait(&controller->mutexCond, &controller->mutex,
+                               &limitTs);
+      }
+    }
+    EXIT_PTHREAD_SECTION(&controller->mutex)
+  }
+
+  /* Change running state */
+  controller->_isRunning = false;
+}
+
+/*!
+ * \brief Make and begin Jthread.
+ * \param jvmti [in] JVMTI environment object.
+ * \param env   [in] JNI environment object.
+ */
+void TPerfCounterSampler::start(jvmtiEnv *jvmti, JNIEnv *env) {
+  /* Counters are available after JVM initialization. */
+  if (unlikely(!resolveCounters())) {
+    throw "Perf counter sampler cannot be started.";
+  }
+
+  /* Call super class's method. */
+  TAgentThread::start(jvmti, env, TPerfCounterSampler::entryPoint, this,
+                      JVMTI_THREAD_MIN_PRIORITY);
+}
+
+/*!
+ * \brief Get the latest sample.
+ * \param sample [out] Buffer to store the sample.
+ * \return false if no sample exists.
+ */
+bool TPerfCounterSampler::getLatestSample(TPerfSample *sample) {
+  /* Retry if the sample is overwritten while copying. */
+  for (int retry = 0; retry < 3; retry++) {
+    if (readSample(count - 1, sample)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/*!
+ * \brief Output summary of samples since previous call.
+ */
+void TPerfCounterSampler::printSummary(void) {
+  jlong current = count;
+  jlong idx = reportedCount;
+  if ((current - idx) > capacity) {
+    idx = current - capacity;
+  }
+
+  jlong numSamples = 0;
+  jlong numRates = 0;
+  jlong totalAlloc = 0;
+  jlong maxAlloc = 0;
+  jlong totalPromotion = 0;
+  jlong maxPromotion = 0;
+  jlong maxLatency = 0;
+  TPerfSample sample;
+  TPerfSample latest;
+
+  for (; idx < current; idx++) {
+    if (!readSample(idx, &sample)) {
+      continue;
+    }
+
+    numSamples++;
+    memcpy(&latest, &sample, sizeof(TPerfSample));
+    if (sample.allocationRate >= 0) {
+      numRates++;
+      totalAlloc += sample.allocationRate;
+      maxAlloc = (sample.allocationRate > maxAlloc) ? sample.allocationRate
+                                                    : maxAlloc;
+      totalPromotion += (sample.promotionRate > 0) ? sample.promotionRate : 0;
+      maxPromotion = (sample.promotionRate > maxPromotion)
+                         ? sample.promotionRate
+                         : maxPromotion;
+    }
+
+    maxLatency = (sample.safepointLatency > maxLatency)
+                     ? sample.safepointLatency
+                     : maxLatency;
+  }
+
+  reportedCount = current;
+
+  if (numSamples == 0) {
+    logger->printInfoMsg("Perf counter summary: no sample.");
+    return;
+  }
+
+  logger->printInfoMsg("Perf counter summary (%d samples)", (int)numSamples);
+#ifdef LP64
+  logger->printInfoMsg(
+      "  allocation rate: avg %ld, max %ld bytes/sec",
+#else
+  logger->printInfoMsg(
+      "  allocation rate: avg %lld, max %lld bytes/sec",
+#endif
+      (numRates > 0) ? totalAlloc / numRates : 0, maxAlloc);
+#ifdef LP64
+  logger->printInfoMsg(
+      "  promotion rate: avg %ld, max %ld bytes/sec",
+#else
+  logger->printInfoMsg(
+      "  promotion rate: avg %lld, max %lld bytes/sec",
+#endif
+      (numRates > 0) ? totalPromotion / numRates : 0, maxPromotion);
+#ifdef LP64
+  logger->printInfoMsg("  safepoint latency: latest %ld, max %ld usec",
+#else
+  logger->printInfoMsg("  safepoint latency: latest %lld, max %lld usec",
+#endif
+                       latest.safepointLatency, maxLatency);
+
+  /* Output the latest value of additional counters. */
+  for (int cnt = 0; cnt < numCounters; cnt++) {
+#ifdef LP64
+    logger->printInfoMsg("  %s = %ld",
+#else
+    logger->printInfoMsg("  %s = %lld",
+#endif
+                         counterNames[cnt], latest.counters[cnt]);
+  }
+
+  logger->flush();
+}
@@ -0,0 +1,236 @@
+/*!
+ * \file perfCounterSampler.hpp
+ * \brief This file is used to sample JVM performance counters periodically.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#ifndef PERF_COUNTER_SAMPLER_HPP
+#define PERF_COUNTER_SAMPLER_HPP
+
+#include <jvmti.h>
+#include <jni.h>
+
+#include "agentThread.hpp"
+
+/*!
+ * \brief Max number of additional counters which are given by user.
+ */
+#define PERF_SAMPLER_MAX_COUNTERS 16
+
+/*!
+ * \brief Counters which are used to derive rates.
+ */
+typedef enum {
+  PERF_EDEN_USED,      /*!< sun.gc.generation.0.space.0.used     */
+  PERF_EDEN_CAPACITY,  /*!< sun.gc.generation.0.space.0.capacity */
+  PERF_OLD_USED,       /*!< sun.gc.generation.1.space.0.used     */
+  PERF_YGC_COUNT,      /*!< sun.gc.collector.0.invocations       */
+  PERF_FGC_COUNT,      /*!< sun.gc.collector.1.invocations       */
+  PERF_SAFEPOINT_TIME, /*!< sun.rt.safepointTime                 */
+  PERF_SAFEPOINTS,     /*!< sun.rt.safepoints                    */
+  PERF_HRT_FREQUENCY,  /*!< sun.os.hrt.frequency                 */
+  PERF_BASE_COUNTERS   /*!< Number of base counters.             */
+} TPerfBaseCounter;
+
+/*!
+ * \brief A sample of performance counters.<br>
+ *        Derived values are -1 if they cannot be calculated.
+ */
+typedef struct {
+  jlong time;             /*!< Sampled time (msec from epoch).            */
+  jlong allocationRate;   /*!< Allocation rate in eden (bytes/sec).       */
+  jlong promotionRate;    /*!< Promotion rate to old gen (bytes/sec).     */
+  jlong safepointLatency; /*!< Average time of safepoints since previous
+                               sample (usec).                             */
+  jlong counters[PERF_SAMPLER_MAX_COUNTERS]; /*!< Additional counters.    */
+} TPerfSample;
+
+/*!
+ * \brief This class reads counters in hsperfdata periodically and stores
+ *        them to time-series ring.<br>
+ *        Counters are read without safepoint because they are placed on
+ *        shared memory. The ring has single writer (sampler thread), and
+ *        readers detect overwritten samples by record count.
+ */
+class TPerfCounterSampler : public TAgentThread {
+ private:
+  /*!
+   * \brief Singleton instance of TPerfCounterSampler.
+   */
+  static TPerfCounterSampler *inst;
+
+  /*!
+   * \brief Interval of sampling (msec).
+   */
+  int interval;
+
+  /*!
+   * \brief Number of samples in the ring.
+   */
+  jlong capacity;
+
+  /*!
+   * \brief Time-series ring of samples.
+   */
+  TPerfSample *ring;
+
+  /*!
+   * \brief Total number of written samples.<br>
+   *        This value is updated after the sample is written.
+   */
+  volatile jlong count;
+
+  /*!
+   * \brief Number of samples which have been reported to log.
+   */
+  jlong reportedCount;
+
+  /*!
+   * \brief Are counters resolved?
+   */
+  bool isResolved;
+
+  /*!
+   * \brief Pointers of base counters in hsperfdata.
+   */
+  jlong *baseCounters[PERF_BASE_COUNTERS];
+
+  /*!
+   * \brief Values of base counters at previous sample.
+   */
+  jlong prevBase[PERF_BASE_COUNTERS];
+
+  /*!
+   * \brief Monotonic time of previous sample (usec). 0 means no sample.
+   */
+  jlong prevTime;
+
+  /*!
+   * \brief Number of additional counters.
+   */
+  int numCounters;
+
+  /*!
+   * \brief Names of additional counters.
+   */
+  char *counterNames[PERF_SAMPLER_MAX_COUNTERS];
+
+  /*!
+   * \brief Pointers of additional counters in hsperfdata.
+   */
+  jlong *counters[PERF_SAMPLER_MAX_COUNTERS];
+
+  /*!
+   * \brief Resolve addresses of counters in hsperfdata.
+   * \return false if hsperfdata is not available.
+   */
+  bool resolveCounters(void);
+
+  /*!
+   * \brief Read counters and append a sample to the ring.
+   */
+  void sample(void);
+
+  /*!
+   * \brief Copy a sample from the ring.
+   * \param idx    [in]  Index of sample.
+   * \param sample [out] Buffer to store the sample.
+   * \return false if the sample does not exist or has been overwritten.
+   */
+  bool readSample(jlong idx, TPerfSample *sample);
+
+ protected:
+  /*!
+   * \brief TPerfCounterSampler constructor.
+   * \param interval [in] Interval of sampling (msec).
+   * \param records  [in] Number of samples in the ring.
+   * \param names    [in] Comma-separated names of additional counters.
+   */
+  TPerfCounterSampler(int interval, int records, const char *names);
+
+  /*!
+   * \brief TPerfCounterSampler destructor.
+   */
+  virtual ~TPerfCounterSampler(void);
+
+  /*!
+   * \brief JThread entry point.
+   * \param jvmti [in] JVMTI environment object.
+   * \param jni   [in] JNI environment object.
+   * \param data  [in] Pointer of TPerfCounterSampler.
+   */
+  static void JNICALL entryPoint(jvmtiEnv *jvmti, JNIEnv *jni, void *data);
+
+ public:
+  /*!
+   * \brief Global initialization.
+   * \param interval [in] Interval of sampling (msec).
+   * \param records  [in] Number of samples in the ring.
+   * \param names    [in] Comma-separated names of additional counters.
+   * \return Process result.
+   * \warning Please call only once from main thread.
+   */
+  static bool globalInitialize(int interval, int records, const char *names);
+
+  /*!
+   * \brief Global finalization.
+   */
+  static void globalFinalize(void);
+
+  /*!
+   * \brief Get singleton instance of TPerfCounterSampler.
+   * \return Instance of TPerfCounterSampler.
+   */
+  inline static TPerfCounterSampler *getInstance() { return inst; };
+
+  using TAgentThread::start;
+
+  /*!
+   * \brief Make and begin Jthread.
+   * \param jvmti [in] JVMTI environment object.
+   * \param env   [in] JNI environment object.
+   */
+  void start(jvmtiEnv *jvmti, JNIEnv *env);
+
+  /*!
+   * \brief Get the latest sample.
+   * \param sample [out] Buffer to store the sample.
+   * \return false if no sample exists.
+   */
+  bool getLatestSample(TPerfSample *sample);
+
+  /*!
+   * \brief Get number of additional counters.
+   * \return Number of additional counters.
+   */
+  inline int getNumCounters(void) { return numCounters; };
+
+  /*!
+   * \brief Get name of additional counter.
+   * \param idx [in] Index of additional counter.
+   * \return Name of the counter.
+   */
+  inline const char *getCounterName(int idx) { return counterNames[idx]; };
+
+  /*!
+   * \brief Output summary of samples since previous call.
+   */
+  void printSummary(void);
+};
+
+#endif  // PERF_COUNTER_SAMPLER_HPP
@@ -0,0 +1,165 @@
+/*!
+ * \file resourceLog.cpp
+ * \brief This file is used to store resource log as binary columnar ring.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "globals.hpp"
+#include "util.hpp"
+#include "resourceLog.hpp"
+
+/*!
+ * \brief Names of columns. The order is same as CSV resource log.
+ */
+static const char *columnNames[RESOURCE_LOG_COLUMNS] = {
+    "time",           "cause",              "java_usr_time",
+    "java_sys_time",  "java_vsize",         "java_rssize",
+    "sys_usr_time",   "sys_nice_time",      "sys_sys_time",
+    "sys_idle_time",  "sys_iowait_time",    "sys_irq_time",
+    "sys_softirq_time", "sys_steal_time",   "sys_guest_time",
+    "jvm_sync_park",  "jvm_safepoint_time", "jvm_safepoints",
+    "jvm_live_threads"};
+
+/*!
+ * \brief TResourceLog constructor.<br>
+ *        Existing file is reused if its layout is same.
+ * \param path     [in] Path of binary resource log.
+ * \param capacity [in] Number of records in the ring.
+ */
+TResourceLog::TResourceLog(const char *path, jlong capacity) {
+  this->path = strdup(path);
+  if (unlikely(this->path == NULL)) {
+    throw errno;
+  }
+
+  fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR);
+  if (unlikely(fd < 0)) {
+    int raisedErrNum = errno;
+    free(this->path);
+    throw raisedErrNum;
+  }
+
+  mappedSize = RESOURCE_LOG_HEADER_SIZE +
+               capacity * RESOURCE_LOG_COLUMNS * sizeof(jlong);
+
+  /* Read existing header to decide whether records can be kept. */
+  TResourceLogHeader existing;
+  bool isReusable =
+      (pread(fd, &existing, sizeof(existing), 0) == sizeof(existing)) &&
+      isCompatible(&existing, capacity);
+
+  /* Discard incompatible records, and allocate whole ring. */
+  if (!isReusable && unlikely((ftruncate(fd, 0) != 0) ||
+                              (ftruncate(fd, mappedSize) != 0))) {
+    int raisedErrNum = errno;
+    close(fd);
+    free(this->path);
+    throw raisedErrNum;
+  }
+
+  void *addr =
+      mmap(NULL, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (unlikely(addr == MAP_FAILED)) {
+    int raisedErrNum = errno;
+    close(fd);
+    free(this->path);
+    throw raisedErrNum;
+  }
+
+  header = (TResourceLogHeader *)addr;
+  columns = (jlong *)((char *)addr + RESOURCE_LOG_HEADER_SIZE);
+
+  if (!isReusable) {
+    initializeHeader(capacity);
+  }
+}
+
+/*!
+ * \brief TResourceLog destructor.
+ */
+TResourceLog::~TResourceLog(void) {
+  munmap(header, mappedSize);
+  close(fd);
+  free(path);
+}
+
+/*!
+ * \brief Check whether the existing header is compatible with this writer.
+ * \param hdr      [in] Header which is read from existing file.
+ * \param capacity [in] Number of records in the ring.
+ * \return true if existing records can be kept.
+ */
+bool TResourceLog::isCompatible(const TResourceLogHeader *hdr,
+                                jlong capacity) {
+  struct stat st;
+
+  return (memcmp(hdr->magic, RESOURCE_LOG_MAGIC, sizeof(hdr->magic)) == 0) &&
+         (hdr->version == RESOURCE_LOG_VERSION) &&
+         (hdr->byteOrderMark == RESOURCE_LOG_BYTE_ORDER_MARK) &&
+         (hdr->numColumns == RESOURCE_LOG_COLUMNS) &&
+         (hdr->capacity == capacity) && (hdr->count >= 0) &&
+         (fstat(fd, &st) == 0) && ((size_t)st.st_size == mappedSize);
+}
+
+/*!
+ * \brief Initialize header of new ring.
+ * \param capacity [in] Number of records in the ring.
+ */
+void TResourceLog::initializeHeader(jlong capacity) {
+  memset(header, 0, sizeof(TResourceLogHeader));
+
+  memcpy(header->magic, RESOURCE_LOG_MAGIC, sizeof(header->magic));
+  header->version = RESOURCE_LOG_VERSION;
+  header->byteOrderMark = RESOURCE_LOG_BYTE_ORDER_MARK;
+  header->numColumns = RESOURCE_LOG_COLUMNS;
+  header->capacity = capacity;
+  header->count = 0;
+
+  for (int idx = 0; idx < RESOURCE_LOG_COLUMNS; idx++) {
+    strncpy(header->columnNames[idx], columnNames[idx],
+            RESOURCE_LOG_COLUMN_NAME_LEN - 1);
+  }
+}
+
+/*!
+ * \brief Append a record.
+ * \param record [in] Values of all columns.
+ *                    It must have RESOURCE_LOG_COLUMNS elements.
+ * \warning This function is not thread-safe.
+ */
+void TResourceLog::append(const jlong *record) {
+  jlong capacity = header->capacity;
+  jlong count = header->count;
+  jlong slot = count % capacity;
+
+  for (int idx = 0; idx < RESOURCE_LOG_COLUMNS; idx++) {
+    columns[idx * capacity + slot] = record[idx];
+  }
+
+  /* Readers see the record only after all columns are stored. */
+  publish_barrier();
+  header->count = count + 1;
+}
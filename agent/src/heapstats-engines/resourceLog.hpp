@@ -0,0 +1,159 @@
+/*!
+ * \file resourceLog.hpp
+ * \brief This file is used to store resource log as binary columnar ring.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#ifndef RESOURCE_LOG_HPP
+#define RESOURCE_LOG_HPP
+
+#include <jni.h>
+
+/*!
+ * \brief Magic number of binary resource log.
+ */
+#define RESOURCE_LOG_MAGIC "HSRESLOG"
+
+/*!
+ * \brief Format version of binary resource log.
+ */
+#define RESOURCE_LOG_VERSION 1
+
+/*!
+ * \brief Value to detect byte order of binary resource log.
+ */
+#define RESOURCE_LOG_BYTE_ORDER_MARK 0x01020304
+
+/*!
+ * \brief Number of columns in binary resource log.<br>
+ *        Columns are same as CSV resource log except archive file name.
+ */
+#define RESOURCE_LOG_COLUMNS 19
+
+/*!
+ * \brief Max length of column name including NULL.
+ */
+#define RESOURCE_LOG_COLUMN_NAME_LEN 24
+
+/*!
+ * \brief Size of header. Columns start at this offset.
+ */
+#define RESOURCE_LOG_HEADER_SIZE 4096
+
+/*!
+ * \brief Header of binary resource log.<br>
+ *        Each column is stored as an array of jlong which has "capacity"
+ *        elements, and column N starts at
+ *        RESOURCE_LOG_HEADER_SIZE + N * capacity * sizeof(jlong).<br>
+ *        Record I is stored at index (I % capacity) of each column.
+ *        Readers should read records in [max(0, count - capacity), count).
+ */
+typedef struct {
+  char magic[8];       /*!< RESOURCE_LOG_MAGIC without NULL.            */
+  jint version;        /*!< RESOURCE_LOG_VERSION.                       */
+  jint byteOrderMark;  /*!< RESOURCE_LOG_BYTE_ORDER_MARK in writer's
+                            byte order.                                 */
+  jint numColumns;     /*!< Number of columns.                          */
+  jint reserved;       /*!< Padding for alignment.                      */
+  jlong capacity;      /*!< Number of records in the ring.              */
+  volatile jlong count; /*!< Total number of written records. This value
+                             is updated after all columns are written.  */
+  char columnNames[RESOURCE_LOG_COLUMNS][RESOURCE_LOG_COLUMN_NAME_LEN];
+  /*!< Names of columns. */
+} TResourceLogHeader;
+
+/*!
+ * \brief This class appends resource log to memory-mapped ring file.
+ */
+class TResourceLog {
+ public:
+  /*!
+   * \brief TResourceLog constructor.<br>
+   *        Existing file is reused if its layout is same.
+   * \param path     [in] Path of binary resource log.
+   * \param capacity [in] Number of records in the ring.
+   */
+  TResourceLog(const char *path, jlong capacity);
+
+  /*!
+   * \brief TResourceLog destructor.
+   */
+  virtual ~TResourceLog(void);
+
+  /*!
+   * \brief Append a record.
+   * \param record [in] Values of all columns.
+   *                    It must have RESOURCE_LOG_COLUMNS elements.
+   * \warning This function is not thread-safe.
+   */
+  void append(const jlong *record);
+
+  /*!
+   * \brief Get path of binary resource log.
+   * \return Path of this log.
+   */
+  inline const char *getPath(void) { return path; };
+
+  /*!
+   * \brief Get number of records in the ring.
+   * \return Capacity of this log.
+   */
+  inline jlong getCapacity(void) { return header->capacity; };
+
+ private:
+  /*!
+   * \brief Path of binary resource log.
+   */
+  char *path;
+
+  /*!
+   * \brief File descriptor of binary resource log.
+   */
+  int fd;
+
+  /*!
+   * \brief Size of mapped file.
+   */
+  size_t mappedSize;
+
+  /*!
+   * \brief Header of mapped file.
+   */
+  TResourceLogHeader *header;
+
+  /*!
+   * \brief Head of the first column.
+   */
+  jlong *columns;
+
+  /*!
+   * \brief Check whether the existing header is compatible with this writer.
+   * \param hdr      [in] Header which is read from existing file.
+   * \param capacity [in] Number of records in the ring.
+   * \return true if existing records can be kept.
+   */
+  bool isCompatible(const TResourceLogHeader *hdr, jlong capacity);
+
+  /*!
+   * \brief Initialize header of new ring.
+   * \param capacity [in] Number of records in the ring.
+   */
+  void initializeHeader(jlong capacity);
+};
+
+#endif  // RESOURCE_LOG_HPP
@@ -33,7 +33,7 @@ static TSignalMap signalMap[] =
     {SIGHUP,   "SIGHUP"},  {SIGALRM,   "SIGALRM"},  {SIGUSR1,   "SIGUSR1"},
     {SIGUSR2,  "SIGUSR2"}, {SIGTSTP,   "SIGTSTP"},  {SIGTTIN,   "SIGTTIN"},
     {SIGTTOU,  "SIGTTOU"}, {SIGPOLL,   "SIGPOLL"},  {SIGVTALRM, "SIGVTALRM"},
-    {SIGIOT,   "SIGIOT"},  {SIGWINCH,  "SIGWINCH"}
+    {SIGIOT,   "SIGIOT"},  {SIGWINCH,  "SIGWINCH"}, {SIGPROF,   "SIGPROF"}
   };
 
 
@@ -53,6 +53,12 @@ void SignalHandlerStub(int signo, siginfo_t *siginfo, void *data) {
       // java.lang.Terminator . (Unix class)
       // We should ignore this signal.
 
+      // Do nothing.
+    } else if (((void *)chain->handler == SIG_DFL) && (signo == SIGPROF)) {
+      // HotSpot does not handle SIGPROF, so previous handler is SIG_DFL
+      // which terminates the process. Timers of CPU profiler might fire
+      // after the handler of profiler is disabled.
+
       // Do nothing.
     } else if ((void *)chain->handler != SIG_IGN) {
       chain->handler(signo, siginfo, data);
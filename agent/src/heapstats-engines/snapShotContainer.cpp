@@ -105,6 +105,11 @@ TSnapShotContainer *TSnapShotContainer::getInstance(void) {
     }
   }
 
+  if (likely(result != NULL)) {
+    result->setCensusMode(conf->SnapShotSampleRate()->get(),
+                          conf->CollectRefTree()->get());
+  }
+
   return result;
 }
 
@@ -173,6 +178,12 @@ TSnapShotContainer::TSnapShotContainer(bool isParent)
   /* Initialize each field. */
   lockval = 0;
   isParentContainer = isParent;
+  sampleThreshold = 0x100000000ULL;
+  sampleRate = 100;
+  collectRefTree = conf->CollectRefTree()->get();
+  sampledObjects = 0;
+  sampledSquareSize = 0.0;
+  hookTime = 0;
 
   /* Create thread storage key. */
   if (unlikely(isParent &&
@@ -361,6 +372,26 @@ void TSnapShotContainer::setJvmInfo(TJvmInfo *info) {
   this->_header.metaspaceCapacity = info->getMetaspaceCapacity();
 }
 
+/*!
+ * \brief Set how heap objects are counted in this snapshot.
+ * \param sampleRate     [in] Percentage of objects to count.<br>
+ *                            All objects are skipped if it is 0.
+ * \param collectRefTree [in] Collect reference tree of objects.
+ * \warning Please call it before heap census is started.
+ */
+void TSnapShotContainer::setCensusMode(int sampleRate, bool collectRefTree) {
+  this->sampleRate = sampleRate;
+  this->sampleThreshold = (0x100000000ULL * sampleRate) / 100;
+  this->collectRefTree = collectRefTree;
+
+  /* Children-class-information is written only if reftree is collected. */
+  this->_header.magicNumber =
+      collectRefTree ? EXTENDED_REFTREE_SNAPSHOT : EXTENDED_SNAPSHOT;
+  if (isSampling()) {
+    this->_header.magicNumber |= EXTENDED_SAMPLED_SNAPSHOT;
+  }
+}
+
 /*!
  * \brief Clear snapshot data.
  */
@@ -389,6 +420,11 @@ void TSnapShotContainer::clear(bool isForce) {
       this->clearChildClassCounters(clsCounter);
     }
 
+    /* Reset variance of sampling and cost of hooks. */
+    this->sampledObjects = 0;
+    this->sampledSquareSize = 0.0;
+    this->hookTime = 0;
+
     /* Clean local snapshots. */
     for (TLocalSnapShotContainer::iterator it = containerMap.begin();
          it != containerMap.end(); ++it) {
@@ -448,6 +484,15 @@ void TSnapShotContainer::mergeChildren(void) {
     /* Loop each local snapshot container. */
     for (TLocalSnapShotContainer::iterator it = this->containerMap.begin();
          it != this->containerMap.end(); it++) {
+      /* Marge variance of sampling. */
+      this->sampledObjects += (*it).second->sampledObjects;
+      this->sampledSquareSize += (*it).second->sampledSquareSize;
+
+      /* GC threads run in parallel, so the busiest one inflates pause. */
+      if (this->hookTime < (*it).second->hookTime) {
+        this->hookTime = (*it).second->hookTime;
+      }
+
       /* Loop each class in snapshot container. */
       TSizeMap *srcCounterMap = &(*it).second->counterMap;
       for (TSizeMap::iterator it2 = srcCounterMap->begin();
@@ -23,12 +23,14 @@
 #define _SNAPSHOT_CONTAINER_HPP
 
 #include <pthread.h>
+#include <stdint.h>
 
 #include <tr1/unordered_map>
 #include <queue>
 
 #include "jvmInfo.hpp"
 #include "oopUtil.hpp"
+#include "snapShotFormat.hpp"
 
 #if PROCESSOR_ARCH == X86
 #include "arch/x86/lock.inline.hpp"
@@ -36,33 +38,12 @@
 #include "arch/arm/lock.inline.hpp"
 #endif
 
-/* Magic number macro. */
-
 /*!
- * \brief Magic number of snapshot file format.<br />
- *        49 ... HeapStats 1.0 format.<br />
- *        61 ... HeapStats 1.1 format.<br />
- *   Extended magic number is represented as logical or.
- *   Meanings of each field are as below:
- *     0b10000000: This SnapShot is 2.0 format.
- *                 It contains snapshot and metaspace data.
- *     0b00000001: This SnapShot contains reference data.
- *     0b00000010: This SnapShot contains safepoint time.
- *       Other fields (bit 2 - 6) are reserved.
- * \warning Don't change output snapshot format, if you change this value.
+ * \brief One in this number of calls of GC hook is timed.
  */
-#define EXTENDED_SNAPSHOT         0x80  // 0b10000000
-#define EXTENDED_REFTREE_SNAPSHOT 0x81  // 0b10000001
-#define EXTENDED_SAFEPOINT_TIME   0x82  // 0b10000010
+#define GC_HOOK_TIMING_INTERVAL 256
 
-/*!
- * \brief This structure stored class size and number of class-instance.
- */
 #pragma pack(push, 1)
-typedef struct {
-  jlong count;      /*!< Class instance count. */
-  jlong total_size; /*!< Class total use size. */
-} TObjectCounter;
 
 /*!
  * \brief This structure stored class information.
@@ -103,28 +84,6 @@ typedef struct {
   TOopMapBlock *offsets;     /*!< Offset list.              */
   int offsetCount;           /*!< Count of offset list.     */
 } TClassCounter;
-
-/*!
- * \brief This structure stored snapshot information.
- */
-typedef struct {
-  char magicNumber;        /*!< Magic number for format.              */
-  char byteOrderMark;      /*!< Express byte order.                   */
-  jlong snapShotTime;      /*!< Datetime of take snapshot.            */
-  jlong size;              /*!< Class entries count.                  */
-  jint cause;              /*!< Cause of snapshot.                    */
-  jlong gcCauseLen;        /*!< Length of GC cause.                   */
-  char gcCause[80];        /*!< String about GC casue.                */
-  jlong FGCCount;          /*!< Full-GC count.                        */
-  jlong YGCCount;          /*!< Young-GC count.                       */
-  jlong gcWorktime;        /*!< GC worktime.                          */
-  jlong newAreaSize;       /*!< New area using size.                  */
-  jlong oldAreaSize;       /*!< Old area using size.                  */
-  jlong totalHeapSize;     /*!< Total heap size.                      */
-  jlong metaspaceUsage;    /*!< Usage of PermGen or Metaspace.        */
-  jlong metaspaceCapacity; /*!< Max capacity of PermGen or Metaspace. */
-  jlong safepointTime;     /*!< Safepoint time in milliseconds.       */
-} TSnapShotFileHeader;
 #pragma pack(pop)
 
 /*!
@@ -243,6 +202,92 @@ class TSnapShotContainer {
     counter->total_size += size;
   }
 
+  /*!
+   * \brief Set how heap objects are counted in this snapshot.
+   * \param sampleRate     [in] Percentage of objects to count.<br>
+   *                            All objects are skipped if it is 0.
+   * \param collectRefTree [in] Collect reference tree of objects.
+   * \warning Please call it before heap census is started.
+   */
+  void setCensusMode(int sampleRate, bool collectRefTree);
+
+  /*!
+   * \brief Is heap census estimated from sampled objects?
+   * \return true if sampling rate is less than 100.
+   */
+  inline bool isSampling(void) {
+    return this->sampleThreshold < 0x100000000ULL;
+  }
+
+  /*!
+   * \brief Is heap census of this snapshot skipped?
+   * \return true if sampling rate is 0.
+   */
+  inline bool isSkipped(void) { return this->sampleRate == 0; }
+
+  /*!
+   * \brief Get percentage of sampled objects.
+   * \return Sampling rate.
+   */
+  inline int getSampleRate(void) { return this->sampleRate; }
+
+  /*!
+   * \brief Is reference tree collected in this snapshot?
+   * \return true if reference tree is collected.
+   */
+  inline bool isCollectRefTree(void) { return this->collectRefTree; }
+
+  /*!
+   * \brief Is object counted in sampling mode?<br>
+   *        Objects are chosen by hash of their address, so each GC thread
+   *        decides it without any shared state.
+   * \param oop [in] Java heap object(Inner class format).
+   * \return true if object should be counted.
+   */
+  inline bool isSampledObject(void *oop) {
+    /* Fibonacci hashing spreads aligned addresses over 32 bits. */
+    uint64_t hash = ((uint64_t)((uintptr_t)oop >> 3) *
+                     0x9E3779B97F4A7C15ULL) >> 32;
+    return hash < this->sampleThreshold;
+  }
+
+  /*!
+   * \brief Add sampled object to variance of estimation without lock.
+   * \param size [in] Object size.
+   */
+  inline void FastAddSample(jlong size) {
+    this->sampledObjects++;
+    this->sampledSquareSize += (double)size * size;
+  }
+
+  /*!
+   * \brief Get number of sampled objects.
+   * \return Number of sampled objects which are merged from children.
+   */
+  inline jlong getSampledObjects(void) { return this->sampledObjects; }
+
+  /*!
+   * \brief Get sum of squared size of sampled objects.
+   * \return Sum of squared size which is merged from children.
+   */
+  inline double getSampledSquareSize(void) {
+    return this->sampledSquareSize;
+  }
+
+  /*!
+   * \brief Add elapsed time of timed hook without lock.
+   * \param nsec [in] Elapsed time of a call (in nano seconds).
+   */
+  inline void FastAddHookTime(jlong nsec) {
+    this->hookTime += nsec * GC_HOOK_TIMING_INTERVAL;
+  }
+
+  /*!
+   * \brief Get estimated time which was spent in hooks.
+   * \return Hook time of the busiest GC thread (in nano seconds).
+   */
+  inline jlong getHookTime(void) { return this->hookTime; }
+
   /*!
    * \brief Increment instance count and using size.
    * \param counter [in] Increment target class.
@@ -509,6 +554,37 @@ class TSnapShotContainer {
    * \brief Is this container is cleared ?
    */
   volatile bool isCleared;
+
+  /*!
+   * \brief Objects are sampled if hash of address is less than it.<br>
+   *        Value is 2^32 if all objects are counted.
+   */
+  uint64_t sampleThreshold;
+
+  /*!
+   * \brief Percentage of sampled objects.
+   */
+  int sampleRate;
+
+  /*!
+   * \brief Is reference tree collected ?
+   */
+  bool collectRefTree;
+
+  /*!
+   * \brief Number of sampled objects.
+   */
+  jlong sampledObjects;
+
+  /*!
+   * \brief Sum of squared size of sampled objects.
+   */
+  double sampledSquareSize;
+
+  /*!
+   * \brief Estimated time which was spent in hooks (in nano seconds).
+   */
+  jlong hookTime;
 };
 
 /* Include optimized inline functions. */
@@ -0,0 +1,367 @@
+/*!
+ * \file snapShotFile.cpp
+ * \brief This file is used to manage segments of snapshot file.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <string>
+#include <vector>
+
+#include "globals.hpp"
+#include "util.hpp"
+#include "snapShotFormat.hpp"
+#include "snapShotFile.hpp"
+
+/*!
+ * \brief Singleton instance.
+ */
+TSnapShotFile *TSnapShotFile::inst = NULL;
+
+/*!
+ * \brief TSnapShotFile constructor.
+ */
+TSnapShotFile::TSnapShotFile(void) {
+  activePath = NULL;
+  firstTime = -1;
+  lastTime = -1;
+  numSnapShots = -1;
+  fileSize = 0;
+  isPreallocated = false;
+}
+
+/*!
+ * \brief TSnapShotFile destructor.
+ */
+TSnapShotFile::~TSnapShotFile(void) { free(activePath); }
+
+/*!
+ * \brief Load state of active segment which is written by others.<br>
+ *        e.g. previous process or before changing "file".
+ * \param path [in] Path of active segment.
+ * \return Process result.
+ */
+bool TSnapShotFile::loadActiveSegment(const char *path) {
+  char *newPath = strdup(path);
+  if (unlikely(newPath == NULL)) {
+    return false;
+  }
+
+  free(activePath);
+  activePath = newPath;
+  firstTime = -1;
+  lastTime = -1;
+  numSnapShots = 0;
+  fileSize = 0;
+  isPreallocated = false;
+
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    /* Active segment will be created. */
+    return true;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) == 0) {
+    fileSize = st.st_size;
+  }
+
+  if (fileSize > 0) {
+    /* Only time of the first snapshot is read. Others are unknown. */
+    jlong snapShotTime;
+    if (pread(fd, &snapShotTime, sizeof(jlong),
+              offsetof(TSnapShotFileHeader, snapShotTime)) == sizeof(jlong)) {
+      firstTime = snapShotTime;
+    }
+
+    numSnapShots = -1;
+  }
+
+  close(fd);
+  return true;
+}
+
+/*!
+ * \brief Does active segment need to be rotated?
+ * \param snapShotTime [in] Time of snapshot to write (in msec).
+ * \return true if active segment should be rotated.
+ */
+bool TSnapShotFile::needRotation(jlong snapShotTime) {
+  if (fileSize == 0) {
+    return false;
+  }
+
+  jlong rotateSize = conf->SnapShotRotateSize()->get();
+  if ((rotateSize > 0) && (fileSize >= rotateSize)) {
+    return true;
+  }
+
+  jlong rotateInterval = conf->SnapShotRotateInterval()->get();
+  return (rotateInterval > 0) && (firstTime >= 0) &&
+         ((snapShotTime - firstTime) >= rotateInterval * 1000);
+}
+
+/*!
+ * \brief Rename active segment, and add it to index.
+ * \return Value is zero, if process is succeed.<br />
+ *         Value is error number a.k.a. "errno", if process is failure.
+ */
+int TSnapShotFile::rotate(void) {
+  /* Release preallocated space after the last snapshot. */
+  if (isPreallocated) {
+    int fd = open(activePath, O_WRONLY | O_CLOEXEC);
+    if (fd >= 0) {
+      if (unlikely(ftruncate(fd, fileSize) != 0)) {
+        logger->printWarnMsgWithErrno(
+            "Could not release preallocated space of %s", activePath);
+      }
+
+      close(fd);
+    }
+  }
+
+  /* Segment is named by time of the first snapshot. */
+  char timeStr[20];
+  time_t segmentTime = (firstTime >= 0) ? (time_t)(firstTime / 1000)
+                                        : time(NULL);
+  struct tm timeStruct;
+  localtime_r(&segmentTime, &timeStruct);
+  strftime(timeStr, sizeof(timeStr), "%Y%m%d%H%M%S", &timeStruct);
+
+  char segmentPath[PATH_MAX];
+  snprintf(segmentPath, PATH_MAX, "%s.%s", activePath, timeStr);
+  for (int Cnt = 1; access(segmentPath, F_OK) == 0; Cnt++) {
+    snprintf(segmentPath, PATH_MAX, "%s.%s-%d", activePath, timeStr, Cnt);
+  }
+
+  if (unlikely(rename(activePath, segmentPath) != 0)) {
+    return errno;
+  }
+
+  logger->printInfoMsg("SnapShot file is rotated to %s", segmentPath);
+
+  /* Add segment to index. */
+  char indexPath[PATH_MAX];
+  snprintf(indexPath, PATH_MAX, "%s" SNAPSHOT_INDEX_SUFFIX, activePath);
+  struct stat st;
+  bool isNewIndex = (stat(indexPath, &st) != 0) || (st.st_size == 0);
+  FILE *index = fopen(indexPath, "a");
+  if (unlikely(index == NULL)) {
+    logger->printWarnMsgWithErrno("Could not open %s", indexPath);
+  } else {
+    if (isNewIndex) {
+      fprintf(index, "# segment\tfirst_time\tlast_time\tsnapshots\tbytes\n");
+    }
+
+    fprintf(index, "%s\t" JLONG_FORMAT_STR "\t" JLONG_FORMAT_STR
+                   "\t" JLONG_FORMAT_STR "\t%lld\n",
+            segmentPath, firstTime, lastTime, numSnapShots,
+            (long long)fileSize);
+    if (unlikely(fclose(index) != 0)) {
+      logger->printWarnMsgWithErrno("Could not write %s", indexPath);
+    }
+  }
+
+  if (conf->SnapShotRotateCount()->get() > 0) {
+    removeOldSegments(indexPath);
+  }
+
+  firstTime = -1;
+  lastTime = -1;
+  numSnapShots = 0;
+  fileSize = 0;
+  isPreallocated = false;
+  return 0;
+}
+
+/*!
+ * \brief Remove the oldest segments which exceed retention count.
+ * \param indexPath [in] Path of index file.
+ */
+void TSnapShotFile::removeOldSegments(const char *indexPath) {
+  FILE *index = fopen(indexPath, "r");
+  if (unlikely(index == NULL)) {
+    return;
+  }
+
+  std::vector<std::string> entries;
+  char line[PATH_MAX + 128];
+  while (fgets(line, sizeof(line), index) != NULL) {
+    if (line[0] != '#') {
+      entries.push_back(line);
+    }
+  }
+
+  fclose(index);
+
+  size_t keepCount = conf->SnapShotRotateCount()->get();
+  if (entries.size() <= keepCount) {
+    return;
+  }
+
+  size_t removeCount = entries.size() - keepCount;
+  for (size_t idx = 0; idx < removeCount; idx++) {
+    std::string segment = entries[idx].substr(0, entries[idx].find('\t'));
+    if (unlikely((unlink(segment.c_str()) != 0) && (errno != ENOENT))) {
+      logger->printWarnMsgWithErrno("Could not remove %s", segment.c_str());
+    }
+  }
+
+  /* Replace index atomically for readers. */
+  char tmpPath[PATH_MAX];
+  snprintf(tmpPath, PATH_MAX, "%s.tmp", indexPath);
+  index = fopen(tmpPath, "w");
+  if (unlikely(index == NULL)) {
+    logger->printWarnMsgWithErrno("Could not open %s", tmpPath);
+    return;
+  }
+
+  fprintf(index, "# segment\tfirst_time\tlast_time\tsnapshots\tbytes\n");
+  for (size_t idx = removeCount; idx < entries.size(); idx++) {
+    fputs(entries[idx].c_str(), index);
+  }
+
+  if (unlikely((fclose(index) != 0) || (rename(tmpPath, indexPath) != 0))) {
+    logger->printWarnMsgWithErrno("Could not update %s", indexPath);
+    unlink(tmpPath);
+  }
+}
+
+/*!
+ * \brief Open active segment to append snapshot.<br>
+ *        Active segment is rotated before opening if it is needed.
+ * \param snapShotTime [in] Time of snapshot to write (in msec).
+ * \return File descriptor of active segment.<br>
+ *         Value is -1 and errno is set, if process is failure.
+ */
+int TSnapShotFile::openSegment(jlong snapShotTime) {
+  const char *path = conf->FileName()->get();
+
+  /* "file" might be changed through JMX. */
+  if ((activePath == NULL) || (strcmp(activePath, path) != 0)) {
+    if (unlikely(!loadActiveSegment(path))) {
+      return -1;
+    }
+  }
+
+  if (needRotation(snapShotTime)) {
+    int result = rotate();
+    if (unlikely(result != 0)) {
+      /* Snapshot is appended to current segment. */
+      errno = result;
+      logger->printWarnMsgWithErrno("Could not rotate %s", activePath);
+    }
+  }
+
+  int fd = open(activePath, O_CREAT | O_WRONLY | O_CLOEXEC, S_IRUSR | S_IWUSR);
+  if (unlikely(fd < 0)) {
+    return -1;
+  }
+
+  jlong rotateSize = conf->SnapShotRotateSize()->get();
+  if (conf->SnapShotPreallocate()->get() && (rotateSize > fileSize) &&
+      !isPreallocated) {
+    /*
+     * File size is kept, so snapshot is still appended at EOF and readers
+     * do not see unwritten space.
+     */
+    if (unlikely(fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, rotateSize) != 0)) {
+      if ((errno == EOPNOTSUPP) || (errno == ENOSYS)) {
+        logger->printDebugMsg("Preallocation is not supported for %s",
+                              activePath);
+      } else {
+        logger->printWarnMsgWithErrno("Could not preallocate %s", activePath);
+      }
+    }
+
+    /* Don't retry until next segment or rollback. */
+    isPreallocated = true;
+  }
+
+  return fd;
+}
+
+/*!
+ * \brief Finish writing snapshot to active segment.<br>
+ *        Active segment is truncated to "oldOffset" if writing is
+ *        failed.
+ * \param snapShotTime [in] Time of written snapshot (in msec).
+ * \param oldOffset    [in] Size of active segment before writing.
+ * \param isSucceeded  [in] Is snapshot written successfully?
+ */
+void TSnapShotFile::finishSegment(jlong snapShotTime, off_t oldOffset,
+                                  bool isSucceeded) {
+  if (unlikely(!isSucceeded)) {
+    /* Truncation releases preallocated space, too. */
+    if (unlikely(truncate(activePath, oldOffset) < 0)) {
+      logger->printWarnMsgWithErrno("Could not rollback snapshot");
+    }
+
+    fileSize = oldOffset;
+    isPreallocated = false;
+    return;
+  }
+
+  struct stat st;
+  if (likely(stat(activePath, &st) == 0)) {
+    fileSize = st.st_size;
+  }
+
+  if (firstTime < 0) {
+    firstTime = snapShotTime;
+  }
+
+  lastTime = snapShotTime;
+  if (numSnapShots >= 0) {
+    numSnapShots++;
+  }
+}
+
+/*!
+ * \brief Global initialization.
+ * \return Process result.
+ * \warning Please call only once from main thread.
+ */
+bool TSnapShotFile::globalInitialize(void) {
+  try {
+    inst = new TSnapShotFile();
+  } catch (...) {
+    logger->printWarnMsg("Cannot initialize TSnapShotFile.");
+    return false;
+  }
+
+  return true;
+}
+
+/*!
+ * \brief Global finalization.
+ */
+void TSnapShotFile::globalFinalize(void) {
+  delete inst;
+  inst = NULL;
+}
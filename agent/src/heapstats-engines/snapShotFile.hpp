@@ -0,0 +1,161 @@
+/*!
+ * \file snapShotFile.hpp
+ * \brief This file is used to manage segments of snapshot file.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#ifndef SNAPSHOT_FILE_HPP
+#define SNAPSHOT_FILE_HPP
+
+#include <jni.h>
+#include <sys/types.h>
+
+/*!
+ * \brief Suffix of index file of rotated snapshot files.
+ */
+#define SNAPSHOT_INDEX_SUFFIX ".idx"
+
+/*!
+ * \brief This class manages snapshot file as segments.<br>
+ *        Snapshots are always appended to "file" (active segment).
+ *        When it exceeds rotation size or interval, it is renamed to
+ *        "file.<time of the first snapshot>" and listed in "file.idx"
+ *        with its time range, so readers can find snapshots by time
+ *        without opening each segment.<br>
+ *        Rotation is disabled if both of rotation size and interval are 0.
+ * \warning This class is not thread-safe.
+ *          It is used only by snapshot processor.
+ */
+class TSnapShotFile {
+ public:
+  /*!
+   * \brief TSnapShotFile constructor.
+   */
+  TSnapShotFile(void);
+
+  /*!
+   * \brief TSnapShotFile destructor.
+   */
+  virtual ~TSnapShotFile(void);
+
+  /*!
+   * \brief Open active segment to append snapshot.<br>
+   *        Active segment is rotated before opening if it is needed.
+   * \param snapShotTime [in] Time of snapshot to write (in msec).
+   * \return File descriptor of active segment.<br>
+   *         Value is -1 and errno is set, if process is failure.
+   */
+  int openSegment(jlong snapShotTime);
+
+  /*!
+   * \brief Finish writing snapshot to active segment.<br>
+   *        Active segment is truncated to "oldOffset" if writing is
+   *        failed.
+   * \param snapShotTime [in] Time of written snapshot (in msec).
+   * \param oldOffset    [in] Size of active segment before writing.
+   * \param isSucceeded  [in] Is snapshot written successfully?
+   */
+  void finishSegment(jlong snapShotTime, off_t oldOffset, bool isSucceeded);
+
+  /*!
+   * \brief Global initialization.
+   * \return Process result.
+   * \warning Please call only once from main thread.
+   */
+  static bool globalInitialize(void);
+
+  /*!
+   * \brief Global finalization.
+   */
+  static void globalFinalize(void);
+
+  /*!
+   * \brief Get singleton instance.
+   * \return Instance of TSnapShotFile.
+   */
+  inline static TSnapShotFile *getInstance() { return inst; };
+
+ private:
+  /*!
+   * \brief Singleton instance.
+   */
+  static TSnapShotFile *inst;
+
+  /*!
+   * \brief Path of active segment.
+   */
+  char *activePath;
+
+  /*!
+   * \brief Time of the first snapshot in active segment (in msec).<br>
+   *        Value is -1 if it is unknown.
+   */
+  jlong firstTime;
+
+  /*!
+   * \brief Time of the last snapshot in active segment (in msec).<br>
+   *        Value is -1 if it is unknown.
+   */
+  jlong lastTime;
+
+  /*!
+   * \brief Number of snapshots in active segment.<br>
+   *        Value is -1 if it is unknown.
+   */
+  jlong numSnapShots;
+
+  /*!
+   * \brief Size of active segment.
+   */
+  off_t fileSize;
+
+  /*!
+   * \brief Is disk space of active segment already preallocated?
+   */
+  bool isPreallocated;
+
+  /*!
+   * \brief Load state of active segment which is written by others.<br>
+   *        e.g. previous process or before changing "file".
+   * \param path [in] Path of active segment.
+   * \return Process result.
+   */
+  bool loadActiveSegment(const char *path);
+
+  /*!
+   * \brief Does active segment need to be rotated?
+   * \param snapShotTime [in] Time of snapshot to write (in msec).
+   * \return true if active segment should be rotated.
+   */
+  bool needRotation(jlong snapShotTime);
+
+  /*!
+   * \brief Rename active segment, and add it to index.
+   * \return Value is zero, if process is succeed.<br />
+   *         Value is error number a.k.a. "errno", if process is failure.
+   */
+  int rotate(void);
+
+  /*!
+   * \brief Remove the oldest segments which exceed retention count.
+   * \param indexPath [in] Path of index file.
+   */
+  void removeOldSegments(const char *indexPath);
+};
+
+#endif  // SNAPSHOT_FILE_HPP
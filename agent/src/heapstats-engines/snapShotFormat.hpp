@@ -0,0 +1,106 @@
+/*!
+ * \file snapShotFormat.hpp
+ * \brief This file defines format of snapshot file.<br>
+ *        It is shared with tools which read snapshot file, so it must not
+ *        depend on JVM or other agent headers.
+ * Copyright (C) 2011-2017 Nippon Telegraph and Telephone Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#ifndef _SNAPSHOT_FORMAT_HPP
+#define _SNAPSHOT_FORMAT_HPP
+
+#include <jni.h>
+
+/* Magic number macro. */
+
+/*!
+ * \brief Magic number of snapshot file format.<br />
+ *        49 ... HeapStats 1.0 format.<br />
+ *        61 ... HeapStats 1.1 format.<br />
+ *   Extended magic number is represented as logical or.
+ *   Meanings of each field are as below:
+ *     0b10000000: This SnapShot is 2.0 format.
+ *                 It contains snapshot and metaspace data.
+ *     0b00000001: This SnapShot contains reference data.
+ *     0b00000010: This SnapShot contains safepoint time.
+ *     0b00000100: This SnapShot is estimated from sampled objects.
+ *       Other fields (bit 3 - 6) are reserved.
+ * \warning Don't change output snapshot format, if you change this value.
+ */
+#define EXTENDED_SNAPSHOT         0x80  // 0b10000000
+#define EXTENDED_REFTREE_SNAPSHOT 0x81  // 0b10000001
+#define EXTENDED_SAFEPOINT_TIME   0x82  // 0b10000010
+#define EXTENDED_SAMPLED_SNAPSHOT 0x84  // 0b10000100
+
+/*!
+ * \brief Magic number of HeapStats 1.0 format.<br />
+ *        It does not contain class loader, metaspace and reference data.
+ */
+#define SNAPSHOT_FORMAT_1_0 49
+
+/*!
+ * \brief Magic number of HeapStats 1.1 format.<br />
+ *        It contains reference data.
+ */
+#define SNAPSHOT_FORMAT_1_1 61
+
+/*!
+ * \brief Tag of end-marker of children-class-information.
+ */
+#define SNAPSHOT_CHILD_END_MARKER -1
+
+/*!
+ * \brief This structure stored class size and number of class-instance.
+ */
+#pragma pack(push, 1)
+typedef struct {
+  jlong count;      /*!< Class instance count. */
+  jlong total_size; /*!< Class total use size. */
+} TObjectCounter;
+
+/*!
+ * \brief This structure stored snapshot information.<br />
+ *        In snapshot file, "gcCause" has "gcCauseLen" bytes, and
+ *        "metaspaceUsage" and later fields are written only if "magicNumber"
+ *        shows that they are contained.
+ */
+typedef struct {
+  char magicNumber;        /*!< Magic number for format.              */
+  char byteOrderMark;      /*!< Express byte order.                   */
+  jlong snapShotTime;      /*!< Datetime of take snapshot.            */
+  jlong size;              /*!< Class entries count.                  */
+  jint cause;              /*!< Cause of snapshot.                    */
+  jlong gcCauseLen;        /*!< Length of GC cause.                   */
+  char gcCause[80];        /*!< String about GC casue.                */
+  jlong FGCCount;          /*!< Full-GC count.                        */
+  jlong YGCCount;          /*!< Young-GC count.                       */
+  jlong gcWorktime;        /*!< GC worktime.                          */
+  jlong newAreaSize;       /*!< New area using size.                  */
+  jlong oldAreaSize;       /*!< Old area using size.                  */
+  jlong totalHeapSize;     /*!< Total heap size.                      */
+  jlong metaspaceUsage;    /*!< Usage of PermGen or Metaspace.        */
+  jlong metaspaceCapacity; /*!< Max capacity of PermGen or Metaspace. */
+  jlong safepointTime;     /*!< Safepoint time in milliseconds.       */
+  jlong sampleRate;        /*!< Percentage of sampled objects.        */
+  jlong sampledObjects;    /*!< Number of sampled objects.            */
+  jlong countError;        /*!< 95% CI of estimated object count.     */
+  jlong sizeError;         /*!< 95% CI of estimated heap usage.       */
+} TSnapShotFileHeader;
+#pragma pack(pop)
+
+#endif  // _SNAPSHOT_FORMAT_HPP
@@ -22,8 +22,11 @@
 #include "globals.hpp"
 #include "vmFunctions.hpp"
 #include "elapsedTimer.hpp"
+#include "startupProfiler.hpp"
 #include "util.hpp"
 #include "callbackRegister.hpp"
+#include "snapShotFile.hpp"
+#include "overheadGovernor.hpp"
 #include "snapShotMain.hpp"
 
 /* Struct defines. */
@@ -166,6 +169,18 @@ void JNICALL
     if (likely(counter != NULL)) {
       /* Remove class data. */
       clsContainer->popClass(counter);
+
+      /* Class data might be reused by other class. */
+      TMonitorProfiler *monitorProfiler = TMonitorProfiler::getInstance();
+      if (monitorProfiler != NULL) {
+        monitorProfiler->removeClass(counter);
+      }
+    }
+
+    /* Address of the class might be reused by other class. */
+    TAllocationProfiler *allocProfiler = TAllocationProfiler::getInstance();
+    if (allocProfiler != NULL) {
+      allocProfiler->removeClass(klassOop);
     }
   }
 }
@@ -187,6 +202,35 @@ inline void setSnapShotInfo(TInvokeCause cause, TSnapShotContainer *snapshot) {
   snapshot->setJvmInfo(jvmInfo);
 }
 
+/*!
+ * \brief Get snapshot container for heap census in GC.<br>
+ *        Census mode is decided by governor if it is enabled.
+ * \return Snapshot container instance.
+ */
+inline TSnapShotContainer *getSnapShotForGC(void) {
+  TSnapShotContainer *snapshot = TSnapShotContainer::getInstance();
+
+  if (likely(snapshot != NULL) && conf->GCOverheadGovernor()->get()) {
+    TOverheadGovernor::getInstance()->prepare(snapshot);
+  }
+
+  return snapshot;
+}
+
+/*!
+ * \brief Clear snapshot container to reuse it for heap census in GC.<br>
+ *        Census mode is decided again because governor might change the
+ *        level after the container was prepared.
+ * \param snapshot [in] Snapshot container instance.
+ */
+inline void recycleSnapShotForGC(TSnapShotContainer *snapshot) {
+  snapshot->clear(false);
+
+  if (conf->GCOverheadGovernor()->get()) {
+    TOverheadGovernor::getInstance()->prepare(snapshot);
+  }
+}
+
 /*!
  * \brief Add snapshot to outputing wait queue.
  * \param snapshot [in] Snapshot instance.
@@ -255,6 +299,14 @@ inline void notifySnapShot(TSnapShotContainer *snapshot) {
  * \param snapshot [in] Snapshot instance.
  */
 inline void outputSnapShotByGC(TSnapShotContainer *snapshot) {
+  /* Snapshot which is skipped by governor is not written. */
+  if (unlikely(snapshot->isSkipped())) {
+    jvmInfo->resumeGCinfo();
+    TSnapShotContainer::releaseInstance(snapshot);
+    TOverheadGovernor::getInstance()->skipCollection();
+    return;
+  }
+
   setSnapShotInfo(GC, snapshot);
 
   /* Standby for next GC. */
@@ -279,7 +331,7 @@ void onInnerGarbageCollectionInterrupt(void) {
   jvmInfo->resumeGCinfo();
 
   /* Clear unfinished snapshot data. */
-  snapshotByGC->clear(false);
+  recycleSnapShotForGC(snapshotByGC);
 }
 
 /*!
@@ -287,7 +339,7 @@ void onInnerGarbageCollectionInterrupt(void) {
  * \param jvmti [in] JVMTI environment object.
  */
 void JNICALL OnGarbageCollectionStart(jvmtiEnv *jvmti) {
-  snapshotByGC = TSnapShotContainer::getInstance();
+  snapshotByGC = getSnapShotForGC();
 
   /* Enable inner GC event. */
   setupHookForInnerGCEvent(true, &onInnerGarbageCollectionInterrupt);
@@ -321,7 +373,7 @@ void OnG1GarbageCollectionFinish(void) {
 
   /* Set information and push waiting queue. */
   outputSnapShotByGC(snapshotByGC);
-  snapshotByGC = TSnapShotContainer::getInstance();
+  snapshotByGC = getSnapShotForGC();
 }
 
 /*!
@@ -415,6 +467,9 @@ void iterateFieldObjectCallBack(void *oop, void *data) {
  * \param oop      [in] Java heap object(Inner class format).
  */
 inline void calculateObjectUsage(TSnapShotContainer *snapshot, void *oop) {
+  /* Measure cost of this hook for governor. */
+  TGCHookTimer hookTimer(oop);
+
   void *klassOop = getKlassOopFromOop(oop);
   TClassContainer *workClsContainer = clsContainer->getLocalContainer();
   /* Sanity check. */
@@ -429,8 +484,20 @@ inline void calculateObjectUsage(TSnapShotContainer *snapshot, void *oop) {
     return;
   }
 
+  hookTimer.setSnapshot(localSnapshot);
+
+  /* Governor skips this snapshot because hooks are too heavy. */
+  if (unlikely(snapshot->isSkipped())) {
+    return;
+  }
+
   snapshot->setIsCleared(false);
 
+  /* Skip objects which are not sampled. They are estimated at output. */
+  if (snapshot->isSampling() && !snapshot->isSampledObject(oop)) {
+    return;
+  }
+
   TClassCounter *clsCounter = NULL;
   TObjectData *clsData = NULL;
 
@@ -471,9 +538,12 @@ inline void calculateObjectUsage(TSnapShotContainer *snapshot, void *oop) {
 
   /* Count perent class size and instance count. */
   localSnapshot->FastInc(clsCounter->counter, size);
+  if (snapshot->isSampling()) {
+    localSnapshot->FastAddSample(size);
+  }
 
   /* If we should not collect reftree or oop has no field. */
-  if (!conf->CollectRefTree()->get() || !hasOopField(oopType)) {
+  if (!snapshot->isCollectRefTree() || !hasOopField(oopType)) {
     return;
   }
 
@@ -561,15 +631,15 @@ void JNICALL OnCMSGCStart(jvmtiEnv *jvmti) {
   }
 
   if (likely(snapshotByGC == NULL)) {
-    snapshotByGC = TSnapShotContainer::getInstance();
+    snapshotByGC = getSnapShotForGC();
   } else {
-    snapshotByGC->clear(false);
+    recycleSnapShotForGC(snapshotByGC);
   }
 
   if (likely(snapshotByCMS == NULL)) {
-    snapshotByCMS = TSnapShotContainer::getInstance();
+    snapshotByCMS = getSnapShotForGC();
   } else if (cmsState == CMS_FINALMARKING) {
-    snapshotByCMS->clear(false);
+    recycleSnapShotForGC(snapshotByCMS);
   }
 
   /* Enable inner GC event. */
@@ -595,7 +665,7 @@ void JNICALL OnCMSGCFinish(jvmtiEnv *jvmti) {
       /* Set information and push waiting queue. */
       outputSnapShotByGC(snapshotByGC);
       snapshotByGC = NULL;
-      snapshotByCMS->clear(false);
+      recycleSnapShotForGC(snapshotByCMS);
     }
   }
 }
@@ -738,6 +808,11 @@ jint setEventEnableForSnapShot(jvmtiEnv *jvmti, bool enable) {
     TGarbageCollectionFinishCallback::switchEventNotification(jvmti, mode);
   }
 
+  /* Switch sampled allocation event. */
+  if (conf->AllocProfile()->get()) {
+    TAllocationProfiler::getInstance()->switchEventNotification(jvmti, enable);
+  }
+
   return SUCCESS;
 }
 
@@ -760,9 +835,9 @@ void setThreadEnableForSnapShot(jvmtiEnv *jvmti, JNIEnv *env, bool enable) {
 
       if (TVMVariables::getInstance()->getUseG1()) {
         if (snapshotByGC == NULL) {
-          snapshotByGC = TSnapShotContainer::getInstance();
+          snapshotByGC = getSnapShotForGC();
         } else {
-          snapshotByGC->clear(false);
+          recycleSnapShotForGC(snapshotByGC);
         }
       }
 
@@ -795,7 +870,7 @@ void setThreadEnableForSnapShot(jvmtiEnv *jvmti, JNIEnv *env, bool enable) {
  * \brief Clear current SnapShot.
  */
 void clearCurrentSnapShot() {
-  snapshotByGC->clear(false);
+  recycleSnapShotForGC(snapshotByGC);
 }
 
 /*!
@@ -878,20 +953,18 @@ void onVMDeathForSnapShot(jvmtiEnv *jvmti, JNIEnv *env) {
  * \return Initialize process result.
  */
 jint onAgentInitForSnapShot(jvmtiEnv *jvmti) {
-  /* Initialize oop util. */
-  if (unlikely(!oopUtilInitialize(jvmti))) {
-    logger->printCritMsg(
-        "Please check installation and version of java and debuginfo "
-        "packages.");
-    return GET_LOW_LEVEL_INFO_FAILED;
-  }
-
   /* Initialize snapshot containers. */
   if (unlikely(!TSnapShotContainer::globalInitialize())) {
     logger->printCritMsg("TSnapshotContainer initialize failed!");
     return CLASSCONTAINER_INITIALIZE_FAILED;
   }
 
+  /* Initialize segments of snapshot file. */
+  if (unlikely(!TSnapShotFile::globalInitialize())) {
+    logger->printCritMsg("TSnapShotFile initialize failed!");
+    return CLASSCONTAINER_INITIALIZE_FAILED;
+  }
+
   /* Initialize TClassContainer. */
   try {
     clsContainer = new TClassContainer();
@@ -900,6 +973,42 @@ jint onAgentInitForSnapShot(jvmtiEnv *jvmti) {
     return CLASSCONTAINER_INITIALIZE_FAILED;
   }
 
+  /* Initialize allocation profiler. */
+  if (conf->AllocProfile()->get()) {
+    if (unlikely(!TAllocationProfiler::globalInitialize(
+                     conf->AllocProfileStackDepth()->get(),
+                     conf->AllocProfileInterval()->get()))) {
+      logger->printWarnMsg("Failed to initialize allocation profiler.");
+      conf->AllocProfile()->set(false);
+    }
+  }
+
+  /* Initialize live counter export. */
+  if (conf->LiveCounter()->get()) {
+    if (unlikely(!TLiveCounter::globalInitialize(
+                     conf->LiveCounterFile()->get()))) {
+      logger->printWarnMsg("Failed to initialize live counter.");
+      conf->LiveCounter()->set(false);
+    }
+  }
+
+  /* Initialize metrics server. */
+  if (conf->MetricsServer()->get()) {
+    if (unlikely(!TMetricsServer::globalInitialize(
+                     conf->MetricsSocket()->get()))) {
+      logger->printWarnMsg("Failed to initialize metrics server.");
+      conf->MetricsServer()->set(false);
+    }
+  }
+
+  /* Initialize GC overhead governor. */
+  if (conf->GCOverheadGovernor()->get()) {
+    if (unlikely(!TOverheadGovernor::globalInitialize())) {
+      logger->printWarnMsg("Failed to initialize GC overhead governor.");
+      conf->GCOverheadGovernor()->set(false);
+    }
+  }
+
   /* Create thread instances that controlled snapshot trigger. */
   try {
     gcWatcher = new TGCWatcher(&TakeSnapShot, jvmInfo);
@@ -941,9 +1050,25 @@ void onAgentFinalForSnapShot(JNIEnv *env) {
   /* Finalize and deallocate old snapshot containers. */
   TSnapShotContainer::globalFinalize();
 
+  /*
+   * alloc_profile might be turned off at InitEventSetting() after
+   * initialization.
+   */
+  TAllocationProfiler::globalFinalize();
+
+  /* Remove live counter file. */
+  TLiveCounter::globalFinalize();
+
+  /* Stop metrics server. Log function is already stopped at VMDeath. */
+  TMetricsServer::globalFinalize();
+
+  /* Snapshot at GC is not taken any more. */
+  TOverheadGovernor::globalFinalize();
+
   /* Destroy object that is for snapshot. */
   delete clsContainer;
   clsContainer = NULL;
+  TSnapShotFile::globalFinalize();
 
   /* Destroy object that is each snapshot trigger. */
   delete gcWatcher;
@@ -22,6 +22,7 @@
 #include "globals.hpp"
 #include "elapsedTimer.hpp"
 #include "fsUtil.hpp"
+#include "overheadGovernor.hpp"
 #include "snapShotProcessor.hpp"
 
 /*!
@@ -98,6 +99,8 @@ void JNICALL
     /* If waiting is finished by notification. */
     if (needProcess && (snapshot != NULL)) {
       int result = 0;
+      jlong startTime = getMonotonicTime();
+      jlong startCpuTime = getThreadCpuTime();
       {
         /* Count working time. */
         static const char *label = "Write SnapShot and calculation";
@@ -106,10 +109,31 @@ void JNICALL
         /* Marge children snapshot's data to parent snapshot. */
         snapshot->mergeChildren();
 
+        /* Adapt heap census in GC to its overhead. */
+        if (conf->GCOverheadGovernor()->get() &&
+            (snapshot->getHeader()->cause == GC)) {
+          TOverheadGovernor::getInstance()->update(snapshot);
+        }
+
         /* Output class-data. */
         result = controller->_container->afterTakeSnapShot(snapshot, &ranking);
       }
 
+      /* Publish summary to monitoring tools. */
+      jlong processTime = getMonotonicTime() - startTime;
+      jlong processCpuTime = getThreadCpuTime() - startCpuTime;
+      if (conf->LiveCounter()->get()) {
+        TLiveCounter::getInstance()->publish(snapshot->getHeader(), ranking,
+                                             processTime, processCpuTime);
+      }
+
+      if (conf->MetricsServer()->get()) {
+        TMetricsServer *server = TMetricsServer::getInstance();
+        server->updateSnapShot(snapshot->getHeader(), ranking, processTime,
+                               processCpuTime);
+        server->updateThreadRecorder();
+      }
+
       /* If raise disk full error. */
       if (unlikely(isRaisedDiskFull(result))) {
         checkDiskFull(result, "snapshot");
@@ -126,6 +150,12 @@ void JNICALL
         }
       }
 
+      /* Show allocation site ranking. */
+      if (conf->AllocProfile()->get()) {
+        TAllocationProfiler::getInstance()->showRanking(
+            jvmti, jni, conf->AllocProfileRank()->get());
+      }
+
       /* Clean up. */
       controller->_container->commitClassChange();
       TSnapShotContainer::releaseInstance(snapshot);
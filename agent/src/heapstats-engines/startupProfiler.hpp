@@ -0,0 +1,168 @@
+/*!
+ * \file startupProfiler.hpp
+ * \brief This file is used to measure each phase of agent startup.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#ifndef STARTUP_PROFILER_HPP
+#define STARTUP_PROFILER_HPP
+
+#include <jni.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "globals.hpp"
+
+/*!
+ * \brief Max number of recorded startup phases.
+ */
+#define STARTUP_PROFILER_MAX_PHASES 32
+
+/*!
+ * \brief Elapsed time of a startup phase.
+ */
+typedef struct {
+  const char *name;  /*!< Name of phase. It must be a string literal.     */
+  jlong start;       /*!< Start time from agent loading (in usec).        */
+  jlong elapsed;     /*!< Elapsed time of phase (in usec).                */
+} TStartupPhase;
+
+/*!
+ * \brief This class records elapsed time of each startup phase, and shows
+ *        them as table at the end of startup.<br>
+ *        Phases can be recorded from several threads.
+ */
+class TStartupProfiler {
+ public:
+  /*!
+   * \brief Set start time of agent.<br>
+   *        Please call this function at first of agent loading.
+   */
+  static void begin(void) {
+    baseTime = getTime();
+    phaseCount = 0;
+  }
+
+  /*!
+   * \brief Get current time on monotonic clock.
+   * \return Current time (in usec).
+   */
+  static jlong getTime(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (jlong)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+  }
+
+  /*!
+   * \brief Record elapsed time of phase.
+   * \param name  [in] Name of phase. It must be a string literal.
+   * \param start [in] Start time of phase from getTime().
+   */
+  static void record(const char *name, jlong start) {
+    jlong end = getTime();
+
+    pthread_mutex_lock(&mutex);
+    {
+      /* Phases over the limit are not shown. */
+      if (phaseCount < STARTUP_PROFILER_MAX_PHASES) {
+        phases[phaseCount].name = name;
+        phases[phaseCount].start = start - baseTime;
+        phases[phaseCount].elapsed = end - start;
+        phaseCount++;
+      }
+    }
+    pthread_mutex_unlock(&mutex);
+  }
+
+  /*!
+   * \brief Show table of all recorded phases.
+   * \param vmVersion [in] Version string of JVM.
+   */
+  static void print(const char *vmVersion) {
+    jlong total = getTime() - baseTime;
+
+    pthread_mutex_lock(&mutex);
+    {
+      logger->printInfoMsg("Startup time: %.3f msec (JVM %s)",
+                           total / 1000.0, vmVersion);
+      logger->printInfoMsg("  %-32s %10s %10s", "Phase", "Start", "Elapsed");
+      for (int i = 0; i < phaseCount; i++) {
+        logger->printInfoMsg("  %-32s %10.3f %10.3f", phases[i].name,
+                             phases[i].start / 1000.0,
+                             phases[i].elapsed / 1000.0);
+      }
+    }
+    pthread_mutex_unlock(&mutex);
+  }
+
+ private:
+  /*!
+   * \brief Time of agent loading.
+   */
+  static jlong baseTime;
+
+  /*!
+   * \brief Recorded phases.
+   */
+  static TStartupPhase phases[STARTUP_PROFILER_MAX_PHASES];
+
+  /*!
+   * \brief Number of recorded phases.
+   */
+  static int phaseCount;
+
+  /*!
+   * \brief Mutex of recorded phases.
+   */
+  static pthread_mutex_t mutex;
+};
+
+/*!
+ * \brief This class records a startup phase in its scope.
+ */
+class TStartupPhaseTimer {
+ public:
+  /*!
+   * \brief TStartupPhaseTimer constructor.
+   * \param name [in] Name of phase. It must be a string literal.
+   */
+  TStartupPhaseTimer(const char *name) {
+    this->name = name;
+    this->start = TStartupProfiler::getTime();
+  }
+
+  /*!
+   * \brief TStartupPhaseTimer destructor.
+   */
+  ~TStartupPhaseTimer() {
+    TStartupProfiler::record(this->name, this->start);
+  }
+
+ private:
+  /*!
+   * \brief Name of phase.
+   */
+  const char *name;
+
+  /*!
+   * \brief Start time of phase.
+   */
+  jlong start;
+};
+
+#endif  // STARTUP_PROFILER_HPP
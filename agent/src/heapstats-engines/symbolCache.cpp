@@ -0,0 +1,389 @@
+/*!
+ * \file symbolCache.cpp
+ * \brief This file is used to cache resolved symbols of library on disk.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "globals.hpp"
+#include "bufferedFdWriter.hpp"
+#include "symbolCache.hpp"
+
+/*!
+ * \brief Get hash value of key.
+ * \param key [in] Key of symbol cache.
+ * \return Hash value.
+ */
+size_t TSymbolCacheKeyHasher::operator()(const char *key) const {
+  size_t hash = 5381;
+  for (const unsigned char *pos = (const unsigned char *)key; *pos != '\0';
+       pos++) {
+    hash = hash * 33 + *pos;
+  }
+
+  return hash;
+}
+
+/*!
+ * \brief Compare keys.
+ * \param key1 [in] Key of symbol cache.
+ * \param key2 [in] Key of symbol cache.
+ * \return true if keys are the same.
+ */
+bool TSymbolCacheKeyEqual::operator()(const char *key1,
+                                      const char *key2) const {
+  return strcmp(key1, key2) == 0;
+}
+
+/*!
+ * \brief TSymbolCache constructor.
+ * \param dir          [in] Directory of cache file.
+ * \param libname      [in] Name of library.
+ * \param buildId      [in] Build-id of library in hex string.
+ * \param hasDebugInfo [in] Is debuginfo of library installed?
+ */
+TSymbolCache::TSymbolCache(const char *dir, const char *libname,
+                           const char *buildId, bool hasDebugInfo)
+    : entries() {
+  this->dir = strdup(dir);
+  this->buildId = strdup(buildId);
+
+  char cachePath[PATH_MAX];
+  snprintf(cachePath, PATH_MAX, "%s/%s-%s.symcache", dir, libname, buildId);
+  this->path = strdup(cachePath);
+
+  if (unlikely((this->dir == NULL) || (this->buildId == NULL) ||
+               (this->path == NULL))) {
+    free(this->dir);
+    free(this->buildId);
+    free(this->path);
+    throw ENOMEM;
+  }
+
+  this->hasDebugInfo = hasDebugInfo;
+  this->isDirty = false;
+  pthread_mutex_init(&this->mutex, NULL);
+}
+
+/*!
+ * \brief TSymbolCache destructor.
+ */
+TSymbolCache::~TSymbolCache(void) {
+  clear();
+  pthread_mutex_destroy(&this->mutex);
+
+  free(this->dir);
+  free(this->buildId);
+  free(this->path);
+}
+
+/*!
+ * \brief Remove all entries.
+ */
+void TSymbolCache::clear(void) {
+  for (std::tr1::unordered_map<const char *, TSymbolCacheEntry,
+                               TSymbolCacheKeyHasher,
+                               TSymbolCacheKeyEqual>::iterator itr =
+           entries.begin();
+       itr != entries.end(); itr++) {
+    free((void *)itr->first);
+  }
+
+  entries.clear();
+}
+
+/*!
+ * \brief Load cache file.<br>
+ *        The file is ignored if it is written for other build, or it is
+ *        not owned by the current user.<br>
+ *        Format of the file is header lines and "<key> <value>" lines.
+ *        Value is "-" if the key was not found.
+ * \return true if cache file is loaded.
+ */
+bool TSymbolCache::load(void) {
+  int fd = open(this->path, O_RDONLY);
+  if (fd < 0) {
+    logger->printDebugMsg("Symbol cache is not found: %s", this->path);
+    return false;
+  }
+
+  /* Values in cache are trusted, so cache written by others is ignored. */
+  struct stat st;
+  if (unlikely((fstat(fd, &st) != 0) || (st.st_uid != geteuid()) ||
+               ((st.st_mode & (S_IWGRP | S_IWOTH)) != 0))) {
+    logger->printWarnMsg("Symbol cache is ignored: %s", this->path);
+    close(fd);
+    return false;
+  }
+
+  FILE *in = fdopen(fd, "r");
+  if (unlikely(in == NULL)) {
+    logger->printWarnMsgWithErrno("Could not open symbol cache");
+    close(fd);
+    return false;
+  }
+
+  /* Header which should be matched. */
+  char header[4][SYMBOL_CACHE_MAX_LINE];
+  snprintf(header[0], SYMBOL_CACHE_MAX_LINE, "# HeapStats symbol cache\n");
+  snprintf(header[1], SYMBOL_CACHE_MAX_LINE, "version %d\n",
+           SYMBOL_CACHE_VERSION);
+  snprintf(header[2], SYMBOL_CACHE_MAX_LINE, "buildid %s\n", this->buildId);
+  snprintf(header[3], SYMBOL_CACHE_MAX_LINE, "debuginfo %d\n",
+           this->hasDebugInfo ? 1 : 0);
+
+  char line[SYMBOL_CACHE_MAX_LINE];
+  bool isValid = true;
+  for (int i = 0; i < 4; i++) {
+    if ((fgets(line, SYMBOL_CACHE_MAX_LINE, in) == NULL) ||
+        (strcmp(line, header[i]) != 0)) {
+      isValid = false;
+      break;
+    }
+  }
+
+  ENTER_PTHREAD_SECTION(&this->mutex) {
+    clear();
+
+    while (isValid && (fgets(line, SYMBOL_CACHE_MAX_LINE, in) != NULL)) {
+      char *lineEnd = strchr(line, '\n');
+      char *separator = strrchr(line, ' ');
+      if (unlikely((lineEnd == NULL) || (separator == NULL))) {
+        /* Broken or truncated line. */
+        isValid = false;
+        break;
+      }
+
+      *lineEnd = '\0';
+      *separator = '\0';
+      char *value = separator + 1;
+      bool isFound = (strcmp(value, "-") != 0);
+      if (unlikely(!addEntry(line, isFound ? strtoll(value, NULL, 10) : 0,
+                             isFound))) {
+        isValid = false;
+      }
+    }
+
+    if (unlikely(!isValid)) {
+      clear();
+    }
+
+    this->isDirty = false;
+  }
+  EXIT_PTHREAD_SECTION(&this->mutex)
+
+  fclose(in);
+
+  if (!isValid) {
+    logger->printDebugMsg("Symbol cache is not usable: %s", this->path);
+  }
+
+  return isValid;
+}
+
+/*!
+ * \brief Write all entries to cache file if any entry is added.<br>
+ *        Entries are written to temporary file at first, and it is renamed
+ *        to cache file to avoid reading incomplete file by other process.
+ * \return Value is zero, if process is succeed.<br />
+ *         Value is error number a.k.a. "errno", if process is failure.
+ */
+int TSymbolCache::save(void) {
+  int result = 0;
+
+  ENTER_PTHREAD_SECTION(&this->mutex) {
+    if (this->isDirty) {
+      char tempPath[PATH_MAX];
+      snprintf(tempPath, PATH_MAX, "%s.%d", this->path, getpid());
+
+      result = makeDirectory(this->dir);
+      int fd = -1;
+      if (likely(result == 0)) {
+        fd = open(tempPath, O_CREAT | O_WRONLY | O_TRUNC, S_IRUSR | S_IWUSR);
+        if (unlikely(fd < 0)) {
+          result = errno;
+        }
+      }
+
+      if (likely(fd >= 0)) {
+        try {
+          TBufferedFdWriter writer(fd);
+          writer.printf("# HeapStats symbol cache\n");
+          writer.printf("version %d\n", SYMBOL_CACHE_VERSION);
+          writer.printf("buildid %s\n", this->buildId);
+          writer.printf("debuginfo %d\n", this->hasDebugInfo ? 1 : 0);
+
+          for (std::tr1::unordered_map<const char *, TSymbolCacheEntry,
+                                       TSymbolCacheKeyHasher,
+                                       TSymbolCacheKeyEqual>::iterator itr =
+                   entries.begin();
+               itr != entries.end(); itr++) {
+            if (itr->second.isFound) {
+              writer.printf("%s %lld\n", itr->first,
+                            (long long)itr->second.value);
+            } else {
+              writer.printf("%s -\n", itr->first);
+            }
+          }
+
+          result = writer.flush();
+        } catch (...) {
+          result = ENOMEM;
+        }
+
+        if (unlikely((close(fd) != 0) && (result == 0))) {
+          result = errno;
+        }
+
+        if (likely(result == 0) &&
+            unlikely(rename(tempPath, this->path) != 0)) {
+          result = errno;
+        }
+
+        if (unlikely(result != 0)) {
+          unlink(tempPath);
+        }
+      }
+
+      if (likely(result == 0)) {
+        this->isDirty = false;
+      }
+    }
+  }
+  EXIT_PTHREAD_SECTION(&this->mutex)
+
+  return result;
+}
+
+/*!
+ * \brief Look up resolved value.
+ * \param key   [in]  Key of value.
+ * \param value [out] Resolved value if result is SYMBOL_CACHE_FOUND.
+ * \return Result of looking up.
+ */
+TSymbolCacheResult TSymbolCache::find(const char *key, jlong *value) {
+  TSymbolCacheResult result = SYMBOL_CACHE_MISS;
+
+  ENTER_PTHREAD_SECTION(&this->mutex) {
+    std::tr1::unordered_map<const char *, TSymbolCacheEntry,
+                            TSymbolCacheKeyHasher,
+                            TSymbolCacheKeyEqual>::iterator itr =
+        entries.find(key);
+    if (itr != entries.end()) {
+      if (itr->second.isFound) {
+        *value = itr->second.value;
+        result = SYMBOL_CACHE_FOUND;
+      } else {
+        result = SYMBOL_CACHE_NOT_FOUND;
+      }
+    }
+  }
+  EXIT_PTHREAD_SECTION(&this->mutex)
+
+  return result;
+}
+
+/*!
+ * \brief Add resolved value.
+ * \param key     [in] Key of value.
+ * \param value   [in] Resolved value.
+ * \param isFound [in] Was key found in the library?
+ */
+void TSymbolCache::add(const char *key, jlong value, bool isFound) {
+  ENTER_PTHREAD_SECTION(&this->mutex) {
+    if (likely(addEntry(key, value, isFound))) {
+      this->isDirty = true;
+    }
+  }
+  EXIT_PTHREAD_SECTION(&this->mutex)
+}
+
+/*!
+ * \brief Add resolved value without lock.
+ * \param key     [in] Key of value.
+ * \param value   [in] Resolved value.
+ * \param isFound [in] Was key found in the library?
+ * \return true if entry is added or updated.
+ */
+bool TSymbolCache::addEntry(const char *key, jlong value, bool isFound) {
+  TSymbolCacheEntry entry = {value, isFound};
+
+  std::tr1::unordered_map<const char *, TSymbolCacheEntry,
+                          TSymbolCacheKeyHasher,
+                          TSymbolCacheKeyEqual>::iterator itr =
+      entries.find(key);
+  if (itr != entries.end()) {
+    itr->second = entry;
+    return true;
+  }
+
+  char *keyStr = strdup(key);
+  if (unlikely(keyStr == NULL)) {
+    return false;
+  }
+
+  try {
+    entries[keyStr] = entry;
+  } catch (...) {
+    free(keyStr);
+    return false;
+  }
+
+  return true;
+}
+
+/*!
+ * \brief Create directory and its parents.<br>
+ *        Created directories are accessible only by the current user.
+ * \param dir [in] Path of directory.
+ * \return Value is zero, if process is succeed.<br />
+ *         Value is error number a.k.a. "errno", if process is failure.
+ */
+int TSymbolCache::makeDirectory(const char *dir) {
+  char work[PATH_MAX];
+  if (unlikely(strlen(dir) >= PATH_MAX)) {
+    return ENAMETOOLONG;
+  }
+
+  strcpy(work, dir);
+  for (char *pos = work + 1;; pos++) {
+    if ((*pos == '/') || (*pos == '\0')) {
+      char separator = *pos;
+      *pos = '\0';
+      if ((mkdir(work, S_IRWXU) != 0) && (errno != EEXIST)) {
+        return errno;
+      }
+
+      if (separator == '\0') {
+        break;
+      }
+
+      *pos = separator;
+    }
+  }
+
+  return 0;
+}
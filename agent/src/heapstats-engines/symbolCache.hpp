@@ -0,0 +1,192 @@
+/*!
+ * \file symbolCache.hpp
+ * \brief This file is used to cache resolved symbols of library on disk.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#ifndef SYMBOL_CACHE_HPP
+#define SYMBOL_CACHE_HPP
+
+#include <jni.h>
+#include <pthread.h>
+
+#include <tr1/unordered_map>
+
+/*!
+ * \brief Version of symbol cache file format.
+ */
+#define SYMBOL_CACHE_VERSION 1
+
+/*!
+ * \brief Max length of a line in symbol cache file.
+ */
+#define SYMBOL_CACHE_MAX_LINE 1024
+
+/*!
+ * \brief Result of looking up symbol cache.
+ */
+typedef enum {
+  SYMBOL_CACHE_MISS = 0,  /*!< Key has not been resolved yet.            */
+  SYMBOL_CACHE_FOUND,     /*!< Key was resolved to the value.           */
+  SYMBOL_CACHE_NOT_FOUND  /*!< Key was not found in the library.        */
+} TSymbolCacheResult;
+
+/*!
+ * \brief Entry of symbol cache.
+ */
+typedef struct {
+  jlong value;  /*!< Resolved value. Address is relative to library base. */
+  bool isFound; /*!< Was key found in the library?                        */
+} TSymbolCacheEntry;
+
+/*!
+ * \brief Hasher of key of symbol cache.
+ */
+struct TSymbolCacheKeyHasher {
+  size_t operator()(const char *key) const;
+};
+
+/*!
+ * \brief Comparator of key of symbol cache.
+ */
+struct TSymbolCacheKeyEqual {
+  bool operator()(const char *key1, const char *key2) const;
+};
+
+/*!
+ * \brief This class keeps resolved symbols and VMStructs values of a library
+ *        in a file which is named by build-id of the library.<br>
+ *        The same build of the library has the same relative addresses, so
+ *        they can be reused without loading symbol tables.
+ */
+class TSymbolCache {
+ public:
+  /*!
+   * \brief TSymbolCache constructor.
+   * \param dir          [in] Directory of cache file.
+   * \param libname      [in] Name of library.
+   * \param buildId      [in] Build-id of library in hex string.
+   * \param hasDebugInfo [in] Is debuginfo of library installed?
+   */
+  TSymbolCache(const char *dir, const char *libname, const char *buildId,
+               bool hasDebugInfo);
+
+  /*!
+   * \brief TSymbolCache destructor.
+   */
+  virtual ~TSymbolCache(void);
+
+  /*!
+   * \brief Load cache file.<br>
+   *        The file is ignored if it is written for other build, or it is
+   *        not owned by the current user.
+   * \return true if cache file is loaded.
+   */
+  bool load(void);
+
+  /*!
+   * \brief Write all entries to cache file if any entry is added.
+   * \return Value is zero, if process is succeed.<br />
+   *         Value is error number a.k.a. "errno", if process is failure.
+   */
+  int save(void);
+
+  /*!
+   * \brief Look up resolved value.
+   * \param key   [in]  Key of value.
+   * \param value [out] Resolved value if result is SYMBOL_CACHE_FOUND.
+   * \return Result of looking up.
+   */
+  TSymbolCacheResult find(const char *key, jlong *value);
+
+  /*!
+   * \brief Add resolved value.
+   * \param key     [in] Key of value.
+   * \param value   [in] Resolved value.
+   * \param isFound [in] Was key found in the library?
+   */
+  void add(const char *key, jlong value, bool isFound);
+
+  /*!
+   * \brief Get path of cache file.
+   * \return Path of cache file.
+   */
+  inline const char *getPath(void) { return this->path; };
+
+ private:
+  /*!
+   * \brief Directory of cache file.
+   */
+  char *dir;
+
+  /*!
+   * \brief Path of cache file.
+   */
+  char *path;
+
+  /*!
+   * \brief Build-id of library in hex string.
+   */
+  char *buildId;
+
+  /*!
+   * \brief Is debuginfo of library installed?<br>
+   *        Symbols which were not found might be found with debuginfo.
+   */
+  bool hasDebugInfo;
+
+  /*!
+   * \brief Is any entry added after cache file is loaded or saved?
+   */
+  bool isDirty;
+
+  /*!
+   * \brief Mutex of entries.
+   */
+  pthread_mutex_t mutex;
+
+  /*!
+   * \brief Resolved values.
+   */
+  std::tr1::unordered_map<const char *, TSymbolCacheEntry,
+                          TSymbolCacheKeyHasher, TSymbolCacheKeyEqual> entries;
+
+  /*!
+   * \brief Add resolved value without lock.
+   * \param key     [in] Key of value.
+   * \param value   [in] Resolved value.
+   * \param isFound [in] Was key found in the library?
+   * \return true if entry is added or updated.
+   */
+  bool addEntry(const char *key, jlong value, bool isFound);
+
+  /*!
+   * \brief Remove all entries.
+   */
+  void clear(void);
+
+  /*!
+   * \brief Create directory and its parents.
+   * \param dir [in] Path of directory.
+   * \return Value is zero, if process is succeed.<br />
+   *         Value is error number a.k.a. "errno", if process is failure.
+   */
+  static int makeDirectory(const char *dir);
+};
+
+#endif  // SYMBOL_CACHE_HPP
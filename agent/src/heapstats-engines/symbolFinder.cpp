@@ -57,6 +57,50 @@ inline void createLibInfo(TLibraryInfo *libinfo, const char *libPath,
   }
 }
 
+/*!
+ * \brief Get build-id from note segments of loaded library.<br>
+ *        Library file does not need to be opened.
+ * \param info [in] Information of loaded library on memory.
+ * \return Build-id in hex string, or NULL if it is not found.<br>
+ *         It should be freed by caller.
+ */
+static char *getBuildIdFromMemory(struct dl_phdr_info *info) {
+  for (int idx = 0; idx < info->dlpi_phnum; idx++) {
+    const ElfW(Phdr) *phdr = &info->dlpi_phdr[idx];
+    if (phdr->p_type != PT_NOTE) {
+      continue;
+    }
+
+    char *note = (char *)(info->dlpi_addr + phdr->p_vaddr);
+    char *noteEnd = note + phdr->p_memsz;
+    while (note + sizeof(ElfW(Nhdr)) <= noteEnd) {
+      ElfW(Nhdr) *nhdr = (ElfW(Nhdr) *)note;
+      char *name = note + sizeof(ElfW(Nhdr));
+      unsigned char *desc =
+          (unsigned char *)name + ALIGN_SIZE_UP(nhdr->n_namesz, 4);
+
+      if ((nhdr->n_type == NT_GNU_BUILD_ID) && (nhdr->n_namesz == 4) &&
+          (memcmp(name, "GNU", 4) == 0)) {
+        char *buildId = (char *)malloc(nhdr->n_descsz * 2 + 1);
+        if (unlikely(buildId == NULL)) {
+          return NULL;
+        }
+
+        for (unsigned int Cnt = 0; Cnt < nhdr->n_descsz; Cnt++) {
+          sprintf(buildId + Cnt * 2, "%02hhx", desc[Cnt]);
+        }
+
+        buildId[nhdr->n_descsz * 2] = '\0';
+        return buildId;
+      }
+
+      note = (char *)desc + ALIGN_SIZE_UP(nhdr->n_descsz, 4);
+    }
+  }
+
+  return NULL;
+}
+
 /*!
  * \brief Callback function of dl_iterate_phdr(3).
  * \param info [in] Information of loaded library on memory.
@@ -84,6 +128,7 @@ static int libraryCallback(struct dl_phdr_info *info, size_t size, void *data) {
     /* Store library information. */
     libinfo->realpath = strdup(real_path);
     libinfo->baseaddr = info->dlpi_addr;
+    libinfo->buildid = getBuildIdFromMemory(info);
 
     /* Abort callback loop. */
     return 1;
@@ -108,6 +153,10 @@ TSymbolFinder::TSymbolFinder(void) {
   memset(&debugBfdInfo, 0, sizeof(debugBfdInfo));
 
   memset(&targetLibInfo, 0, sizeof(targetLibInfo));
+
+  isSymTableLoaded = false;
+  symCache = NULL;
+  pthread_mutex_init(&mutex, NULL);
 }
 
 /*!
@@ -116,15 +165,21 @@ TSymbolFinder::TSymbolFinder(void) {
 TSymbolFinder::~TSymbolFinder() {
   /* Cleanup. */
   this->clear();
+  pthread_mutex_destroy(&mutex);
 }
 
 /*!
- * \brief Load target libaray.
+ * \brief Load target libaray.<br>
+ *        If symbol cache of the same build is available, loading symbol
+ *        tables is deferred until a symbol which is not cached is needed.
  * \param pathPattern [in] Pattern of target library path.
  * \param libname     [in] Name of library.
+ * \param cacheDir    [in] Directory of symbol cache, or NULL if symbol
+ *                         cache is not used.
  * \return Is success load library.<br>
  */
-bool TSymbolFinder::loadLibrary(const char *pathPattern, const char *libname) {
+bool TSymbolFinder::loadLibrary(const char *pathPattern, const char *libname,
+                                const char *cacheDir) {
   /* Sanity check. */
   if (unlikely(pathPattern == NULL)) {
     logger->printWarnMsg("Library path is not set.");
@@ -140,6 +195,7 @@ bool TSymbolFinder::loadLibrary(const char *pathPattern, const char *libname) {
   createLibInfo(&targetLibInfo, pathPattern, libname);
   targetLibInfo.realpath = NULL;
   targetLibInfo.baseaddr = ((ptrdiff_t)0);
+  targetLibInfo.buildid = NULL;
 
   /* If failure allocate memory. */
   if (unlikely((targetLibInfo.libpath == NULL) ||
@@ -158,8 +214,56 @@ bool TSymbolFinder::loadLibrary(const char *pathPattern, const char *libname) {
     return false;
   }
 
+  /* Use symbol cache if the library has build-id. */
+  if ((cacheDir != NULL) && (targetLibInfo.buildid != NULL)) {
+    /* Symbols which were not found might be found with debuginfo. */
+    char dbgInfoPath[PATH_MAX];
+    struct stat st;
+    snprintf(dbgInfoPath, PATH_MAX,
+             DEBUGINFO_DIR "/.build-id/%.2s/%s" DEBUGINFO_SUFFIX,
+             targetLibInfo.buildid, targetLibInfo.buildid + 2);
+    bool hasDebugInfo = (stat(dbgInfoPath, &st) == 0);
+
+    try {
+      symCache = new TSymbolCache(cacheDir, libname, targetLibInfo.buildid,
+                                  hasDebugInfo);
+    } catch (...) {
+      logger->printWarnMsg("Cannot allocate memory for symbol cache.");
+      symCache = NULL;
+    }
+
+    if ((symCache != NULL) && symCache->load()) {
+      logger->printDebugMsg("Symbols are loaded from %s",
+                            symCache->getPath());
+      return true;
+    }
+  }
+
+  if (unlikely(!loadSymbolTables())) {
+    free(targetLibInfo.libname);
+    targetLibInfo.libname = NULL;
+    free(targetLibInfo.libpath);
+    targetLibInfo.libpath = NULL;
+    free(targetLibInfo.realpath);
+    targetLibInfo.realpath = NULL;
+    free(targetLibInfo.buildid);
+    targetLibInfo.buildid = NULL;
+    delete symCache;
+    symCache = NULL;
+    return false;
+  }
+
+  return true;
+}
+
+/*!
+ * \brief Load symbol tables of target library and its debuginfo.
+ * \return true if any symbol table is loaded.
+ */
+bool TSymbolFinder::loadSymbolTables(void) {
   /* Load library with bfd record. */
   loadLibraryInfo(targetLibInfo.realpath, &libBfdInfo);
+  isSymTableLoaded = true;
 
   /* If bfd record has the symbols, no need to search debuginfo */
   if (libBfdInfo.hasSymtab && libBfdInfo.staticSymCnt > 0 &&
@@ -225,12 +329,6 @@ bool TSymbolFinder::loadLibrary(const char *pathPattern, const char *libname) {
   if (unlikely(libBfdInfo.staticSymCnt == 0 && debugBfdInfo.staticSymCnt == 0 &&
                libBfdInfo.dynSymCnt == 0 && debugBfdInfo.dynSymCnt == 0)) {
     logger->printWarnMsg("Cannot load library information.");
-    free(targetLibInfo.libname);
-    targetLibInfo.libname = NULL;
-    free(targetLibInfo.libpath);
-    targetLibInfo.libpath = NULL;
-    free(targetLibInfo.realpath);
-    targetLibInfo.realpath = NULL;
     return false;
   }
 
@@ -246,6 +344,30 @@ bool TSymbolFinder::loadLibrary(const char *pathPattern, const char *libname) {
 void *TSymbolFinder::findSymbol(char const *symbol) {
   void *result = NULL;
 
+  /* Use the address which was resolved by the same build. */
+  if (symCache != NULL) {
+    jlong cachedAddr;
+    switch (symCache->find(symbol, &cachedAddr)) {
+      case SYMBOL_CACHE_FOUND:
+        return getAbsoluteAddress((void *)cachedAddr);
+      case SYMBOL_CACHE_NOT_FOUND:
+        return NULL;
+      default:
+        break;
+    }
+  }
+
+  /* Load symbol tables at the first miss of symbol cache. */
+  if (unlikely(!isSymTableLoaded)) {
+    ENTER_PTHREAD_SECTION(&mutex) {
+      if (!isSymTableLoaded) {
+        logger->printDebugMsg("Symbol cache does not have %s", symbol);
+        loadSymbolTables();
+      }
+    }
+    EXIT_PTHREAD_SECTION(&mutex)
+  }
+
   /* Search symbol in library as static symbol. */
 
   if (likely(libBfdInfo.staticSymCnt != 0)) {
@@ -279,6 +401,10 @@ void *TSymbolFinder::findSymbol(char const *symbol) {
     }
   }
 
+  if (symCache != NULL) {
+    symCache->add(symbol, (jlong)result, result != NULL);
+  }
+
   if (likely(result != NULL)) {
     /* Convert absolute symbol address. */
     result = getAbsoluteAddress(result);
@@ -396,6 +522,13 @@ void TSymbolFinder::clear(void) {
   targetLibInfo.libpath = NULL;
   free(targetLibInfo.realpath);
   targetLibInfo.realpath = NULL;
+  free(targetLibInfo.buildid);
+  targetLibInfo.buildid = NULL;
+
+  /* Discard symbol cache. */
+  delete symCache;
+  symCache = NULL;
+  isSymTableLoaded = false;
 
   /* Deallocate and null-clear bfd object. */
   if (unlikely(libBfdInfo.bfdInfo != NULL)) {
@@ -425,3 +558,20 @@ void TSymbolFinder::clear(void) {
   debugBfdInfo.dynSyms = NULL;
   debugBfdInfo.dynSymCnt = 0;
 }
+
+/*!
+ * \brief Write symbols which are resolved in this process to symbol
+ *        cache.
+ */
+void TSymbolFinder::saveCache(void) {
+  if (symCache == NULL) {
+    return;
+  }
+
+  int ret = symCache->save();
+  if (unlikely(ret != 0)) {
+    errno = ret;
+    logger->printWarnMsgWithErrno("Could not save symbol cache: %s",
+                                  symCache->getPath());
+  }
+}
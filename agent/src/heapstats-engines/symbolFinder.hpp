@@ -23,10 +23,12 @@
 #define _SYMBOL_FINDER_HPP
 
 #include <bfd.h>
+#include <pthread.h>
 #include <sys/stat.h>
 #include <stddef.h>
 
 #include "util.hpp"
+#include "symbolCache.hpp"
 
 #ifndef DEBUGINFO_DIR
 
@@ -54,6 +56,7 @@ typedef struct {
   size_t libpath_len; /*!< Length of library path.          */
   char *realpath;     /*!< Real path of library.            */
   ptrdiff_t baseaddr; /*!< Pointer of library base address. */
+  char *buildid;      /*!< Build-id in hex string, or NULL. */
 } TLibraryInfo;
 
 /*!
@@ -100,9 +103,12 @@ class TSymbolFinder {
    * \brief Load target libaray.
    * \param pathPattern [in] Pattern of target library path.
    * \param libname     [in] Name of library.
+   * \param cacheDir    [in] Directory of symbol cache, or NULL if symbol
+   *                         cache is not used.
    * \return Is success load library.<br>
    */
-  virtual bool loadLibrary(const char *pathPattern, const char *libname);
+  virtual bool loadLibrary(const char *pathPattern, const char *libname,
+                           const char *cacheDir = NULL);
 
   /*!
    * \brief Find symbol in target library.
@@ -117,6 +123,18 @@ class TSymbolFinder {
    */
   virtual void clear(void);
 
+  /*!
+   * \brief Write symbols which are resolved in this process to symbol
+   *        cache.
+   */
+  void saveCache(void);
+
+  /*!
+   * \brief Get symbol cache of target library.
+   * \return Symbol cache, or NULL if symbol cache is not used.
+   */
+  inline TSymbolCache *getSymbolCache(void) { return this->symCache; };
+
   /*!
    * \brief Get target library name.
    * \return String of library name.
@@ -151,6 +169,12 @@ class TSymbolFinder {
    */
   virtual void loadLibraryInfo(char const *path, TLibBFDInfo *libInfo);
 
+  /*!
+   * \brief Load symbol tables of target library and its debuginfo.
+   * \return true if any symbol table is loaded.
+   */
+  virtual bool loadSymbolTables(void);
+
   /*!
    * \brief Find symbol in target library to use BFD.
    * \param libInfo  [in] BFD information record.
@@ -180,6 +204,19 @@ class TSymbolFinder {
    * \brief BFD record of target library's debug information.
    */
   TLibBFDInfo debugBfdInfo;
+  /*!
+   * \brief Are symbol tables loaded?<br>
+   *        They are loaded at the first miss of symbol cache.
+   */
+  volatile bool isSymTableLoaded;
+  /*!
+   * \brief Mutex for loading symbol tables.
+   */
+  pthread_mutex_t mutex;
+  /*!
+   * \brief Symbol cache of target library.
+   */
+  TSymbolCache *symCache;
 };
 
 #endif  // _SYMBOL_FINDER_HPP
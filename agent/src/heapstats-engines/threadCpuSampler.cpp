@@ -0,0 +1,474 @@
+/*!
+ * \file threadCpuSampler.cpp
+ * \brief This file is used to rank threads by CPU time in /proc/self/task.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include <jvmti.h>
+#include <jni.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "globals.hpp"
+#include "util.hpp"
+#include "sorter.hpp"
+#include "threadCpuSampler.hpp"
+
+#if PROCESSOR_ARCH == X86
+#include "arch/x86/lock.inline.hpp"
+#elif PROCESSOR_ARCH == ARM
+#include "arch/arm/lock.inline.hpp"
+#endif
+
+/*!
+ * \brief Directory entry which is returned by getdents64(2).
+ */
+struct TLinuxDirent64 {
+  ino64_t d_ino;           /*!< Inode number.               */
+  off64_t d_off;           /*!< Offset to next entry.       */
+  unsigned short d_reclen; /*!< Length of this entry.       */
+  unsigned char d_type;    /*!< File type.                  */
+  char d_name[];           /*!< File name (NULL-terminated). */
+};
+
+/*!
+ * \brief Comparator of CPU time in interval for TSorter.
+ * \param arg1 [in] Statistics of thread.
+ * \param arg2 [in] Statistics of thread.
+ * \return Difference of CPU time in interval.
+ */
+static int ThreadCpuTicksCmp(const void *arg1, const void *arg2) {
+  jlong ticks1 = ((TThreadCpuStat *)arg1)->intervalTicks;
+  jlong ticks2 = ((TThreadCpuStat *)arg2)->intervalTicks;
+
+  return (ticks1 > ticks2) ? 1 : ((ticks1 < ticks2) ? -1 : 0);
+}
+
+/*!
+ * \brief JVMTI callback for ThreadStart event.
+ * \param jvmti  [in] JVMTI environment.
+ * \param env    [in] JNI environment of the event (current) thread.
+ * \param thread [in] Started thread.
+ */
+void JNICALL OnThreadStartForThreadCpu(jvmtiEnv *jvmti, JNIEnv *env,
+                                       jthread thread) {
+  TThreadCpuSampler::getInstance()->onThreadStart(jvmti, thread);
+}
+
+/*!
+ * \brief JVMTI callback for ThreadEnd event.
+ * \param jvmti  [in] JVMTI environment.
+ * \param env    [in] JNI environment of the event (current) thread.
+ * \param thread [in] Terminated thread.
+ */
+void JNICALL OnThreadEndForThreadCpu(jvmtiEnv *jvmti, JNIEnv *env,
+                                     jthread thread) {
+  TThreadCpuSampler::getInstance()->onThreadEnd();
+}
+
+/* Class static variables. */
+
+/*!
+ * \brief Singleton instance of TThreadCpuSampler.
+ */
+TThreadCpuSampler *TThreadCpuSampler::inst = NULL;
+
+/* Class methods. */
+
+/*!
+ * \brief Global initialization.
+ * \return Process result.
+ * \warning Please call only once from main thread.
+ */
+bool TThreadCpuSampler::globalInitialize(void) {
+  try {
+    inst = new TThreadCpuSampler();
+  } catch (...) {
+    logger->printCritMsg("Cannot initialize TThreadCpuSampler.");
+    return false;
+  }
+
+  return true;
+}
+
+/*!
+ * \brief Global finalization.
+ */
+void TThreadCpuSampler::globalFinalize(void) {
+  delete inst;
+  inst = NULL;
+}
+
+/*!
+ * \brief TThreadCpuSampler constructor.
+ */
+TThreadCpuSampler::TThreadCpuSampler(void)
+    : cachedFds(0), generation(0), stats(), names(), namesLockVal(0) {
+  clockTicks = sysconf(_SC_CLK_TCK);
+  if (unlikely(clockTicks <= 0)) {
+    clockTicks = 100;
+  }
+
+  taskDirFd = open("/proc/self/task", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (unlikely(taskDirFd < 0)) {
+    int raisedErrNum = errno;
+    logger->printWarnMsgWithErrno("Could not open /proc/self/task");
+    throw raisedErrNum;
+  }
+
+  dentsBuf = (char *)malloc(THREAD_CPU_DENTS_BUFFER_SIZE);
+  if (unlikely(dentsBuf == NULL)) {
+    int raisedErrNum = errno;
+    close(taskDirFd);
+    throw raisedErrNum;
+  }
+}
+
+/*!
+ * \brief TThreadCpuSampler destructor.
+ */
+TThreadCpuSampler::~TThreadCpuSampler() {
+  for (std::tr1::unordered_map<pid_t, TThreadCpuStat,
+                               TNumericalHasher<pid_t> >::iterator itr =
+           stats.begin();
+       itr != stats.end(); itr++) {
+    if (itr->second.statFd >= 0) {
+      close(itr->second.statFd);
+    }
+  }
+
+  for (std::tr1::unordered_map<pid_t, char *,
+                               TNumericalHasher<pid_t> >::iterator itr =
+           names.begin();
+       itr != names.end(); itr++) {
+    free(itr->second);
+  }
+
+  free(dentsBuf);
+  close(taskDirFd);
+}
+
+/*!
+ * \brief Record name of the current thread.
+ * \param jvmti  [in] JVMTI environment.
+ * \param thread [in] Current thread.
+ */
+void TThreadCpuSampler::onThreadStart(jvmtiEnv *jvmti, jthread thread) {
+  jvmtiThreadInfo threadInfo;
+  if (isError(jvmti, jvmti->GetThreadInfo(thread, &threadInfo))) {
+    return;
+  }
+
+  pid_t tid = (pid_t)syscall(SYS_gettid);
+  char *name = strdup(threadInfo.name);
+  jvmti->Deallocate((unsigned char *)threadInfo.name);
+
+  if (unlikely(name == NULL)) {
+    return;
+  }
+
+  spinLockWait(&namesLockVal);
+  {
+    try {
+      char *current = names[tid];
+      if (unlikely(current != NULL)) {
+        free(current);
+      }
+
+      names[tid] = name;
+    } catch (...) {
+      /*
+       * Maybe failed to allocate memory at "std::map::operator[]".
+       * The thread is named by comm.
+       */
+      free(name);
+    }
+  }
+  spinLockRelease(&namesLockVal);
+}
+
+/*!
+ * \brief Forget name of the current thread.
+ */
+void TThreadCpuSampler::onThreadEnd(void) {
+  pid_t tid = (pid_t)syscall(SYS_gettid);
+
+  spinLockWait(&namesLockVal);
+  {
+    std::tr1::unordered_map<pid_t, char *, TNumericalHasher<pid_t> >::iterator
+        itr = names.find(tid);
+
+    if (itr != names.end()) {
+      free(itr->second);
+      names.erase(itr);
+    }
+  }
+  spinLockRelease(&namesLockVal);
+}
+
+/*!
+ * \brief Read CPU ticks of the thread.
+ * \param stat  [in,out] Statistics of the thread.
+ * \param ticks [out]    utime + stime of the thread.
+ * \return false if the thread has been terminated.
+ */
+bool TThreadCpuSampler::readThreadTicks(TThreadCpuStat *stat, jlong *ticks) {
+  int fd = stat->statFd;
+
+  if (fd < 0) {
+    char path[32];
+    snprintf(path, sizeof(path), "%d/stat", stat->tid);
+
+    fd = openat(taskDirFd, path, O_RDONLY | O_CLOEXEC);
+    if (unlikely(fd < 0)) {
+      return false;
+    }
+
+    /* Keep stat file opened while the number of FDs is bounded. */
+    if (cachedFds < THREAD_CPU_MAX_CACHED_FDS) {
+      stat->statFd = fd;
+      cachedFds++;
+    }
+  }
+
+  char buf[512];
+  ssize_t len = pread(fd, buf, sizeof(buf) - 1, 0);
+
+  if (stat->statFd != fd) {
+    close(fd);
+  }
+
+  if (unlikely(len <= 0)) {
+    return false;
+  }
+
+  buf[len] = '\0';
+
+  /* comm might contain spaces and parentheses. */
+  char *pos = strrchr(buf, ')');
+  if (unlikely(pos == NULL)) {
+    return false;
+  }
+
+  /* Skip from state (3rd) to cmajflt (13th). */
+  pos++;
+  for (int cnt = 0; cnt < 11; cnt++) {
+    pos = strchr(pos + 1, ' ');
+    if (unlikely(pos == NULL)) {
+      return false;
+    }
+  }
+
+  char *endPtr;
+  jlong utime = strtoll(pos + 1, &endPtr, 10);
+  jlong stime = strtoll(endPtr + 1, NULL, 10);
+
+  *ticks = utime + stime;
+  return true;
+}
+
+/*!
+ * \brief Get name of the thread.
+ * \param tid    [in]  Thread ID (LWP ID).
+ * \param buf    [out] Buffer to store name.
+ * \param len    [in]  Length of buf.
+ * \param isJava [out] Whether the thread is Java thread.
+ */
+void TThreadCpuSampler::getThreadName(pid_t tid, char *buf, size_t len,
+                                      bool *isJava) {
+  *isJava = false;
+
+  spinLockWait(&namesLockVal);
+  {
+    std::tr1::unordered_map<pid_t, char *, TNumericalHasher<pid_t> >::iterator
+        itr = names.find(tid);
+
+    if (itr != names.end()) {
+      strncpy(buf, itr->second, len - 1);
+      buf[len - 1] = '\0';
+      *isJava = true;
+    }
+  }
+  spinLockRelease(&namesLockVal);
+
+  if (*isJava) {
+    return;
+  }
+
+  /* Native thread or thread which started before VMInit. */
+  char path[32];
+  snprintf(path, sizeof(path), "%d/comm", tid);
+  strncpy(buf, "(unknown)", len - 1);
+  buf[len - 1] = '\0';
+
+  int fd = openat(taskDirFd, path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return;
+  }
+
+  ssize_t readLen = read(fd, buf, len - 1);
+  close(fd);
+
+  if (readLen > 0) {
+    buf[readLen] = '\0';
+    char *newLine = strchr(buf, '\n');
+    if (newLine != NULL) {
+      *newLine = '\0';
+    }
+  }
+}
+
+/*!
+ * \brief Read CPU time of all threads, and drop terminated threads.
+ */
+void TThreadCpuSampler::sample(void) {
+  generation++;
+
+  /* Rewind cached directory FD instead of opendir(3). */
+  if (unlikely(lseek(taskDirFd, 0, SEEK_SET) != 0)) {
+    logger->printWarnMsgWithErrno("Could not rewind /proc/self/task");
+    return;
+  }
+
+  long readLen;
+  while ((readLen = syscall(SYS_getdents64, taskDirFd, dentsBuf,
+                            THREAD_CPU_DENTS_BUFFER_SIZE)) > 0) {
+    for (long ofs = 0; ofs < readLen;) {
+      TLinuxDirent64 *entry = (TLinuxDirent64 *)(dentsBuf + ofs);
+      ofs += entry->d_reclen;
+
+      if (entry->d_name[0] == '.') {
+        continue;
+      }
+
+      pid_t tid = (pid_t)atoi(entry->d_name);
+      TThreadCpuStat *stat;
+
+      try {
+        stat = &stats[tid];
+      } catch (...) {
+        /* Maybe failed to allocate memory at "std::map::operator[]". */
+        continue;
+      }
+
+      if (stat->tid == 0) {
+        /* New thread. All of its CPU time is consumed in this interval. */
+        stat->tid = tid;
+        stat->statFd = -1;
+        stat->ticks = 0;
+      }
+
+      jlong ticks;
+      if (!readThreadTicks(stat, &ticks)) {
+        continue;
+      }
+
+      stat->intervalTicks = ticks - stat->ticks;
+      stat->ticks = ticks;
+      stat->generation = generation;
+    }
+  }
+
+  if (unlikely(readLen < 0)) {
+    logger->printWarnMsgWithErrno("Could not read /proc/self/task");
+  }
+
+  /* Drop threads which are not found in this sampling. */
+  for (std::tr1::unordered_map<pid_t, TThreadCpuStat,
+                               TNumericalHasher<pid_t> >::iterator itr =
+           stats.begin();
+       itr != stats.end();) {
+    if (itr->second.generation == generation) {
+      itr++;
+      continue;
+    }
+
+    if (itr->second.statFd >= 0) {
+      close(itr->second.statFd);
+      cachedFds--;
+    }
+
+    stats.erase(itr++);
+  }
+}
+
+/*!
+ * \brief Output ranking of threads by CPU time in current interval.
+ * \param rank [in] Number of threads to output.
+ */
+void TThreadCpuSampler::showRanking(int rank) {
+  sample();
+
+  TSorter<TThreadCpuStat> *sortArray;
+  try {
+    sortArray = new TSorter<TThreadCpuStat>(
+        rank, (TComparator)&ThreadCpuTicksCmp);
+  } catch (...) {
+    logger->printWarnMsg("Couldn't allocate working memory!");
+    return;
+  }
+
+  for (std::tr1::unordered_map<pid_t, TThreadCpuStat,
+                               TNumericalHasher<pid_t> >::iterator itr =
+           stats.begin();
+       itr != stats.end(); itr++) {
+    sortArray->push(itr->second);
+  }
+
+  /* Output ranking header. */
+  logger->printInfoMsg("Thread CPU Ranking (caused by Interval, %d threads)",
+                       (int)stats.size());
+  logger->printInfoMsg(
+      "Rank       tid   interval(msec)      total(msec)  Type    "
+      "Thread name");
+  logger->printInfoMsg(
+      "----  --------  ---------------  ---------------  ------  "
+      "-----------");
+
+  /* Output high-rank thread information. */
+  int rankCnt = sortArray->getCount();
+  Node<TThreadCpuStat> *aNode = sortArray->lastNode();
+  for (int Cnt = 0; Cnt < rankCnt && aNode != NULL;
+       Cnt++, aNode = aNode->prev) {
+    TThreadCpuStat *stat = &aNode->value;
+    char name[THREAD_CPU_NAME_LEN];
+    bool isJava;
+
+    getThreadName(stat->tid, name, sizeof(name), &isJava);
+
+#ifdef LP64
+    logger->printInfoMsg("%4d  %8d  %15ld  %15ld  %-6s  %s",
+#else
+    logger->printInfoMsg("%4d  %8d  %15lld  %15lld  %-6s  %s",
+#endif
+                         Cnt + 1, stat->tid,
+                         stat->intervalTicks * 1000 / clockTicks,
+                         stat->ticks * 1000 / clockTicks,
+                         isJava ? "Java" : "Native", name);
+  }
+
+  /* Clean up after ranking output. */
+  logger->flush();
+  delete sortArray;
+}
@@ -0,0 +1,205 @@
+/*!
+ * \file threadCpuSampler.hpp
+ * \brief This file is used to rank threads by CPU time in /proc/self/task.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#ifndef THREAD_CPU_SAMPLER_HPP
+#define THREAD_CPU_SAMPLER_HPP
+
+#include <jvmti.h>
+#include <jni.h>
+
+#include <sys/types.h>
+
+#include <tr1/unordered_map>
+
+#include "util.hpp"
+
+/*!
+ * \brief Max number of stat files which are kept opened.<br>
+ *        Stat files of other threads are opened at each sampling.
+ */
+#define THREAD_CPU_MAX_CACHED_FDS 1024
+
+/*!
+ * \brief Size of buffer for getdents64(2).
+ */
+#define THREAD_CPU_DENTS_BUFFER_SIZE 32768
+
+/*!
+ * \brief Max length of thread name in ranking.
+ */
+#define THREAD_CPU_NAME_LEN 256
+
+/*!
+ * \brief CPU time statistics of a thread.
+ */
+typedef struct {
+  pid_t tid;               /*!< Thread ID (LWP ID).                        */
+  int statFd;              /*!< FD of /proc/self/task/<tid>/stat, or -1.   */
+  jlong ticks;             /*!< utime + stime at the last sampling.        */
+  jlong intervalTicks;     /*!< CPU ticks which are consumed in interval.  */
+  unsigned int generation; /*!< Sampling generation which found thread.   */
+} TThreadCpuStat;
+
+/*!
+ * \brief JVMTI callback for ThreadStart event.
+ * \param jvmti  [in] JVMTI environment.
+ * \param env    [in] JNI environment of the event (current) thread.
+ * \param thread [in] Started thread.
+ */
+void JNICALL OnThreadStartForThreadCpu(jvmtiEnv *jvmti, JNIEnv *env,
+                                       jthread thread);
+
+/*!
+ * \brief JVMTI callback for ThreadEnd event.
+ * \param jvmti  [in] JVMTI environment.
+ * \param env    [in] JNI environment of the event (current) thread.
+ * \param thread [in] Terminated thread.
+ */
+void JNICALL OnThreadEndForThreadCpu(jvmtiEnv *jvmti, JNIEnv *env,
+                                     jthread thread);
+
+/*!
+ * \brief This class reads CPU time of all threads from /proc/self/task, and
+ *        outputs ranking of threads which consumed CPU in each interval.<br>
+ *        Native thread IDs are joined with Java thread names which are
+ *        recorded at ThreadStart event. The other threads (e.g. GC threads)
+ *        are named by /proc/self/task/<tid>/comm .
+ */
+class TThreadCpuSampler {
+ private:
+  /*!
+   * \brief Singleton instance of TThreadCpuSampler.
+   */
+  static TThreadCpuSampler *inst;
+
+  /*!
+   * \brief FD of /proc/self/task .
+   */
+  int taskDirFd;
+
+  /*!
+   * \brief Buffer for getdents64(2).
+   */
+  char *dentsBuf;
+
+  /*!
+   * \brief Number of stat files which are kept opened.
+   */
+  int cachedFds;
+
+  /*!
+   * \brief Current sampling generation.
+   */
+  unsigned int generation;
+
+  /*!
+   * \brief Clock ticks per second.
+   */
+  long clockTicks;
+
+  /*!
+   * \brief CPU time statistics of threads.
+   */
+  std::tr1::unordered_map<pid_t, TThreadCpuStat, TNumericalHasher<pid_t> >
+      stats;
+
+  /*!
+   * \brief Names of Java threads.
+   */
+  std::tr1::unordered_map<pid_t, char *, TNumericalHasher<pid_t> > names;
+
+  /*!
+   * \brief SpinLock variable for names.
+   */
+  volatile int namesLockVal;
+
+  /*!
+   * \brief Read CPU ticks of the thread.
+   * \param stat  [in,out] Statistics of the thread.
+   * \param ticks [out]    utime + stime of the thread.
+   * \return false if the thread has been terminated.
+   */
+  bool readThreadTicks(TThreadCpuStat *stat, jlong *ticks);
+
+  /*!
+   * \brief Get name of the thread.
+   * \param tid    [in]  Thread ID (LWP ID).
+   * \param buf    [out] Buffer to store name.
+   * \param len    [in]  Length of buf.
+   * \param isJava [out] Whether the thread is Java thread.
+   */
+  void getThreadName(pid_t tid, char *buf, size_t len, bool *isJava);
+
+  /*!
+   * \brief Read CPU time of all threads, and drop terminated threads.
+   */
+  void sample(void);
+
+ protected:
+  /*!
+   * \brief TThreadCpuSampler constructor.
+   */
+  TThreadCpuSampler(void);
+
+  /*!
+   * \brief TThreadCpuSampler destructor.
+   */
+  virtual ~TThreadCpuSampler();
+
+ public:
+  /*!
+   * \brief Global initialization.
+   * \return Process result.
+   * \warning Please call only once from main thread.
+   */
+  static bool globalInitialize(void);
+
+  /*!
+   * \brief Global finalization.
+   */
+  static void globalFinalize(void);
+
+  /*!
+   * \brief Get singleton instance of TThreadCpuSampler.
+   * \return Instance of TThreadCpuSampler.
+   */
+  inline static TThreadCpuSampler *getInstance() { return inst; };
+
+  /*!
+   * \brief Record name of the current thread.
+   * \param jvmti  [in] JVMTI environment.
+   * \param thread [in] Current thread.
+   */
+  void onThreadStart(jvmtiEnv *jvmti, jthread thread);
+
+  /*!
+   * \brief Forget name of the current thread.
+   */
+  void onThreadEnd(void);
+
+  /*!
+   * \brief Output ranking of threads by CPU time in current interval.
+   * \param rank [in] Number of threads to output.
+   */
+  void showRanking(int rank);
+};
+
+#endif  // THREAD_CPU_SAMPLER_HPP
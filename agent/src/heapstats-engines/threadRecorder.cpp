@@ -34,6 +34,7 @@
 
 #include "globals.hpp"
 #include "util.hpp"
+#include "asyncWriter.hpp"
 #include "vmFunctions.hpp"
 #include "callbackRegister.hpp"
 #include "jniCallbackRegister.hpp"
@@ -224,6 +225,12 @@ JNIEXPORT jobject JNICALL IoTrace_socketReadBegin(JNIEnv *env, jclass cls) {
   void *javaThread = GetCurrentThread(env);
   TThreadRecorder::getInstance()->putEvent((jthread)&javaThread,
                                            SocketReadStart, 0);
+
+  TIoTraceStats *stats = TThreadRecorder::getInstance()->getIoTraceStats();
+  if (stats != NULL) {
+    stats->begin();
+  }
+
   return NULL;
 }
 
@@ -238,6 +245,11 @@ JNIEXPORT void JNICALL IoTrace_socketReadEnd(JNIEnv *env, jclass cls,
   void *javaThread = GetCurrentThread(env);
   TThreadRecorder::getInstance()->putEvent((jthread)&javaThread,
                                            SocketReadEnd, bytesRead);
+
+  TIoTraceStats *stats = TThreadRecorder::getInstance()->getIoTraceStats();
+  if (stats != NULL) {
+    stats->socketEnd(env, IoTraceSocketRead, address, port, bytesRead);
+  }
 }
 
 /*
@@ -248,6 +260,12 @@ JNIEXPORT jobject JNICALL IoTrace_socketWriteBegin(JNIEnv *env, jclass cls) {
   void *javaThread = GetCurrentThread(env);
   TThreadRecorder::getInstance()->putEvent((jthread)&javaThread,
                                            SocketWriteStart, 0);
+
+  TIoTraceStats *stats = TThreadRecorder::getInstance()->getIoTraceStats();
+  if (stats != NULL) {
+    stats->begin();
+  }
+
   return NULL;
 }
 
@@ -261,6 +279,11 @@ JNIEXPORT void JNICALL IoTrace_socketWriteEnd(JNIEnv *env, jclass cls,
   void *javaThread = GetCurrentThread(env);
   TThreadRecorder::getInstance()->putEvent((jthread)&javaThread,
                                            SocketWriteEnd, bytesWritten);
+
+  TIoTraceStats *stats = TThreadRecorder::getInstance()->getIoTraceStats();
+  if (stats != NULL) {
+    stats->socketEnd(env, IoTraceSocketWrite, address, port, bytesWritten);
+  }
 }
 
 /*
@@ -272,7 +295,14 @@ JNIEXPORT jobject JNICALL
   void *javaThread = GetCurrentThread(env);
   TThreadRecorder::getInstance()->putEvent((jthread)&javaThread,
                                            FileReadStart, 0);
-  return NULL;
+
+  TIoTraceStats *stats = TThreadRecorder::getInstance()->getIoTraceStats();
+  if (stats != NULL) {
+    stats->begin();
+  }
+
+  /* Pass the path to fileReadEnd() as the context. */
+  return path;
 }
 
 /*
@@ -284,6 +314,11 @@ JNIEXPORT void JNICALL IoTrace_fileReadEnd(JNIEnv *env, jclass cls,
   void *javaThread = GetCurrentThread(env);
   TThreadRecorder::getInstance()->putEvent((jthread)&javaThread,
                                            FileReadEnd, bytesRead);
+
+  TIoTraceStats *stats = TThreadRecorder::getInstance()->getIoTraceStats();
+  if (stats != NULL) {
+    stats->fileEnd(env, IoTraceFileRead, (jstring)context, bytesRead);
+  }
 }
 
 /*
@@ -295,7 +330,14 @@ JNIEXPORT jobject JNICALL
   void *javaThread = GetCurrentThread(env);
   TThreadRecorder::getInstance()->putEvent((jthread)&javaThread,
                                            FileWriteStart, 0);
-  return NULL;
+
+  TIoTraceStats *stats = TThreadRecorder::getInstance()->getIoTraceStats();
+  if (stats != NULL) {
+    stats->begin();
+  }
+
+  /* Pass the path to fileWriteEnd() as the context. */
+  return path;
 }
 
 /*
@@ -308,6 +350,11 @@ JNIEXPORT void JNICALL IoTrace_fileWriteEnd(JNIEnv *env, jclass cls,
   void *javaThread = GetCurrentThread(env);
   TThreadRecorder::getInstance()->putEvent((jthread)&javaThread,
                                            FileWriteEnd, bytesWritten);
+
+  TIoTraceStats *stats = TThreadRecorder::getInstance()->getIoTraceStats();
+  if (stats != NULL) {
+    stats->fileEnd(env, IoTraceFileWrite, (jstring)context, bytesWritten);
+  }
 }
 
 /* Class member functions */
@@ -322,6 +369,8 @@ TThreadRecorder::TThreadRecorder(size_t buffer_size) : threadIDMap() {
   aligned_buffer_size = ALIGN_SIZE_UP(buffer_size, systemPageSize);
   bufferLockVal = 0;
   idmapLockVal = 0;
+  ioTraceStats = NULL;
+  memset(eventCounts, 0, sizeof(eventCounts));
 
   /* manpage of mmap(2):
    *
@@ -359,6 +408,7 @@ TThreadRecorder::~TThreadRecorder() {
   }
   spinLockRelease(&idmapLockVal);
 
+  delete ioTraceStats;
 }
 
 /*!
@@ -534,6 +584,7 @@ bool TThreadRecorder::registerIOTracer(jvmtiEnv *jvmti, JNIEnv *env) {
  */
 void TThreadRecorder::initialize(jvmtiEnv *jvmti, JNIEnv *env, size_t buf_sz) {
   static bool isRegistered = false;
+  static bool isIOTracerRegistered = false;
 
   if (likely(inst == NULL)) {
     inst = new TThreadRecorder(buf_sz);
@@ -542,7 +593,17 @@ void TThreadRecorder::initialize(jvmtiEnv *jvmti, JNIEnv *env, size_t buf_sz) {
       isRegistered = true;
       registerHookPoint(jvmti, env);
       registerJNIHookPoint(env);
-      registerIOTracer(jvmti, env);
+      isIOTracerRegistered = registerIOTracer(jvmti, env);
+    }
+
+    int ioStatsEntries = conf->ThreadRecordIOStatsEntries()->get();
+    if (isIOTracerRegistered && (ioStatsEntries > 0)) {
+      try {
+        inst->ioTraceStats = new TIoTraceStats(env, ioStatsEntries);
+      } catch (...) {
+        logger->printWarnMsg("Could not initialize I/O statistics.");
+        inst->ioTraceStats = NULL;
+      }
     }
 
     inst->registerAllThreads(jvmti);
@@ -575,15 +636,25 @@ void TThreadRecorder::dump(const char *fname) {
     throw errno;
   }
 
+  /* Data is copied to writer, so the lock is released before disk I/O. */
+  TAsyncFile *writer;
+  try {
+    writer = new TAsyncFile(fd, 0);
+  } catch (...) {
+    close(fd);
+    logger->printWarnMsg("Thread Recorder dump failed.");
+    throw ENOMEM;
+  }
+
   /* Write byte order mark. */
   char bom = BOM;
-  write(fd, &bom, sizeof(char));
+  writer->write(&bom, sizeof(char));
 
   spinLockWait(&idmapLockVal);
   {
     /* Dump thread list. */
     int threadIDMapSize = threadIDMap.size();
-    write(fd, &threadIDMapSize, sizeof(int));
+    writer->write(&threadIDMapSize, sizeof(int));
 
     for (std::tr1::unordered_map<jlong, char *,
                                  TNumericalHasher<jlong> >::iterator itr =
@@ -591,17 +662,60 @@ void TThreadRecorder::dump(const char *fname) {
          itr != threadIDMap.end(); itr++) {
       jlong id = itr->first;
       int classname_length = strlen(itr->second);
-      write(fd, &id, sizeof(jlong));
-      write(fd, &classname_length, sizeof(int));
-      write(fd, itr->second, classname_length);
+      writer->write(&id, sizeof(jlong));
+      writer->write(&classname_length, sizeof(int));
+      writer->write(itr->second, classname_length);
     }
 
     /* Dump thread event. */
-    write(fd, record_buffer, aligned_buffer_size);
+    writer->write(record_buffer, aligned_buffer_size);
   }
   spinLockRelease(&idmapLockVal);
 
+  int result = writer->finish();
+  if (unlikely(result != 0)) {
+    errno = result;
+    logger->printWarnMsgWithErrno("Thread Recorder dump failed.");
+  }
+
+  delete writer;
   close(fd);
+
+  /* Dump I/O statistics. */
+  if (ioTraceStats != NULL) {
+    ioTraceStats->dump(conf->ThreadRecordIOStatsFileName()->get());
+  }
+}
+
+/*!
+ * \brief Get number of events for each TThreadEvent.
+ *
+ * \param counts [out] Number of events.
+ *                     It must have THREAD_EVENT_KINDS elements.
+ */
+void TThreadRecorder::getEventCounts(jlong *counts) {
+  spinLockWait(&bufferLockVal);
+  {
+    memcpy(counts, eventCounts, sizeof(eventCounts));
+  }
+  spinLockRelease(&bufferLockVal);
+}
+
+/*!
+ * \brief Get number of threads which are registered to thread id map.
+ *
+ * \return Number of threads.
+ */
+int TThreadRecorder::getThreadCount(void) {
+  int count;
+
+  spinLockWait(&idmapLockVal);
+  {
+    count = threadIDMap.size();
+  }
+  spinLockRelease(&idmapLockVal);
+
+  return count;
 }
 
 /*!
@@ -727,6 +841,7 @@ void TThreadRecorder::putEvent(jthread thread, TThreadEvent event,
   spinLockWait(&bufferLockVal);
   {
     memcpy32(top_of_buffer, &eventRecord);
+    eventCounts[event]++;
 
     if (unlikely(++top_of_buffer == end_of_buffer)) {
       logger->printDebugMsg(
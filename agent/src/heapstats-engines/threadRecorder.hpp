@@ -29,6 +29,8 @@
 
 #include <tr1/unordered_map>
 
+#include "ioTraceStats.hpp"
+
 /*!
  * \brief Header of recording data.
  */
@@ -78,6 +80,12 @@ typedef enum {
   SocketReadEnd,
 } TThreadEvent;
 
+/*!
+ * \brief Number of kinds of thread event.<br>
+ *        Index 0 is not used because TThreadEvent starts at 1.
+ */
+#define THREAD_EVENT_KINDS (SocketReadEnd + 1)
+
 /*!
  * \brief Implementation of HeapStats Thread Recorder.
  *        This instance must be singleton.
@@ -107,6 +115,12 @@ class TThreadRecorder {
    */
   TEventRecord *end_of_buffer;
 
+  /*!
+   * \brief Number of events for each TThreadEvent.
+   *        They are counted under the lock of ring buffer.
+   */
+  jlong eventCounts[THREAD_EVENT_KINDS];
+
   /*!
    * \brief ThreadID-ThreadName map.
    *        Key is thread ID, Value is thread name.
@@ -123,6 +137,12 @@ class TThreadRecorder {
    */
   volatile int idmapLockVal;
 
+  /*!
+   * \brief Aggregator of I/O statistics.
+   *        This value is NULL if I/O statistics is disabled.
+   */
+  TIoTraceStats *ioTraceStats;
+
   /*!
    * \brief Instance of TThreadRecorder.
    */
@@ -239,6 +259,28 @@ class TThreadRecorder {
    */
   inline static TThreadRecorder *getInstance() { return inst; };
 
+  /*!
+   * \brief Get aggregator of I/O statistics.
+   *
+   * \return Instance of TIoTraceStats, or NULL if it is disabled.
+   */
+  inline TIoTraceStats *getIoTraceStats() { return ioTraceStats; };
+
+  /*!
+   * \brief Get number of events for each TThreadEvent.
+   *
+   * \param counts [out] Number of events.
+   *                     It must have THREAD_EVENT_KINDS elements.
+   */
+  void getEventCounts(jlong *counts);
+
+  /*!
+   * \brief Get number of threads which are registered to thread id map.
+   *
+   * \return Number of threads.
+   */
+  int getThreadCount(void);
+
   /*!
    * \brief Enqueue new event.
    *
@@ -20,7 +20,9 @@
  */
 
 #include <set>
+#include <signal.h>
 #include <sys/time.h>
+#include <unistd.h>
 #include <net-snmp/net-snmp-config.h>
 #include <net-snmp/net-snmp-includes.h>
 #include <pthread.h>
@@ -44,10 +46,16 @@ unsigned long int TTrapSender::initializeTime;
  *   - TTrapSender::finalize()
  *   - TTrapSender::~TTrapSender
  *   - TTrapSender::sendTrap
+ *   - TTrapSender::senderEntryPoint
  */
 pthread_mutex_t TTrapSender::senderMutex =
                                 PTHREAD_ADAPTIVE_MUTEX_INITIALIZER_NP;
 
+/*!
+ * \brief Condition to notify queued trap to sender thread.
+ */
+pthread_cond_t TTrapSender::queueCond = PTHREAD_COND_INITIALIZER;
+
 /*!
  * \brief Flags whether libnetsnmp.so is loaded.
  */
@@ -68,6 +76,61 @@ TNetSNMPFunctions TTrapSender::netSnmpFuncs;
   */
 netsnmp_session TTrapSender::session;
 
+/*!
+ * \brief Opened SNMP session which is shared by all traps.
+ */
+netsnmp_session *TTrapSender::activeSession = NULL;
+
+/*!
+ * \brief Ring buffer of PDUs which are waiting to be sent.
+ */
+netsnmp_pdu *TTrapSender::trapQueue[SNMP_TRAP_QUEUE_SIZE];
+
+/*!
+ * \brief Index of the oldest PDU in trapQueue.
+ */
+int TTrapSender::queueHead = 0;
+
+/*!
+ * \brief Number of PDUs in trapQueue.
+ */
+int TTrapSender::queueCount = 0;
+
+/*!
+ * \brief Number of traps which are dropped because queue is full.
+ */
+unsigned long TTrapSender::droppedTraps = 0;
+
+/*!
+ * \brief Minimum interval between traps in micro seconds.
+ */
+long TTrapSender::sendInterval = 0;
+
+/*!
+ * \brief Sender thread.
+ */
+pthread_t TTrapSender::senderThread;
+
+/*!
+ * \brief Flags whether sender thread is running.
+ */
+bool TTrapSender::isSenderRunning = false;
+
+/*!
+ * \brief Flags whether sender thread should exit after queue is empty.
+ */
+bool TTrapSender::isTerminating = false;
+
+/*!
+ * \brief Get current time in micro seconds.
+ * \return Current time.
+ */
+static inline jlong getNowTimeUSec(void) {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (jlong)tv.tv_sec * 1000000 + (jlong)tv.tv_usec;
+}
+
 
 /*!
  * \brief TTrapSender initialization.
@@ -104,8 +167,33 @@ bool TTrapSender::initialize(int snmp, char *pPeer, char *pCommName, int port) {
     session.remote_port = port;
     session.community = (u_char *)strdup(pCommName);
     session.community_len = (pCommName != NULL) ? strlen(pCommName) : 0;
+
+    int rate = conf->SnmpTrapRate()->get();
+    sendInterval = (rate > 0) ? 1000000 / rate : 0;
+    isTerminating = false;
+  } EXIT_PTHREAD_SECTION(&senderMutex)
+
+  /*
+   * Traps are sent by dedicated thread not to block snapshot and log.
+   * Signals should be handled by threads of JVM.
+   */
+  sigset_t allSignals;
+  sigset_t oldMask;
+  sigfillset(&allSignals);
+  pthread_sigmask(SIG_BLOCK, &allSignals, &oldMask);
+
+  ENTER_PTHREAD_SECTION(&senderMutex) {
+    isSenderRunning = (pthread_create(&senderThread, NULL, &senderEntryPoint,
+                                      NULL) == 0);
   } EXIT_PTHREAD_SECTION(&senderMutex)
 
+  pthread_sigmask(SIG_SETMASK, &oldMask, NULL);
+
+  if (unlikely(!isSenderRunning)) {
+    logger->printWarnMsg(
+        "Could not create SNMP trap sender thread. Traps are sent directly.");
+  }
+
   return true;
 }
 
@@ -113,11 +201,32 @@ bool TTrapSender::initialize(int snmp, char *pPeer, char *pCommName, int port) {
  * \brief TTrapSender global finalization.
  */
 void TTrapSender::finalize(void) {
+  /* Stop sender thread after all queued traps are sent. */
+  bool isJoinNeeded = false;
+  ENTER_PTHREAD_SECTION(&senderMutex) {
+    isTerminating = true;
+    isJoinNeeded = isSenderRunning;
+    pthread_cond_signal(&queueCond);
+  } EXIT_PTHREAD_SECTION(&senderMutex)
+
+  if (isJoinNeeded) {
+    pthread_join(senderThread, NULL);
+  }
+
   /* Close and free SNMP session. */
   ENTER_PTHREAD_SECTION(&senderMutex) {
-    netSnmpFuncs.snmp_close(&session);
+    if (activeSession != NULL) {
+      netSnmpFuncs.snmp_close(activeSession);
+      activeSession = NULL;
+      SOCK_CLEANUP;
+    }
+
     free(session.peername);
     free(session.community);
+
+    if (unlikely(droppedTraps > 0)) {
+      logger->printWarnMsg("%lu SNMP trap(s) were dropped.", droppedTraps);
+    }
   } EXIT_PTHREAD_SECTION(&senderMutex)
 
   /* Unload library */
@@ -244,7 +353,8 @@ int TTrapSender::addValue(oid id[], int len, const char *pValue, char type) {
 }
 
 /*!
- * \brief Add variable as send information by trap.
+ * \brief Pass PDU to sender thread.<br>
+ *        PDU is sent in the caller if sender thread is not running.
  * \return Return process result code.
  */
 int TTrapSender::sendTrap(void) {
@@ -254,67 +364,151 @@ int TTrapSender::sendTrap(void) {
     return SNMP_PROC_FAILURE;
   }
 
+  /* PDU is owned by the queue or sendPdu() from here. */
+  netsnmp_pdu *pdu = pPdu;
+  pPdu = NULL;
+
   /* If failure lock to use in multi-thread. */
   if (unlikely(pthread_mutex_lock(&senderMutex) != 0)) {
     logger->printWarnMsg("Entering mutex failed!");
+    netSnmpFuncs.snmp_free_pdu(pdu);
+    clearValues();
     return SNMP_PROC_FAILURE;
   }
 
-  SOCK_STARTUP;
+  int result = SNMP_PROC_SUCCESS;
+  unsigned long dropped = 0;
+  if (likely(isSenderRunning)) {
+    if (likely(queueCount < SNMP_TRAP_QUEUE_SIZE)) {
+      trapQueue[(queueHead + queueCount) % SNMP_TRAP_QUEUE_SIZE] = pdu;
+      queueCount++;
+      pthread_cond_signal(&queueCond);
+    } else {
+      /* Sender cannot keep up with alerts. */
+      netSnmpFuncs.snmp_free_pdu(pdu);
+      dropped = ++droppedTraps;
+      result = SNMP_PROC_FAILURE;
+    }
+  } else if (!sendPdu(pdu)) {
+    result = SNMP_PROC_FAILURE;
+  }
+
+  /* Unlock to use in multi-thread. */
+  pthread_mutex_unlock(&senderMutex);
+
+  if (unlikely(dropped > 0)) {
+    logger->printWarnMsg("SNMP trap queue is full. Trap is dropped. "
+                         "(total %lu traps)", dropped);
+  }
+
+  /* Values are copied into PDU, so they can be freed now. */
+  clearValues();
+
+  return result;
+}
 
-  /* Open session. */
+/*!
+ * \brief Send PDU through shared session.<br>
+ *        Session is opened at the first time, and is reopened after
+ *        failure of sending.
+ * \param pdu [in] PDU to send. It is freed in this function.
+ * \return true if succeeded.
+ */
+bool TTrapSender::sendPdu(netsnmp_pdu *pdu) {
+  if (activeSession == NULL) {
+    SOCK_STARTUP;
+
+    /* Open session. */
 #ifdef HAVE_NETSNMP_TRANSPORT_OPEN_CLIENT
-  netsnmp_session *sess = netSnmpFuncs.snmp_add(
-        &session, netSnmpFuncs.netsnmp_transport_open_client(
-                                        "snmptrap", session.peername),
+    activeSession = netSnmpFuncs.snmp_add(
+          &session, netSnmpFuncs.netsnmp_transport_open_client(
+                                          "snmptrap", session.peername),
                                                                   NULL, NULL);
 #else
-  char target[256];
-  snprintf(target, sizeof(target), "%s:%d", session.peername,
-             session.remote_port);
-  netsnmp_session *sess = netSnmpFuncs.snmp_add(
-        &session, netSnmpFuncs.netsnmp_tdomain_transport(target, 0, "udp"),
+    char target[256];
+    snprintf(target, sizeof(target), "%s:%d", session.peername,
+               session.remote_port);
+    activeSession = netSnmpFuncs.snmp_add(
+          &session, netSnmpFuncs.netsnmp_tdomain_transport(target, 0, "udp"),
                                                                   NULL, NULL);
 #endif
 
-  /* If failure open session. */
-  if (sess == NULL) {
-    logger->printWarnMsg("Failure open SNMP trap session.");
-    SOCK_CLEANUP;
-
-    /* Unlock to use in multi-thread. */
-    pthread_mutex_unlock(&senderMutex);
-
-    return SNMP_PROC_FAILURE;
+    /* If failure open session. */
+    if (activeSession == NULL) {
+      logger->printWarnMsg("Failure open SNMP trap session.");
+      SOCK_CLEANUP;
+      netSnmpFuncs.snmp_free_pdu(pdu);
+      return false;
+    }
   }
 
   /*
    * Send trap.
-   * snmp_send() will free pPDU.
+   * snmp_send() will free PDU.
    */
-  int success = netSnmpFuncs.snmp_send(sess, pPdu);
-
-  /* Clean up after send trap. */
-  netSnmpFuncs.snmp_close(sess);
-
-  /* If failure send trap. */
-  if (!success) {
+  if (unlikely(!netSnmpFuncs.snmp_send(activeSession, pdu))) {
     /* Free PDU. */
-    netSnmpFuncs.snmp_free_pdu(pPdu);
+    netSnmpFuncs.snmp_free_pdu(pdu);
     logger->printWarnMsg("Send SNMP trap failed!");
+
+    /* Session will be reopened at next trap. */
+    netSnmpFuncs.snmp_close(activeSession);
+    activeSession = NULL;
+    SOCK_CLEANUP;
+    return false;
   }
 
-  pPdu = NULL;
+  return true;
+}
 
-  /* Clean up. */
-  SOCK_CLEANUP;
+/*!
+ * \brief Entry point of sender thread.<br>
+ *        Queued traps are sent in order. Interval between traps is kept
+ *        to snmp_trap_rate except while finalizing.
+ * \param arg [in] Unused.
+ * \return Always NULL.
+ */
+void *TTrapSender::senderEntryPoint(void *arg) {
+  jlong lastSentTime = 0;
+
+  while (true) {
+    netsnmp_pdu *pdu = NULL;
+    bool isPaced = false;
+
+    ENTER_PTHREAD_SECTION(&senderMutex) {
+      while ((queueCount == 0) && !isTerminating) {
+        pthread_cond_wait(&queueCond, &senderMutex);
+      }
+
+      if (queueCount > 0) {
+        pdu = trapQueue[queueHead];
+        queueHead = (queueHead + 1) % SNMP_TRAP_QUEUE_SIZE;
+        queueCount--;
+      } else {
+        /* Later traps are sent by the caller. */
+        isSenderRunning = false;
+      }
+
+      isPaced = !isTerminating;
+    } EXIT_PTHREAD_SECTION(&senderMutex)
+
+    if (pdu == NULL) {
+      break;
+    }
 
-  /* Unlock to use in multi-thread. */
-  pthread_mutex_unlock(&senderMutex);
+    if (isPaced && (sendInterval > 0)) {
+      jlong elapsed = getNowTimeUSec() - lastSentTime;
+      if ((elapsed >= 0) && (elapsed < sendInterval)) {
+        usleep(sendInterval - elapsed);
+      }
+    }
 
-  clearValues();
+    /* Session is used only by this thread while it is running. */
+    sendPdu(pdu);
+    lastSentTime = getNowTimeUSec();
+  }
 
-  return (success) ? SNMP_PROC_SUCCESS : SNMP_PROC_FAILURE;
+  return NULL;
 }
 
 /*!
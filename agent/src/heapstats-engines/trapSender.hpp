@@ -149,6 +149,11 @@
  */
 #define OID_METASPACEALERT OID_PEN ".6.0"
 
+/*!
+ * \brief Max number of traps which are waiting to be sent.
+ */
+#define SNMP_TRAP_QUEUE_SIZE 1024
+
 /* Function type definition for NET-SNMP client library. */
 typedef netsnmp_log_handler *(*Tnetsnmp_register_loghandler)(int type, int pri);
 typedef void (*Tsnmp_sess_init)(netsnmp_session *);
@@ -203,6 +208,11 @@ class TTrapSender {
    */
   static pthread_mutex_t senderMutex;
 
+  /*!
+   * \brief Condition to notify queued trap to sender thread.
+   */
+  static pthread_cond_t queueCond;
+
   /*!
    * \brief TTrapSender initialization.
    * \param snmp      [in] SNMP version.
@@ -214,7 +224,8 @@ class TTrapSender {
   static bool initialize(int snmp, char *pPeer, char *pCommName, int port);
 
   /*!
-   * \brief TTrapSender global finalization.
+   * \brief TTrapSender global finalization.<br>
+   *        Queued traps are sent before the session is closed.
    */
   static void finalize(void);
 
@@ -250,7 +261,8 @@ class TTrapSender {
   int addValue(oid id[], int len, const char *pValue, char type);
 
   /*!
-   * \brief Add variable as send information by trap.
+   * \brief Pass PDU to sender thread.<br>
+   *        PDU is sent in the caller if sender thread is not running.
    * \return Return process result code.
    */
   int sendTrap(void);
@@ -295,6 +307,42 @@ class TTrapSender {
    * \brief SNMP session information.
    */
   static netsnmp_session session;
+  /*!
+   * \brief Opened SNMP session which is shared by all traps.
+   */
+  static netsnmp_session *activeSession;
+  /*!
+   * \brief Ring buffer of PDUs which are waiting to be sent.
+   */
+  static netsnmp_pdu *trapQueue[SNMP_TRAP_QUEUE_SIZE];
+  /*!
+   * \brief Index of the oldest PDU in trapQueue.
+   */
+  static int queueHead;
+  /*!
+   * \brief Number of PDUs in trapQueue.
+   */
+  static int queueCount;
+  /*!
+   * \brief Number of traps which are dropped because queue is full.
+   */
+  static unsigned long droppedTraps;
+  /*!
+   * \brief Minimum interval between traps in micro seconds.
+   */
+  static long sendInterval;
+  /*!
+   * \brief Sender thread.
+   */
+  static pthread_t senderThread;
+  /*!
+   * \brief Flags whether sender thread is running.
+   */
+  static bool isSenderRunning;
+  /*!
+   * \brief Flags whether sender thread should exit after queue is empty.
+   */
+  static bool isTerminating;
 
   /*!
    * \brief SNMP PDU information.
@@ -312,6 +360,22 @@ class TTrapSender {
    */
   static bool getProcAddressFromNetSNMPLib(void);
 
+  /*!
+   * \brief Send PDU through shared session.<br>
+   *        Session is opened at the first time, and is reopened after
+   *        failure of sending.
+   * \param pdu [in] PDU to send. It is freed in this function.
+   * \return true if succeeded.
+   */
+  static bool sendPdu(netsnmp_pdu *pdu);
+
+  /*!
+   * \brief Entry point of sender thread.
+   * \param arg [in] Unused.
+   * \return Always NULL.
+   */
+  static void *senderEntryPoint(void *arg);
+
 };
 
 #endif  //_TRAP_SENDER_H
@@ -262,6 +262,26 @@ jlong getNowTimeSec(void) {
   return (jlong)tv.tv_sec * 1000 + (jlong)tv.tv_usec / 1000;
 }
 
+/*!
+ * \brief Get current monotonic time.
+ * \return Micro-second elapsed time from unspecified starting point.
+ */
+jlong getMonotonicTime(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (jlong)ts.tv_sec * 1000000 + (jlong)ts.tv_nsec / 1000;
+}
+
+/*!
+ * \brief Get CPU time of the current thread.
+ * \return Micro-second CPU time which is consumed by the current thread.
+ */
+jlong getThreadCpuTime(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return (jlong)ts.tv_sec * 1000000 + (jlong)ts.tv_nsec / 1000;
+}
+
 /*!
  * \brief A little sleep.
  * \param sec  [in] Second of sleep range.
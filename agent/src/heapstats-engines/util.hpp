@@ -277,6 +277,18 @@ char *strReplase(char const *str, char const *oldStr, char const *newStr);
  */
 jlong getNowTimeSec(void);
 
+/*!
+ * \brief Get current monotonic time.
+ * \return Micro-second elapsed time from unspecified starting point.
+ */
+jlong getMonotonicTime(void);
+
+/*!
+ * \brief Get CPU time of the current thread.
+ * \return Micro-second CPU time which is consumed by the current thread.
+ */
+jlong getThreadCpuTime(void);
+
 /*!
  * \brief A little sleep.
  * \param sec  [in] Second of sleep range.
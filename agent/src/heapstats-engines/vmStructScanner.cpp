@@ -20,6 +20,7 @@
  */
 
 #include <dlfcn.h>
+#include <stdio.h>
 
 #include "vmStructScanner.hpp"
 
@@ -74,6 +75,9 @@ VMLongConstantEntry **TVMStructScanner::vmLongConstEntries = NULL;
  * \param finder [in] Symbol search object.
  */
 TVMStructScanner::TVMStructScanner(TSymbolFinder *finder) {
+  symCache = finder->getSymbolCache();
+  libBaseAddr = (ptrdiff_t)finder->getLibraryAddress();
+
   if (unlikely(vmStructEntries == NULL)) {
     /* Get VMStructs. */
     vmStructEntries = (VMStructEntry **)dlsym(RTLD_DEFAULT, SYMBOL_VMSTRUCTS);
@@ -137,8 +141,32 @@ void TVMStructScanner::GetDataFromVMStructs(TOffsetNameMap *ofsMap) {
     return;
   }
 
+  char key[SYMBOL_CACHE_MAX_LINE];
+
   /* Check map entry. */
   for (TOffsetNameMap *ofs = ofsMap; ofs->className != NULL; ofs++) {
+    if (symCache != NULL) {
+      snprintf(key, sizeof(key), "VMStructs:%s::%s", ofs->className,
+               ofs->fieldName);
+
+      /* Map has only pointer of address if target field is static. */
+      jlong value;
+      TSymbolCacheResult cached = symCache->find(key, &value);
+      if (cached == SYMBOL_CACHE_FOUND) {
+        if (ofs->ofs == NULL) {
+          *ofs->addr = (void *)(libBaseAddr + (ptrdiff_t)value);
+        } else {
+          *ofs->ofs = (off_t)value;
+        }
+        continue;
+      } else if (cached == SYMBOL_CACHE_NOT_FOUND) {
+        continue;
+      }
+    }
+
+    bool isFound = false;
+    jlong value = 0;
+
     /* Search JVM inner struct entry. */
     for (VMStructEntry *entry = *this->vmStructEntries; entry->typeName != NULL;
          entry++) {
@@ -147,12 +175,19 @@ void TVMStructScanner::GetDataFromVMStructs(TOffsetNameMap *ofsMap) {
         /* If entry is expressing static field. */
         if (entry->isStatic) {
           *ofs->addr = entry->address;
+          value = (ptrdiff_t)entry->address - libBaseAddr;
         } else {
           *ofs->ofs = entry->offset;
+          value = entry->offset;
         }
+        isFound = true;
         break;
       }
     }
+
+    if (symCache != NULL) {
+      symCache->add(key, value, isFound);
+    }
   }
 }
 
@@ -166,16 +201,38 @@ void TVMStructScanner::GetDataFromVMTypes(TTypeSizeMap *typeMap) {
     return;
   }
 
+  char key[SYMBOL_CACHE_MAX_LINE];
+
   /* Search JVM inner struct entry. */
   for (TTypeSizeMap *types = typeMap; types->typeName != NULL; types++) {
+    if (symCache != NULL) {
+      snprintf(key, sizeof(key), "VMTypes:%s", types->typeName);
+
+      jlong value;
+      TSymbolCacheResult cached = symCache->find(key, &value);
+      if (cached == SYMBOL_CACHE_FOUND) {
+        *types->size = (uint64_t)value;
+        continue;
+      } else if (cached == SYMBOL_CACHE_NOT_FOUND) {
+        continue;
+      }
+    }
+
+    bool isFound = false;
+
     /* Check map entry. */
     for (VMTypeEntry *entry = *this->vmTypeEntries; entry->typeName != NULL;
          entry++) {
       if (strcmp(entry->typeName, types->typeName) == 0) {
         *types->size = entry->size;
+        isFound = true;
         break;
       }
     }
+
+    if (symCache != NULL) {
+      symCache->add(key, isFound ? (jlong)*types->size : 0, isFound);
+    }
   }
 }
 
@@ -189,16 +246,38 @@ void TVMStructScanner::GetDataFromVMIntConstants(TIntConstMap *constMap) {
     return;
   }
 
+  char key[SYMBOL_CACHE_MAX_LINE];
+
   /* Search JVM inner struct entry. */
   for (TIntConstMap *consts = constMap; consts->name != NULL; consts++) {
+    if (symCache != NULL) {
+      snprintf(key, sizeof(key), "VMIntConstants:%s", consts->name);
+
+      jlong value;
+      TSymbolCacheResult cached = symCache->find(key, &value);
+      if (cached == SYMBOL_CACHE_FOUND) {
+        *consts->value = (int32_t)value;
+        continue;
+      } else if (cached == SYMBOL_CACHE_NOT_FOUND) {
+        continue;
+      }
+    }
+
+    bool isFound = false;
+
     /* Check map entry. */
     for (VMIntConstantEntry *entry = *this->vmIntConstEntries;
          entry->name != NULL; entry++) {
       if (strcmp(entry->name, consts->name) == 0) {
         *consts->value = entry->value;
+        isFound = true;
         break;
       }
     }
+
+    if (symCache != NULL) {
+      symCache->add(key, isFound ? (jlong)*consts->value : 0, isFound);
+    }
   }
 }
 
@@ -212,15 +291,37 @@ void TVMStructScanner::GetDataFromVMLongConstants(TLongConstMap *constMap) {
     return;
   }
 
+  char key[SYMBOL_CACHE_MAX_LINE];
+
   /* Search JVM inner struct entry. */
   for (TLongConstMap *consts = constMap; consts->name != NULL; consts++) {
+    if (symCache != NULL) {
+      snprintf(key, sizeof(key), "VMLongConstants:%s", consts->name);
+
+      jlong value;
+      TSymbolCacheResult cached = symCache->find(key, &value);
+      if (cached == SYMBOL_CACHE_FOUND) {
+        *consts->value = (uint64_t)value;
+        continue;
+      } else if (cached == SYMBOL_CACHE_NOT_FOUND) {
+        continue;
+      }
+    }
+
+    bool isFound = false;
+
     /* Check map entry. */
     for (VMLongConstantEntry *entry = *this->vmLongConstEntries;
          entry->name != NULL; entry++) {
       if (strcmp(entry->name, consts->name) == 0) {
         *consts->value = entry->value;
+        isFound = true;
         break;
       }
     }
+
+    if (symCache != NULL) {
+      symCache->add(key, isFound ? (jlong)*consts->value : 0, isFound);
+    }
   }
 }
@@ -142,7 +142,8 @@ typedef struct {
 
 /*!
  * \brief This class is used to search JVM inner information.<br>
- *        E.g. VMStruct, inner-class, etc...
+ *        E.g. VMStruct, inner-class, etc...<br>
+ *        Results are kept in symbol cache of libjvm if it is available.
  */
 class TVMStructScanner {
  public:
@@ -193,6 +194,17 @@ class TVMStructScanner {
    * \brief Pointer of hotspot constant long integer information.
    */
   static VMLongConstantEntry **vmLongConstEntries;
+
+  /*!
+   * \brief Symbol cache of libjvm, or NULL if it is not used.
+   */
+  TSymbolCache *symCache;
+
+  /*!
+   * \brief Base address of libjvm.<br>
+   *        Address of static field is cached as relative address.
+   */
+  ptrdiff_t libBaseAddr;
 };
 
 #endif  // _VMSCANNER_HPP
@@ -81,10 +81,15 @@ TVMVariables::TVMVariables(TSymbolFinder *sym, TVMStructScanner *scan)
   ofsThreadCurrentPendingMonitor = -1;
   ofsOSThreadThreadId = -1;
   ofsObjectMonitorObject = -1;
+  ofsObjectMonitorOwner = -1;
+  ofsThreadStackBase = -1;
+  ofsThreadStackSize = -1;
   threads_lock = NULL;
   youngGen = NULL;
   youngGenStartAddr = NULL;
   youngGenSize = 0;
+  heapStartAddr = NULL;
+  heapSize = 0;
 
 #ifdef __LP64__
   HeapWordSize = 8;
@@ -206,6 +211,11 @@ bool TVMVariables::getValuesFromVMStructs(void) {
       {"OSThread", "_thread_id", &ofsOSThreadThreadId, NULL},
       {"ObjectMonitor", "_object", &ofsObjectMonitorObject, NULL},
 
+      /* Optional: They are used to filter deadlock detection. */
+      {"ObjectMonitor", "_owner", &ofsObjectMonitorOwner, NULL},
+      {"Thread", "_stack_base", &ofsThreadStackBase, NULL},
+      {"Thread", "_stack_size", &ofsThreadStackSize, NULL},
+
       /*
        * For CR6990754.
        * Use native memory and reference counting to implement SymbolTable.
@@ -346,6 +356,29 @@ bool TVMVariables::getValuesAfterVMInit(void) {
   narrowOffsetBase = (ptrdiff_t) * (void **)narrowOffsetBase;
   narrowKlassOffsetBase = (ptrdiff_t) * (void **)narrowKlassOffsetBase;
 
+  /* Reserved region of Java heap is optional. It is used in memory map. */
+  off_t offsetHeapReserved = -1;
+  off_t offsetMemRegionStart = -1;
+  off_t offsetMemRegionWordSize = -1;
+  TOffsetNameMap heapMap[] = {
+      {"CollectedHeap", "_reserved", &offsetHeapReserved, NULL},
+      {"MemRegion", "_start", &offsetMemRegionStart, NULL},
+      {"MemRegion", "_word_size", &offsetMemRegionWordSize, NULL},
+      /* End marker. */
+      {NULL, NULL, NULL, NULL}};
+
+  this->vmScanner->GetDataFromVMStructs(heapMap);
+
+  if (likely((offsetHeapReserved != -1) && (offsetMemRegionStart != -1) &&
+             (offsetMemRegionWordSize != -1))) {
+    void *heapReserved = incAddress(collectedHeap, offsetHeapReserved);
+    heapStartAddr = *(void **)incAddress(heapReserved, offsetMemRegionStart);
+    heapSize = *(size_t *)incAddress(heapReserved, offsetMemRegionWordSize) *
+               HeapWordSize;
+  } else {
+    logger->printDebugMsg("Reserved region of Java heap is not found.");
+  }
+
   bool result = true;
 
   if (this->useCMS) {
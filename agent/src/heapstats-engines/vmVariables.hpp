@@ -307,6 +307,21 @@ class TVMVariables {
    */
   off_t ofsObjectMonitorObject;
 
+  /*!
+   * \brief offset of _owner in ObjectMonitor.
+   */
+  off_t ofsObjectMonitorOwner;
+
+  /*!
+   * \brief offset of _stack_base in Thread.
+   */
+  off_t ofsThreadStackBase;
+
+  /*!
+   * \brief offset of _stack_size in Thread.
+   */
+  off_t ofsThreadStackSize;
+
   /*!
    * \brief Pointer of Threads_lock monitor in HotSpot.
    */
@@ -327,6 +342,16 @@ class TVMVariables {
    */
   size_t youngGenSize;
 
+  /*!
+   * \brief Start address of reserved Java heap.
+   */
+  void *heapStartAddr;
+
+  /*!
+   * \brief sizeof reserved Java heap.
+   */
+  size_t heapSize;
+
   /* Class of HeapStats for scanning variables in HotSpot VM */
   TSymbolFinder *symFinder;
   TVMStructScanner *vmScanner;
@@ -461,10 +486,15 @@ class TVMVariables {
   };
   inline off_t getOfsOSThreadThreadId() { return ofsOSThreadThreadId; };
   inline off_t getOfsObjectMonitorObject() { return ofsObjectMonitorObject; };
+  inline off_t getOfsObjectMonitorOwner() { return ofsObjectMonitorOwner; };
+  inline off_t getOfsThreadStackBase() { return ofsThreadStackBase; };
+  inline off_t getOfsThreadStackSize() { return ofsThreadStackSize; };
   inline void *getThreadsLock() { return threads_lock; };
   inline void *getYoungGen() const { return youngGen; };
   inline void *getYoungGenStartAddr() const { return youngGenStartAddr; };
   inline size_t getYoungGenSize() const { return youngGenSize; };
+  inline void *getHeapStartAddr() const { return heapStartAddr; };
+  inline size_t getHeapSize() const { return heapSize; };
 };
 
 #endif  // VMVARIABLES_H
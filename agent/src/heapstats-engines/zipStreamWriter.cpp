@@ -0,0 +1,600 @@
+/*!
+ * \file zipStreamWriter.cpp
+ * \brief This file is used to write ZIP archive in streaming.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "util.hpp"
+#include "zipStreamWriter.hpp"
+
+/*!
+ * \brief Signature of local file header.
+ */
+#define ZIP_LOCAL_HEADER_SIG 0x04034b50
+
+/*!
+ * \brief Signature of data descriptor.
+ */
+#define ZIP_DATA_DESCRIPTOR_SIG 0x08074b50
+
+/*!
+ * \brief Signature of central directory header.
+ */
+#define ZIP_CENTRAL_HEADER_SIG 0x02014b50
+
+/*!
+ * \brief Signature of end of central directory record.
+ */
+#define ZIP_END_OF_CENTRAL_SIG 0x06054b50
+
+/*!
+ * \brief Version needed to extract (2.0: deflate).
+ */
+#define ZIP_VERSION_NEEDED 20
+
+/*!
+ * \brief Version made by (upper byte 3: UNIX).
+ */
+#define ZIP_VERSION_MADE_BY ((3 << 8) | ZIP_VERSION_NEEDED)
+
+/*!
+ * \brief General purpose flag: sizes and CRC are in data descriptor.
+ */
+#define ZIP_FLAG_DATA_DESCRIPTOR 0x0008
+
+/*!
+ * \brief Compression method: deflate.
+ */
+#define ZIP_METHOD_DEFLATE 8
+
+/*!
+ * \brief Max offset and size which can be stored without ZIP64.
+ */
+#define ZIP_MAX_32BIT_VALUE 0xffffffffULL
+
+/*!
+ * \brief Store 16bit value as little endian.
+ * \param buf   [out] Buffer to store.
+ * \param value [in]  Value to store.
+ * \return Next position of buf.
+ */
+static inline unsigned char *putLE16(unsigned char *buf, uint16_t value) {
+  buf[0] = (unsigned char)(value & 0xff);
+  buf[1] = (unsigned char)((value >> 8) & 0xff);
+  return buf + 2;
+}
+
+/*!
+ * \brief Store 32bit value as little endian.
+ * \param buf   [out] Buffer to store.
+ * \param value [in]  Value to store.
+ * \return Next position of buf.
+ */
+static inline unsigned char *putLE32(unsigned char *buf, uint32_t value) {
+  buf = putLE16(buf, (uint16_t)(value & 0xffff));
+  return putLE16(buf, (uint16_t)((value >> 16) & 0xffff));
+}
+
+/*!
+ * \brief Convert time to MS-DOS date and time.
+ * \param mtime   [in]  Time to convert.
+ * \param dosTime [out] MS-DOS time.
+ * \param dosDate [out] MS-DOS date.
+ */
+static void toDosTime(time_t mtime, uint16_t *dosTime, uint16_t *dosDate) {
+  struct tm tm;
+  if (unlikely(localtime_r(&mtime, &tm) == NULL) || (tm.tm_year < 80)) {
+    /* MS-DOS time starts at 1980-01-01. */
+    *dosTime = 0;
+    *dosDate = (1 << 5) | 1;
+    return;
+  }
+
+  *dosTime = (uint16_t)((tm.tm_hour << 11) | (tm.tm_min << 5) |
+                        (tm.tm_sec >> 1));
+  *dosDate = (uint16_t)(((tm.tm_year - 80) << 9) | ((tm.tm_mon + 1) << 5) |
+                        tm.tm_mday);
+}
+
+/*!
+ * \brief TZipStreamWriter constructor.
+ * \param path [in] Path of archive file. It must not exist.
+ */
+TZipStreamWriter::TZipStreamWriter(const char *path) {
+  initialize();
+
+  this->path = strdup(path);
+  if (unlikely(this->path == NULL)) {
+    release();
+    throw ENOMEM;
+  }
+
+  fd = open(path, O_CREAT | O_WRONLY | O_EXCL | O_CLOEXEC, S_IRUSR | S_IWUSR);
+  if (unlikely(fd < 0)) {
+    int raisedErrNum = errno;
+    release();
+    throw raisedErrNum;
+  }
+}
+
+/*!
+ * \brief TZipStreamWriter constructor for part of archive.<br>
+ *        Entries in the part are moved to other archive by append().
+ * \param fd [in] FD of readable and writable empty file.<br>
+ *                It is closed by this instance.
+ */
+TZipStreamWriter::TZipStreamWriter(int fd) {
+  try {
+    initialize();
+  } catch (...) {
+    close(fd);
+    throw;
+  }
+
+  this->fd = fd;
+}
+
+/*!
+ * \brief TZipStreamWriter destructor.<br>
+ *        Archive is removed if finish() has not succeeded.
+ */
+TZipStreamWriter::~TZipStreamWriter(void) {
+  if (fd >= 0) {
+    close(fd);
+  }
+
+  if (unlikely(!isFinished && (path != NULL))) {
+    unlink(path);
+  }
+
+  for (std::vector<TZipEntry>::iterator itr = entries.begin();
+       itr != entries.end(); itr++) {
+    free((*itr).name);
+  }
+
+  release();
+}
+
+/*!
+ * \brief Allocate buffers and initialize deflate stream.
+ */
+void TZipStreamWriter::initialize(void) {
+  path = NULL;
+  fd = -1;
+  outLen = 0;
+  offset = 0;
+  isFinished = false;
+
+  inBuf = (unsigned char *)malloc(ZIP_STREAM_BUFFER_SIZE);
+  outBuf = (unsigned char *)malloc(ZIP_STREAM_BUFFER_SIZE);
+  if (unlikely((inBuf == NULL) || (outBuf == NULL))) {
+    free(inBuf);
+    free(outBuf);
+    throw ENOMEM;
+  }
+
+  /* Raw deflate (negative window bits) because ZIP has own header. */
+  memset(&stream, 0, sizeof(z_stream));
+  if (unlikely(deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                            -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)) {
+    free(inBuf);
+    free(outBuf);
+    throw ENOMEM;
+  }
+}
+
+/*!
+ * \brief Release buffers and deflate stream.
+ */
+void TZipStreamWriter::release(void) {
+  deflateEnd(&stream);
+  free(path);
+  free(inBuf);
+  free(outBuf);
+}
+
+/*!
+ * \brief Write data in outBuf to archive file.
+ * \return Value is zero, if process is succeed.<br />
+ *         Value is error number a.k.a. "errno", if process is failure.
+ */
+int TZipStreamWriter::flushBuffer(void) {
+  unsigned char *pos = outBuf;
+
+  while (outLen > 0) {
+    ssize_t written = write(fd, pos, outLen);
+    if (unlikely(written < 0)) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      return errno;
+    }
+
+    pos += written;
+    outLen -= written;
+  }
+
+  return 0;
+}
+
+/*!
+ * \brief Append data to archive through outBuf.
+ * \param data [in] Data to write.
+ * \param len  [in] Length of data.
+ * \return Value is zero, if process is succeed.<br />
+ *         Value is error number a.k.a. "errno", if process is failure.
+ */
+int TZipStreamWriter::put(const void *data, size_t len) {
+  const unsigned char *src = (const unsigned char *)data;
+
+  while (len > 0) {
+    if (outLen == ZIP_STREAM_BUFFER_SIZE) {
+      int result = flushBuffer();
+      if (unlikely(result != 0)) {
+        return result;
+      }
+    }
+
+    size_t copyLen = ZIP_STREAM_BUFFER_SIZE - outLen;
+    if (copyLen > len) {
+      copyLen = len;
+    }
+
+    memcpy(outBuf + outLen, src, copyLen);
+    outLen += copyLen;
+    offset += copyLen;
+    src += copyLen;
+    len -= copyLen;
+  }
+
+  return 0;
+}
+
+/*!
+ * \brief Deflate data in stream, and append it to archive.
+ * \param flush      [in]     Flush mode of deflate().
+ * \param compressed [in,out] Total size of deflated data.
+ * \return Value is zero, if process is succeed.<br />
+ *         Value is error number a.k.a. "errno", if process is failure.
+ */
+int TZipStreamWriter::deflateToArchive(int flush, uint64_t *compressed) {
+  unsigned char deflated[4096];
+  int ret;
+
+  do {
+    stream.next_out = deflated;
+    stream.avail_out = sizeof(deflated);
+
+    ret = deflate(&stream, flush);
+    if (unlikely(ret == Z_STREAM_ERROR)) {
+      return EINVAL;
+    }
+
+    size_t len = sizeof(deflated) - stream.avail_out;
+    int result = put(deflated, len);
+    if (unlikely(result != 0)) {
+      return result;
+    }
+    *compressed += len;
+  } while ((stream.avail_out == 0) ||
+           ((flush == Z_FINISH) && (ret != Z_STREAM_END)));
+
+  return 0;
+}
+
+/*!
+ * \brief Add all data which is read from FD to archive.
+ * \param srcFd     [in] FD of source. It is read until EOF.
+ * \param entryName [in] Entry name in archive.
+ * \param mtime     [in] Modification time of entry.
+ * \return Value is zero, if process is succeed.<br />
+ *         Value is error number a.k.a. "errno", if process is failure.
+ */
+int TZipStreamWriter::addFromFd(int srcFd, const char *entryName,
+                                time_t mtime) {
+  if (unlikely(isFinished)) {
+    return EINVAL;
+  }
+
+  if (unlikely((uint64_t)offset > ZIP_MAX_32BIT_VALUE)) {
+    /* ZIP64 is not supported. */
+    return EFBIG;
+  }
+
+  TZipEntry entry;
+  size_t nameLen = strlen(entryName);
+  entry.offset = (uint32_t)offset;
+  toDosTime(mtime, &entry.dosTime, &entry.dosDate);
+
+  /* Write local header. Sizes and CRC are written in data descriptor. */
+  unsigned char header[30];
+  unsigned char *pos = putLE32(header, ZIP_LOCAL_HEADER_SIG);
+  pos = putLE16(pos, ZIP_VERSION_NEEDED);
+  pos = putLE16(pos, ZIP_FLAG_DATA_DESCRIPTOR);
+  pos = putLE16(pos, ZIP_METHOD_DEFLATE);
+  pos = putLE16(pos, entry.dosTime);
+  pos = putLE16(pos, entry.dosDate);
+  pos = putLE32(pos, 0);
+  pos = putLE32(pos, 0);
+  pos = putLE32(pos, 0);
+  pos = putLE16(pos, (uint16_t)nameLen);
+  putLE16(pos, 0);
+
+  int result = put(header, sizeof(header));
+  if (likely(result == 0)) {
+    result = put(entryName, nameLen);
+  }
+  if (unlikely(result != 0)) {
+    return result;
+  }
+
+  /* Stream source to archive. */
+  uLong crc = crc32(0L, Z_NULL, 0);
+  uint64_t size = 0;
+  uint64_t compressed = 0;
+  deflateReset(&stream);
+
+  while (true) {
+    ssize_t readSize = read(srcFd, inBuf, ZIP_STREAM_BUFFER_SIZE);
+    if (readSize == 0) {
+      break;
+    } else if (unlikely(readSize < 0)) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      return errno;
+    }
+
+    crc = crc32(crc, inBuf, (uInt)readSize);
+    size += readSize;
+
+    stream.next_in = inBuf;
+    stream.avail_in = (uInt)readSize;
+    result = deflateToArchive(Z_NO_FLUSH, &compressed);
+    if (unlikely(result != 0)) {
+      return result;
+    }
+  }
+
+  stream.next_in = NULL;
+  stream.avail_in = 0;
+  result = deflateToArchive(Z_FINISH, &compressed);
+  if (unlikely(result != 0)) {
+    return result;
+  }
+
+  if (unlikely((size > ZIP_MAX_32BIT_VALUE) ||
+               (compressed > ZIP_MAX_32BIT_VALUE))) {
+    return EFBIG;
+  }
+
+  entry.crc = (uint32_t)crc;
+  entry.size = (uint32_t)size;
+  entry.compressedSize = (uint32_t)compressed;
+
+  /* Write data descriptor. */
+  unsigned char descriptor[16];
+  pos = putLE32(descriptor, ZIP_DATA_DESCRIPTOR_SIG);
+  pos = putLE32(pos, entry.crc);
+  pos = putLE32(pos, entry.compressedSize);
+  putLE32(pos, entry.size);
+
+  result = put(descriptor, sizeof(descriptor));
+  if (unlikely(result != 0)) {
+    return result;
+  }
+
+  entry.name = strdup(entryName);
+  if (unlikely(entry.name == NULL)) {
+    return ENOMEM;
+  }
+  entries.push_back(entry);
+
+  return 0;
+}
+
+/*!
+ * \brief Add file to archive.
+ * \param sourceFile [in] Path of source file.
+ * \param entryName  [in] Entry name in archive.<br>
+ *                        File name of sourceFile is used if it is NULL.
+ * \return Value is zero, if process is succeed.<br />
+ *         Value is error number a.k.a. "errno", if process is failure.
+ */
+int TZipStreamWriter::addFile(const char *sourceFile, const char *entryName) {
+  if (entryName == NULL) {
+    entryName = strrchr(sourceFile, '/');
+    entryName = (entryName == NULL) ? sourceFile : entryName + 1;
+  }
+
+  int srcFd = open(sourceFile, O_RDONLY | O_CLOEXEC);
+  if (unlikely(srcFd < 0)) {
+    return errno;
+  }
+
+  /* Files in procfs have no modification time, so use current time. */
+  struct stat st;
+  time_t mtime = time(NULL);
+  if (likely(fstat(srcFd, &st) == 0) && (st.st_mtime != 0)) {
+    mtime = st.st_mtime;
+  }
+
+  int result = addFromFd(srcFd, entryName, mtime);
+  close(srcFd);
+
+  return result;
+}
+
+/*!
+ * \brief Move all entries in part of archive to this archive.<br>
+ *        Deflated data is copied as is, so parts can be made in parallel.
+ * \param part [in] Part of archive. It is empty after this call.
+ * \return Value is zero, if process is succeed.<br />
+ *         Value is error number a.k.a. "errno", if process is failure.
+ */
+int TZipStreamWriter::append(TZipStreamWriter *part) {
+  if (unlikely(isFinished || (part->path != NULL))) {
+    return EINVAL;
+  }
+
+  off_t base = offset;
+  if (unlikely((uint64_t)(base + part->offset) > ZIP_MAX_32BIT_VALUE)) {
+    /* ZIP64 is not supported. */
+    return EFBIG;
+  }
+
+  /* Local headers in the part do not depend on its position. */
+  int result = part->flushBuffer();
+  if (unlikely(result != 0)) {
+    return result;
+  }
+
+  if (unlikely(lseek(part->fd, 0, SEEK_SET) != 0)) {
+    return errno;
+  }
+
+  off_t remain = part->offset;
+  while (remain > 0) {
+    ssize_t readSize = read(part->fd, inBuf,
+                            (remain < ZIP_STREAM_BUFFER_SIZE)
+                                ? (size_t)remain
+                                : ZIP_STREAM_BUFFER_SIZE);
+    if (unlikely(readSize <= 0)) {
+      if ((readSize < 0) && (errno == EINTR)) {
+        continue;
+      }
+
+      return (readSize == 0) ? EIO : errno;
+    }
+
+    result = put(inBuf, readSize);
+    if (unlikely(result != 0)) {
+      return result;
+    }
+    remain -= readSize;
+  }
+
+  /* Move entries with relocated offset. */
+  for (std::vector<TZipEntry>::iterator itr = part->entries.begin();
+       itr != part->entries.end(); itr++) {
+    (*itr).offset += (uint32_t)base;
+    entries.push_back(*itr);
+  }
+  part->entries.clear();
+
+  /* Discard data in the part. */
+  if (unlikely((ftruncate(part->fd, 0) != 0) ||
+               (lseek(part->fd, 0, SEEK_SET) != 0))) {
+    return errno;
+  }
+  part->offset = 0;
+
+  return 0;
+}
+
+/*!
+ * \brief Write central directory and close archive.
+ * \return Value is zero, if process is succeed.<br />
+ *         Value is error number a.k.a. "errno", if process is failure.
+ */
+int TZipStreamWriter::finish(void) {
+  if (unlikely(isFinished)) {
+    return EINVAL;
+  }
+
+  off_t centralOffset = offset;
+  int result = 0;
+
+  /* Write central directory. */
+  for (std::vector<TZipEntry>::iterator itr = entries.begin();
+       (itr != entries.end()) && (result == 0); itr++) {
+    unsigned char header[46];
+    size_t nameLen = strlen((*itr).name);
+
+    unsigned char *pos = putLE32(header, ZIP_CENTRAL_HEADER_SIG);
+    pos = putLE16(pos, ZIP_VERSION_MADE_BY);
+    pos = putLE16(pos, ZIP_VERSION_NEEDED);
+    pos = putLE16(pos, ZIP_FLAG_DATA_DESCRIPTOR);
+    pos = putLE16(pos, ZIP_METHOD_DEFLATE);
+    pos = putLE16(pos, (*itr).dosTime);
+    pos = putLE16(pos, (*itr).dosDate);
+    pos = putLE32(pos, (*itr).crc);
+    pos = putLE32(pos, (*itr).compressedSize);
+    pos = putLE32(pos, (*itr).size);
+    pos = putLE16(pos, (uint16_t)nameLen);
+    pos = putLE16(pos, 0); /* Extra field length.   */
+    pos = putLE16(pos, 0); /* File comment length.  */
+    pos = putLE16(pos, 0); /* Disk number start.    */
+    pos = putLE16(pos, 0); /* Internal attributes.  */
+    /* External attributes: regular file with rw-r--r-- . */
+    pos = putLE32(pos, (uint32_t)(S_IFREG | S_IRUSR | S_IWUSR | S_IRGRP |
+                                  S_IROTH) << 16);
+    putLE32(pos, (*itr).offset);
+
+    result = put(header, sizeof(header));
+    if (likely(result == 0)) {
+      result = put((*itr).name, nameLen);
+    }
+  }
+
+  if (unlikely(result != 0)) {
+    return result;
+  }
+
+  if (unlikely(((uint64_t)offset > ZIP_MAX_32BIT_VALUE) ||
+               (entries.size() > 0xffff))) {
+    return EFBIG;
+  }
+
+  /* Write end of central directory record. */
+  unsigned char record[22];
+  unsigned char *pos = putLE32(record, ZIP_END_OF_CENTRAL_SIG);
+  pos = putLE16(pos, 0); /* Number of this disk.          */
+  pos = putLE16(pos, 0); /* Disk where central dir starts. */
+  pos = putLE16(pos, (uint16_t)entries.size());
+  pos = putLE16(pos, (uint16_t)entries.size());
+  pos = putLE32(pos, (uint32_t)(offset - centralOffset));
+  pos = putLE32(pos, (uint32_t)centralOffset);
+  putLE16(pos, 0); /* Comment length. */
+
+  result = put(record, sizeof(record));
+  if (likely(result == 0)) {
+    result = flushBuffer();
+  }
+  if (unlikely(result != 0)) {
+    return result;
+  }
+
+  int ret = close(fd);
+  fd = -1;
+  if (unlikely(ret != 0)) {
+    return errno;
+  }
+
+  isFinished = true;
+  return 0;
+}
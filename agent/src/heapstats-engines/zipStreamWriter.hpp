@@ -0,0 +1,197 @@
+/*!
+ * \file zipStreamWriter.hpp
+ * \brief This file is used to write ZIP archive in streaming.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#ifndef ZIP_STREAM_WRITER_HPP
+#define ZIP_STREAM_WRITER_HPP
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <time.h>
+#include <zlib.h>
+
+#include <vector>
+
+/*!
+ * \brief Size of buffers for reading source and writing archive.
+ */
+#define ZIP_STREAM_BUFFER_SIZE 65536
+
+/*!
+ * \brief Entry in central directory.
+ */
+typedef struct {
+  char *name;              /*!< Entry name (without directory).   */
+  uint32_t crc;            /*!< CRC-32 of uncompressed data.      */
+  uint32_t compressedSize; /*!< Size of deflated data.            */
+  uint32_t size;           /*!< Size of uncompressed data.        */
+  uint32_t offset;         /*!< Offset of local header.           */
+  uint16_t dosTime;        /*!< Modification time in MS-DOS form. */
+  uint16_t dosDate;        /*!< Modification date in MS-DOS form. */
+} TZipEntry;
+
+/*!
+ * \brief This class writes ZIP archive in one pass.<br>
+ *        Each source is read, deflated and written to the archive directly,
+ *        so any working file is not needed. Sizes and CRC of entries are
+ *        written in data descriptor, so the source can be pipe or procfs
+ *        which size is unknown.
+ */
+class TZipStreamWriter {
+ private:
+  /*!
+   * \brief Path of archive file. NULL if this is part of archive.
+   */
+  char *path;
+
+  /*!
+   * \brief FD of archive file.
+   */
+  int fd;
+
+  /*!
+   * \brief Deflate stream which is reused in all entries.
+   */
+  z_stream stream;
+
+  /*!
+   * \brief Buffer for source data.
+   */
+  unsigned char *inBuf;
+
+  /*!
+   * \brief Buffer for archive data.
+   */
+  unsigned char *outBuf;
+
+  /*!
+   * \brief Length of data in outBuf.
+   */
+  size_t outLen;
+
+  /*!
+   * \brief Current size of archive.
+   */
+  off_t offset;
+
+  /*!
+   * \brief Entries which have been written.
+   */
+  std::vector<TZipEntry> entries;
+
+  /*!
+   * \brief Is central directory written?
+   */
+  bool isFinished;
+
+  /*!
+   * \brief Allocate buffers and initialize deflate stream.
+   */
+  void initialize(void);
+
+  /*!
+   * \brief Release buffers and deflate stream.
+   */
+  void release(void);
+
+  /*!
+   * \brief Write data in outBuf to archive file.
+   * \return Value is zero, if process is succeed.<br />
+   *         Value is error number a.k.a. "errno", if process is failure.
+   */
+  int flushBuffer(void);
+
+  /*!
+   * \brief Append data to archive through outBuf.
+   * \param data [in] Data to write.
+   * \param len  [in] Length of data.
+   * \return Value is zero, if process is succeed.<br />
+   *         Value is error number a.k.a. "errno", if process is failure.
+   */
+  int put(const void *data, size_t len);
+
+  /*!
+   * \brief Deflate data in stream, and append it to archive.
+   * \param flush      [in]     Flush mode of deflate().
+   * \param compressed [in,out] Total size of deflated data.
+   * \return Value is zero, if process is succeed.<br />
+   *         Value is error number a.k.a. "errno", if process is failure.
+   */
+  int deflateToArchive(int flush, uint64_t *compressed);
+
+ public:
+  /*!
+   * \brief TZipStreamWriter constructor.
+   * \param path [in] Path of archive file. It must not exist.
+   */
+  TZipStreamWriter(const char *path);
+
+  /*!
+   * \brief TZipStreamWriter constructor for part of archive.<br>
+   *        Entries in the part are moved to other archive by append().
+   * \param fd [in] FD of readable and writable empty file.<br>
+   *                It is closed by this instance.
+   */
+  TZipStreamWriter(int fd);
+
+  /*!
+   * \brief TZipStreamWriter destructor.<br>
+   *        Archive is removed if finish() has not succeeded.
+   */
+  virtual ~TZipStreamWriter(void);
+
+  /*!
+   * \brief Add all data which is read from FD to archive.
+   * \param srcFd     [in] FD of source. It is read until EOF.
+   * \param entryName [in] Entry name in archive.
+   * \param mtime     [in] Modification time of entry.
+   * \return Value is zero, if process is succeed.<br />
+   *         Value is error number a.k.a. "errno", if process is failure.
+   */
+  int addFromFd(int srcFd, const char *entryName, time_t mtime);
+
+  /*!
+   * \brief Add file to archive.
+   * \param sourceFile [in] Path of source file.
+   * \param entryName  [in] Entry name in archive.<br>
+   *                        File name of sourceFile is used if it is NULL.
+   * \return Value is zero, if process is succeed.<br />
+   *         Value is error number a.k.a. "errno", if process is failure.
+   */
+  int addFile(const char *sourceFile, const char *entryName = NULL);
+
+  /*!
+   * \brief Move all entries in part of archive to this archive.<br>
+   *        Deflated data is copied as is, so parts can be made in parallel.
+   * \param part [in] Part of archive. It is empty after this call.
+   * \return Value is zero, if process is succeed.<br />
+   *         Value is error number a.k.a. "errno", if process is failure.
+   */
+  int append(TZipStreamWriter *part);
+
+  /*!
+   * \brief Write central directory and close archive.
+   * \return Value is zero, if process is succeed.<br />
+   *         Value is error number a.k.a. "errno", if process is failure.
+   */
+  int finish(void);
+};
+
+#endif  // ZIP_STREAM_WRITER_HPP
@@ -0,0 +1,70 @@
+import java.util.concurrent.CountDownLatch;
+import java.util.concurrent.atomic.AtomicBoolean;
+
+
+public class AllocBurn implements Runnable{
+
+  private final AtomicBoolean running;
+
+  private final CountDownLatch startLatch;
+
+  private long count;
+
+  private Object[] holder;
+
+  public AllocBurn(AtomicBoolean running, CountDownLatch startLatch){
+    this.running = running;
+    this.startLatch = startLatch;
+    this.count = 0;
+    this.holder = new Object[1024];
+  }
+
+  private void allocate(int size){
+    holder[(int)(count & (holder.length - 1))] = new byte[size];
+  }
+
+  public void run(){
+
+    try{
+      startLatch.await();
+    }
+    catch(InterruptedException e){
+      return;
+    }
+
+    while(running.get()){
+      allocate(1024);
+      count++;
+    }
+
+  }
+
+  public static void main(String[] args) throws Exception{
+    int threads = (args.length > 0) ? Integer.parseInt(args[0]) : 4;
+    int seconds = (args.length > 1) ? Integer.parseInt(args[1]) : 10;
+
+    AtomicBoolean running = new AtomicBoolean(true);
+    CountDownLatch startLatch = new CountDownLatch(1);
+    AllocBurn[] burns = new AllocBurn[threads];
+    Thread[] workers = new Thread[threads];
+
+    for(int idx = 0; idx < threads; idx++){
+      burns[idx] = new AllocBurn(running, startLatch);
+      workers[idx] = new Thread(burns[idx], "AllocBurn-" + idx);
+      workers[idx].start();
+    }
+
+    startLatch.countDown();
+    Thread.sleep(seconds * 1000L);
+    running.set(false);
+
+    long total = 0;
+    for(int idx = 0; idx < threads; idx++){
+      workers[idx].join();
+      total += burns[idx].count;
+    }
+
+    System.out.println("allocations/sec: " + (total / seconds));
+  }
+
+}
@@ -0,0 +1,42 @@
+#!/bin/bash
+
+### Usage
+###   ./testcase.sh /path/to/heapstats [threads] [seconds]
+###
+### Compare throughput of allocating threads between alloc_profile=false and
+### alloc_profile=true, and check allocation site ranking which is written
+### by allocation profiler. This test requires JDK 11 or later.
+
+TARGET_HEAPSTATS=$1
+shift
+
+if [ "x$TARGET_HEAPSTATS" = "x" ]; then
+  echo "You must set HeapStats agent that you want to check."
+  exit 1
+fi
+
+if [ "x$JAVA_HOME" = "x" ]; then
+  JAVA_HOME=/usr/lib/jvm/java-openjdk
+fi
+
+$JAVA_HOME/bin/javac AllocBurn.java
+
+rm -f heapstats-alloc-profile.log
+
+for PROFILE in false true; do
+  CONF=heapstats-test-$PROFILE.conf
+  sed -e "s/^alloc_profile=.*/alloc_profile=$PROFILE/" heapstats.conf > $CONF
+
+  echo "alloc_profile=$PROFILE"
+  $JAVA_HOME/bin/java $JAVA_OPTS -agentpath:$TARGET_HEAPSTATS=$CONF \
+                                                              AllocBurn "$@"
+
+  rm -f $CONF
+done
+
+if grep -q "LAllocBurn;.allocate" heapstats-alloc-profile.log; then
+  echo "Allocation profile: OK"
+else
+  echo "Allocation profile: NG (AllocBurn.allocate is not found)"
+  exit 1
+fi
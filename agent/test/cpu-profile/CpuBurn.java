@@ -0,0 +1,76 @@
+import java.util.concurrent.CountDownLatch;
+import java.util.concurrent.atomic.AtomicBoolean;
+
+
+public class CpuBurn implements Runnable{
+
+  private final AtomicBoolean running;
+
+  private final CountDownLatch startLatch;
+
+  private long count;
+
+  private double result;
+
+  public CpuBurn(AtomicBoolean running, CountDownLatch startLatch){
+    this.running = running;
+    this.startLatch = startLatch;
+    this.count = 0;
+    this.result = 0.0d;
+  }
+
+  private double burn(int loop){
+    double val = 0.0d;
+
+    for(int cnt = 1; cnt <= loop; cnt++){
+      val += Math.sqrt(cnt) / cnt;
+    }
+
+    return val;
+  }
+
+  public void run(){
+
+    try{
+      startLatch.await();
+    }
+    catch(InterruptedException e){
+      return;
+    }
+
+    while(running.get()){
+      result += burn(10000);
+      count++;
+    }
+
+  }
+
+  public static void main(String[] args) throws Exception{
+    int threads = (args.length > 0) ? Integer.parseInt(args[0]) : 4;
+    int seconds = (args.length > 1) ? Integer.parseInt(args[1]) : 10;
+
+    AtomicBoolean running = new AtomicBoolean(true);
+    CountDownLatch startLatch = new CountDownLatch(1);
+    CpuBurn[] burns = new CpuBurn[threads];
+    Thread[] workers = new Thread[threads];
+
+    for(int idx = 0; idx < threads; idx++){
+      burns[idx] = new CpuBurn(running, startLatch);
+      workers[idx] = new Thread(burns[idx], "CpuBurn-" + idx);
+      workers[idx].start();
+    }
+
+    startLatch.countDown();
+    Thread.sleep(seconds * 1000L);
+    running.set(false);
+
+    long total = 0;
+    for(int idx = 0; idx < threads; idx++){
+      workers[idx].join();
+      total += burns[idx].count;
+    }
+
+    System.out.println("loops/sec: " + (total / seconds));
+  }
+
+}
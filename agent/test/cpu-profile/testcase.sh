@@ -0,0 +1,40 @@
+#!/bin/bash
+
+### Usage
+###   ./testcase.sh /path/to/heapstats [threads] [seconds]
+###
+### Compare throughput of CPU bound threads between cpu_profile=false and
+### cpu_profile=true, and check collapsed stacks which are written by
+### CPU profiler.
+
+TARGET_HEAPSTATS=$1
+shift
+
+if [ "x$TARGET_HEAPSTATS" = "x" ]; then
+  echo "You must set HeapStats agent that you want to check."
+  exit 1
+fi
+
+if [ "x$JAVA_HOME" = "x" ]; then
+  JAVA_HOME=/usr/lib/jvm/java-openjdk
+fi
+
+$JAVA_HOME/bin/javac CpuBurn.java
+
+for PROFILE in false true; do
+  CONF=heapstats-test-$PROFILE.conf
+  sed -e "s/^cpu_profile=.*/cpu_profile=$PROFILE/" heapstats.conf > $CONF
+
+  echo "cpu_profile=$PROFILE"
+  $JAVA_HOME/bin/java $JAVA_OPTS -agentpath:$TARGET_HEAPSTATS=$CONF \
+                                                              CpuBurn "$@"
+
+  rm -f $CONF
+done
+
+if grep -q "CpuBurn.burn" heapstats-cpu-profile.txt; then
+  echo "CPU profile: OK"
+else
+  echo "CPU profile: NG (CpuBurn.burn is not found)"
+  exit 1
+fi
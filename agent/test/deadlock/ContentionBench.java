@@ -0,0 +1,83 @@
+import java.util.concurrent.CountDownLatch;
+import java.util.concurrent.atomic.AtomicBoolean;
+
+
+public class ContentionBench implements Runnable{
+
+  private final Object[] locks;
+
+  private final AtomicBoolean running;
+
+  private final CountDownLatch startLatch;
+
+  private long count;
+
+  public ContentionBench(Object[] locks, AtomicBoolean running,
+                                                 CountDownLatch startLatch){
+    this.locks = locks;
+    this.running = running;
+    this.startLatch = startLatch;
+    this.count = 0;
+  }
+
+  public void run(){
+
+    try{
+      startLatch.await();
+    }
+    catch(InterruptedException e){
+      return;
+    }
+
+    int idx = 0;
+    while(running.get()){
+
+      synchronized(locks[idx]){
+        /* Hold the lock for a while to cause contention. */
+        for(int cnt = 0; cnt < 100; cnt++){
+          Thread.yield();
+        }
+        count++;
+      }
+
+      idx = (idx + 1) % locks.length;
+    }
+
+  }
+
+  public static void main(String[] args) throws Exception{
+    int threads = (args.length > 0) ? Integer.parseInt(args[0]) : 16;
+    int lockNum = (args.length > 1) ? Integer.parseInt(args[1]) : 4;
+    int seconds = (args.length > 2) ? Integer.parseInt(args[2]) : 10;
+
+    Object[] locks = new Object[lockNum];
+    for(int idx = 0; idx < lockNum; idx++){
+      locks[idx] = new Object();
+    }
+
+    AtomicBoolean running = new AtomicBoolean(true);
+    CountDownLatch startLatch = new CountDownLatch(1);
+    ContentionBench[] benches = new ContentionBench[threads];
+    Thread[] workers = new Thread[threads];
+
+    for(int idx = 0; idx < threads; idx++){
+      benches[idx] = new ContentionBench(locks, running, startLatch);
+      workers[idx] = new Thread(benches[idx]);
+      workers[idx].start();
+    }
+
+    startLatch.countDown();
+    Thread.sleep(seconds * 1000L);
+    running.set(false);
+
+    long total = 0;
+    for(int idx = 0; idx < threads; idx++){
+      workers[idx].join();
+      total += benches[idx].count;
+    }
+
+    System.out.println("threads: " + threads + ", locks: " + lockNum +
+                       ", ops/sec: " + (total / seconds));
+  }
+
+}
@@ -0,0 +1,43 @@
+#!/bin/bash
+
+### Usage
+###   ./bench.sh /path/to/heapstats [threads] [locks] [seconds]
+###
+### Compare throughput of contended monitor enter between
+### check_deadlock=true, check_deadlock=false and monitor_profile=true.
+### Ranking of contended monitors is output every 5 seconds on
+### monitor_profile=true.
+
+TARGET_HEAPSTATS=$1
+shift
+
+if [ "x$TARGET_HEAPSTATS" = "x" ]; then
+  echo "You must set HeapStats agent that you want to check."
+  exit 1
+fi
+
+if [ "x$JAVA_HOME" = "x" ]; then
+  JAVA_HOME=/usr/lib/jvm/java-openjdk
+fi
+
+$JAVA_HOME/bin/javac ContentionBench.java
+
+for CHECK in false true profile; do
+  CONF=heapstats-bench-$CHECK.conf
+
+  if [ "$CHECK" = "profile" ]; then
+    sed -e "s/^check_deadlock=.*/check_deadlock=false/" \
+        -e "s/^monitor_profile=.*/monitor_profile=true/" \
+        -e "s/^monitor_profile_stack_depth=.*/monitor_profile_stack_depth=2/" \
+        -e "s/^log_interval=.*/log_interval=5/" heapstats.conf > $CONF
+    echo "monitor_profile=true"
+  else
+    sed -e "s/^check_deadlock=.*/check_deadlock=$CHECK/" heapstats.conf > $CONF
+    echo "check_deadlock=$CHECK"
+  fi
+
+  $JAVA_HOME/bin/java $JAVA_OPTS -agentpath:$TARGET_HEAPSTATS=$CONF \
+                                                      ContentionBench "$@"
+
+  rm -f $CONF
+done
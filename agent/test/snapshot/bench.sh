@@ -0,0 +1,45 @@
+#!/bin/bash
+
+### Usage
+###   ./bench.sh /path/to/heapstats-snapshot /path/to/heapstats-cli.jar \
+###                                        /path/to/heapstats_snapshot.dat
+###
+### Compare time to dump class histograms of all snapshots as CSV between
+### heapstats-snapshot (native) and heapstats-cli (Java SnapShotParser).
+### Number of decoding threads of heapstats-snapshot can be set through
+### SNAPSHOT_THREADS.
+
+SNAPSHOT_TOOL=$1
+CLI_JAR=$2
+SNAPSHOT_FILE=$3
+
+if [ "x$SNAPSHOT_FILE" = "x" ]; then
+  echo "You must set heapstats-snapshot, heapstats-cli.jar and snapshot file."
+  exit 1
+fi
+
+if [ "x$JAVA_HOME" = "x" ]; then
+  JAVA_HOME=/usr/lib/jvm/java-openjdk
+fi
+
+if [ "x$SNAPSHOT_THREADS" = "x" ]; then
+  SNAPSHOT_THREADS=`nproc`
+fi
+
+ls -l $SNAPSHOT_FILE
+
+echo "heapstats-snapshot: index and decode only"
+$SNAPSHOT_TOOL bench -j $SNAPSHOT_THREADS $SNAPSHOT_FILE
+
+echo "heapstats-snapshot: CSV ($SNAPSHOT_THREADS threads)"
+time $SNAPSHOT_TOOL csv -j $SNAPSHOT_THREADS $SNAPSHOT_FILE > native.csv
+
+echo "heapstats-snapshot: CSV (1 thread)"
+time $SNAPSHOT_TOOL csv -j 1 $SNAPSHOT_FILE > /dev/null
+
+echo "heapstats-cli: CSV"
+time $JAVA_HOME/bin/java $JAVA_OPTS -jar $CLI_JAR -snapshot -e java.csv \
+                                                              $SNAPSHOT_FILE
+
+wc -l native.csv java.csv
+rm -f native.csv java.csv
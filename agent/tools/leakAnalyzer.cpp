@@ -0,0 +1,197 @@
+/*!
+ * \file leakAnalyzer.cpp
+ * \brief This file is used to find leak suspects from snapshot history.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include <algorithm>
+
+#include "leakAnalyzer.hpp"
+
+/*!
+ * \brief Compare leak suspects by score in descending order.
+ * \param a [in] Leak suspect.
+ * \param b [in] Leak suspect.
+ * \return true if "a" is more suspicious than "b".
+ */
+static bool compareByScore(const TLeakSuspect &a, const TLeakSuspect &b) {
+  return a.score > b.score;
+}
+
+/*!
+ * \brief TLeakAnalyzer constructor.
+ * \param sampleAll [in] Sample all snapshots, not only after full GC.
+ */
+TLeakAnalyzer::TLeakAnalyzer(bool sampleAll) : statsMap() {
+  this->sampleAll = sampleAll;
+  this->prevFGCCount = -1;
+  this->sampleCount = 0;
+  this->firstTime = 0;
+  this->lastTime = 0;
+}
+
+/*!
+ * \brief TLeakAnalyzer destructor.
+ */
+TLeakAnalyzer::~TLeakAnalyzer(void) { /* Do nothing. */ }
+
+/*!
+ * \brief Set header of snapshot just before the first snapshot.<br>
+ *        It is used to decide whether the first snapshot is taken after
+ *        full GC.
+ * \param header [in] Header of snapshot.
+ */
+void TLeakAnalyzer::setBaseline(const TSnapShotFileHeader *header) {
+  prevFGCCount = header->FGCCount;
+}
+
+/*!
+ * \brief Add sample to statistics of a class.
+ * \param stats [in] Statistics of the class.
+ * \param time  [in] Time of sample (in sec from the first sample).
+ * \param size  [in] Total size.
+ * \param count [in] Instance count.
+ */
+void TLeakAnalyzer::addSample(TLeakStats *stats, double time, jlong size,
+                              jlong count) {
+  if (stats->samples > 0) {
+    if (size > stats->lastSize) {
+      stats->increases++;
+    }
+  } else {
+    stats->firstSize = size;
+    stats->firstCount = count;
+  }
+
+  /*
+   * Welford's online algorithm.
+   * Sums of squares are not kept because they lose precision.
+   */
+  stats->samples++;
+  double timeDelta = time - stats->meanTime;
+  stats->meanTime += timeDelta / stats->samples;
+  stats->meanSize += (size - stats->meanSize) / stats->samples;
+  stats->timeM2 += timeDelta * (time - stats->meanTime);
+  stats->sizeCoM += timeDelta * (size - stats->meanSize);
+
+  stats->lastSize = size;
+  stats->lastCount = count;
+}
+
+/*!
+ * \brief Add snapshot to statistics.<br>
+ *        Snapshots must be added in order of time.
+ * \param snapshot [in] Decoded snapshot.
+ */
+void TLeakAnalyzer::addSnapShot(const TSnapShot *snapshot) {
+  const TSnapShotFileHeader *hdr = &snapshot->index->header;
+  bool isAfterFullGC = (prevFGCCount >= 0) && (hdr->FGCCount > prevFGCCount);
+  prevFGCCount = hdr->FGCCount;
+
+  if (!sampleAll && !isAfterFullGC) {
+    return;
+  }
+
+  if (sampleCount == 0) {
+    firstTime = hdr->snapShotTime;
+  }
+
+  sampleCount++;
+  lastTime = hdr->snapShotTime;
+  double time = (hdr->snapShotTime - firstTime) / 1000.0;
+
+  for (size_t idx = 0; idx < snapshot->classes.size(); idx++) {
+    const TSnapShotClass *entry = &snapshot->classes[idx];
+    std::pair<TLeakStatsMap::iterator, bool> inserted =
+        statsMap.insert(std::make_pair(entry->tag, TLeakStats()));
+    TLeakStats *stats = &inserted.first->second;
+
+    if (inserted.second) {
+      stats->name = entry->name;
+      stats->nameLen = entry->nameLen;
+      stats->loaderId = entry->loaderId;
+      stats->samples = 0;
+      stats->meanTime = 0.0;
+      stats->meanSize = 0.0;
+      stats->timeM2 = 0.0;
+      stats->sizeCoM = 0.0;
+      stats->increases = 0;
+    }
+
+    addSample(stats, time, entry->totalSize, entry->count);
+    stats->lastSeq = sampleCount;
+  }
+
+  /* Classes which have no instance are not written in snapshot. */
+  for (TLeakStatsMap::iterator itr = statsMap.begin(); itr != statsMap.end();
+       ++itr) {
+    if (itr->second.lastSeq != sampleCount) {
+      addSample(&itr->second, time, 0, 0);
+      itr->second.lastSeq = sampleCount;
+    }
+  }
+}
+
+/*!
+ * \brief Rank leak suspects.<br>
+ *        Classes which are grown in total size are ranked by slope
+ *        weighted by monotonic growth score.
+ * \param minSamples [in]  Minimum number of samples of suspect.
+ * \param topN       [in]  Max number of suspects.
+ * \param suspects   [out] Suspects in descending order of score.
+ */
+void TLeakAnalyzer::getSuspects(jlong minSamples, size_t topN,
+                                std::vector<TLeakSuspect> *suspects) {
+  suspects->clear();
+
+  for (TLeakStatsMap::const_iterator itr = statsMap.begin();
+       itr != statsMap.end(); ++itr) {
+    const TLeakStats *stats = &itr->second;
+    if ((stats->samples < minSamples) || (stats->samples < 2) ||
+        (stats->timeM2 <= 0.0) || (stats->lastSize <= stats->firstSize)) {
+      continue;
+    }
+
+    TLeakSuspect suspect;
+    suspect.stats = stats;
+    suspect.slope = stats->sizeCoM / stats->timeM2 * 3600.0;
+    if (suspect.slope <= 0.0) {
+      continue;
+    }
+
+    suspect.monotonic = (double)stats->increases / (stats->samples - 1);
+
+    /*
+     * Size grows faster than instance count if elements are added to
+     * arrays or collections which are kept alive.
+     */
+    suspect.divergence =
+        ((stats->lastCount > 0) && (stats->firstCount > 0) &&
+         (stats->firstSize > 0))
+            ? ((double)stats->lastSize / stats->lastCount) /
+                  ((double)stats->firstSize / stats->firstCount)
+            : 0.0;
+    suspect.score = suspect.slope * suspect.monotonic;
+    suspects->push_back(suspect);
+  }
+
+  size_t rankCount = std::min(topN, suspects->size());
+  std::partial_sort(suspects->begin(), suspects->begin() + rankCount,
+                    suspects->end(), compareByScore);
+  suspects->resize(rankCount);
+}
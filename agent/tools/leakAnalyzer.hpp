@@ -0,0 +1,172 @@
+/*!
+ * \file leakAnalyzer.hpp
+ * \brief This file is used to find leak suspects from snapshot history.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#ifndef LEAK_ANALYZER_HPP
+#define LEAK_ANALYZER_HPP
+
+#include <tr1/unordered_map>
+#include <vector>
+
+#include "snapShotReader.hpp"
+
+/*!
+ * \brief Time series statistics of a class.<br>
+ *        Only running values are kept, so memory usage does not depend on
+ *        number of snapshots.
+ */
+typedef struct {
+  const char *name;    /*!< Class name in mapped file.                    */
+  jlong nameLen;       /*!< Length of class name.                         */
+  jlong loaderId;      /*!< Class loader instance id.                     */
+  jlong samples;       /*!< Number of samples.                            */
+  double meanTime;     /*!< Mean of sample time (in sec from the first).  */
+  double meanSize;     /*!< Mean of total size.                           */
+  double timeM2;       /*!< Sum of squared deviation of time.             */
+  double sizeCoM;      /*!< Sum of co-deviation of time and total size.   */
+  jlong increases;     /*!< Number of samples which is larger than prev.  */
+  jlong firstSize;     /*!< Total size at the first sample.               */
+  jlong firstCount;    /*!< Instance count at the first sample.           */
+  jlong lastSize;      /*!< Total size at the last sample.                */
+  jlong lastCount;     /*!< Instance count at the last sample.            */
+  size_t lastSeq;      /*!< Sequence of sample which updated this entry.  */
+} TLeakStats;
+
+/*!
+ * \brief Leak suspect in report.
+ */
+typedef struct {
+  const TLeakStats *stats; /*!< Statistics of the class.                  */
+  double slope;            /*!< Growth of total size (in bytes / hour).   */
+  double monotonic;        /*!< Ratio of samples which grew (0.0 - 1.0).  */
+  double divergence;       /*!< Ratio of growth of average instance size. */
+  double score;            /*!< Score to rank suspects.                   */
+} TLeakSuspect;
+
+/*!
+ * \brief This class computes per-class time series statistics from
+ *        snapshots, and ranks leak suspects.<br>
+ *        By default, only snapshots which are taken after full GC are
+ *        sampled, because live objects of other snapshots contain garbage.
+ */
+class TLeakAnalyzer {
+ public:
+  /*!
+   * \brief TLeakAnalyzer constructor.
+   * \param sampleAll [in] Sample all snapshots, not only after full GC.
+   */
+  TLeakAnalyzer(bool sampleAll);
+
+  /*!
+   * \brief TLeakAnalyzer destructor.
+   */
+  virtual ~TLeakAnalyzer(void);
+
+  /*!
+   * \brief Set header of snapshot just before the first snapshot.<br>
+   *        It is used to decide whether the first snapshot is taken after
+   *        full GC.
+   * \param header [in] Header of snapshot.
+   */
+  void setBaseline(const TSnapShotFileHeader *header);
+
+  /*!
+   * \brief Add snapshot to statistics.<br>
+   *        Snapshots must be added in order of time.
+   * \param snapshot [in] Decoded snapshot.
+   */
+  void addSnapShot(const TSnapShot *snapshot);
+
+  /*!
+   * \brief Get number of sampled snapshots.
+   * \return Number of samples.
+   */
+  inline size_t getSampleCount(void) { return sampleCount; };
+
+  /*!
+   * \brief Get time of the first sample.
+   * \return Time of the first sample (in msec).
+   */
+  inline jlong getFirstTime(void) { return firstTime; };
+
+  /*!
+   * \brief Get time of the last sample.
+   * \return Time of the last sample (in msec).
+   */
+  inline jlong getLastTime(void) { return lastTime; };
+
+  /*!
+   * \brief Rank leak suspects.<br>
+   *        Classes which are grown in total size are ranked by slope
+   *        weighted by monotonic growth score.
+   * \param minSamples [in]  Minimum number of samples of suspect.
+   * \param topN       [in]  Max number of suspects.
+   * \param suspects   [out] Suspects in descending order of score.
+   */
+  void getSuspects(jlong minSamples, size_t topN,
+                   std::vector<TLeakSuspect> *suspects);
+
+ private:
+  /*!
+   * \brief Map from class tag to statistics.
+   */
+  typedef std::tr1::unordered_map<jlong, TLeakStats> TLeakStatsMap;
+
+  /*!
+   * \brief Statistics of all classes.
+   */
+  TLeakStatsMap statsMap;
+
+  /*!
+   * \brief Sample all snapshots, not only after full GC.
+   */
+  bool sampleAll;
+
+  /*!
+   * \brief Full GC count of the previous snapshot.
+   */
+  jlong prevFGCCount;
+
+  /*!
+   * \brief Number of sampled snapshots.
+   */
+  size_t sampleCount;
+
+  /*!
+   * \brief Time of the first sample (in msec).
+   */
+  jlong firstTime;
+
+  /*!
+   * \brief Time of the last sample (in msec).
+   */
+  jlong lastTime;
+
+  /*!
+   * \brief Add sample to statistics of a class.
+   * \param stats [in] Statistics of the class.
+   * \param time  [in] Time of sample (in sec from the first sample).
+   * \param size  [in] Total size.
+   * \param count [in] Instance count.
+   */
+  void addSample(TLeakStats *stats, double time, jlong size, jlong count);
+};
+
+#endif  // LEAK_ANALYZER_HPP
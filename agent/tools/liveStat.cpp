@@ -0,0 +1,220 @@
+/*!
+ * \file liveStat.cpp
+ * \brief This file is used to show live counters which are published by
+ *        HeapStats agent.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "liveCounterFormat.hpp"
+
+/*!
+ * \brief Max number of retries to read consistent values.
+ */
+#define LIVE_STAT_MAX_RETRY 1000
+
+/*!
+ * \brief Show usage of this command.
+ * \param progName [in] Name of this command.
+ */
+static void showUsage(const char *progName) {
+  fprintf(stderr, "Usage: %s <pid | file> [interval(msec) [count]]\n",
+          progName);
+}
+
+/*!
+ * \brief Map live counter file.
+ * \param target [in] Process ID of JVM or path of live counter file.
+ * \return Mapped live counter file, or NULL if it cannot be mapped.
+ */
+static const TLiveCounterHeader *mapLiveCounter(const char *target) {
+  char path[PATH_MAX];
+  char *endPtr = NULL;
+  long pid = strtol(target, &endPtr, 10);
+
+  if ((*target != '\0') && (*endPtr == '\0') && (pid > 0)) {
+    snprintf(path, PATH_MAX, "/tmp/heapstats_%d/%ld", geteuid(), pid);
+  } else {
+    snprintf(path, PATH_MAX, "%s", target);
+  }
+
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    fprintf(stderr, "Could not open %s: %s\n", path, strerror(errno));
+    return NULL;
+  }
+
+  struct stat st;
+  if ((fstat(fd, &st) != 0) ||
+      ((size_t)st.st_size < sizeof(TLiveCounterHeader))) {
+    fprintf(stderr, "%s is not live counter file.\n", path);
+    close(fd);
+    return NULL;
+  }
+
+  void *addr =
+      mmap(NULL, sizeof(TLiveCounterHeader), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    fprintf(stderr, "Could not map %s: %s\n", path, strerror(errno));
+    return NULL;
+  }
+
+  const TLiveCounterHeader *header = (const TLiveCounterHeader *)addr;
+  if ((memcmp(header->magic, LIVE_COUNTER_MAGIC, sizeof(header->magic)) !=
+       0) ||
+      (header->version != LIVE_COUNTER_VERSION) ||
+      (header->byteOrderMark != LIVE_COUNTER_BYTE_ORDER_MARK)) {
+    fprintf(stderr, "%s is not supported live counter file.\n", path);
+    munmap(addr, sizeof(TLiveCounterHeader));
+    return NULL;
+  }
+
+  return header;
+}
+
+/*!
+ * \brief Copy consistent values from live counter file.<br>
+ *        Values are copied between two reads of the same even sequence.
+ * \param header [in]  Mapped live counter file.
+ * \param values [out] Copied values.
+ * \return true if consistent values are copied.
+ */
+static bool readLiveCounter(const TLiveCounterHeader *header,
+                            TLiveCounterHeader *values) {
+  for (int retry = 0; retry < LIVE_STAT_MAX_RETRY; retry++) {
+    jint sequence = header->sequence;
+    if ((sequence & 1) != 0) {
+      /* Writer is updating values. */
+      sched_yield();
+      continue;
+    }
+
+    __sync_synchronize();
+    memcpy(values, (const void *)header, sizeof(TLiveCounterHeader));
+    __sync_synchronize();
+
+    if (header->sequence == sequence) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/*!
+ * \brief Show values of live counter.
+ * \param values [in] Values which are copied from live counter file.
+ */
+static void showLiveCounter(const TLiveCounterHeader *values) {
+  static const char *causeNames[] = {"UNKNOWN", "GC", "DataDumpRequest",
+                                     "Interval"};
+  char timeStr[20] = "-";
+
+  if (values->snapShotTime > 0) {
+    time_t snapDate = values->snapShotTime / 1000;
+    struct tm timeStruct;
+    localtime_r(&snapDate, &timeStruct);
+    strftime(timeStr, sizeof(timeStr), "%F %T", &timeStruct);
+  }
+
+  const char *causeName =
+      ((values->cause >= 1) && (values->cause <= 3)) ? causeNames[values->cause]
+                                                    : causeNames[0];
+
+  printf("PID: %d  Snapshot: %s (%s%s%s)\n", values->pid, timeStr, causeName,
+         (values->gcCause[0] != '\0') ? ", " : "", values->gcCause);
+  printf("FGC: %lld  YGC: %lld  GC time: %lld ms  Safepoint time: %lld ms\n",
+         (long long)values->FGCCount, (long long)values->YGCCount,
+         (long long)values->gcWorktime, (long long)values->safepointTime);
+  printf("Heap: new %lld / old %lld / total %lld bytes  "
+         "Metaspace: %lld / %lld bytes\n",
+         (long long)values->newAreaSize, (long long)values->oldAreaSize,
+         (long long)values->totalHeapSize, (long long)values->metaspaceUsage,
+         (long long)values->metaspaceCapacity);
+  printf("Agent: %lld snapshots, %lld us total (%lld us CPU), "
+         "last %lld us\n",
+         (long long)values->snapShotCount, (long long)values->processTime,
+         (long long)values->processCpuTime,
+         (long long)values->lastProcessTime);
+
+  printf("Rank    usage(byte)    increment(byte)  Class name\n");
+  printf("----  ---------------  ---------------  ----------\n");
+  for (int idx = 0;
+       (idx < values->rankCount) && (idx < LIVE_COUNTER_MAX_RANKS); idx++) {
+    const TLiveCounterClass *entry = &values->ranking[idx];
+    printf("%4d  %15lld  %15lld  %.*s\n", idx + 1, (long long)entry->usage,
+           (long long)entry->delta, LIVE_COUNTER_CLASS_NAME_LEN,
+           entry->className);
+  }
+}
+
+/*!
+ * \brief Entry point of heapstats-livestat.
+ * \param argc [in] Number of arguments.
+ * \param argv [in] Arguments.
+ * \return Exit status.
+ */
+int main(int argc, char *argv[]) {
+  if ((argc < 2) || (argc > 4)) {
+    showUsage(argv[0]);
+    return 1;
+  }
+
+  long interval = (argc >= 3) ? atol(argv[2]) : 0;
+  long count = (argc >= 4) ? atol(argv[3]) : ((interval > 0) ? -1 : 1);
+  if ((interval < 0) || (count == 0)) {
+    showUsage(argv[0]);
+    return 1;
+  }
+
+  const TLiveCounterHeader *header = mapLiveCounter(argv[1]);
+  if (header == NULL) {
+    return 1;
+  }
+
+  TLiveCounterHeader values;
+  for (long loop = 0; (count < 0) || (loop < count); loop++) {
+    if (loop > 0) {
+      usleep(interval * 1000);
+      printf("\n");
+    }
+
+    if (!readLiveCounter(header, &values)) {
+      fprintf(stderr, "Could not read consistent values.\n");
+      continue;
+    }
+
+    showLiveCounter(&values);
+    fflush(stdout);
+  }
+
+  munmap((void *)header, sizeof(TLiveCounterHeader));
+  return 0;
+}
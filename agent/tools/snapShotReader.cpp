@@ -0,0 +1,547 @@
+/*!
+ * \file snapShotReader.cpp
+ * \brief This file is used to read snapshot file without JVM.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "snapShotReader.hpp"
+
+/*!
+ * \brief Shared state of decoding threads in TSnapShotReader::forEach().
+ */
+typedef struct {
+  TSnapShotReader *reader;  /*!< Reader of snapshot file.                */
+  size_t next;              /*!< Index of snapshot to decode next.       */
+  size_t end;               /*!< Index after the last snapshot.          */
+  size_t nextEmit;          /*!< Index of snapshot to pass handler next. */
+  TSnapShotHandler handler; /*!< Handler of decoded snapshot.            */
+  void *data;               /*!< User data for handler.                  */
+  bool isStopped;           /*!< Is reading stopped?                     */
+  int result;               /*!< Result of forEach().                    */
+  pthread_mutex_t mutex;    /*!< Mutex of this state.                    */
+  pthread_cond_t cond;      /*!< Condition to wait for the turn.         */
+} TSnapShotDecodeContext;
+
+/*!
+ * \brief Is host little endian?
+ * \return true if host is little endian.
+ */
+static inline bool isHostLittleEndian(void) {
+  const jint one = 1;
+  return *(const char *)&one == 1;
+}
+
+/*!
+ * \brief Read jlong from file.
+ * \param pos  [in] Position of value.
+ * \param swap [in] Should byte order be swapped?
+ * \return Value in host byte order.
+ */
+static inline jlong readLong(const unsigned char *pos, bool swap) {
+  jlong value;
+  memcpy(&value, pos, sizeof(jlong));
+  return swap ? (jlong)__builtin_bswap64((unsigned long long)value) : value;
+}
+
+/*!
+ * \brief Read jint from file.
+ * \param pos  [in] Position of value.
+ * \param swap [in] Should byte order be swapped?
+ * \return Value in host byte order.
+ */
+static inline jint readInt(const unsigned char *pos, bool swap) {
+  jint value;
+  memcpy(&value, pos, sizeof(jint));
+  return swap ? (jint)__builtin_bswap32((unsigned int)value) : value;
+}
+
+/*!
+ * \brief Does snapshot contain class loader information?
+ * \param magic [in] Magic number of snapshot.
+ * \return true if it is contained.
+ */
+static inline bool hasLoaderData(unsigned char magic) {
+  return magic != SNAPSHOT_FORMAT_1_0;
+}
+
+/*!
+ * \brief Does snapshot contain reference data?
+ * \param magic [in] Magic number of snapshot.
+ * \return true if it is contained.
+ */
+static inline bool hasReferenceData(unsigned char magic) {
+  return (magic == SNAPSHOT_FORMAT_1_1) ||
+         ((magic & EXTENDED_REFTREE_SNAPSHOT) == EXTENDED_REFTREE_SNAPSHOT);
+}
+
+/*!
+ * \brief TSnapShotReader constructor.<br>
+ *        Snapshot file is mapped and indexed.
+ * \param path [in] Path of snapshot file.
+ */
+TSnapShotReader::TSnapShotReader(const char *path) : indexes() {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw errno;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    int raisedErrNum = errno;
+    close(fd);
+    throw raisedErrNum;
+  }
+
+  base = NULL;
+  fileSize = st.st_size;
+  truncated = false;
+
+  if (fileSize > 0) {
+    void *addr = mmap(NULL, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+      int raisedErrNum = errno;
+      close(fd);
+      throw raisedErrNum;
+    }
+
+    base = (const unsigned char *)addr;
+  }
+
+  close(fd);
+
+  try {
+    buildIndex();
+  } catch (...) {
+    if (base != NULL) {
+      munmap((void *)base, fileSize);
+    }
+
+    throw ENOMEM;
+  }
+}
+
+/*!
+ * \brief TSnapShotReader destructor.
+ */
+TSnapShotReader::~TSnapShotReader(void) {
+  if (base != NULL) {
+    munmap((void *)base, fileSize);
+  }
+}
+
+/*!
+ * \brief Index snapshot boundaries in one pass.
+ */
+void TSnapShotReader::buildIndex(void) {
+  if (base == NULL) {
+    return;
+  }
+
+  /* Index pass reads whole file from head to tail only once. */
+  madvise((void *)base, fileSize, MADV_SEQUENTIAL);
+
+  size_t offset = 0;
+  while (offset < fileSize) {
+    TSnapShotIndex index;
+    if (!indexSnapShot(offset, &index)) {
+      /* The last snapshot might be written now. */
+      truncated = true;
+      break;
+    }
+
+    indexes.push_back(index);
+    offset += index.length;
+  }
+
+  /* Snapshots are decoded by several threads. */
+  madvise((void *)base, fileSize, MADV_NORMAL);
+}
+
+/*!
+ * \brief Parse header and skip all entries of snapshot.
+ * \param offset [in]  Offset of snapshot.
+ * \param index  [out] Location and header of snapshot.
+ * \return true if the snapshot is complete.
+ */
+bool TSnapShotReader::indexSnapShot(size_t offset, TSnapShotIndex *index) {
+  size_t pos = offset;
+  size_t remain = fileSize - offset;
+  TSnapShotFileHeader *hdr = &index->header;
+  memset(hdr, 0, sizeof(TSnapShotFileHeader));
+
+/* Check that "size" bytes can be read at "pos". */
+#define SNAPSHOT_READER_NEED(size)         \
+  if ((size) > remain) {                   \
+    return false;                          \
+  }                                        \
+  remain -= (size);
+
+  SNAPSHOT_READER_NEED(2);
+  unsigned char magic = base[pos];
+  char bom = base[pos + 1];
+  pos += 2;
+
+  if ((magic != SNAPSHOT_FORMAT_1_0) && (magic != SNAPSHOT_FORMAT_1_1) &&
+      ((magic & EXTENDED_SNAPSHOT) == 0)) {
+    return false;
+  } else if ((bom != 'L') && (bom != 'B')) {
+    return false;
+  }
+
+  bool swap = ((bom == 'L') != isHostLittleEndian());
+  hdr->magicNumber = magic;
+  hdr->byteOrderMark = bom;
+
+  SNAPSHOT_READER_NEED(sizeof(jlong) * 2 + sizeof(jint) + sizeof(jlong));
+  hdr->snapShotTime = readLong(base + pos, swap);
+  hdr->size = readLong(base + pos + 8, swap);
+  hdr->cause = readInt(base + pos + 16, swap);
+  hdr->gcCauseLen = readLong(base + pos + 20, swap);
+  pos += 28;
+
+  if ((hdr->size < 0) || (hdr->gcCauseLen < 0)) {
+    return false;
+  }
+
+  SNAPSHOT_READER_NEED((size_t)hdr->gcCauseLen);
+  size_t gcCauseLen = ((size_t)hdr->gcCauseLen < sizeof(hdr->gcCause))
+                          ? hdr->gcCauseLen
+                          : sizeof(hdr->gcCause) - 1;
+  memcpy(hdr->gcCause, base + pos, gcCauseLen);
+  hdr->gcCause[gcCauseLen] = '\0';
+  pos += hdr->gcCauseLen;
+
+  SNAPSHOT_READER_NEED(sizeof(jlong) * 6);
+  hdr->FGCCount = readLong(base + pos, swap);
+  hdr->YGCCount = readLong(base + pos + 8, swap);
+  hdr->gcWorktime = readLong(base + pos + 16, swap);
+  hdr->newAreaSize = readLong(base + pos + 24, swap);
+  hdr->oldAreaSize = readLong(base + pos + 32, swap);
+  hdr->totalHeapSize = readLong(base + pos + 40, swap);
+  pos += 48;
+
+  if (hasLoaderData(magic)) {
+    SNAPSHOT_READER_NEED(sizeof(jlong) * 2);
+    hdr->metaspaceUsage = readLong(base + pos, swap);
+    hdr->metaspaceCapacity = readLong(base + pos + 8, swap);
+    pos += 16;
+  }
+
+  if ((magic & EXTENDED_SAFEPOINT_TIME) == EXTENDED_SAFEPOINT_TIME) {
+    SNAPSHOT_READER_NEED(sizeof(jlong));
+    hdr->safepointTime = readLong(base + pos, swap);
+    pos += 8;
+  }
+
+  if ((magic & EXTENDED_SAMPLED_SNAPSHOT) == EXTENDED_SAMPLED_SNAPSHOT) {
+    SNAPSHOT_READER_NEED(sizeof(jlong) * 4);
+    hdr->sampleRate = readLong(base + pos, swap);
+    hdr->sampledObjects = readLong(base + pos + 8, swap);
+    hdr->countError = readLong(base + pos + 16, swap);
+    hdr->sizeError = readLong(base + pos + 24, swap);
+    pos += 32;
+  }
+
+  index->offset = offset;
+  index->entryOffset = pos;
+
+  /* Skip all class entries without decoding them. */
+  bool hasLoader = hasLoaderData(magic);
+  bool hasRefs = hasReferenceData(magic);
+  for (jlong Cnt = 0; Cnt < hdr->size; Cnt++) {
+    SNAPSHOT_READER_NEED(sizeof(jlong) * 2);
+    jlong nameLen = readLong(base + pos + 8, swap);
+    pos += 16;
+    if (nameLen < 0) {
+      return false;
+    }
+
+    SNAPSHOT_READER_NEED((size_t)nameLen);
+    pos += nameLen;
+
+    if (hasLoader) {
+      SNAPSHOT_READER_NEED(sizeof(jlong) * 2);
+      pos += 16;
+    }
+
+    SNAPSHOT_READER_NEED(sizeof(TObjectCounter));
+    pos += sizeof(TObjectCounter);
+
+    while (hasRefs) {
+      SNAPSHOT_READER_NEED(sizeof(jlong) + sizeof(TObjectCounter));
+      jlong childTag = readLong(base + pos, swap);
+      pos += sizeof(jlong) + sizeof(TObjectCounter);
+      if (childTag == SNAPSHOT_CHILD_END_MARKER) {
+        break;
+      }
+    }
+  }
+
+#undef SNAPSHOT_READER_NEED
+
+  index->length = pos - offset;
+  return true;
+}
+
+/*!
+ * \brief Decode snapshot.
+ * \param id       [in]  Index of snapshot.
+ * \param snapshot [out] Decoded snapshot.
+ */
+void TSnapShotReader::decode(size_t id, TSnapShot *snapshot) {
+  const TSnapShotIndex *index = &indexes[id];
+  unsigned char magic = index->header.magicNumber;
+  bool swap = ((index->header.byteOrderMark == 'L') != isHostLittleEndian());
+  bool hasLoader = hasLoaderData(magic);
+  bool hasRefs = hasReferenceData(magic);
+
+  snapshot->id = id;
+  snapshot->index = index;
+  snapshot->classes.clear();
+  snapshot->children.clear();
+  snapshot->classes.reserve(index->header.size);
+
+  /* All boundaries are already checked by indexSnapShot(). */
+  const unsigned char *pos = base + index->entryOffset;
+  for (jlong Cnt = 0; Cnt < index->header.size; Cnt++) {
+    TSnapShotClass entry;
+    entry.tag = readLong(pos, swap);
+    entry.nameLen = readLong(pos + 8, swap);
+    entry.name = (const char *)pos + 16;
+    pos += 16 + entry.nameLen;
+
+    if (hasLoader) {
+      entry.loaderId = readLong(pos, swap);
+      entry.loaderTag = readLong(pos + 8, swap);
+      pos += 16;
+    } else {
+      entry.loaderId = 0;
+      entry.loaderTag = 0;
+    }
+
+    entry.count = readLong(pos, swap);
+    entry.totalSize = readLong(pos + 8, swap);
+    pos += sizeof(TObjectCounter);
+
+    entry.firstChild = snapshot->children.size();
+    while (hasRefs) {
+      TSnapShotChild child;
+      child.tag = readLong(pos, swap);
+      child.count = readLong(pos + 8, swap);
+      child.totalSize = readLong(pos + 16, swap);
+      pos += sizeof(jlong) + sizeof(TObjectCounter);
+
+      if (child.tag == SNAPSHOT_CHILD_END_MARKER) {
+        break;
+      }
+
+      snapshot->children.push_back(child);
+    }
+
+    entry.numChildren = snapshot->children.size() - entry.firstChild;
+    snapshot->classes.push_back(entry);
+  }
+}
+
+/*!
+ * \brief Entry point of decoding thread.
+ * \param data [in] Shared state of forEach().
+ * \return Always NULL.
+ */
+void *TSnapShotReader::decodeEntryPoint(void *data) {
+  TSnapShotDecodeContext *ctx = (TSnapShotDecodeContext *)data;
+  TSnapShot snapshot;
+
+  while (true) {
+    size_t id;
+    bool isFinished;
+    pthread_mutex_lock(&ctx->mutex);
+    {
+      id = ctx->next;
+      isFinished = ctx->isStopped || (id >= ctx->end);
+      if (!isFinished) {
+        ctx->next++;
+      }
+    }
+    pthread_mutex_unlock(&ctx->mutex);
+
+    if (isFinished) {
+      break;
+    }
+
+    bool isDecoded = true;
+    try {
+      ctx->reader->decode(id, &snapshot);
+    } catch (...) {
+      isDecoded = false;
+    }
+
+    /* Wait for the turn to keep order of snapshots. */
+    pthread_mutex_lock(&ctx->mutex);
+    {
+      while (!ctx->isStopped && (ctx->nextEmit != id)) {
+        pthread_cond_wait(&ctx->cond, &ctx->mutex);
+      }
+
+      if (!isDecoded && !ctx->isStopped) {
+        ctx->isStopped = true;
+        ctx->result = ENOMEM;
+      }
+
+      isFinished = ctx->isStopped;
+    }
+    pthread_mutex_unlock(&ctx->mutex);
+
+    if (isFinished) {
+      break;
+    }
+
+    /* Only this thread can be here until nextEmit is incremented. */
+    bool isContinued = ctx->handler(&snapshot, ctx->data);
+
+    pthread_mutex_lock(&ctx->mutex);
+    {
+      ctx->nextEmit++;
+      if (!isContinued) {
+        ctx->isStopped = true;
+      }
+
+      pthread_cond_broadcast(&ctx->cond);
+    }
+    pthread_mutex_unlock(&ctx->mutex);
+  }
+
+  /* Waiting threads should check state again. */
+  pthread_mutex_lock(&ctx->mutex);
+  pthread_cond_broadcast(&ctx->cond);
+  pthread_mutex_unlock(&ctx->mutex);
+
+  return NULL;
+}
+
+/*!
+ * \brief Decode snapshots in parallel, and pass them to handler in order
+ *        of file.<br>
+ *        At most "numThreads" decoded snapshots are kept in memory.
+ * \param start      [in] Index of the first snapshot.
+ * \param end        [in] Index after the last snapshot.
+ * \param numThreads [in] Number of decoding threads.
+ * \param handler    [in] Handler of decoded snapshot. It is called
+ *                        from one thread at a time.
+ * \param data       [in] User data for handler.
+ * \return Value is zero, if process is succeed.<br />
+ *         Value is error number a.k.a. "errno", if process is failure.
+ */
+int TSnapShotReader::forEach(size_t start, size_t end, int numThreads,
+                             TSnapShotHandler handler, void *data) {
+  if (end > indexes.size()) {
+    end = indexes.size();
+  }
+
+  TSnapShotDecodeContext ctx;
+  ctx.reader = this;
+  ctx.next = start;
+  ctx.end = end;
+  ctx.nextEmit = start;
+  ctx.handler = handler;
+  ctx.data = data;
+  ctx.isStopped = false;
+  ctx.result = 0;
+  pthread_mutex_init(&ctx.mutex, NULL);
+  pthread_cond_init(&ctx.cond, NULL);
+
+  /* Calling thread also decodes snapshots. */
+  std::vector<pthread_t> threads;
+  for (int Cnt = 1; Cnt < numThreads; Cnt++) {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, &decodeEntryPoint, &ctx) != 0) {
+      /* Continue with threads which are already started. */
+      break;
+    }
+
+    threads.push_back(thread);
+  }
+
+  decodeEntryPoint(&ctx);
+  for (size_t Cnt = 0; Cnt < threads.size(); Cnt++) {
+    pthread_join(threads[Cnt], NULL);
+  }
+
+  pthread_cond_destroy(&ctx.cond);
+  pthread_mutex_destroy(&ctx.mutex);
+  return ctx.result;
+}
+
+/*!
+ * \brief Convert JNI style class name to Java style.<br>
+ *        e.g. "[Ljava/lang/String;" to "java.lang.String []".
+ * \param name    [in]  Class name in JNI style.
+ * \param nameLen [in]  Length of class name.
+ * \param buf     [out] Buffer of Java style name.
+ * \param bufLen  [in]  Size of buffer.
+ * \return Java style class name in "buf".
+ */
+const char *TSnapShotReader::toJavaStyle(const char *name, jlong nameLen,
+                                         char *buf, size_t bufLen) {
+  static const char *primitiveNames[] = {
+      "B", "byte",   "C", "char", "I", "int",  "S",  "short",  "J", "long",
+      "D", "double", "F", "float", "V", "void", "Z", "boolean", NULL};
+
+  jlong dims = 0;
+  while ((dims < nameLen) && (name[dims] == '[')) {
+    dims++;
+  }
+
+  const char *elem = name + dims;
+  jlong elemLen = nameLen - dims;
+  if ((elemLen >= 2) && (elem[0] == 'L') && (elem[elemLen - 1] == ';')) {
+    elem++;
+    elemLen -= 2;
+  } else if (elemLen == 1) {
+    for (int idx = 0; primitiveNames[idx] != NULL; idx += 2) {
+      if (elem[0] == primitiveNames[idx][0]) {
+        elem = primitiveNames[idx + 1];
+        elemLen = strlen(elem);
+        break;
+      }
+    }
+  }
+
+  size_t len = 0;
+  for (jlong idx = 0; (idx < elemLen) && (len + 1 < bufLen); idx++) {
+    buf[len++] = (elem[idx] == '/') ? '.' : elem[idx];
+  }
+
+  for (jlong idx = 0; (idx < dims) && (len + 4 < bufLen); idx++) {
+    memcpy(buf + len, " []", 3);
+    len += 3;
+  }
+
+  buf[len] = '\0';
+  return buf;
+}
@@ -0,0 +1,200 @@
+/*!
+ * \file snapShotReader.hpp
+ * \brief This file is used to read snapshot file without JVM.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#ifndef SNAPSHOT_READER_HPP
+#define SNAPSHOT_READER_HPP
+
+#include <stddef.h>
+
+#include <vector>
+
+#include "snapShotFormat.hpp"
+
+/*!
+ * \brief Location of a snapshot in snapshot file.
+ */
+typedef struct {
+  size_t offset;              /*!< Offset of snapshot in file.             */
+  size_t length;              /*!< Length of snapshot including header.    */
+  size_t entryOffset;         /*!< Offset of the first class entry.        */
+  TSnapShotFileHeader header; /*!< Header in host byte order.
+                                   gcCause is terminated by NULL.          */
+} TSnapShotIndex;
+
+/*!
+ * \brief Class entry of decoded snapshot.<br>
+ *        Class name refers mapped file, so it is not terminated by NULL.
+ */
+typedef struct {
+  jlong tag;          /*!< Class tag.                                     */
+  const char *name;   /*!< Class name in JNI style.                       */
+  jlong nameLen;      /*!< Length of class name.                          */
+  jlong loaderId;     /*!< Class loader instance id.                      */
+  jlong loaderTag;    /*!< Class loader class tag.                        */
+  jlong count;        /*!< Number of instances.                           */
+  jlong totalSize;    /*!< Total size of instances.                       */
+  size_t firstChild;  /*!< Index of the first reference in "children".    */
+  size_t numChildren; /*!< Number of references from this class.          */
+} TSnapShotClass;
+
+/*!
+ * \brief Reference from instances of a class to instances of child class.
+ */
+typedef struct {
+  jlong tag;       /*!< Tag of child class.                                */
+  jlong count;     /*!< Number of child instances.                         */
+  jlong totalSize; /*!< Total size of child instances.                     */
+} TSnapShotChild;
+
+/*!
+ * \brief Decoded snapshot.
+ */
+typedef struct {
+  size_t id;                           /*!< Index of snapshot in file.   */
+  const TSnapShotIndex *index;         /*!< Location and header.         */
+  std::vector<TSnapShotClass> classes; /*!< Class entries.               */
+  std::vector<TSnapShotChild> children; /*!< References of all classes.  */
+} TSnapShot;
+
+/*!
+ * \brief Handler of decoded snapshot.
+ * \param snapshot [in] Decoded snapshot.
+ * \param data     [in] User data.
+ * \return false to stop reading.
+ */
+typedef bool (*TSnapShotHandler)(const TSnapShot *snapshot, void *data);
+
+/*!
+ * \brief This class reads snapshot file through mmap(2).<br>
+ *        Boundaries of all snapshots are indexed at first, then each
+ *        snapshot can be decoded independently in several threads.
+ */
+class TSnapShotReader {
+ public:
+  /*!
+   * \brief TSnapShotReader constructor.<br>
+   *        Snapshot file is mapped and indexed.
+   * \param path [in] Path of snapshot file.
+   */
+  TSnapShotReader(const char *path);
+
+  /*!
+   * \brief TSnapShotReader destructor.
+   */
+  virtual ~TSnapShotReader(void);
+
+  /*!
+   * \brief Get number of complete snapshots in file.
+   * \return Number of snapshots.
+   */
+  inline size_t getCount(void) { return indexes.size(); };
+
+  /*!
+   * \brief Get location and header of snapshot.
+   * \param id [in] Index of snapshot.
+   * \return Location and header of snapshot.
+   */
+  inline const TSnapShotIndex *getIndex(size_t id) { return &indexes[id]; };
+
+  /*!
+   * \brief Is the last part of file broken or truncated?
+   * \return true if the file has data after the last complete snapshot.
+   */
+  inline bool isTruncated(void) { return truncated; };
+
+  /*!
+   * \brief Decode snapshot.
+   * \param id       [in]  Index of snapshot.
+   * \param snapshot [out] Decoded snapshot.
+   */
+  void decode(size_t id, TSnapShot *snapshot);
+
+  /*!
+   * \brief Decode snapshots in parallel, and pass them to handler in order
+   *        of file.<br>
+   *        At most "numThreads" decoded snapshots are kept in memory.
+   * \param start      [in] Index of the first snapshot.
+   * \param end        [in] Index after the last snapshot.
+   * \param numThreads [in] Number of decoding threads.
+   * \param handler    [in] Handler of decoded snapshot. It is called
+   *                        from one thread at a time.
+   * \param data       [in] User data for handler.
+   * \return Value is zero, if process is succeed.<br />
+   *         Value is error number a.k.a. "errno", if process is failure.
+   */
+  int forEach(size_t start, size_t end, int numThreads,
+              TSnapShotHandler handler, void *data);
+
+  /*!
+   * \brief Convert JNI style class name to Java style.<br>
+   *        e.g. "[Ljava/lang/String;" to "java.lang.String []".
+   * \param name    [in]  Class name in JNI style.
+   * \param nameLen [in]  Length of class name.
+   * \param buf     [out] Buffer of Java style name.
+   * \param bufLen  [in]  Size of buffer.
+   * \return Java style class name in "buf".
+   */
+  static const char *toJavaStyle(const char *name, jlong nameLen, char *buf,
+                                 size_t bufLen);
+
+ private:
+  /*!
+   * \brief Head of mapped file.
+   */
+  const unsigned char *base;
+
+  /*!
+   * \brief Size of mapped file.
+   */
+  size_t fileSize;
+
+  /*!
+   * \brief Locations of all snapshots.
+   */
+  std::vector<TSnapShotIndex> indexes;
+
+  /*!
+   * \brief Is the last part of file broken or truncated?
+   */
+  bool truncated;
+
+  /*!
+   * \brief Index snapshot boundaries in one pass.
+   */
+  void buildIndex(void);
+
+  /*!
+   * \brief Parse header and skip all entries of snapshot.
+   * \param offset [in]  Offset of snapshot.
+   * \param index  [out] Location and header of snapshot.
+   * \return true if the snapshot is complete.
+   */
+  bool indexSnapShot(size_t offset, TSnapShotIndex *index);
+
+  /*!
+   * \brief Entry point of decoding thread.
+   * \param data [in] Shared state of forEach().
+   * \return Always NULL.
+   */
+  static void *decodeEntryPoint(void *data);
+};
+
+#endif  // SNAPSHOT_READER_HPP
@@ -0,0 +1,626 @@
+/*!
+ * \file snapShotTool.cpp
+ * \brief This file is used to show snapshot file without JVM.
+ * Copyright (C) 2017 Yasumasa Suenaga
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <tr1/unordered_map>
+
+#include "leakAnalyzer.hpp"
+#include "snapShotReader.hpp"
+
+/*!
+ * \brief Max length of class name which is converted to Java style.
+ */
+#define SNAPSHOT_TOOL_NAME_LEN 1024
+
+/*!
+ * \brief Commands of heapstats-snapshot.
+ */
+typedef enum {
+  CommandHeader, /*!< Show header of each snapshot.                 */
+  CommandTop,    /*!< Show top-N classes by heap usage.             */
+  CommandCSV,    /*!< Show all class entries as CSV.                */
+  CommandRefs,   /*!< Show reference edges as CSV.                  */
+  CommandBench,  /*!< Measure time to index and decode snapshots.   */
+  CommandLeak    /*!< Rank leak suspects in time window.            */
+} TSnapShotCommand;
+
+/*!
+ * \brief Options of heapstats-snapshot.
+ */
+typedef struct {
+  TSnapShotCommand command; /*!< Command to run.                         */
+  int topN;                 /*!< Number of classes in top command.        */
+  bool jniStyle;            /*!< Show class names in JNI style.           */
+  jlong classCount;         /*!< Number of decoded classes (bench).       */
+  jlong childCount;         /*!< Number of decoded references (bench).    */
+  TLeakAnalyzer *analyzer;  /*!< Statistics of snapshots (leak).          */
+} TSnapShotToolOption;
+
+/*!
+ * \brief Map from class tag to class entry in snapshot.
+ */
+typedef std::tr1::unordered_map<jlong, const TSnapShotClass *> TClassTagMap;
+
+/*!
+ * \brief Show usage of this command.
+ * \param progName [in] Name of this command.
+ */
+static void showUsage(const char *progName) {
+  fprintf(stderr,
+          "Usage: %s <header | top | csv | refs | bench | leak> [options] <file>\n"
+          "  -f <index>  Index of the first snapshot (default: 0)\n"
+          "  -l <index>  Index of the last snapshot (default: last)\n"
+          "  -n <num>    Number of classes in top command (default: 20)\n"
+          "  -j <num>    Number of decoding threads (default: CPUs)\n"
+          "  -J          Show class names in JNI style\n"
+          "  -S <time>   Start of time window (\"YYYY-MM-DD hh:mm:ss\")\n"
+          "  -E <time>   End of time window (\"YYYY-MM-DD hh:mm:ss\")\n"
+          "  -A          Sample all snapshots in leak command, not only\n"
+          "              snapshots after full GC\n"
+          "  -m <num>    Minimum samples of leak suspect (default: 3)\n",
+          progName);
+}
+
+/*!
+ * \brief Get current time of monotonic clock.
+ * \return Current time (in sec).
+ */
+static double getMonotonicTime(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+/*!
+ * \brief Format time of snapshot.
+ * \param snapShotTime [in]  Time of snapshot (in msec).
+ * \param buf          [out] Buffer of formatted time.
+ * \param bufLen       [in]  Size of buffer.
+ * \return Formatted time in "buf".
+ */
+static const char *formatTime(jlong snapShotTime, char *buf, size_t bufLen) {
+  time_t snapDate = snapShotTime / 1000;
+  struct tm timeStruct;
+  localtime_r(&snapDate, &timeStruct);
+  strftime(buf, bufLen, "%F %T", &timeStruct);
+  return buf;
+}
+
+/*!
+ * \brief Parse time of time window.
+ * \param str  [in]  Time string as "YYYY-MM-DD hh:mm:ss" in local time.
+ * \param time [out] Parsed time (in msec).
+ * \return true if the string is valid.
+ */
+static bool parseTime(const char *str, jlong *time) {
+  struct tm timeStruct;
+  memset(&timeStruct, 0, sizeof(struct tm));
+  const char *end = strptime(str, "%Y-%m-%d %H:%M:%S", &timeStruct);
+  if ((end == NULL) || (*end != '\0')) {
+    return false;
+  }
+
+  timeStruct.tm_isdst = -1;
+  *time = (jlong)mktime(&timeStruct) * 1000;
+  return true;
+}
+
+/*!
+ * \brief Get class name to show.
+ * \param option [in]  Options of this command.
+ * \param entry  [in]  Class entry.
+ * \param buf    [out] Buffer of class name.
+ * \param bufLen [in]  Size of buffer.
+ * \return Class name in "buf".
+ */
+static const char *getClassName(const TSnapShotToolOption *option,
+                                const TSnapShotClass *entry, char *buf,
+                                size_t bufLen) {
+  if (option->jniStyle) {
+    size_t len = ((size_t)entry->nameLen < bufLen) ? entry->nameLen
+                                                   : bufLen - 1;
+    memcpy(buf, entry->name, len);
+    buf[len] = '\0';
+    return buf;
+  }
+
+  return TSnapShotReader::toJavaStyle(entry->name, entry->nameLen, buf,
+                                      bufLen);
+}
+
+/*!
+ * \brief Get class loader name in the same style as HeapStats Analyzer.
+ * \param option  [in]  Options of this command.
+ * \param entry   [in]  Class entry.
+ * \param classes [in]  Map of classes in the same snapshot.
+ * \param buf     [out] Buffer of class loader name.
+ * \param bufLen  [in]  Size of buffer.
+ * \return Class loader name in "buf".
+ */
+static const char *getLoaderName(const TSnapShotToolOption *option,
+                                 const TSnapShotClass *entry,
+                                 const TClassTagMap &classes, char *buf,
+                                 size_t bufLen) {
+  if (entry->loaderTag < 0) {
+    snprintf(buf, bufLen, "-");
+  } else if (entry->loaderTag == 0) {
+    snprintf(buf, bufLen, "<SystemClassLoader>");
+  } else {
+    char loaderName[SNAPSHOT_TOOL_NAME_LEN] = "<Unknown>";
+    TClassTagMap::const_iterator loader = classes.find(entry->loaderTag);
+    if (loader != classes.end()) {
+      getClassName(option, loader->second, loaderName, sizeof(loaderName));
+    }
+
+    snprintf(buf, bufLen, "%s (0x%llx)", loaderName,
+             (unsigned long long)entry->loaderId);
+  }
+
+  return buf;
+}
+
+/*!
+ * \brief Print string as CSV field.
+ * \param str [in] String to print.
+ */
+static void printCSVField(const char *str) {
+  putchar('"');
+  for (; *str != '\0'; str++) {
+    if (*str == '"') {
+      putchar('"');
+    }
+
+    putchar(*str);
+  }
+
+  putchar('"');
+}
+
+/*!
+ * \brief Build map from class tag to class entry.
+ * \param snapshot [in]  Decoded snapshot.
+ * \param classes  [out] Map of classes.
+ */
+static void buildClassTagMap(const TSnapShot *snapshot,
+                             TClassTagMap *classes) {
+  classes->rehash(snapshot->classes.size());
+  for (size_t idx = 0; idx < snapshot->classes.size(); idx++) {
+    (*classes)[snapshot->classes[idx].tag] = &snapshot->classes[idx];
+  }
+}
+
+/*!
+ * \brief Show header of snapshot.
+ * \param snapshot [in] Decoded snapshot.
+ */
+static void showHeader(const TSnapShot *snapshot) {
+  static const char *causeNames[] = {"UNKNOWN", "GC", "DataDumpRequest",
+                                     "Interval"};
+  const TSnapShotFileHeader *hdr = &snapshot->index->header;
+  char timeStr[20];
+  const char *causeName = ((hdr->cause >= 1) && (hdr->cause <= 3))
+                              ? causeNames[hdr->cause]
+                              : causeNames[0];
+
+  printf("#%zu  %s (%s%s%s)  offset: %zu  length: %zu\n", snapshot->id,
+         formatTime(hdr->snapShotTime, timeStr, sizeof(timeStr)), causeName,
+         (hdr->gcCause[0] != '\0') ? ", " : "", hdr->gcCause,
+         snapshot->index->offset, snapshot->index->length);
+  printf("  Format: 0x%02x  Classes: %lld  References: %zu\n",
+         (unsigned char)hdr->magicNumber, (long long)hdr->size,
+         snapshot->children.size());
+  printf("  FGC: %lld  YGC: %lld  GC time: %lld ms  Safepoint time: %lld ms\n",
+         (long long)hdr->FGCCount, (long long)hdr->YGCCount,
+         (long long)hdr->gcWorktime, (long long)hdr->safepointTime);
+  printf("  Heap: new %lld / old %lld / total %lld bytes  "
+         "Metaspace: %lld / %lld bytes\n",
+         (long long)hdr->newAreaSize, (long long)hdr->oldAreaSize,
+         (long long)hdr->totalHeapSize, (long long)hdr->metaspaceUsage,
+         (long long)hdr->metaspaceCapacity);
+
+  if (hdr->sampleRate > 0) {
+    printf("  Sampled: %lld%% of objects (%lld)  Estimation error (95%%): "
+           "+/-%lld objects / +/-%lld bytes\n",
+           (long long)hdr->sampleRate, (long long)hdr->sampledObjects,
+           (long long)hdr->countError, (long long)hdr->sizeError);
+  }
+}
+
+/*!
+ * \brief Compare class entries by heap usage in descending order.
+ * \param a [in] Class entry.
+ * \param b [in] Class entry.
+ * \return true if "a" uses more heap than "b".
+ */
+static bool compareByTotalSize(const TSnapShotClass *a,
+                               const TSnapShotClass *b) {
+  return a->totalSize > b->totalSize;
+}
+
+/*!
+ * \brief Show top-N classes by heap usage.
+ * \param snapshot [in] Decoded snapshot.
+ * \param option   [in] Options of this command.
+ */
+static void showTop(const TSnapShot *snapshot,
+                    const TSnapShotToolOption *option) {
+  std::vector<const TSnapShotClass *> ranking;
+  ranking.reserve(snapshot->classes.size());
+  for (size_t idx = 0; idx < snapshot->classes.size(); idx++) {
+    ranking.push_back(&snapshot->classes[idx]);
+  }
+
+  size_t rankCount = std::min((size_t)option->topN, ranking.size());
+  std::partial_sort(ranking.begin(), ranking.begin() + rankCount,
+                    ranking.end(), compareByTotalSize);
+
+  TClassTagMap classes;
+  buildClassTagMap(snapshot, &classes);
+
+  char timeStr[20];
+  printf("#%zu  %s\n", snapshot->id,
+         formatTime(snapshot->index->header.snapShotTime, timeStr,
+                    sizeof(timeStr)));
+  printf("Rank    usage(byte)      instances  Class name (Class loader)\n");
+  printf("----  ---------------  -------------  -------------------------\n");
+
+  char className[SNAPSHOT_TOOL_NAME_LEN];
+  char loaderName[SNAPSHOT_TOOL_NAME_LEN];
+  for (size_t idx = 0; idx < rankCount; idx++) {
+    const TSnapShotClass *entry = ranking[idx];
+    printf("%4zu  %15lld  %13lld  %s (%s)\n", idx + 1,
+           (long long)entry->totalSize, (long long)entry->count,
+           getClassName(option, entry, className, sizeof(className)),
+           getLoaderName(option, entry, classes, loaderName,
+                         sizeof(loaderName)));
+  }
+
+  printf("\n");
+}
+
+/*!
+ * \brief Show all class entries as CSV.
+ * \param snapshot [in] Decoded snapshot.
+ * \param option   [in] Options of this command.
+ */
+static void showCSV(const TSnapShot *snapshot,
+                    const TSnapShotToolOption *option) {
+  TClassTagMap classes;
+  buildClassTagMap(snapshot, &classes);
+
+  char timeStr[20];
+  char className[SNAPSHOT_TOOL_NAME_LEN];
+  char loaderName[SNAPSHOT_TOOL_NAME_LEN];
+  formatTime(snapshot->index->header.snapShotTime, timeStr, sizeof(timeStr));
+
+  for (size_t idx = 0; idx < snapshot->classes.size(); idx++) {
+    const TSnapShotClass *entry = &snapshot->classes[idx];
+    printf("%s,0x%llx,", timeStr, (unsigned long long)entry->tag);
+    printCSVField(getClassName(option, entry, className, sizeof(className)));
+    putchar(',');
+    printCSVField(
+        getLoaderName(option, entry, classes, loaderName, sizeof(loaderName)));
+    printf(",%lld,%lld\n", (long long)entry->count,
+           (long long)entry->totalSize);
+  }
+}
+
+/*!
+ * \brief Show reference edges as CSV.
+ * \param snapshot [in] Decoded snapshot.
+ * \param option   [in] Options of this command.
+ */
+static void showRefs(const TSnapShot *snapshot,
+                     const TSnapShotToolOption *option) {
+  TClassTagMap classes;
+  buildClassTagMap(snapshot, &classes);
+
+  char timeStr[20];
+  char parentName[SNAPSHOT_TOOL_NAME_LEN];
+  char childName[SNAPSHOT_TOOL_NAME_LEN];
+  formatTime(snapshot->index->header.snapShotTime, timeStr, sizeof(timeStr));
+
+  for (size_t idx = 0; idx < snapshot->classes.size(); idx++) {
+    const TSnapShotClass *entry = &snapshot->classes[idx];
+    if (entry->numChildren == 0) {
+      continue;
+    }
+
+    getClassName(option, entry, parentName, sizeof(parentName));
+    for (size_t childIdx = entry->firstChild;
+         childIdx < entry->firstChild + entry->numChildren; childIdx++) {
+      const TSnapShotChild *child = &snapshot->children[childIdx];
+      TClassTagMap::const_iterator childClass = classes.find(child->tag);
+      if (childClass != classes.end()) {
+        getClassName(option, childClass->second, childName,
+                     sizeof(childName));
+      } else {
+        snprintf(childName, sizeof(childName), "<Unknown>");
+      }
+
+      printf("%s,0x%llx,", timeStr, (unsigned long long)entry->tag);
+      printCSVField(parentName);
+      printf(",0x%llx,", (unsigned long long)child->tag);
+      printCSVField(childName);
+      printf(",%lld,%lld\n", (long long)child->count,
+             (long long)child->totalSize);
+    }
+  }
+}
+
+/*!
+ * \brief Show ranking of leak suspects.
+ * \param option     [in] Options of this command.
+ * \param minSamples [in] Minimum number of samples of suspect.
+ */
+static void showLeakSuspects(const TSnapShotToolOption *option,
+                             jlong minSamples) {
+  TLeakAnalyzer *analyzer = option->analyzer;
+  std::vector<TLeakSuspect> suspects;
+  analyzer->getSuspects(minSamples, option->topN, &suspects);
+
+  if (analyzer->getSampleCount() == 0) {
+    printf("No snapshot is sampled. "
+           "Use -A if full GC did not occur in the time window.\n");
+    return;
+  }
+
+  char firstTime[20];
+  char lastTime[20];
+  printf("Samples: %zu  (%s - %s)\n", analyzer->getSampleCount(),
+         formatTime(analyzer->getFirstTime(), firstTime, sizeof(firstTime)),
+         formatTime(analyzer->getLastTime(), lastTime, sizeof(lastTime)));
+  printf("Rank  growth(byte/h)  monotonic  divergence  samples      "
+         "first(byte)       last(byte)  Class name\n");
+  printf("----  --------------  ---------  ----------  -------  "
+         "---------------  ---------------  -------------------------\n");
+
+  char className[SNAPSHOT_TOOL_NAME_LEN];
+  for (size_t idx = 0; idx < suspects.size(); idx++) {
+    const TLeakSuspect *suspect = &suspects[idx];
+    const TLeakStats *stats = suspect->stats;
+
+    if (option->jniStyle) {
+      size_t len = ((size_t)stats->nameLen < sizeof(className))
+                       ? stats->nameLen
+                       : sizeof(className) - 1;
+      memcpy(className, stats->name, len);
+      className[len] = '\0';
+    } else {
+      TSnapShotReader::toJavaStyle(stats->name, stats->nameLen, className,
+                                   sizeof(className));
+    }
+
+    printf("%4zu  %14.0f  %8.1f%%  %10.2f  %7lld  %15lld  %15lld  %s\n",
+           idx + 1, suspect->slope, suspect->monotonic * 100.0,
+           suspect->divergence, (long long)stats->samples,
+           (long long)stats->firstSize, (long long)stats->lastSize,
+           className);
+  }
+}
+
+/*!
+ * \brief Handler of decoded snapshot.
+ * \param snapshot [in] Decoded snapshot.
+ * \param data     [in] Options of this command.
+ * \return false to stop reading.
+ */
+static bool processSnapShot(const TSnapShot *snapshot, void *data) {
+  TSnapShotToolOption *option = (TSnapShotToolOption *)data;
+
+  switch (option->command) {
+    case CommandHeader:
+      showHeader(snapshot);
+      break;
+    case CommandTop:
+      showTop(snapshot, option);
+      break;
+    case CommandCSV:
+      showCSV(snapshot, option);
+      break;
+    case CommandRefs:
+      showRefs(snapshot, option);
+      break;
+    case CommandBench:
+      option->classCount += snapshot->classes.size();
+      option->childCount += snapshot->children.size();
+      break;
+    case CommandLeak:
+      option->analyzer->addSnapShot(snapshot);
+      break;
+  }
+
+  return !ferror(stdout);
+}
+
+/*!
+ * \brief Entry point of heapstats-snapshot.
+ * \param argc [in] Number of arguments.
+ * \param argv [in] Arguments.
+ * \return Exit status.
+ */
+int main(int argc, char *argv[]) {
+  static const char *commandNames[] = {"header", "top", "csv", "refs",
+                                       "bench", "leak"};
+  if (argc < 3) {
+    showUsage(argv[0]);
+    return 1;
+  }
+
+  TSnapShotToolOption option;
+  memset(&option, 0, sizeof(TSnapShotToolOption));
+  option.topN = 20;
+
+  int commandIdx = 0;
+  while ((commandIdx < 6) && (strcmp(argv[1], commandNames[commandIdx]) != 0)) {
+    commandIdx++;
+  }
+
+  if (commandIdx == 6) {
+    showUsage(argv[0]);
+    return 1;
+  }
+
+  option.command = (TSnapShotCommand)commandIdx;
+
+  long first = 0;
+  long last = -1;
+  long numThreads = sysconf(_SC_NPROCESSORS_ONLN);
+  jlong windowStart = -1;
+  jlong windowEnd = -1;
+  bool sampleAll = false;
+  jlong minSamples = 3;
+  int opt;
+  optind = 2;
+  while ((opt = getopt(argc, argv, "f:l:n:j:JS:E:Am:")) != -1) {
+    switch (opt) {
+      case 'f':
+        first = atol(optarg);
+        break;
+      case 'l':
+        last = atol(optarg);
+        break;
+      case 'n':
+        option.topN = atoi(optarg);
+        break;
+      case 'j':
+        numThreads = atol(optarg);
+        break;
+      case 'J':
+        option.jniStyle = true;
+        break;
+      case 'S':
+        if (!parseTime(optarg, &windowStart)) {
+          showUsage(argv[0]);
+          return 1;
+        }
+        break;
+      case 'E':
+        if (!parseTime(optarg, &windowEnd)) {
+          showUsage(argv[0]);
+          return 1;
+        }
+        break;
+      case 'A':
+        sampleAll = true;
+        break;
+      case 'm':
+        minSamples = atol(optarg);
+        break;
+      default:
+        showUsage(argv[0]);
+        return 1;
+    }
+  }
+
+  if ((optind != argc - 1) || (first < 0) || (option.topN <= 0)) {
+    showUsage(argv[0]);
+    return 1;
+  }
+
+  if (numThreads < 1) {
+    numThreads = 1;
+  }
+
+  double startTime = getMonotonicTime();
+  TSnapShotReader *reader;
+  try {
+    reader = new TSnapShotReader(argv[optind]);
+  } catch (int errNum) {
+    fprintf(stderr, "Could not read %s: %s\n", argv[optind],
+            strerror(errNum));
+    return 1;
+  }
+
+  double indexTime = getMonotonicTime() - startTime;
+  if (reader->isTruncated()) {
+    fprintf(stderr, "%s has broken or incomplete snapshot after #%zu.\n",
+            argv[optind], reader->getCount());
+  }
+
+  size_t end = ((last < 0) || ((size_t)last >= reader->getCount()))
+                   ? reader->getCount()
+                   : (size_t)last + 1;
+
+  /* Snapshots are written in order of time, so skip them without decode. */
+  while (((size_t)first < end) && (windowStart >= 0) &&
+         (reader->getIndex(first)->header.snapShotTime < windowStart)) {
+    first++;
+  }
+
+  while (((size_t)first < end) && (windowEnd >= 0) &&
+         (reader->getIndex(end - 1)->header.snapShotTime > windowEnd)) {
+    end--;
+  }
+
+  if (option.command == CommandLeak) {
+    option.analyzer = new TLeakAnalyzer(sampleAll);
+    if ((first > 0) && ((size_t)first <= reader->getCount())) {
+      option.analyzer->setBaseline(&reader->getIndex(first - 1)->header);
+    }
+  }
+
+  if (option.command == CommandCSV) {
+    printf("snapshot_time,tag,class,class_loader,instances,total_size\n");
+  } else if (option.command == CommandRefs) {
+    printf("snapshot_time,parent_tag,parent,child_tag,child,instances,"
+           "total_size\n");
+  }
+
+  startTime = getMonotonicTime();
+  int result = reader->forEach(first, end, numThreads, &processSnapShot,
+                               &option);
+  double decodeTime = getMonotonicTime() - startTime;
+
+  if (result != 0) {
+    fprintf(stderr, "Could not decode snapshot: %s\n", strerror(result));
+  } else if (option.command == CommandBench) {
+    size_t bytes = 0;
+    for (size_t idx = first; idx < end; idx++) {
+      bytes += reader->getIndex(idx)->length;
+    }
+
+    double mbytes = bytes / 1048576.0;
+    double totalTime = indexTime + decodeTime;
+    printf("Snapshots: %zu  Classes: %lld  References: %lld  "
+           "Threads: %ld\n",
+           (end > (size_t)first) ? end - first : 0,
+           (long long)option.classCount, (long long)option.childCount,
+           numThreads);
+    printf("Index:  %.3f sec\n", indexTime);
+    printf("Decode: %.3f sec\n", decodeTime);
+    printf("Total:  %.3f sec (%.1f MB/s)\n", totalTime,
+           (totalTime > 0) ? mbytes / totalTime : 0.0);
+  } else if (option.command == CommandLeak) {
+    showLeakSuspects(&option, minSamples);
+  }
+
+  delete option.analyzer;
+  delete reader;
+  return ((result == 0) && (fflush(stdout) == 0)) ? 0 : 1;
+}
@@ -90,10 +90,33 @@ public class LogData implements Comparable<LogData>{
             throw new IllegalArgumentException("CSV data is not valid: " + csv);
         }
         
-        Instant instant = Instant.ofEpochMilli(Long.parseLong(csvArray[0]));
+        long[] columns = new long[19];
+        for(int idx = 0; idx < columns.length; idx++){
+            /* Java process and machine CPU times are unsigned. */
+            columns[idx] = ((idx >= 2) && (idx <= 14)) ? Long.parseUnsignedLong(csvArray[idx])
+                                                       : Long.parseLong(csvArray[idx]);
+        }
+
+        parseFromColumns(columns);
+        archivePath = (csvArray.length == 20) ? Paths.get(logdir, csvArray[19]).toString() : null;
+    }
+
+    /**
+     * This method creates LogData from columns of binary log.
+     * Order of columns is same as CSV except archive file.
+     * 
+     * @param columns Column values to be set.
+     * @throws IllegalArgumentException 
+     */
+    public void parseFromColumns(long[] columns) throws IllegalArgumentException{
+        if(columns.length < 19){
+            throw new IllegalArgumentException("Binary log data is not valid: " + columns.length + " columns");
+        }
+        
+        Instant instant = Instant.ofEpochMilli(columns[0]);
         dateTime = LocalDateTime.ofInstant(instant, ZoneId.systemDefault());
         
-        switch(Integer.parseInt(csvArray[1])){
+        switch((int)columns[1]){
             
             case 1:
                 logCause = LogCause.EXHAUSTED;
@@ -116,26 +139,26 @@ public class LogData implements Comparable<LogData>{
                 break;
         }
         
-        javaUserTime = Long.parseUnsignedLong(csvArray[2]);
-        javaSysTime  = Long.parseUnsignedLong(csvArray[3]);
-        javaVSSize = Long.parseUnsignedLong(csvArray[4]);
-        javaRSSize = Long.parseUnsignedLong(csvArray[5]);
+        javaUserTime = columns[2];
+        javaSysTime  = columns[3];
+        javaVSSize = columns[4];
+        javaRSSize = columns[5];
         
-        systemUserTime     = Long.parseUnsignedLong(csvArray[6]);
-        systemNiceTime     = Long.parseUnsignedLong(csvArray[7]);
-        systemSysTime      = Long.parseUnsignedLong(csvArray[8]);
-        systemIdleTime     = Long.parseUnsignedLong(csvArray[9]);
-        systemIOWaitTime   = Long.parseUnsignedLong(csvArray[10]);
-        systemIRQTime      = Long.parseUnsignedLong(csvArray[11]);
-        systemSoftIRQTime  = Long.parseUnsignedLong(csvArray[12]);
-        systemStealTime    = Long.parseUnsignedLong(csvArray[13]);
-        systemGuestTime    = Long.parseUnsignedLong(csvArray[14]);
+        systemUserTime     = columns[6];
+        systemNiceTime     = columns[7];
+        systemSysTime      = columns[8];
+        systemIdleTime     = columns[9];
+        systemIOWaitTime   = columns[10];
+        systemIRQTime      = columns[11];
+        systemSoftIRQTime  = columns[12];
+        systemStealTime    = columns[13];
+        systemGuestTime    = columns[14];
         
-        jvmSyncPark = Long.parseLong(csvArray[15]);
-        jvmSafepointTime = Long.parseLong(csvArray[16]);
-        jvmSafepoints = Long.parseLong(csvArray[17]);
-        jvmLiveThreads = Long.parseLong(csvArray[18]);
-        archivePath = (csvArray.length == 20) ? Paths.get(logdir, csvArray[19]).toString() : null;
+        jvmSyncPark = columns[15];
+        jvmSafepointTime = columns[16];
+        jvmSafepoints = columns[17];
+        jvmLiveThreads = columns[18];
+        archivePath = null;
     }
 
     /**
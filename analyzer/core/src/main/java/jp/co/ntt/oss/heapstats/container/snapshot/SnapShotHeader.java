@@ -69,6 +69,11 @@ public class SnapShotHeader implements Comparable<SnapShotHeader>, Serializable
      */
     public static final byte EXTENDED_FORMAT_FLAG_SAFEPOINT_TIME = 0b00000010;
 
+    /**
+     * Flag for sampled heap census of extended SnapShot format.
+     */
+    public static final byte EXTENDED_FORMAT_FLAG_SAMPLED = 0b00000100;
+
     /**
      * serialVersionUID.
      */
@@ -164,6 +169,26 @@ public class SnapShotHeader implements Comparable<SnapShotHeader>, Serializable
      */
     private long safepointTime;
 
+    /**
+     * Percentage of sampled objects.
+     */
+    private long sampleRate;
+
+    /**
+     * Number of sampled objects.
+     */
+    private long sampledObjects;
+
+    /**
+     * 95% confidence interval of estimated instance count.
+     */
+    private long countError;
+
+    /**
+     * 95% confidence interval of estimated heap usage.
+     */
+    private long sizeError;
+
     private Path snapshotFile;
 
     private byte snapShotType;
@@ -194,6 +219,10 @@ public class SnapShotHeader implements Comparable<SnapShotHeader>, Serializable
         metaspaceUsage = 0;
         metaspaceCapacity = 0;
         safepointTime = 0;
+        sampleRate = 100;
+        sampledObjects = 0;
+        countError = 0;
+        sizeError = 0;
         snapShotCache = new SoftReference<>(null);
     }
 
@@ -493,6 +522,78 @@ public class SnapShotHeader implements Comparable<SnapShotHeader>, Serializable
         safepointTime = value;
     }
 
+    /**
+     * Percentage of sampled objects.
+     *
+     * @return Return sampling rate. It is 100 if all objects are counted.
+     */
+    public final long getSampleRate() {
+        return sampleRate;
+    }
+
+    /**
+     * Set percentage of sampled objects.
+     *
+     * @param value sampling rate
+     */
+    public final void setSampleRate(final long value) {
+        sampleRate = value;
+    }
+
+    /**
+     * Number of sampled objects.
+     *
+     * @return Return number of objects which are counted actually.
+     */
+    public final long getSampledObjects() {
+        return sampledObjects;
+    }
+
+    /**
+     * Set number of sampled objects.
+     *
+     * @param value number of sampled objects
+     */
+    public final void setSampledObjects(final long value) {
+        sampledObjects = value;
+    }
+
+    /**
+     * 95% confidence interval of estimated instance count.
+     *
+     * @return Return half width of confidence interval.
+     */
+    public final long getCountError() {
+        return countError;
+    }
+
+    /**
+     * Set 95% confidence interval of estimated instance count.
+     *
+     * @param value half width of confidence interval
+     */
+    public final void setCountError(final long value) {
+        countError = value;
+    }
+
+    /**
+     * 95% confidence interval of estimated heap usage.
+     *
+     * @return Return half width of confidence interval in bytes.
+     */
+    public final long getSizeError() {
+        return sizeError;
+    }
+
+    /**
+     * Set 95% confidence interval of estimated heap usage.
+     *
+     * @param value half width of confidence interval in bytes
+     */
+    public final void setSizeError(final long value) {
+        sizeError = value;
+    }
+
     /**
      * Getter of SnapShot File.
      *
@@ -642,6 +743,12 @@ public class SnapShotHeader implements Comparable<SnapShotHeader>, Serializable
         return (snapShotType & EXTENDED_FORMAT_FLAG_SAFEPOINT_TIME) == EXTENDED_FORMAT_FLAG_SAFEPOINT_TIME;
     }
 
+    public boolean hasSamplingData(){
+        final byte extended_sampled = EXTENDED_FORMAT | EXTENDED_FORMAT_FLAG_SAMPLED;
+
+        return (snapShotType & extended_sampled) == extended_sampled;
+    }
+
     public boolean hasMetaspaceData(){
         return (snapShotType != FILE_FORMAT_1_0);
     }
@@ -685,6 +792,16 @@ public class SnapShotHeader implements Comparable<SnapShotHeader>, Serializable
         buf.append(safepointTime);
         buf.append(" ms");
 
+        if(hasSamplingData()){
+            buf.append(", Sampled ");
+            buf.append(sampleRate);
+            buf.append(" % (+/- ");
+            buf.append(countError);
+            buf.append(" instances, +/- ");
+            buf.append(sizeError);
+            buf.append(" byte)");
+        }
+
         return buf.toString();
     }
 
@@ -282,6 +282,14 @@ public class SnapShotParser {
             header.setSafepointTime(longBuffer.getLong());
         }
 
+        if(header.hasSamplingData()){
+            readLong(ch, 32);
+            header.setSampleRate(longBuffer.getLong());
+            header.setSampledObjects(longBuffer.getLong());
+            header.setCountError(longBuffer.getLong());
+            header.setSizeError(longBuffer.getLong());
+        }
+
         header.setSnapShotHeaderSize(ch.position() - startPos);
 
         return header;
@@ -20,10 +20,17 @@ package jp.co.ntt.oss.heapstats.task;
 
 import java.io.File;
 import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.MappedByteBuffer;
+import java.nio.channels.FileChannel;
+import java.nio.charset.StandardCharsets;
 import java.nio.file.Files;
 import java.nio.file.Path;
 import java.nio.file.Paths;
+import java.nio.file.StandardOpenOption;
 import java.util.ArrayList;
+import java.util.Arrays;
 import java.util.Comparator;
 import java.util.List;
 import java.util.Optional;
@@ -34,7 +41,7 @@ import jp.co.ntt.oss.heapstats.container.log.LogData;
 import jp.co.ntt.oss.heapstats.lambda.ConsumerWrapper;
 
 /**
- * HeapStats log file (CSV) parser.
+ * HeapStats log file (CSV or binary) parser.
  * @author Yasumasa Suenaga
  */
 public class ParseLogFile extends ProgressRunnable{
@@ -47,6 +54,15 @@ public class ParseLogFile extends ProgressRunnable{
     
     private final boolean parseAsPossible;
     
+    /** Magic number of binary resource log. */
+    private static final byte[] BINARY_LOG_MAGIC = "HSRESLOG".getBytes(StandardCharsets.US_ASCII);
+    
+    /** Byte order mark of binary resource log. */
+    private static final int BINARY_LOG_BYTE_ORDER_MARK = 0x01020304;
+    
+    /** Offset of the first column in binary resource log. */
+    private static final int BINARY_LOG_HEADER_SIZE = 4096;
+    
     /**
      * Constructor of LogFileParser.
      * 
@@ -73,6 +89,69 @@ public class ParseLogFile extends ProgressRunnable{
         logEntries.add(element);
     }
     
+    /**
+     * Check whether the log is binary resource log.
+     * 
+     * @param logPath Log to be checked.
+     * @return true if the log starts with magic number of binary log.
+     * @throws IOException 
+     */
+    private boolean isBinaryLog(Path logPath) throws IOException{
+        byte[] magic = new byte[BINARY_LOG_MAGIC.length];
+        
+        try(FileChannel ch = FileChannel.open(logPath, StandardOpenOption.READ)){
+            ByteBuffer buf = ByteBuffer.wrap(magic);
+            while(buf.hasRemaining() && (ch.read(buf) > 0));
+            return !buf.hasRemaining() && Arrays.equals(magic, BINARY_LOG_MAGIC);
+        }
+        
+    }
+    
+    /**
+     * Parse binary resource log.
+     * Records are read from the oldest one in the ring.
+     * 
+     * @param logPath Log to be parsed.
+     * @param progress
+     * @throws IOException 
+     */
+    protected void parseBinary(Path logPath, AtomicLong progress) throws IOException{
+        try(FileChannel ch = FileChannel.open(logPath, StandardOpenOption.READ)){
+            MappedByteBuffer buf = ch.map(FileChannel.MapMode.READ_ONLY, 0, ch.size());
+            
+            buf.order(ByteOrder.BIG_ENDIAN);
+            if(buf.getInt(12) != BINARY_LOG_BYTE_ORDER_MARK){
+                buf.order(ByteOrder.LITTLE_ENDIAN);
+            }
+            
+            int numColumns = buf.getInt(16);
+            long capacity = buf.getLong(24);
+            long count = buf.getLong(32);
+            
+            if((numColumns < 19) || (capacity <= 0) || (count < 0) ||
+               (BINARY_LOG_HEADER_SIZE + numColumns * capacity * 8 > ch.size())){
+                throw new IOException("Binary log is broken: " + logPath.toString());
+            }
+            
+            long recordSize = ch.size() / capacity;
+            long[] columns = new long[numColumns];
+            for(long idx = Math.max(0, count - capacity); idx < count; idx++){
+                long slot = idx % capacity;
+                
+                for(int col = 0; col < numColumns; col++){
+                    columns[col] = buf.getLong((int)(BINARY_LOG_HEADER_SIZE + (col * capacity + slot) * 8));
+                }
+                
+                LogData element = new LogData();
+                element.parseFromColumns(columns);
+                logEntries.add(element);
+                updateProgress.ifPresent(p -> p.accept(progress.addAndGet(recordSize)));
+            }
+            
+        }
+        
+    }
+    
     /**
      * Parse log file.
      * 
@@ -84,6 +163,11 @@ public class ParseLogFile extends ProgressRunnable{
         Path logPath = Paths.get(logfile);
         String logdir =logPath.getParent().toString();
         
+        if(isBinaryLog(logPath)){
+            parseBinary(logPath, progress);
+            return;
+        }
+        
         try(Stream<String> paths = Files.lines(logPath)){
             paths.peek(s -> addEntry(s, logdir))
                  .forEach(s -> updateProgress.ifPresent(p -> p.accept(progress.addAndGet(s.length()))));
@@ -151,7 +151,7 @@ public class HeapStatsUtils {
 
         /* Log file list to parse. */
         if (prop.getProperty("logfile") == null) {
-            prop.setProperty("logfile", "redhat-release,cmdline,status,smaps,limits");
+            prop.setProperty("logfile", "redhat-release,cmdline,status,smaps,smaps_summary.txt,limits");
         }
 
         /* Socket endpoint file to parse. */
@@ -95,6 +95,13 @@ public class HeapStats implements HeapStatsMBean{
    */
   private native boolean invokeAllLogCollection0();
 
+  /**
+   * Get the latest sample of perf counter sampler at libheapstats.
+   *
+   * @return Map of counter name and value.
+   */
+  private native Map<String, Long> getPerfCounterSample0();
+
   /**
    * {@inheritDoc}
    */
@@ -218,6 +225,14 @@ public class HeapStats implements HeapStatsMBean{
     return invokeAllLogCollection0();
   }
 
+  /**
+   * {@inheritDoc}
+   */
+  @Override
+  public Map<String, Long> getPerfCounterSample(){
+    return getPerfCounterSample0();
+  }
+
   /**
    * {@inheritDoc}
    */
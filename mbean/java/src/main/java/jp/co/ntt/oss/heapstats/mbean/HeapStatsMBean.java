@@ -121,6 +121,18 @@ public interface HeapStatsMBean{
    */
   public boolean invokeAllLogCollection();
 
+  /**
+   * Get the latest sample of perf counter sampler.
+   * Key is "time", "allocation_rate" (bytes/sec), "promotion_rate"
+   * (bytes/sec), "safepoint_latency" (usec) or name of counter which is
+   * listed in perf_sampler_counters. Derived value is -1 if it is not
+   * available.
+   * This map is empty if perf_sampler is disabled.
+   *
+   * @return Latest perf counter sample.
+   */
+  public Map<String, Long> getPerfCounterSample();
+
   /**
    * This function is for WildFly/JBoss.
    * @throws java.lang.Exception
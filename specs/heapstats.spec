@@ -21,6 +21,7 @@ BuildRequires: net-snmp-devel >= 5.3
 BuildRequires: java-1.8.0-openjdk-devel
 BuildRequires: binutils >= 2
 BuildRequires: binutils-devel
+BuildRequires: zlib-devel
 BuildRequires: autoconf
 BuildRequires: automake
 BuildRequires: maven
@@ -108,6 +109,8 @@ rm -rf $RPM_BUILD_ROOT
 %dir %{_sysconfdir}/heapstats/iotracer/
 %{_sysconfdir}/heapstats/iotracer/IoTrace.class
 /usr/bin/heapstats-attacher
+/usr/bin/heapstats-livestat
+/usr/bin/heapstats-snapshot
 /usr/libexec/heapstats/heapstats-attacher.jar
 /etc/ld.so.conf.d/heapstats-agent.conf
 /usr/share/snmp/mibs/HeapStatsMibs.txt